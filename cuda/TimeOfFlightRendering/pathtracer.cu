@@ -30,21 +30,26 @@
 #include <optix_math.h>
 #include <optixu/optixu_math_namespace.h>
 #include <optixu/optixu_matrix_namespace.h>
-#include "random.h"
+#include "sampler.h"
+#include "tof_correlation.h"
+#include "light_sampling.h"
+#include "adaptive_sampling.h"
+#include "transient_histogram.h"
+#include "compact_storage.h"
+#include "progressive_accumulation.h"
 #include "helpers.h"
 #include "microfacet.h"
+#include "microfacet_sampling.h"
 
+// Only the buckets of the modulation model the programs were instantiated for are carried along the path
+template <typename Model>
 struct PerRayData_radiance
 {
     float3 result;
-    float2 ir_result_pulse;
-    float4 ir_result_rect;
-    float4 ir_result_sin;
+    tof_buckets<Model, float> ir_result;
 
     float3 radiance;
-    float2 ir_radiance_pulse;
-    float4 ir_radiance_rect;
-    float4 ir_radiance_sin;
+    tof_buckets<Model, float> ir_radiance;
 
     float3 attenuation;
     float ir_attenuation;
@@ -54,7 +59,9 @@ struct PerRayData_radiance
     float3 direction;
 
     float current_index_of_refraction;
-    unsigned int seed;
+    unsigned int pixel_key;
+    unsigned int sample_index;
+    unsigned int dimension;
     int depth;
     int done;
 };
@@ -102,17 +109,63 @@ rtDeclareVariable(unsigned int,  max_depth, , );
 
 rtBuffer<float4, 2> input_rayDirections;
 
+rtBuffer<progressive_pixel, 2>      pixel_accumulation;         // compensated sums of colour and buckets over all passes
+
+// mean of the accumulated passes, only written while the host does not read the compact copies
 rtBuffer<float4, 2> output_buffer;
 rtBuffer<float2, 2> output_buckets_pulse;
 rtBuffer<float4, 2> output_buckets_rect;
 rtBuffer<float4, 2> output_buckets_sin;
 
+rtBuffer<uchar4, 2>                 output_compact_color;
+rtBuffer<unsigned int, 3>           output_compact_buckets;     // words of a pixel are the first dimension
+rtDeclareVariable(unsigned int,     compact_color, , ) = 0;     // 1 writes the colour as 8 bit RGBA
+rtDeclareVariable(unsigned int,     bucket_storage, , ) = 0;    // compact_bucket_format, COMPACT_BUCKETS_FLOAT writes no copy
+rtDeclareVariable(float,            bucket_fixed_scale, , ) = 1048576.0f;
+
+rtBuffer<adaptive_statistics, 2>    pixel_statistics;
+rtBuffer<unsigned int, 1>           unconverged_pixels;     // pixels that need another pass, counted by every launch
+rtDeclareVariable(unsigned int,     adaptive_pass, , ) = 0;     // pass of the current frame, pass 0 renders every pixel
+rtDeclareVariable(float,            depth_error_threshold, , ) = 0.0f;  // standard error of the distance in meters
+rtDeclareVariable(unsigned int,     min_passes, , ) = 4;        // passes a pixel needs before it can stop
+
+// Path length histograms for offline demodulation (transient_histogram.h). Both hold the sum over all samples of the
+// pixel, the number of samples is in pixel_statistics.
+rtBuffer<float, 3>                  output_transient;           // bins are the first dimension, so every pixel is contiguous
+rtBuffer<float, 2>                  output_transient_ambient;   // unmodulated light
+rtDeclareVariable(unsigned int,     transient_bins, , ) = 0;    // 0 disables the histograms
+rtDeclareVariable(float,            transient_bin_width, , ) = 0.04f;  // path length per bin in meters
+
+static __device__ __inline__ void record_transient(float path_length, float intensity)
+{
+    if (transient_bins == 0)
+        return;
+
+    unsigned int bin;
+    float fraction;
+    transient_bin_position(path_length, transient_bin_width, transient_bins, bin, fraction);
+
+    output_transient[make_uint3(bin, launch_index.x, launch_index.y)] += (1.0f - fraction) * intensity;
+    if (fraction > 0.0f)
+        output_transient[make_uint3(bin + 1, launch_index.x, launch_index.y)] += fraction * intensity;
+}
+
+static __device__ __inline__ void record_transient_ambient(float intensity)
+{
+    if (transient_bins == 0)
+        return;
+
+    output_transient_ambient[launch_index] += intensity;
+}
+
 rtDeclareVariable(float3, back_hit_point,   attribute back_hit_point, ); 
 rtDeclareVariable(float3, front_hit_point,  attribute front_hit_point, ); 
 rtDeclareVariable(optix::Ray, ray, rtCurrentRay, );
 
 rtDeclareVariable(float, t_hit, rtIntersectionDistance, );
-rtDeclareVariable(PerRayData_radiance, prd_radiance, rtPayload, );
+rtDeclareVariable(PerRayData_radiance<tof_pulse_model>, prd_radiance_pulse, rtPayload, );
+rtDeclareVariable(PerRayData_radiance<tof_rect_model>, prd_radiance_rect, rtPayload, );
+rtDeclareVariable(PerRayData_radiance<tof_sine_model>, prd_radiance_sin, rtPayload, );
 
 rtDeclareVariable(float3, geometric_normal, attribute geometric_normal, ); 
 rtDeclareVariable(float3, shading_normal, attribute shading_normal, ); 
@@ -121,6 +174,8 @@ rtDeclareVariable(float3, shading_bitangent, attribute shading_bitangent, );
 
 rtBuffer<BasicLight>                 lights;
 rtBuffer<BasicLight>                 ir_lights;
+rtBuffer<light_alias_entry>          ir_light_alias_table;  // selection by power, one entry per ir light
+rtDeclareVariable(unsigned int,      ir_light_samples, , ) = 0;  // ir lights selected per hit, 0 traces every ir light
 
 rtDeclareVariable(unsigned int,      radiance_ray_type, , );
 rtDeclareVariable(unsigned int,      shadow_ray_type, , );
@@ -129,42 +184,118 @@ rtDeclareVariable(rtObject,          top_object, , );
 rtDeclareVariable(rtObject,          top_shadower, , );
 
 rtDeclareVariable(float,  frequency, , );
-const float speedOfLight = 299792458.0f;
 const float smallest_value = 0.0001f; 
 
+//-----------------------------------------------------------------------------
+//
+//  Every program exists once per modulation model (_pulse, _rect, _sin). The
+//  application binds the variants of the model it displays, so a launch only
+//  integrates and carries the buckets of that model.
+//
+//-----------------------------------------------------------------------------
+
+template <typename Model>
+__device__ __inline__ PerRayData_radiance<Model>& current_prd_radiance();
+
+template <>
+__device__ __inline__ PerRayData_radiance<tof_pulse_model>& current_prd_radiance<tof_pulse_model>()
+{
+    return prd_radiance_pulse;
+}
+
+template <>
+__device__ __inline__ PerRayData_radiance<tof_rect_model>& current_prd_radiance<tof_rect_model>()
+{
+    return prd_radiance_rect;
+}
+
+template <>
+__device__ __inline__ PerRayData_radiance<tof_sine_model>& current_prd_radiance<tof_sine_model>()
+{
+    return prd_radiance_sin;
+}
+
+static __device__ __inline__ void write_output_buckets(const tof_buckets<tof_pulse_model, float>& buckets)
+{
+    output_buckets_pulse[launch_index] = make_float2(buckets.value[0], buckets.value[1]);
+}
+
+static __device__ __inline__ void write_output_buckets(const tof_buckets<tof_rect_model, float>& buckets)
+{
+    output_buckets_rect[launch_index] = make_float4(buckets.value[0], buckets.value[1], buckets.value[2], buckets.value[3]);
+}
+
+static __device__ __inline__ void write_output_buckets(const tof_buckets<tof_sine_model, float>& buckets)
+{
+    output_buckets_sin[launch_index] = make_float4(buckets.value[0], buckets.value[1], buckets.value[2], buckets.value[3]);
+}
+
+// Copy of the accumulated pixel in the formats the host reads back
+template <typename Model>
+static __device__ __inline__ void write_compact_output(const float3& color, const tof_buckets<Model, float>& buckets)
+{
+    if (compact_color)
+        output_compact_color[launch_index] = make_uchar4(compact_unorm8(color.x), compact_unorm8(color.y), compact_unorm8(color.z), 255);
+
+    const unsigned int words_per_pixel = compact_words_per_pixel<Model>(bucket_storage);
+    if (words_per_pixel > 0)
+    {
+        unsigned int words[Model::num_buckets];
+        compact_store_buckets<Model>(bucket_storage, bucket_fixed_scale, buckets.value, words);
+        for (unsigned int i = 0; i < words_per_pixel; ++i)
+            output_compact_buckets[make_uint3(i, launch_index.x, launch_index.y)] = words[i];
+    }
+}
+
 //-----------------------------------------------------------------------------
 //
 //  Camera program -- main ray tracing loop
 //
 //-----------------------------------------------------------------------------
 
-RT_PROGRAM void pathtrace_camera()
+template <typename Model>
+static __device__ __inline__ void pathtrace_camera()
 {
     size_t2 screen = output_buffer.size();
 
     float2 inv_screen = 1.0f/make_float2(screen) * 2.f;
     float2 pixel = (make_float2(launch_index)) * inv_screen - 1.f;
 
-    float2 jitter_scale = inv_screen / sqrt_num_samples;
     unsigned int samples_per_pixel = sqrt_num_samples * sqrt_num_samples;
     float3 result = make_float3(0.0f);
-    float2 ir_result_pulse = make_float2(0.0f);
-    float4 ir_result_rect = make_float4(0.0f);
-    float4 ir_result_sin = make_float4(0.0f);
+    tof_buckets<Model, float> ir_result = tof_make_buckets<Model, float>();
 
     size_t2 bufferSize = input_rayDirections.size();
-    unsigned int seed = tea<16>(screen.x * launch_index.y + launch_index.x, frame_number);
+    unsigned int pixel_key = sampler_pixel_key(launch_index.x, launch_index.y);
+
+    // further passes of a frame only render the pixels whose distance has not converged yet
+    adaptive_statistics statistics = pixel_statistics[launch_index];
+    if (frame_number <= 1 && adaptive_pass == 0)
+    {
+        statistics = adaptive_make_statistics();
+
+        for (unsigned int bin = 0; bin < transient_bins; ++bin)
+            output_transient[make_uint3(bin, launch_index.x, launch_index.y)] = 0.0f;
+        if (transient_bins > 0)
+            output_transient_ambient[launch_index] = 0.0f;
+    }
+    else if (adaptive_pass > 0 && adaptive_converged(statistics, depth_error_threshold, min_passes))
+        return;
+
+    // consecutive passes and frames continue the sequence of the pixel
+    unsigned int sample_index = (unsigned int)statistics.samples;
 
     do 
     {
         //
-        // Sample pixel
+        // Sample pixel footprint, a disk with a diameter of one pixel
         //
-        float2 jitter = make_float2(0.0f);
-        do
-        {
-            jitter = make_float2(rnd(seed) - 0.5f, rnd(seed) - 0.5f);
-        } while(sqrt((jitter.x * jitter.x) + (jitter.y * jitter.y)) > 0.5f);
+        float2 u;
+        sample_2d(pixel_key, sample_index, 0, u.x, u.y);
+
+        float2 jitter;
+        concentric_sample_disk(u.x, u.y, jitter.x, jitter.y);
+        jitter = jitter * 0.5f;
 
         float2 d = pixel + (jitter * inv_screen);
 
@@ -173,16 +304,6 @@ RT_PROGRAM void pathtrace_camera()
         if(d.x < -1.0f) d.x = -1.0f;
         if(d.y < -1.0f) d.y = -1.0f;
 
-        //
-        // Sample pixel using jittering
-        //
-        /*
-        unsigned int x = samples_per_pixel % sqrt_num_samples;
-        unsigned int y = samples_per_pixel / sqrt_num_samples;
-        float2 jitter = make_float2(x - rnd(seed), y - rnd(seed));
-        float2 d = pixel + jitter * jitter_scale;
-        */
-
         float2 relativeCoordinate = ((d + 1.0f) / 2.0f);
         float3 calculated_ray = make_float3(input_rayDirections[make_uint2(relativeCoordinate.x * (bufferSize.x - 1), relativeCoordinate.y * (bufferSize.y - 1))]);
 
@@ -190,11 +311,9 @@ RT_PROGRAM void pathtrace_camera()
         float3 ray_direction = normalize(calculated_ray.x*U + calculated_ray.y*V + -calculated_ray.z*W);
 
         // Initialze per-ray data
-        PerRayData_radiance prd;
+        PerRayData_radiance<Model> prd;
         prd.result = make_float3(0.f);
-        prd.ir_result_pulse = make_float2(0.f);
-        prd.ir_result_rect = make_float4(0.f);
-        prd.ir_result_sin = make_float4(0.f);
+        prd.ir_result = tof_make_buckets<Model, float>();
 
         prd.attenuation = make_float3(1.f);
         prd.ir_attenuation = 1.0f;
@@ -202,7 +321,9 @@ RT_PROGRAM void pathtrace_camera()
         prd.ir_traveledDistance = 0.0f;
 
         prd.current_index_of_refraction = 1.00029f; // ior of air
-        prd.seed = seed;
+        prd.pixel_key = pixel_key;
+        prd.sample_index = sample_index;
+        prd.dimension = 1;
         prd.depth = 0;
         prd.done = false;
 
@@ -213,11 +334,16 @@ RT_PROGRAM void pathtrace_camera()
             Ray ray = make_Ray(ray_origin, ray_direction, radiance_ray_type, scene_epsilon, RT_DEFAULT_MAX);
             rtTrace(top_object, ray, prd);
 
+            // the light gathered at this hit was weighted with the throughput up to the hit, russian roulette only
+            // decides about the next segment and must not drop it
+            prd.result += prd.radiance;
+            tof_add_buckets(prd.ir_result, prd.ir_radiance);
+
             // Russian roulette termination 
             if(prd.depth >= rr_begin_depth)
             {
                 float pcont = fmaxf(prd.attenuation);
-                if(rnd(prd.seed) >= pcont)
+                if(sample_1d(prd.pixel_key, prd.sample_index, prd.dimension++) >= pcont)
                     break;
                     
                 prd.ir_attenuation /= prd.ir_attenuation;
@@ -225,10 +351,6 @@ RT_PROGRAM void pathtrace_camera()
             }
 
             prd.depth++;
-            prd.result += prd.radiance;
-            prd.ir_result_pulse += (prd.ir_radiance_pulse);
-            prd.ir_result_rect += (prd.ir_radiance_rect);
-            prd.ir_result_sin += (prd.ir_radiance_sin);
 
             if(prd.done || prd.depth >= max_depth)
             {
@@ -241,43 +363,62 @@ RT_PROGRAM void pathtrace_camera()
         }
 
         result += prd.result;
-        ir_result_pulse += prd.ir_result_pulse;
-        ir_result_rect += prd.ir_result_rect;
-        ir_result_sin += prd.ir_result_sin;
+        tof_add_buckets(ir_result, prd.ir_result);
 
-        seed = prd.seed;
+        sample_index++;
     } while (--samples_per_pixel);
 
     //
     // Update the output buffer
     //
-    float3 pixel_color      = result/(sqrt_num_samples*sqrt_num_samples);
-    float2 ir_buckets_pulse = ir_result_pulse/(sqrt_num_samples*sqrt_num_samples);
-    float4 ir_buckets_rect  = ir_result_rect/(sqrt_num_samples*sqrt_num_samples);
-    float4 ir_buckets_sin   = ir_result_sin/(sqrt_num_samples*sqrt_num_samples);
+    float3 pixel_color = result/(sqrt_num_samples*sqrt_num_samples);
+    tof_scale_buckets(ir_result, 1.0f/(sqrt_num_samples*sqrt_num_samples));
+
+    // pixels have different numbers of samples, the pass is weighted by its number of samples
+    const unsigned int pass_samples = sqrt_num_samples * sqrt_num_samples;
+    const bool first_pass = statistics.samples == 0.0f;
+
+    const tof_modulation<float> modulation = tof_make_modulation(frequency);
+    adaptive_add_pass<Model>(statistics, modulation, tof_distance(modulation, ir_result), pass_samples);
+    pixel_statistics[launch_index] = statistics;
+    if (depth_error_threshold > 0.0f && !adaptive_converged(statistics, depth_error_threshold, min_passes))
+        atomicAdd(&unconverged_pixels[0], 1u);
+
+    float pass_values[7] = { pixel_color.x, pixel_color.y, pixel_color.z, 0.0f, 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < Model::num_buckets; ++i)
+        pass_values[3 + i] = ir_result.value[i];
+
+    progressive_pixel accumulation = first_pass ? progressive_make_sum<7>() : pixel_accumulation[launch_index];
+    progressive_add(accumulation, pass_values, (float)pass_samples);
+    pixel_accumulation[launch_index] = accumulation;
+
+    float mean[7];
+    progressive_mean(accumulation, mean);
+    pixel_color = make_float3(mean[0], mean[1], mean[2]);
+    for (int i = 0; i < Model::num_buckets; ++i)
+        ir_result.value[i] = mean[3 + i];
+
+    if (!compact_color)
+        output_buffer[launch_index] = make_float4(pixel_color, 1.0f);
+    if (bucket_storage == COMPACT_BUCKETS_FLOAT)
+        write_output_buckets(ir_result);
 
-    if (frame_number > 1)
-    {
-        float a = 1.0f / (float)frame_number;
-        float3 old_color = make_float3(output_buffer[launch_index]);
-        output_buffer[launch_index] = make_float4( lerp( old_color, pixel_color, a ), 1.0f);
-        
-        float2 old_ir_buckets_pulse = output_buckets_pulse[launch_index];
-        output_buckets_pulse[launch_index] = lerp( old_ir_buckets_pulse, ir_buckets_pulse, a );
+    write_compact_output(pixel_color, ir_result);
+}
 
-        float4 old_ir_buckets_rect = output_buckets_rect[launch_index];
-        output_buckets_rect[launch_index] = lerp( old_ir_buckets_rect, ir_buckets_rect, a );
-        
-        float4 old_ir_buckets_sin = output_buckets_sin[launch_index];
-        output_buckets_sin[launch_index] = lerp( old_ir_buckets_sin, ir_buckets_sin, a );
-    }
-    else
-    {
-        output_buffer[launch_index] = make_float4(pixel_color, 1.0f);
-        output_buckets_pulse[launch_index] = ir_buckets_pulse;
-        output_buckets_rect[launch_index] = ir_buckets_rect;
-        output_buckets_sin[launch_index] = ir_buckets_sin;
-    }
+RT_PROGRAM void pathtrace_camera_pulse()
+{
+    pathtrace_camera<tof_pulse_model>();
+}
+
+RT_PROGRAM void pathtrace_camera_rect()
+{
+    pathtrace_camera<tof_rect_model>();
+}
+
+RT_PROGRAM void pathtrace_camera_sin()
+{
+    pathtrace_camera<tof_sine_model>();
 }
 
 rtTextureSampler<float4, 2> Kd_map;
@@ -312,11 +453,6 @@ RT_PROGRAM void any_hit_shadow()
     }
 }
 
-float getArea(float amplitude, float frequency, float offset, float from, float to)
-{
-	return ((amplitude * (cosf(2.0f * M_PIf * frequency * from) - cosf(2.0f * M_PIf * frequency * to))) / (2.0f * M_PIf * frequency)) - (offset * from) + (offset * to);
-}
-
 //-----------------------------------------------------------------------------
 //
 //  Cook-Sparrow and Oren-Nayar surface closest-hit
@@ -324,8 +460,12 @@ float getArea(float amplitude, float frequency, float offset, float from, float
 //
 //-----------------------------------------------------------------------------
 
-RT_PROGRAM void microfacet_closest_hit()
+template <typename Model>
+static __device__ __inline__ void microfacet_closest_hit()
 {
+    PerRayData_radiance<Model>& prd_radiance = current_prd_radiance<Model>();
+
+
     float3 world_geometric_normal	= normalize( rtTransformNormal( RT_OBJECT_TO_WORLD, geometric_normal ) );
     float3 world_shading_tangent	= normalize( rtTransformNormal( RT_OBJECT_TO_WORLD, shading_tangent ) );
     float3 world_shading_bitangent	= normalize( rtTransformNormal( RT_OBJECT_TO_WORLD, shading_bitangent ) );
@@ -368,9 +508,7 @@ RT_PROGRAM void microfacet_closest_hit()
         prd_radiance.direction = ray.direction;
 
         prd_radiance.radiance = make_float3(0.0f);
-        prd_radiance.ir_radiance_pulse = make_float2(0.0f);
-        prd_radiance.ir_radiance_rect = make_float4(0.0f);
-        prd_radiance.ir_radiance_sin = make_float4(0.0f);
+        prd_radiance.ir_radiance = tof_make_buckets<Model, float>();
         return;
     }
     
@@ -384,9 +522,7 @@ RT_PROGRAM void microfacet_closest_hit()
     // Next event estimation (compute direct lighting).
     //
     float3 result = make_float3(0.0f);
-    float2 ir_result_pulse = make_float2(0.0f);
-    float4 ir_result_rect = make_float4(0.0f);
-    float4 ir_result_sin = make_float4(0.0f);
+    tof_buckets<Model, float> ir_result = tof_make_buckets<Model, float>();
     
     unsigned int num_lights = lights.size();
     for(int i = 0; i < num_lights; ++i)
@@ -433,21 +569,30 @@ RT_PROGRAM void microfacet_closest_hit()
                 float3 temp = prd_radiance.attenuation * (diffuse + specular) * (light.color * light.intensity * (NdotL / LightdistPow2));
                 result += temp;
 
-                float ir_radiance = luminanceCIE(temp) * 0.5f;
-                ir_result_pulse += make_float2(ir_radiance, ir_radiance);
-                ir_result_sin += make_float4(ir_radiance, ir_radiance, ir_radiance, ir_radiance);
-                ir_radiance = ir_radiance * 0.5f;
-                ir_result_rect += make_float4(ir_radiance, ir_radiance, ir_radiance, ir_radiance);
+                tof_accumulate_ambient(luminanceCIE(temp), ir_result);
+                record_transient_ambient(luminanceCIE(temp));
             }
         }
     }
     
-    const double pulselength = (1.0f / frequency) * 0.5f;
+    const tof_modulation<float> modulation = tof_make_modulation(frequency);
     
     unsigned int num_ir_lights = ir_lights.size();
-    for(int i = 0; i < num_ir_lights; ++i)
+    unsigned int num_ir_light_samples = ir_light_samples > 0 ? ir_light_samples : num_ir_lights;
+    for(int i = 0; i < num_ir_light_samples; ++i)
     {
-        BasicLight light = ir_lights[i];
+        unsigned int light_index = i;
+        float light_weight = 1.0f;
+        if(ir_light_samples > 0)
+        {
+            // one shadow ray per selected light instead of one per light, weighted by the selection pdf
+            float remainder;
+            unsigned int slot = light_alias_slot(num_ir_lights, sample_1d(prd_radiance.pixel_key, prd_radiance.sample_index, prd_radiance.dimension++), remainder);
+            light_index = light_alias_select(ir_light_alias_table[slot], slot, remainder);
+            light_weight = 1.0f / (ir_light_alias_table[light_index].pdf * num_ir_light_samples);
+        }
+
+        BasicLight light = ir_lights[light_index];
         float3 lightDir = light.pos - hit_point;
         const float LightdistPow2 = dot(lightDir, lightDir);
         const float Lightdist = sqrt(LightdistPow2);
@@ -484,131 +629,77 @@ RT_PROGRAM void microfacet_closest_hit()
                 
                 float3 ir_specular = TorranceSparrow_f(Kn_val, -ray.direction, lightDir, fresnel, roughness);
         
-                float Intensity = prd_radiance.ir_attenuation * luminanceCIE((ir_diffuse + ir_specular) * (light.color * light.intensity * (NdotL / LightdistPow2)));
+                float Intensity = light_weight * prd_radiance.ir_attenuation * luminanceCIE((ir_diffuse + ir_specular) * (light.color * light.intensity * (NdotL / LightdistPow2)));
 
                 // IR Calculations
                 float sourceToSensorDistance = Lightdist + prd_radiance.ir_traveledDistance;
-                float deltaTime = sourceToSensorDistance / speedOfLight;
+                float deltaTime = tof_travel_time(sourceToSensorDistance);
 
-                float C1_start = 0.0f;
-                float C2_start = pulselength;
-
-                float C3_start = pulselength * 0.5f;
-                float C4_start = (pulselength * 0.5f) + pulselength;
-                
-                // ==================================================
-                // Lichtpuls
-                {
-                    float begin = deltaTime;
-                    float end = deltaTime + pulselength;
-
-                    if((end >= C1_start && end <= C1_start + pulselength) || (begin >= C1_start && begin <= C1_start + pulselength))
-                    {
-                        if(begin > C1_start)
-                            ir_result_pulse.x += (((C1_start + pulselength) - begin) / pulselength) * Intensity;
-                        else
-                            ir_result_pulse.x += ((end - C1_start) / pulselength) * Intensity;
-                    }
-                    
-                    if((end >= C2_start && end <= C2_start + pulselength) || (begin >= C2_start && begin <= C2_start + pulselength))
-                    {
-                        if(begin > C2_start)
-                            ir_result_pulse.y += (((C2_start + pulselength) - begin) / pulselength) * Intensity;
-                        else
-                            ir_result_pulse.y += ((end - C2_start) / pulselength) * Intensity;
-                    }
-                }
-
-                // ==================================================
-                // Sinus Welle
-                ir_result_sin.x += Intensity * getArea(frequency, frequency, frequency, C1_start - deltaTime, (C1_start - deltaTime) + pulselength);
-                ir_result_sin.y += Intensity * getArea(frequency, frequency, frequency, C2_start - deltaTime, (C2_start - deltaTime) + pulselength);
-                ir_result_sin.z += Intensity * getArea(frequency, frequency, frequency, C3_start - deltaTime, (C3_start - deltaTime) + pulselength);
-                ir_result_sin.w += Intensity * getArea(frequency, frequency, frequency, C4_start - deltaTime, (C4_start - deltaTime) + pulselength);
-
-                // ==================================================
-                // Rechteck Welle
-                while(deltaTime < C4_start + pulselength)
-                {
-                    deltaTime = deltaTime + (pulselength * 2.0);
-                }
-                
-                while(deltaTime + pulselength > 0.0f)
-                {
-                    float begin = deltaTime;
-                    float end = deltaTime + pulselength;
-
-                    if((end >= C1_start && end <= C1_start + pulselength) || (begin >= C1_start && begin <= C1_start + pulselength))
-                    {
-                        if(begin > C1_start)
-                            ir_result_rect.x += (((C1_start + pulselength) - begin) / pulselength) * Intensity;
-                        else
-                            ir_result_rect.x += ((end - C1_start) / pulselength) * Intensity;
-                    }
-                    
-                    if((end >= C2_start && end <= C2_start + pulselength) || (begin >= C2_start && begin <= C2_start + pulselength))
-                    {
-                        if(begin > C2_start)
-                            ir_result_rect.y += (((C2_start + pulselength) - begin) / pulselength) * Intensity;
-                        else
-                            ir_result_rect.y += ((end - C2_start) / pulselength) * Intensity;
-                    }
-
-                    if((end >= C3_start && end <= C3_start + pulselength) || (begin >= C3_start && begin <= C3_start + pulselength))
-                    {
-                        if(begin > C3_start)
-                            ir_result_rect.z += (((C3_start + pulselength) - begin) / pulselength) * Intensity;
-                        else
-                            ir_result_rect.z += ((end - C3_start) / pulselength) * Intensity;
-                    }
-                    
-                    if((end >= C4_start && end <= C4_start + pulselength) || (begin >= C4_start && begin <= C4_start + pulselength))
-                    {
-                        if(begin > C4_start)
-                            ir_result_rect.w += (((C4_start + pulselength) - begin) / pulselength) * Intensity;
-                        else
-                            ir_result_rect.w += ((end - C4_start) / pulselength) * Intensity;
-                    }
-
-                    deltaTime = deltaTime - (pulselength * 2.0);
-                }
+                tof_accumulate(modulation, deltaTime, Intensity, ir_result);
+                record_transient(sourceToSensorDistance, Intensity);
             }
         }
     }
     
-    prd_radiance.ir_radiance_pulse = ir_result_pulse;
-    prd_radiance.ir_radiance_rect = ir_result_rect;
-    prd_radiance.ir_radiance_sin = ir_result_sin;
-    prd_radiance.radiance = result;
-
     if(Ke_val.x > 0.0f || Ke_val.y > 0.0f || Ke_val.z > 0.0f)
     {
-        float intensity = luminanceCIE(Ke_val) * 0.5f;
-        prd_radiance.ir_radiance_pulse += prd_radiance.ir_attenuation * make_float2(intensity, intensity);
-        prd_radiance.ir_radiance_sin += prd_radiance.ir_attenuation * make_float4(intensity, intensity, intensity, intensity);
-        intensity = intensity * 0.5f;
-        prd_radiance.ir_radiance_rect += prd_radiance.ir_attenuation * make_float4(intensity, intensity, intensity, intensity);
-        prd_radiance.radiance += prd_radiance.attenuation * Ke_val;
+        tof_accumulate_ambient(prd_radiance.ir_attenuation * luminanceCIE(Ke_val), ir_result);
+        record_transient_ambient(prd_radiance.ir_attenuation * luminanceCIE(Ke_val));
+        result += prd_radiance.attenuation * Ke_val;
     }
+
+    prd_radiance.ir_radiance = ir_result;
+    prd_radiance.radiance = result;
     
     //
     // Generate a reflection ray.  This will be traced back in ray-gen.
     //
     prd_radiance.origin = hit_point;
 
-    float3 p;
-
     optix::Onb onb( Kn_val );
-    float z1=rnd(prd_radiance.seed);
-    float z2=rnd(prd_radiance.seed);
-    //random_sample_hemisphere(z1, z2, p);
-    cosine_sample_hemisphere(z1, z2, p);
+    const float3 view_dir = -ray.direction;
+    const float wo[3] = { dot(view_dir, onb.m_tangent), dot(view_dir, onb.m_binormal), dot(view_dir, onb.m_normal) };
+
+    // The specular lobe is sampled from the visible normals of the Beckmann distribution used by TorranceSparrow_f,
+    // the diffuse lobe from the cosine. The lobe is picked by the share of light the specular part reflects,
+    // clamped so both lobes stay reachable.
+    const float alpha = RoughnessToAlpha(roughness);
+    float specular_probability = 0.0f;
+    if(wo[2] > 0.0f)
+    {
+        if(metallic >= 0.99f)
+            specular_probability = 1.0f;
+        else
+            specular_probability = clamp(lerp(FrDielectric(wo[2], prd_radiance.current_index_of_refraction, index_of_refraction), 1.0f, metallic), 0.25f, 0.75f);
+    }
+
+    const float lobe = sample_1d(prd_radiance.pixel_key, prd_radiance.sample_index, prd_radiance.dimension++);
+    float z1, z2;
+    sample_2d(prd_radiance.pixel_key, prd_radiance.sample_index, prd_radiance.dimension++, z1, z2);
+
+    float3 p;
+    if(lobe < specular_probability)
+    {
+        float sampled[3];
+        float sampled_pdf;
+        microfacet_sample<microfacet_beckmann>(wo, alpha, alpha, z1, z2, sampled, sampled_pdf);
+        p = make_float3(sampled[0], sampled[1], sampled[2]);
+    }
+    else
+    {
+        cosine_sample_hemisphere(z1, z2, p);
+    }
 
     onb.inverse_transform(p);    
     prd_radiance.direction = normalize(p);
+
+    // One sample MIS of both lobes with the balance heuristic: the sample is weighted by the density of the mixture.
+    // The lights are points, so next event estimation above keeps its full weight.
+    const float wi[3] = { dot(prd_radiance.direction, onb.m_tangent), dot(prd_radiance.direction, onb.m_binormal), dot(prd_radiance.direction, onb.m_normal) };
+    const float pdf = (specular_probability * microfacet_pdf<microfacet_beckmann>(wo, wi, alpha, alpha)) + ((1.0f - specular_probability) * cosine_hemisphere_pdf(wi));
         
     const float NdotL = saturate(dot(Kn_val, prd_radiance.direction));
-    if (NdotL > smallest_value)
+    if (NdotL > smallest_value && pdf > 0.0f)
     {
         float3 fresnel;
         float3 diffuse;
@@ -643,10 +734,11 @@ RT_PROGRAM void microfacet_closest_hit()
             specular = TorranceSparrow_f(Kn_val, -ray.direction, prd_radiance.direction, fresnel, roughness);
         }
         
-        prd_radiance.attenuation = (diffuse + specular) * prd_radiance.attenuation * M_PIf;
+        const float weight = NdotL / pdf;
+        prd_radiance.attenuation = (diffuse + specular) * prd_radiance.attenuation * weight;
 
         float3 ir_specular = specular;
-        prd_radiance.ir_attenuation = luminanceCIE(diffuse + ir_specular) * prd_radiance.ir_attenuation * M_PIf;
+        prd_radiance.ir_attenuation = luminanceCIE(diffuse + ir_specular) * prd_radiance.ir_attenuation * weight;
     }
     else
     {
@@ -655,6 +747,21 @@ RT_PROGRAM void microfacet_closest_hit()
     }
 }
 
+RT_PROGRAM void microfacet_closest_hit_pulse()
+{
+    microfacet_closest_hit<tof_pulse_model>();
+}
+
+RT_PROGRAM void microfacet_closest_hit_rect()
+{
+    microfacet_closest_hit<tof_rect_model>();
+}
+
+RT_PROGRAM void microfacet_closest_hit_sin()
+{
+    microfacet_closest_hit<tof_sine_model>();
+}
+
 //-----------------------------------------------------------------------------
 //
 //  Exception program
@@ -674,35 +781,69 @@ RT_PROGRAM void exception()
 //
 //-----------------------------------------------------------------------------
 
-RT_PROGRAM void miss()
+template <typename Model>
+static __device__ __inline__ void miss()
 {
-    float intensity = luminanceCIE(bg_color) * 0.5f;
-    prd_radiance.ir_radiance_pulse = prd_radiance.ir_attenuation * make_float2(intensity, intensity);
-    prd_radiance.ir_radiance_sin = prd_radiance.ir_attenuation * make_float4(intensity, intensity, intensity, intensity);
-    intensity = intensity * 0.5f;
-    prd_radiance.ir_radiance_rect = prd_radiance.ir_attenuation * make_float4(intensity, intensity, intensity, intensity);
+    PerRayData_radiance<Model>& prd_radiance = current_prd_radiance<Model>();
+
+    prd_radiance.ir_radiance = tof_make_buckets<Model, float>();
+    tof_accumulate_ambient(prd_radiance.ir_attenuation * luminanceCIE(bg_color), prd_radiance.ir_radiance);
+    record_transient_ambient(prd_radiance.ir_attenuation * luminanceCIE(bg_color));
 
     prd_radiance.radiance = prd_radiance.attenuation * bg_color;
     prd_radiance.done = true;
 }
 
+RT_PROGRAM void miss_pulse()
+{
+    miss<tof_pulse_model>();
+}
+
+RT_PROGRAM void miss_rect()
+{
+    miss<tof_rect_model>();
+}
+
+RT_PROGRAM void miss_sin()
+{
+    miss<tof_sine_model>();
+}
+
 //
 // Environment map background
 //
 rtTextureSampler<float4, 2> envmap;
-RT_PROGRAM void envmap_miss()
+
+template <typename Model>
+static __device__ __inline__ void envmap_miss()
 {
+    PerRayData_radiance<Model>& prd_radiance = current_prd_radiance<Model>();
+
     float theta = atan2f( ray.direction.x, ray.direction.z );
     float phi   = M_PIf * 0.5f -  acosf( ray.direction.y );
     float u     = (theta + M_PIf) * (0.5f * M_1_PIf);
     float v     = 0.5f * ( 1.0f + sinf(phi) );
 
-    float intensity = luminanceCIE(make_float3( tex2D(envmap, u, v) )) * 0.5f;
-    prd_radiance.ir_radiance_pulse = prd_radiance.ir_attenuation * make_float2(intensity, intensity);
-    prd_radiance.ir_radiance_sin = prd_radiance.ir_attenuation * make_float4(intensity, intensity, intensity, intensity);
-    intensity = intensity * 0.5f;
-    prd_radiance.ir_radiance_rect = prd_radiance.ir_attenuation * make_float4(intensity, intensity, intensity, intensity);
+    const float3 envmap_color = make_float3( tex2D(envmap, u, v) );
+    prd_radiance.ir_radiance = tof_make_buckets<Model, float>();
+    tof_accumulate_ambient(prd_radiance.ir_attenuation * luminanceCIE(envmap_color), prd_radiance.ir_radiance);
+    record_transient_ambient(prd_radiance.ir_attenuation * luminanceCIE(envmap_color));
 
-    prd_radiance.radiance = prd_radiance.attenuation * make_float3( tex2D(envmap, u, v) );
+    prd_radiance.radiance = prd_radiance.attenuation * envmap_color;
     prd_radiance.done = true;
 }
+
+RT_PROGRAM void envmap_miss_pulse()
+{
+    envmap_miss<tof_pulse_model>();
+}
+
+RT_PROGRAM void envmap_miss_rect()
+{
+    envmap_miss<tof_rect_model>();
+}
+
+RT_PROGRAM void envmap_miss_sin()
+{
+    envmap_miss<tof_sine_model>();
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+//
+// Per-pixel convergence tracking for adaptive sample passes, shared by the OptiX programs and host code.
+//
+// Every pass renders the same number of samples for a pixel. The distance demodulated from the buckets of each
+// pass is added to a running mean and variance (Welford), differences are wrapped by the modulation model, so
+// phase wrapping at the end of the ambiguity range does not look like noise. The standard error of the mean
+// distance decides whether a pixel needs another pass.
+//
+
+#include "tof_correlation.h"
+
+#if defined(__CUDACC__)
+#define ADAPTIVE_HOSTDEVICE __host__ __device__ __inline__
+#else
+#define ADAPTIVE_HOSTDEVICE inline
+#endif
+
+struct adaptive_statistics
+{
+    float samples;          // samples accumulated by the pixel since the last reset
+    float passes;
+    float mean_distance;    // mean of the pass distances
+    float m2;               // sum of squared differences from the mean
+};
+
+static ADAPTIVE_HOSTDEVICE adaptive_statistics adaptive_make_statistics()
+{
+    adaptive_statistics statistics;
+    statistics.samples = 0.0f;
+    statistics.passes = 0.0f;
+    statistics.mean_distance = 0.0f;
+    statistics.m2 = 0.0f;
+    return statistics;
+}
+
+template <typename Model>
+static ADAPTIVE_HOSTDEVICE void adaptive_add_pass(adaptive_statistics& statistics, const tof_modulation<float>& modulation, float distance, unsigned int samples)
+{
+    statistics.samples += (float)samples;
+    statistics.passes += 1.0f;
+
+    const float delta = tof_distance_difference<Model>(modulation, distance, statistics.mean_distance);
+    statistics.mean_distance += delta / statistics.passes;
+    statistics.m2 += delta * tof_distance_difference<Model>(modulation, distance, statistics.mean_distance);
+}
+
+// Standard error of the mean distance, infinite until two passes are known
+static ADAPTIVE_HOSTDEVICE float adaptive_standard_error(const adaptive_statistics& statistics)
+{
+    if (statistics.passes < 2.0f)
+        return 1e30f;
+
+    const float variance = statistics.m2 / (statistics.passes - 1.0f);
+    return sqrtf(variance / statistics.passes);
+}
+
+// The variance of a few passes is too noisy to stop on, pixels that happen to look smooth early would stop
+// with a larger error than the threshold
+static ADAPTIVE_HOSTDEVICE bool adaptive_converged(const adaptive_statistics& statistics, float standard_error_threshold, unsigned int min_passes)
+{
+    return statistics.passes >= (float)min_passes && adaptive_standard_error(statistics) <= standard_error_threshold;
+}
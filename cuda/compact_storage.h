@@ -0,0 +1,106 @@
+#pragma once
+
+//
+// Compact readback formats of the renderer output, shared by the OptiX programs and host code.
+//
+// Colour and buckets are accumulated on the device (see progressive_accumulation.h). The host maps the mean of
+// every pixel in a compact format every frame, which is written by the launch next to the accumulation:
+//
+//  - COMPACT_BUCKETS_FLOAT: no copy, the host maps float output buffers
+//  - COMPACT_BUCKETS_HALF:  IEEE half floats (half_float.h), two buckets per word, relative error of a bucket below 2^-11
+//  - COMPACT_BUCKETS_FIXED: unsigned fixed point, bucket * scale rounded to an integer, absolute error 0.5 / scale
+//
+// Colour is stored as 8 bit RGBA. The buckets of a pixel are contiguous, words_per_pixel words each.
+//
+
+#include "half_float.h"
+#include "tof_correlation.h"
+
+#if defined(__CUDACC__)
+#define COMPACT_HOSTDEVICE __host__ __device__ __inline__
+#else
+#define COMPACT_HOSTDEVICE inline
+#endif
+
+enum compact_bucket_format
+{
+    COMPACT_BUCKETS_FLOAT = 0,
+    COMPACT_BUCKETS_HALF = 1,
+    COMPACT_BUCKETS_FIXED = 2
+};
+
+// Scale of the fixed point buckets used by the renderer, buckets up to 4096 in steps of 2^-20
+static COMPACT_HOSTDEVICE float compact_default_fixed_scale()
+{
+    return 1048576.0f;
+}
+
+// Buckets are never negative, values beyond the range are clamped
+static COMPACT_HOSTDEVICE unsigned int compact_float_to_fixed(float value, float scale)
+{
+    const float scaled = value * scale + 0.5f;
+    if (!(scaled > 0.0f))
+        return 0u;
+    if (scaled >= 4294967296.0f)
+        return 0xffffffffu;
+    return (unsigned int)scaled;
+}
+
+static COMPACT_HOSTDEVICE float compact_fixed_to_float(unsigned int value, float scale)
+{
+    return (float)value / scale;
+}
+
+// 0 for COMPACT_BUCKETS_FLOAT, there is no compact copy
+template <typename Model>
+static COMPACT_HOSTDEVICE unsigned int compact_words_per_pixel(unsigned int format)
+{
+    if (format == COMPACT_BUCKETS_HALF)
+        return (Model::num_buckets + 1) / 2;
+    if (format == COMPACT_BUCKETS_FIXED)
+        return Model::num_buckets;
+    return 0;
+}
+
+template <typename Model>
+static COMPACT_HOSTDEVICE void compact_store_buckets(unsigned int format, float fixed_scale, const float* buckets, unsigned int* words)
+{
+    if (format == COMPACT_BUCKETS_HALF)
+    {
+        for (int i = 0; i < Model::num_buckets; i += 2)
+        {
+            const unsigned int high = i + 1 < Model::num_buckets ? float_to_half(buckets[i + 1]) : 0u;
+            words[i / 2] = float_to_half(buckets[i]) | (high << 16);
+        }
+    }
+    else if (format == COMPACT_BUCKETS_FIXED)
+    {
+        for (int i = 0; i < Model::num_buckets; ++i)
+            words[i] = compact_float_to_fixed(buckets[i], fixed_scale);
+    }
+}
+
+template <typename Model>
+static COMPACT_HOSTDEVICE void compact_load_buckets(unsigned int format, float fixed_scale, const unsigned int* words, float* buckets)
+{
+    if (format == COMPACT_BUCKETS_HALF)
+    {
+        for (int i = 0; i < Model::num_buckets; ++i)
+            buckets[i] = half_to_float((unsigned short)(words[i / 2] >> ((i & 1) * 16)));
+    }
+    else if (format == COMPACT_BUCKETS_FIXED)
+    {
+        for (int i = 0; i < Model::num_buckets; ++i)
+            buckets[i] = compact_fixed_to_float(words[i], fixed_scale);
+    }
+}
+
+// Colour channel in [0, 1] to 8 bit, rounded
+static COMPACT_HOSTDEVICE unsigned char compact_unorm8(float value)
+{
+    if (!(value > 0.0f))
+        return 0;
+    if (value >= 1.0f)
+        return 255;
+    return (unsigned char)(value * 255.0f + 0.5f);
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+//
+// IEEE half floats, shared by the OptiX programs and host code.
+//
+// Used for the compact readback of the renderer (compact_storage.h) and the BTH1 transient histogram files of
+// the Resources library, so both write the same bits for the same values.
+//
+
+#if !defined(__CUDA_ARCH__)
+#include <string.h>
+#endif
+
+#if defined(__CUDACC__)
+#define HALF_HOSTDEVICE __host__ __device__ __inline__
+#else
+#define HALF_HOSTDEVICE inline
+#endif
+
+static HALF_HOSTDEVICE unsigned int half_float_as_uint(float value)
+{
+#if defined(__CUDA_ARCH__)
+    return __float_as_uint(value);
+#else
+    unsigned int bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+#endif
+}
+
+static HALF_HOSTDEVICE float half_uint_as_float(unsigned int bits)
+{
+#if defined(__CUDA_ARCH__)
+    return __uint_as_float(bits);
+#else
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+#endif
+}
+
+// Rounds to nearest even, values beyond the half range become infinity
+static HALF_HOSTDEVICE unsigned short float_to_half(float value)
+{
+    unsigned int bits = half_float_as_uint(value);
+    const unsigned int sign = (bits >> 16) & 0x8000u;
+    bits &= 0x7fffffffu;
+
+    // nan stays nan, infinity and everything that rounds to 65520 or more is infinity
+    if (bits > 0x7f800000u)
+        return (unsigned short)(sign | 0x7e00u);
+    if (bits >= 0x477ff000u)
+        return (unsigned short)(sign | 0x7c00u);
+
+    // below the smallest normal half the value is a multiple of 2^-24
+    if (bits < 0x38800000u)
+    {
+        if (bits < 0x33000000u)
+            return (unsigned short)sign;
+
+        const unsigned int shift = 126u - (bits >> 23);
+        const unsigned int mantissa = (bits & 0x7fffffu) | 0x800000u;
+        unsigned int half = mantissa >> shift;
+        const unsigned int remainder = mantissa & ((1u << shift) - 1u);
+        const unsigned int halfway = 1u << (shift - 1u);
+        if (remainder > halfway || (remainder == halfway && (half & 1u)))
+            half++;
+        return (unsigned short)(sign | half);
+    }
+
+    // rebias the exponent, a carry of the rounding moves into the exponent
+    unsigned int half = (bits >> 13) - (112u << 10);
+    const unsigned int remainder = bits & 0x1fffu;
+    if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1u)))
+        half++;
+    return (unsigned short)(sign | half);
+}
+
+static HALF_HOSTDEVICE float half_to_float(unsigned short half)
+{
+    const unsigned int sign = ((unsigned int)half & 0x8000u) << 16;
+    const unsigned int exponent = ((unsigned int)half >> 10) & 0x1fu;
+    const unsigned int mantissa = (unsigned int)half & 0x3ffu;
+
+    if (exponent == 0)
+    {
+        const float value = (float)mantissa * 5.9604644775390625e-8f;
+        return sign ? -value : value;
+    }
+    if (exponent == 31)
+        return half_uint_as_float(sign | 0x7f800000u | (mantissa << 13));
+    return half_uint_as_float(sign | ((exponent + 112u) << 23) | (mantissa << 13));
+}
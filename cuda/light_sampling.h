@@ -0,0 +1,268 @@
+#pragma once
+
+//
+// Light selection for scenes with many emitters, shared by the OptiX programs and host code.
+//
+//  - light_alias_entry: alias table over the emitted power (Vose), O(1) selection independent of the shading point.
+//    Fits arrays of similar LEDs where the power is the only useful importance.
+//  - light_bvh_node: binary tree over the light positions with the power and bounds of every subtree. The selection
+//    descends with probabilities proportional to power / squared distance of the children, so lights close to
+//    the shading point are preferred. Fits large boards where the distance varies a lot between the emitters.
+//
+// Both return the index of the selected light and its probability, the contribution of the light has to be divided
+// by this pdf. Tables and trees are built on the host (the build functions are not available to nvcc/nvrtc) and
+// sampled on either side.
+//
+
+#include <math.h>
+
+#if defined(__CUDACC__)
+#define LIGHT_SAMPLING_HOSTDEVICE __host__ __device__ __inline__
+#else
+#define LIGHT_SAMPLING_HOSTDEVICE inline
+#endif
+
+struct light_alias_entry
+{
+    float probability;      // probability to keep this entry instead of jumping to alias
+    unsigned int alias;
+    float pdf;              // probability that this light is selected
+};
+
+struct light_bvh_node
+{
+    float bounds_min[3];
+    float bounds_max[3];
+    float power;
+    unsigned int light_index;   // light of a leaf
+    unsigned int second_child;  // the first child directly follows its parent, 0 marks a leaf
+    unsigned int first;         // range of leaves below this node in depth first order
+    unsigned int count;
+};
+
+// Table slot for u in [0, 1), remainder is the position inside the slot
+static LIGHT_SAMPLING_HOSTDEVICE unsigned int light_alias_slot(unsigned int count, float u, float& remainder)
+{
+    const float scaled = u * (float)count;
+    unsigned int slot = (unsigned int)scaled;
+    if (slot >= count)
+        slot = count - 1;
+
+    remainder = scaled - (float)slot;
+    return slot;
+}
+
+static LIGHT_SAMPLING_HOSTDEVICE unsigned int light_alias_select(const light_alias_entry& entry, unsigned int slot, float remainder)
+{
+    return remainder < entry.probability ? slot : entry.alias;
+}
+
+// Selects a light with probability pdf[i] = power[i] / sum(power) for u in [0, 1).
+// Device code that reads the table from an rtBuffer calls light_alias_slot and light_alias_select directly.
+static LIGHT_SAMPLING_HOSTDEVICE unsigned int light_alias_sample(const light_alias_entry* table, unsigned int count, float u, float& pdf)
+{
+    float remainder;
+    const unsigned int slot = light_alias_slot(count, u, remainder);
+    const unsigned int index = light_alias_select(table[slot], slot, remainder);
+
+    pdf = table[index].pdf;
+    return index;
+}
+
+// Importance of all lights below a node for a shading point, the distance is clamped to the extent of the node
+// so the lights of a subtree that contains the point are not weighted to infinity.
+static LIGHT_SAMPLING_HOSTDEVICE float light_bvh_importance(const light_bvh_node& node, const float* point)
+{
+    float distance_pow2 = 0.0f;
+    float extent_pow2 = 0.0f;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        const float center = 0.5f * (node.bounds_min[axis] + node.bounds_max[axis]);
+        const float half_extent = 0.5f * (node.bounds_max[axis] - node.bounds_min[axis]);
+        distance_pow2 += (point[axis] - center) * (point[axis] - center);
+        extent_pow2 += half_extent * half_extent;
+    }
+
+    const float min_distance_pow2 = 1e-6f;
+    distance_pow2 = distance_pow2 > extent_pow2 ? distance_pow2 : extent_pow2;
+    distance_pow2 = distance_pow2 > min_distance_pow2 ? distance_pow2 : min_distance_pow2;
+    return node.power / distance_pow2;
+}
+
+// probability to descend into the first child of node
+static LIGHT_SAMPLING_HOSTDEVICE float light_bvh_first_child_probability(const light_bvh_node* nodes, unsigned int node, const float* point)
+{
+    const float first = light_bvh_importance(nodes[node + 1], point);
+    const float second = light_bvh_importance(nodes[nodes[node].second_child], point);
+    if (first + second <= 0.0f)
+        return 0.5f;
+    return first / (first + second);
+}
+
+static LIGHT_SAMPLING_HOSTDEVICE unsigned int light_bvh_sample(const light_bvh_node* nodes, const float* point, float u, float& pdf)
+{
+    unsigned int node = 0;
+    pdf = 1.0f;
+    while (nodes[node].second_child != 0)
+    {
+        const float p = light_bvh_first_child_probability(nodes, node, point);
+
+        // the remaining part of u is reused for the next level
+        if (u < p)
+        {
+            u = u / p;
+            pdf *= p;
+            node = node + 1;
+        }
+        else
+        {
+            u = (u - p) / (1.0f - p);
+            pdf *= 1.0f - p;
+            node = nodes[node].second_child;
+        }
+        u = u < 0.99999994f ? u : 0.99999994f;
+    }
+    return nodes[node].light_index;
+}
+
+// Probability of light_bvh_sample to select the leaf at position leaf (depth first order) for the shading point
+static LIGHT_SAMPLING_HOSTDEVICE float light_bvh_pdf(const light_bvh_node* nodes, const float* point, unsigned int leaf)
+{
+    unsigned int node = 0;
+    float pdf = 1.0f;
+    while (nodes[node].second_child != 0)
+    {
+        const float p = light_bvh_first_child_probability(nodes, node, point);
+        const light_bvh_node& first_child = nodes[node + 1];
+        if (leaf < first_child.first + first_child.count)
+        {
+            pdf *= p;
+            node = node + 1;
+        }
+        else
+        {
+            pdf *= 1.0f - p;
+            node = nodes[node].second_child;
+        }
+    }
+    return pdf;
+}
+
+#if !defined(__CUDACC__)
+
+#include <algorithm>
+#include <vector>
+
+// Vose's alias method, table needs count entries
+static inline void light_alias_build(const float* power, unsigned int count, light_alias_entry* table)
+{
+    if (count == 0)
+        return;
+
+    double sum = 0.0;
+    for (unsigned int i = 0; i < count; ++i)
+        sum += power[i] > 0.0f ? power[i] : 0.0f;
+
+    std::vector<double> scaled(count);
+    std::vector<unsigned int> small, large;
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        const double p = sum > 0.0 ? (power[i] > 0.0f ? power[i] : 0.0f) / sum : 1.0 / count;
+        table[i].pdf = (float)p;
+        table[i].alias = i;
+        scaled[i] = p * count;
+        if (scaled[i] < 1.0)
+            small.push_back(i);
+        else
+            large.push_back(i);
+    }
+
+    while (!small.empty() && !large.empty())
+    {
+        const unsigned int less = small.back();
+        small.pop_back();
+        const unsigned int more = large.back();
+
+        table[less].probability = (float)scaled[less];
+        table[less].alias = more;
+
+        scaled[more] = (scaled[more] + scaled[less]) - 1.0;
+        if (scaled[more] < 1.0)
+        {
+            large.pop_back();
+            small.push_back(more);
+        }
+    }
+
+    // the rest is 1 up to rounding errors
+    for (size_t i = 0; i < large.size(); ++i)
+        table[large[i]].probability = 1.0f;
+    for (size_t i = 0; i < small.size(); ++i)
+        table[small[i]].probability = 1.0f;
+}
+
+static inline unsigned int light_bvh_build_node(std::vector<light_bvh_node>& nodes, std::vector<unsigned int>& lights, unsigned int begin, unsigned int end, const float* positions, const float* power)
+{
+    const unsigned int index = (unsigned int)nodes.size();
+    nodes.push_back(light_bvh_node());
+
+    light_bvh_node node;
+    node.power = 0.0f;
+    node.light_index = lights[begin];
+    node.second_child = 0;
+    node.first = begin;
+    node.count = end - begin;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        node.bounds_min[axis] = positions[lights[begin] * 3 + axis];
+        node.bounds_max[axis] = positions[lights[begin] * 3 + axis];
+    }
+    for (unsigned int i = begin; i < end; ++i)
+    {
+        node.power += power[lights[i]] > 0.0f ? power[lights[i]] : 0.0f;
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            node.bounds_min[axis] = std::min(node.bounds_min[axis], positions[lights[i] * 3 + axis]);
+            node.bounds_max[axis] = std::max(node.bounds_max[axis], positions[lights[i] * 3 + axis]);
+        }
+    }
+
+    if (end - begin > 1)
+    {
+        // median split along the longest axis
+        int split_axis = 0;
+        for (int axis = 1; axis < 3; ++axis)
+        {
+            if (node.bounds_max[axis] - node.bounds_min[axis] > node.bounds_max[split_axis] - node.bounds_min[split_axis])
+                split_axis = axis;
+        }
+
+        const unsigned int middle = begin + (end - begin) / 2;
+        std::nth_element(lights.begin() + begin, lights.begin() + middle, lights.begin() + end,
+            [positions, split_axis](unsigned int a, unsigned int b) { return positions[a * 3 + split_axis] < positions[b * 3 + split_axis]; });
+
+        light_bvh_build_node(nodes, lights, begin, middle, positions, power);
+        node.second_child = light_bvh_build_node(nodes, lights, middle, end, positions, power);
+    }
+
+    nodes[index] = node;
+    return index;
+}
+
+// positions holds x, y, z of every light, count must be at least 1. Returns the nodes in depth first order.
+static inline std::vector<light_bvh_node> light_bvh_build(const float* positions, const float* power, unsigned int count)
+{
+    std::vector<light_bvh_node> nodes;
+    if (count == 0)
+        return nodes;
+
+    std::vector<unsigned int> lights(count);
+    for (unsigned int i = 0; i < count; ++i)
+        lights[i] = i;
+
+    nodes.reserve(2 * count - 1);
+    light_bvh_build_node(nodes, lights, 0, count, positions, power);
+    return nodes;
+}
+
+#endif
@@ -0,0 +1,310 @@
+#pragma once
+
+//
+// Importance sampling of the microfacet distributions, shared by the OptiX programs and host code.
+//
+// All directions are given in the local shading frame (normal = +z) as float[3] and point away from the surface.
+// The distributions are static structs passed as template parameter, like the correlation models in
+// tof_correlation.h:
+//
+//  - microfacet_beckmann: Beckmann distribution with the rational Smith Lambda approximation of
+//    BeckmannDistribution_Lambda in microfacet.h
+//  - microfacet_ggx:      Trowbridge-Reitz (GGX) distribution
+//
+// Both sample the distribution of normals visible from wo (Heitz and d'Eon 2014, Heitz 2018), so only the
+// masking term of the BRDF is left in the sample weight.
+//
+
+#include <math.h>
+
+#if defined(__CUDACC__)
+#define MICROFACET_HOSTDEVICE __host__ __device__ __inline__
+#else
+#define MICROFACET_HOSTDEVICE inline
+#endif
+
+static MICROFACET_HOSTDEVICE float microfacet_pi()
+{
+    return 3.14159265358979323846f;
+}
+
+static MICROFACET_HOSTDEVICE float microfacet_dot(const float* a, const float* b)
+{
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static MICROFACET_HOSTDEVICE void microfacet_normalize(float* v)
+{
+    const float length = sqrtf(microfacet_dot(v, v));
+    v[0] /= length;
+    v[1] /= length;
+    v[2] /= length;
+}
+
+// alpha^2 tan^2 theta of direction w for anisotropic roughness
+static MICROFACET_HOSTDEVICE float microfacet_alpha2_tan2_theta(const float* w, float alpha_x, float alpha_y)
+{
+    return ((alpha_x * alpha_x * w[0] * w[0]) + (alpha_y * alpha_y * w[1] * w[1])) / (w[2] * w[2]);
+}
+
+// Giles' single precision approximation of the inverse error function
+static MICROFACET_HOSTDEVICE float microfacet_erfinv(float x)
+{
+    x = fminf(fmaxf(x, -0.99999f), 0.99999f);
+    float w = -logf((1.0f - x) * (1.0f + x));
+    float p;
+    if (w < 5.0f)
+    {
+        w = w - 2.5f;
+        p = 2.81022636e-08f;
+        p = 3.43273939e-07f + p * w;
+        p = -3.5233877e-06f + p * w;
+        p = -4.39150654e-06f + p * w;
+        p = 0.00021858087f + p * w;
+        p = -0.00125372503f + p * w;
+        p = -0.00417768164f + p * w;
+        p = 0.246640727f + p * w;
+        p = 1.50140941f + p * w;
+    }
+    else
+    {
+        w = sqrtf(w) - 3.0f;
+        p = -0.000200214257f;
+        p = 0.000100950558f + p * w;
+        p = 0.00134934322f + p * w;
+        p = -0.00367342844f + p * w;
+        p = 0.00573950773f + p * w;
+        p = -0.0076224613f + p * w;
+        p = 0.00943887047f + p * w;
+        p = 1.00167406f + p * w;
+        p = 2.83297682f + p * w;
+    }
+    return p * x;
+}
+
+// Turns the normal of the stretched configuration with alpha = 1 back into the frame of the surface
+static MICROFACET_HOSTDEVICE void microfacet_unstretch_slope(const float* wo_stretched, float slope_x, float slope_y, float alpha_x, float alpha_y, float* wh)
+{
+    const float sin_theta = sqrtf(fmaxf(0.0f, 1.0f - wo_stretched[2] * wo_stretched[2]));
+    const float cos_phi = sin_theta > 0.0f ? wo_stretched[0] / sin_theta : 1.0f;
+    const float sin_phi = sin_theta > 0.0f ? wo_stretched[1] / sin_theta : 0.0f;
+
+    const float rotated_x = cos_phi * slope_x - sin_phi * slope_y;
+    const float rotated_y = sin_phi * slope_x + cos_phi * slope_y;
+
+    wh[0] = -alpha_x * rotated_x;
+    wh[1] = -alpha_y * rotated_y;
+    wh[2] = 1.0f;
+    microfacet_normalize(wh);
+}
+
+struct microfacet_beckmann
+{
+    static MICROFACET_HOSTDEVICE float D(const float* wh, float alpha_x, float alpha_y)
+    {
+        const float cos2_theta = wh[2] * wh[2];
+        if (cos2_theta <= 0.0f)
+            return 0.0f;
+
+        const float e = ((wh[0] * wh[0]) / (alpha_x * alpha_x) + (wh[1] * wh[1]) / (alpha_y * alpha_y)) / cos2_theta;
+        return expf(-e) / (microfacet_pi() * alpha_x * alpha_y * cos2_theta * cos2_theta);
+    }
+
+    static MICROFACET_HOSTDEVICE float lambda(const float* w, float alpha_x, float alpha_y)
+    {
+        if (w[2] == 0.0f)
+            return 0.0f;
+
+        const float alpha2_tan2_theta = microfacet_alpha2_tan2_theta(w, alpha_x, alpha_y);
+        if (alpha2_tan2_theta == 0.0f)
+            return 0.0f;
+
+        const float a = 1.0f / sqrtf(alpha2_tan2_theta);
+        if (a >= 1.6f)
+            return 0.0f;
+        return (1.0f - (1.259f * a) + (0.396f * a * a)) / ((3.535f * a) + (2.181f * a * a));
+    }
+
+    // Slopes of the visible normals for alpha = 1 (Jakob's fit of the inverse CDF, refined with a few Newton steps)
+    static MICROFACET_HOSTDEVICE void sample_slope(float cos_theta, float u1, float u2, float& slope_x, float& slope_y)
+    {
+        const float pi = microfacet_pi();
+
+        if (cos_theta > 0.9999f)
+        {
+            const float r = sqrtf(-logf(1.0f - u1));
+            slope_x = r * cosf(2.0f * pi * u2);
+            slope_y = r * sinf(2.0f * pi * u2);
+            return;
+        }
+
+        const float sin_theta = sqrtf(fmaxf(0.0f, 1.0f - cos_theta * cos_theta));
+        const float tan_theta = sin_theta / cos_theta;
+        const float cot_theta = 1.0f / tan_theta;
+        const float inv_sqrt_pi = 0.564189583547756f;
+
+        float a = -1.0f;
+        float c = erff(cot_theta);
+        const float sample_x = fmaxf(u1, 1e-6f);
+
+        const float theta = acosf(cos_theta);
+        const float fit = 1.0f + theta * (-0.876f + theta * (0.4265f - 0.0594f * theta));
+        float b = c - (1.0f + c) * powf(1.0f - sample_x, fit);
+
+        const float normalization = 1.0f / (1.0f + c + inv_sqrt_pi * tan_theta * expf(-cot_theta * cot_theta));
+
+        for (int iteration = 0; iteration < 9; ++iteration)
+        {
+            if (!(b >= a && b <= c))
+                b = 0.5f * (a + c);
+
+            const float inv_erf = microfacet_erfinv(b);
+            const float value = normalization * (1.0f + b + inv_sqrt_pi * tan_theta * expf(-inv_erf * inv_erf)) - sample_x;
+            const float derivative = normalization * (1.0f - inv_erf * tan_theta);
+            if (fabsf(value) < 1e-5f)
+                break;
+
+            if (value > 0.0f)
+                c = b;
+            else
+                a = b;
+            b -= value / derivative;
+        }
+
+        slope_x = microfacet_erfinv(b);
+        slope_y = microfacet_erfinv(2.0f * fmaxf(u2, 1e-6f) - 1.0f);
+    }
+
+    // wo must be above the surface
+    static MICROFACET_HOSTDEVICE void sample_visible_normal(const float* wo, float alpha_x, float alpha_y, float u1, float u2, float* wh)
+    {
+        float wo_stretched[3] = { alpha_x * wo[0], alpha_y * wo[1], wo[2] };
+        microfacet_normalize(wo_stretched);
+
+        float slope_x, slope_y;
+        sample_slope(wo_stretched[2], u1, u2, slope_x, slope_y);
+        microfacet_unstretch_slope(wo_stretched, slope_x, slope_y, alpha_x, alpha_y, wh);
+    }
+};
+
+struct microfacet_ggx
+{
+    static MICROFACET_HOSTDEVICE float D(const float* wh, float alpha_x, float alpha_y)
+    {
+        if (wh[2] <= 0.0f)
+            return 0.0f;
+
+        const float e = (wh[0] * wh[0]) / (alpha_x * alpha_x) + (wh[1] * wh[1]) / (alpha_y * alpha_y) + wh[2] * wh[2];
+        return 1.0f / (microfacet_pi() * alpha_x * alpha_y * e * e);
+    }
+
+    static MICROFACET_HOSTDEVICE float lambda(const float* w, float alpha_x, float alpha_y)
+    {
+        if (w[2] == 0.0f)
+            return 0.0f;
+
+        return (-1.0f + sqrtf(1.0f + microfacet_alpha2_tan2_theta(w, alpha_x, alpha_y))) * 0.5f;
+    }
+
+    // Heitz 2018, "Sampling the GGX Distribution of Visible Normals"
+    static MICROFACET_HOSTDEVICE void sample_visible_normal(const float* wo, float alpha_x, float alpha_y, float u1, float u2, float* wh)
+    {
+        float vh[3] = { alpha_x * wo[0], alpha_y * wo[1], wo[2] };
+        microfacet_normalize(vh);
+
+        // orthonormal basis around the stretched view direction
+        const float length_pow2 = vh[0] * vh[0] + vh[1] * vh[1];
+        float t1[3] = { 1.0f, 0.0f, 0.0f };
+        if (length_pow2 > 0.0f)
+        {
+            const float inv_length = 1.0f / sqrtf(length_pow2);
+            t1[0] = -vh[1] * inv_length;
+            t1[1] = vh[0] * inv_length;
+        }
+        const float t2[3] = { vh[1] * t1[2] - vh[2] * t1[1], vh[2] * t1[0] - vh[0] * t1[2], vh[0] * t1[1] - vh[1] * t1[0] };
+
+        // uniform disk, the half that is hidden by the projection is squeezed
+        const float r = sqrtf(u1);
+        const float phi = 2.0f * microfacet_pi() * u2;
+        const float p1 = r * cosf(phi);
+        float p2 = r * sinf(phi);
+        const float s = 0.5f * (1.0f + vh[2]);
+        p2 = (1.0f - s) * sqrtf(fmaxf(0.0f, 1.0f - p1 * p1)) + s * p2;
+        const float p3 = sqrtf(fmaxf(0.0f, 1.0f - p1 * p1 - p2 * p2));
+
+        wh[0] = alpha_x * (p1 * t1[0] + p2 * t2[0] + p3 * vh[0]);
+        wh[1] = alpha_y * (p1 * t1[1] + p2 * t2[1] + p3 * vh[1]);
+        wh[2] = fmaxf(1e-6f, p1 * t1[2] + p2 * t2[2] + p3 * vh[2]);
+        microfacet_normalize(wh);
+    }
+};
+
+template <typename Distribution>
+static MICROFACET_HOSTDEVICE float microfacet_G1(const float* w, float alpha_x, float alpha_y)
+{
+    return 1.0f / (1.0f + Distribution::lambda(w, alpha_x, alpha_y));
+}
+
+template <typename Distribution>
+static MICROFACET_HOSTDEVICE float microfacet_G(const float* wo, const float* wi, float alpha_x, float alpha_y)
+{
+    return 1.0f / (1.0f + Distribution::lambda(wo, alpha_x, alpha_y) + Distribution::lambda(wi, alpha_x, alpha_y));
+}
+
+// Reflected direction of wo at wh
+static MICROFACET_HOSTDEVICE void microfacet_reflect(const float* wo, const float* wh, float* wi)
+{
+    const float d = 2.0f * microfacet_dot(wo, wh);
+    wi[0] = d * wh[0] - wo[0];
+    wi[1] = d * wh[1] - wo[1];
+    wi[2] = d * wh[2] - wo[2];
+}
+
+// Solid angle density of wi when wh is drawn from the visible normals of wo and wo is reflected at it
+template <typename Distribution>
+static MICROFACET_HOSTDEVICE float microfacet_pdf(const float* wo, const float* wi, float alpha_x, float alpha_y)
+{
+    if (wo[2] <= 0.0f)
+        return 0.0f;
+
+    float wh[3] = { wo[0] + wi[0], wo[1] + wi[1], wo[2] + wi[2] };
+    if (wh[0] == 0.0f && wh[1] == 0.0f && wh[2] == 0.0f)
+        return 0.0f;
+    microfacet_normalize(wh);
+    if (wh[2] <= 0.0f)
+        return 0.0f;
+
+    // D_wo(wh) / (4 dot(wo, wh)), the dot product cancels
+    return microfacet_G1<Distribution>(wo, alpha_x, alpha_y) * Distribution::D(wh, alpha_x, alpha_y) / (4.0f * wo[2]);
+}
+
+// Samples the reflection of wo, returns false if the direction is below the surface. pdf is set in both cases.
+template <typename Distribution>
+static MICROFACET_HOSTDEVICE bool microfacet_sample(const float* wo, float alpha_x, float alpha_y, float u1, float u2, float* wi, float& pdf)
+{
+    pdf = 0.0f;
+    if (wo[2] <= 0.0f)
+        return false;
+
+    float wh[3];
+    Distribution::sample_visible_normal(wo, alpha_x, alpha_y, u1, u2, wh);
+    microfacet_reflect(wo, wh, wi);
+
+    pdf = microfacet_G1<Distribution>(wo, alpha_x, alpha_y) * Distribution::D(wh, alpha_x, alpha_y) / (4.0f * wo[2]);
+    return wi[2] > 0.0f;
+}
+
+static MICROFACET_HOSTDEVICE float cosine_hemisphere_pdf(const float* wi)
+{
+    return wi[2] > 0.0f ? wi[2] / microfacet_pi() : 0.0f;
+}
+
+// Weight of the strategy with num_f samples of density pdf_f against one with num_g samples of density pdf_g
+static MICROFACET_HOSTDEVICE float mis_power_heuristic(float num_f, float pdf_f, float num_g, float pdf_g)
+{
+    const float f = num_f * pdf_f;
+    const float g = num_g * pdf_g;
+    if (f == 0.0f)
+        return 0.0f;
+    return (f * f) / ((f * f) + (g * g));
+}
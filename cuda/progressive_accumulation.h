@@ -0,0 +1,102 @@
+#pragma once
+
+//
+// Progressive accumulation of the per pixel output over frames and passes, shared by the OptiX programs and host code.
+//
+// Blending every pass into a running mean, mean = lerp(mean, pass, 1 / n), rounds the mean on every update and the
+// error grows with the number of frames. Instead the pixel keeps the weighted sum of its passes and the sum of the
+// weights (the number of samples of a pass), both compensated (Kahan-Babuska-Neumaier): the part of an addition
+// that does not fit into the float sum is carried along in a second float. The mean is sum / weight.
+//
+// Passes with different sample counts are weighted correctly, and two sums of the same pixel, e.g. rendered on
+// different nodes, merge into the sum of all their passes.
+//
+
+#if defined(__CUDACC__)
+#define PROGRESSIVE_HOSTDEVICE __host__ __device__ __inline__
+#else
+#define PROGRESSIVE_HOSTDEVICE inline
+#endif
+
+template <int N>
+struct progressive_sum
+{
+    float sum[N];
+    float compensation[N];
+    float weight;
+    float weight_compensation;
+};
+
+// Colour and up to four buckets of a pixel of the renderer
+typedef progressive_sum<7> progressive_pixel;
+
+// value * weight rounded once, the device must not fuse it into the following addition
+static PROGRESSIVE_HOSTDEVICE float progressive_multiply(float value, float weight)
+{
+#if defined(__CUDA_ARCH__)
+    return __fmul_rn(value, weight);
+#else
+    return value * weight;
+#endif
+}
+
+static PROGRESSIVE_HOSTDEVICE float progressive_abs(float value)
+{
+    return value < 0.0f ? -value : value;
+}
+
+// sum + value, the rounding error of the addition is added to compensation
+static PROGRESSIVE_HOSTDEVICE void progressive_compensated_add(float& sum, float& compensation, float value)
+{
+    const float total = sum + value;
+    if (progressive_abs(sum) >= progressive_abs(value))
+        compensation += (sum - total) + value;
+    else
+        compensation += (value - total) + sum;
+    sum = total;
+}
+
+template <int N>
+static PROGRESSIVE_HOSTDEVICE progressive_sum<N> progressive_make_sum()
+{
+    progressive_sum<N> accumulator;
+    for (int i = 0; i < N; ++i)
+    {
+        accumulator.sum[i] = 0.0f;
+        accumulator.compensation[i] = 0.0f;
+    }
+    accumulator.weight = 0.0f;
+    accumulator.weight_compensation = 0.0f;
+    return accumulator;
+}
+
+// Adds a pass, values are the mean of the pass and weight its number of samples
+template <int N>
+static PROGRESSIVE_HOSTDEVICE void progressive_add(progressive_sum<N>& accumulator, const float* values, float weight)
+{
+    for (int i = 0; i < N; ++i)
+        progressive_compensated_add(accumulator.sum[i], accumulator.compensation[i], progressive_multiply(values[i], weight));
+    progressive_compensated_add(accumulator.weight, accumulator.weight_compensation, weight);
+}
+
+// Adds all passes of other to accumulator
+template <int N>
+static PROGRESSIVE_HOSTDEVICE void progressive_merge(progressive_sum<N>& accumulator, const progressive_sum<N>& other)
+{
+    for (int i = 0; i < N; ++i)
+    {
+        progressive_compensated_add(accumulator.sum[i], accumulator.compensation[i], other.sum[i]);
+        accumulator.compensation[i] += other.compensation[i];
+    }
+    progressive_compensated_add(accumulator.weight, accumulator.weight_compensation, other.weight);
+    accumulator.weight_compensation += other.weight_compensation;
+}
+
+// Weighted mean of all passes, 0 before the first one
+template <int N>
+static PROGRESSIVE_HOSTDEVICE void progressive_mean(const progressive_sum<N>& accumulator, float* mean)
+{
+    const float weight = accumulator.weight + accumulator.weight_compensation;
+    for (int i = 0; i < N; ++i)
+        mean[i] = weight > 0.0f ? (accumulator.sum[i] + accumulator.compensation[i]) / weight : 0.0f;
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+//
+// Low-discrepancy sampler shared by the OptiX programs and host code.
+//
+// Every pair of dimensions is an Owen scrambled 2d Sobol sequence (Burley 2020, "Practical Hash-based
+// Owen Scrambling"). The scrambling seed is derived from the pixel and the dimension, the sample index is
+// shuffled with the same scramble so the pairs are decorrelated from each other. The first 2^k samples of
+// every pair are a (0,k,2)-net, so progressive frames stay stratified as long as every frame adds a power
+// of two samples.
+//
+// The header only uses plain integer and float math, it compiles with nvcc and with any host compiler.
+//
+
+#include <math.h>
+
+#if defined(__CUDACC__)
+#define SAMPLER_HOSTDEVICE __host__ __device__ __inline__
+#else
+#define SAMPLER_HOSTDEVICE inline
+#endif
+
+static SAMPLER_HOSTDEVICE unsigned int sampler_reverse_bits(unsigned int x)
+{
+#if defined(__CUDA_ARCH__)
+    return __brev(x);
+#else
+    x = (x << 16) | (x >> 16);
+    x = ((x & 0x00ff00ffu) << 8) | ((x & 0xff00ff00u) >> 8);
+    x = ((x & 0x0f0f0f0fu) << 4) | ((x & 0xf0f0f0f0u) >> 4);
+    x = ((x & 0x33333333u) << 2) | ((x & 0xccccccccu) >> 2);
+    x = ((x & 0x55555555u) << 1) | ((x & 0xaaaaaaaau) >> 1);
+    return x;
+#endif
+}
+
+// integer hash with good avalanche behaviour (lowbias32)
+static SAMPLER_HOSTDEVICE unsigned int sampler_hash(unsigned int x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+static SAMPLER_HOSTDEVICE unsigned int sampler_hash_combine(unsigned int seed, unsigned int value)
+{
+    return seed ^ (sampler_hash(value) + 0x9e3779b9u + (seed << 6) + (seed >> 2));
+}
+
+// every output bit only depends on the input bits below it
+static SAMPLER_HOSTDEVICE unsigned int sampler_laine_karras_permutation(unsigned int x, unsigned int seed)
+{
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return x;
+}
+
+// base 2 Owen scrambling
+static SAMPLER_HOSTDEVICE unsigned int sampler_nested_uniform_scramble(unsigned int x, unsigned int seed)
+{
+    x = sampler_reverse_bits(x);
+    x = sampler_laine_karras_permutation(x, seed);
+    return sampler_reverse_bits(x);
+}
+
+// second Sobol dimension, the direction numbers of x + 1 follow v_k = v_(k-1) ^ (v_(k-1) >> 1)
+static SAMPLER_HOSTDEVICE unsigned int sampler_sobol_dim1(unsigned int index)
+{
+    unsigned int result = 0;
+    for (unsigned int v = 1u << 31; index != 0; index >>= 1, v ^= v >> 1)
+    {
+        if (index & 1u)
+            result ^= v;
+    }
+    return result;
+}
+
+// maps the upper 24 bits to [0, 1)
+static SAMPLER_HOSTDEVICE float sampler_to_float(unsigned int x)
+{
+    return (float)(x >> 8) * (1.0f / 16777216.0f);
+}
+
+static SAMPLER_HOSTDEVICE unsigned int sampler_pixel_key(unsigned int x, unsigned int y)
+{
+    return sampler_hash_combine(sampler_hash(x), y);
+}
+
+// sample of the 2d pattern number dimension, one dimension index provides two random numbers
+static SAMPLER_HOSTDEVICE void sample_2d(unsigned int pixel_key, unsigned int sample_index, unsigned int dimension, float& u1, float& u2)
+{
+    const unsigned int seed = sampler_hash_combine(pixel_key, dimension);
+    const unsigned int index = sampler_nested_uniform_scramble(sample_index, seed);
+
+    // the first Sobol dimension is the van der Corput sequence
+    u1 = sampler_to_float(sampler_nested_uniform_scramble(sampler_reverse_bits(index), sampler_hash_combine(seed, 1u)));
+    u2 = sampler_to_float(sampler_nested_uniform_scramble(sampler_sobol_dim1(index), sampler_hash_combine(seed, 2u)));
+}
+
+static SAMPLER_HOSTDEVICE float sample_1d(unsigned int pixel_key, unsigned int sample_index, unsigned int dimension)
+{
+    const unsigned int seed = sampler_hash_combine(pixel_key, dimension);
+    const unsigned int index = sampler_nested_uniform_scramble(sample_index, seed);
+    return sampler_to_float(sampler_nested_uniform_scramble(sampler_reverse_bits(index), sampler_hash_combine(seed, 1u)));
+}
+
+// Shirley-Chiu mapping from the unit square to the unit disk, keeps the stratification and needs no rejection
+static SAMPLER_HOSTDEVICE void concentric_sample_disk(float u1, float u2, float& x, float& y)
+{
+    const float quarter_pi = 0.785398163397f;
+
+    const float a = 2.0f * u1 - 1.0f;
+    const float b = 2.0f * u2 - 1.0f;
+    if (a == 0.0f && b == 0.0f)
+    {
+        x = 0.0f;
+        y = 0.0f;
+        return;
+    }
+
+    float r, phi;
+    if (a * a > b * b)
+    {
+        r = a;
+        phi = quarter_pi * (b / a);
+    }
+    else
+    {
+        r = b;
+        phi = 2.0f * quarter_pi - quarter_pi * (a / b);
+    }
+
+    x = r * cosf(phi);
+    y = r * sinf(phi);
+}
@@ -0,0 +1,293 @@
+#pragma once
+
+//
+// Correlation models of the simulated time-of-flight sensor, shared by the OptiX programs and host code.
+//
+// Every model integrates the light that reaches the sensor delta_time after emission over its exposure windows
+// (buckets). The signal is described by tof_modulation: the modulation frequency, the width of the emitted pulse,
+// the length of the exposure windows and their begin relative to the emission.
+//
+//  - tof_pulse_model: a single light pulse and two windows (pulsed ToF)
+//  - tof_rect_model:  periodic rectangular pulses and four windows (continuous wave)
+//  - tof_sine_model:  sinusoidal modulation and four windows (continuous wave)
+//
+// The models are static structs passed as template parameter, so every caller compiles only the model it uses.
+// Scalar type is a template parameter as well, the renderer integrates in float and the analysis tools in double.
+//
+
+#include <math.h>
+
+#if defined(__CUDACC__)
+#define TOF_HOSTDEVICE __host__ __device__ __inline__
+#else
+#define TOF_HOSTDEVICE inline
+#endif
+
+template <typename T>
+struct tof_modulation
+{
+    T frequency;        // modulation frequency in Hz
+    T pulse_width;      // length of the emitted pulse in seconds
+    T exposure;         // length of every exposure window in seconds
+    T window_start[4];  // begin of the exposure windows relative to the emission in seconds
+};
+
+template <typename Model, typename T>
+struct tof_buckets
+{
+    T value[Model::num_buckets];
+};
+
+static TOF_HOSTDEVICE float tof_floor(float x) { return floorf(x); }
+static TOF_HOSTDEVICE double tof_floor(double x) { return floor(x); }
+static TOF_HOSTDEVICE float tof_cos(float x) { return cosf(x); }
+static TOF_HOSTDEVICE double tof_cos(double x) { return cos(x); }
+static TOF_HOSTDEVICE float tof_atan2(float y, float x) { return atan2f(y, x); }
+static TOF_HOSTDEVICE double tof_atan2(double y, double x) { return atan2(y, x); }
+
+template <typename T>
+static TOF_HOSTDEVICE T tof_speed_of_light()
+{
+    return (T)299792458.0;
+}
+
+template <typename T>
+static TOF_HOSTDEVICE T tof_pi()
+{
+    return (T)3.14159265358979323846;
+}
+
+// Modulation used by the renderer: 50% duty cycle, windows at 0, 180, 90 and 270 degrees of the period
+template <typename T>
+static TOF_HOSTDEVICE tof_modulation<T> tof_make_modulation(T frequency)
+{
+    tof_modulation<T> modulation;
+    modulation.frequency = frequency;
+    modulation.pulse_width = ((T)1 / frequency) * (T)0.5;
+    modulation.exposure = modulation.pulse_width;
+    modulation.window_start[0] = (T)0;
+    modulation.window_start[1] = modulation.pulse_width;
+    modulation.window_start[2] = modulation.pulse_width * (T)0.5;
+    modulation.window_start[3] = modulation.pulse_width * (T)1.5;
+    return modulation;
+}
+
+// Single pulse of the given width, windows at 0 and pulse_width
+template <typename T>
+static TOF_HOSTDEVICE tof_modulation<T> tof_make_pulse_modulation(T pulse_width)
+{
+    tof_modulation<T> modulation = tof_make_modulation((T)0.5 / pulse_width);
+    modulation.pulse_width = pulse_width;
+    modulation.exposure = pulse_width;
+    return modulation;
+}
+
+template <typename T>
+static TOF_HOSTDEVICE T tof_travel_time(T path_length)
+{
+    return path_length / tof_speed_of_light<T>();
+}
+
+// Part of the pulse [begin, begin + pulse_width] that falls into the window, relative to the pulse width
+template <typename T>
+static TOF_HOSTDEVICE T tof_window_overlap(const tof_modulation<T>& modulation, T begin, T window_start)
+{
+    const T end = begin + modulation.pulse_width;
+    const T window_end = window_start + modulation.exposure;
+
+    const T overlap = (end < window_end ? end : window_end) - (begin > window_start ? begin : window_start);
+    return overlap > (T)0 ? overlap / modulation.pulse_width : (T)0;
+}
+
+// Integral of offset + amplitude * sin(2 pi f t) over [from, to]
+template <typename T>
+static TOF_HOSTDEVICE T tof_sine_area(T amplitude, T frequency, T offset, T from, T to)
+{
+    const T omega = (T)2 * tof_pi<T>() * frequency;
+    return ((amplitude * (tof_cos(omega * from) - tof_cos(omega * to))) / omega) - (offset * from) + (offset * to);
+}
+
+// Distance from four buckets sampled at 0, 180, 90 and 270 degrees, wrapped into one ambiguity range
+template <typename T>
+static TOF_HOSTDEVICE T tof_four_phase_distance(const tof_modulation<T>& modulation, const T* buckets)
+{
+    const T x = buckets[0] - buckets[1];
+    const T y = buckets[2] - buckets[3];
+    if (x == (T)0 && y == (T)0)
+        return (T)0;
+
+    T phi = tof_atan2(y, x);
+    if (phi < (T)0)
+        phi += (T)2 * tof_pi<T>();
+
+    return (tof_speed_of_light<T>() / ((T)4 * tof_pi<T>() * modulation.frequency)) * phi;
+}
+
+// Difference a - b of two four phase distances, wrapped into half an ambiguity range
+template <typename T>
+static TOF_HOSTDEVICE T tof_four_phase_distance_difference(const tof_modulation<T>& modulation, T a, T b)
+{
+    const T range = tof_speed_of_light<T>() / ((T)2 * modulation.frequency);
+    const T difference = a - b;
+    return difference - range * tof_floor(difference / range + (T)0.5);
+}
+
+struct tof_pulse_model
+{
+    enum { num_buckets = 2 };
+
+    template <typename T>
+    static TOF_HOSTDEVICE void accumulate(const tof_modulation<T>& modulation, T delta_time, T intensity, T* buckets)
+    {
+        buckets[0] += tof_window_overlap(modulation, delta_time, modulation.window_start[0]) * intensity;
+        buckets[1] += tof_window_overlap(modulation, delta_time, modulation.window_start[1]) * intensity;
+    }
+
+    // share of unmodulated light that ends up in every bucket
+    template <typename T>
+    static TOF_HOSTDEVICE T ambient_weight()
+    {
+        return (T)0.5;
+    }
+
+    template <typename T>
+    static TOF_HOSTDEVICE T distance(const tof_modulation<T>& modulation, const T* buckets)
+    {
+        const T sum = buckets[0] + buckets[1];
+        if (sum == (T)0)
+            return (T)0;
+        return (T)0.5 * tof_speed_of_light<T>() * modulation.pulse_width * (buckets[1] / sum);
+    }
+
+    template <typename T>
+    static TOF_HOSTDEVICE T distance_difference(const tof_modulation<T>& /*modulation*/, T a, T b)
+    {
+        return a - b;
+    }
+};
+
+struct tof_rect_model
+{
+    enum { num_buckets = 4 };
+
+    // pulse width and exposure must not be longer than one period
+    template <typename T>
+    static TOF_HOSTDEVICE void accumulate(const tof_modulation<T>& modulation, T delta_time, T intensity, T* buckets)
+    {
+        const T period = (T)1 / modulation.frequency;
+
+        for (int i = 0; i < num_buckets; ++i)
+        {
+            // only the last pulse that begins before the window and the next one can overlap it
+            T offset = modulation.window_start[i] - delta_time;
+            offset -= tof_floor(offset * modulation.frequency) * period;
+
+            const T begin = modulation.window_start[i] - offset;
+            buckets[i] += (tof_window_overlap(modulation, begin, modulation.window_start[i]) + tof_window_overlap(modulation, begin + period, modulation.window_start[i])) * intensity;
+        }
+    }
+
+    template <typename T>
+    static TOF_HOSTDEVICE T ambient_weight()
+    {
+        return (T)0.25;
+    }
+
+    template <typename T>
+    static TOF_HOSTDEVICE T distance(const tof_modulation<T>& modulation, const T* buckets)
+    {
+        return tof_four_phase_distance(modulation, buckets);
+    }
+
+    template <typename T>
+    static TOF_HOSTDEVICE T distance_difference(const tof_modulation<T>& modulation, T a, T b)
+    {
+        return tof_four_phase_distance_difference(modulation, a, b);
+    }
+};
+
+struct tof_sine_model
+{
+    enum { num_buckets = 4 };
+
+    // the integral is scaled by the frequency, so the buckets are the mean signal over one period
+    template <typename T>
+    static TOF_HOSTDEVICE void accumulate(const tof_modulation<T>& modulation, T delta_time, T intensity, T* buckets)
+    {
+        for (int i = 0; i < num_buckets; ++i)
+        {
+            const T from = modulation.window_start[i] - delta_time;
+            buckets[i] += intensity * modulation.frequency * tof_sine_area((T)1, modulation.frequency, (T)1, from, from + modulation.exposure);
+        }
+    }
+
+    template <typename T>
+    static TOF_HOSTDEVICE T ambient_weight()
+    {
+        return (T)0.5;
+    }
+
+    template <typename T>
+    static TOF_HOSTDEVICE T distance(const tof_modulation<T>& modulation, const T* buckets)
+    {
+        return tof_four_phase_distance(modulation, buckets);
+    }
+
+    template <typename T>
+    static TOF_HOSTDEVICE T distance_difference(const tof_modulation<T>& modulation, T a, T b)
+    {
+        return tof_four_phase_distance_difference(modulation, a, b);
+    }
+};
+
+template <typename Model, typename T>
+static TOF_HOSTDEVICE tof_buckets<Model, T> tof_make_buckets()
+{
+    tof_buckets<Model, T> buckets;
+    for (int i = 0; i < Model::num_buckets; ++i)
+        buckets.value[i] = (T)0;
+    return buckets;
+}
+
+template <typename Model, typename T>
+static TOF_HOSTDEVICE void tof_add_buckets(tof_buckets<Model, T>& sum, const tof_buckets<Model, T>& buckets)
+{
+    for (int i = 0; i < Model::num_buckets; ++i)
+        sum.value[i] += buckets.value[i];
+}
+
+template <typename Model, typename T>
+static TOF_HOSTDEVICE void tof_scale_buckets(tof_buckets<Model, T>& buckets, T factor)
+{
+    for (int i = 0; i < Model::num_buckets; ++i)
+        buckets.value[i] *= factor;
+}
+
+// Adds the light of one path that reaches the sensor delta_time after it was emitted
+template <typename Model, typename T>
+static TOF_HOSTDEVICE void tof_accumulate(const tof_modulation<T>& modulation, T delta_time, T intensity, tof_buckets<Model, T>& buckets)
+{
+    Model::accumulate(modulation, delta_time, intensity, buckets.value);
+}
+
+// Adds unmodulated light (ambient, emissive surfaces)
+template <typename Model, typename T>
+static TOF_HOSTDEVICE void tof_accumulate_ambient(T intensity, tof_buckets<Model, T>& buckets)
+{
+    const T weight = Model::template ambient_weight<T>() * intensity;
+    for (int i = 0; i < Model::num_buckets; ++i)
+        buckets.value[i] += weight;
+}
+
+template <typename Model, typename T>
+static TOF_HOSTDEVICE T tof_distance(const tof_modulation<T>& modulation, const tof_buckets<Model, T>& buckets)
+{
+    return Model::distance(modulation, buckets.value);
+}
+
+// Difference a - b of two distances of the model, wrapped for the continuous wave models
+template <typename Model, typename T>
+static TOF_HOSTDEVICE T tof_distance_difference(const tof_modulation<T>& modulation, T a, T b)
+{
+    return Model::distance_difference(modulation, a, b);
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+//
+// Time resolved output of the simulated time-of-flight sensor, shared by the OptiX programs and host code.
+//
+// Instead of correlating every path with one modulation, the renderer can store the modulated light of a pixel
+// as histogram over the path length (bins of bin_width meters, starting at 0). All correlation models are linear
+// in the intensity, so the buckets of any model and frequency follow from the histogram as a matrix product:
+//
+//     bucket[k] = sum over bins of kernel[k * bins + bin] * histogram[bin] + ambient_weight * ambient
+//
+// where kernel[k * bins + bin] is the bucket k of a unit return at the path length of the bin. Unmodulated light
+// is kept in a separate value per pixel (ambient) since it does not depend on the modulation.
+//
+// A contribution is split between the two bins around its path length. Correlating the histogram then evaluates
+// the kernels linearly interpolated between the bin centers instead of at the center of the nearest bin, which
+// keeps the quantization bias of the distance small compared to the noise of the renderer.
+//
+
+#include "tof_correlation.h"
+
+#if defined(__CUDACC__)
+#define TRANSIENT_HOSTDEVICE __host__ __device__ __inline__
+#else
+#define TRANSIENT_HOSTDEVICE inline
+#endif
+
+// Lower bin and the share of the contribution that goes into bin + 1, path lengths beyond the last bin are clamped
+static TRANSIENT_HOSTDEVICE void transient_bin_position(float path_length, float bin_width, unsigned int bins, unsigned int& bin, float& fraction)
+{
+    const float position = path_length / bin_width;
+    if (!(position > 0.0f))
+    {
+        bin = 0;
+        fraction = 0.0f;
+    }
+    else if (position >= (float)(bins - 1))
+    {
+        bin = bins - 1;
+        fraction = 0.0f;
+    }
+    else
+    {
+        bin = (unsigned int)position;
+        fraction = position - (float)bin;
+    }
+}
+
+// Adds intensity at path_length to a histogram with bins entries
+static TRANSIENT_HOSTDEVICE void transient_accumulate(float path_length, float intensity, float bin_width, unsigned int bins, float* histogram)
+{
+    unsigned int bin;
+    float fraction;
+    transient_bin_position(path_length, bin_width, bins, bin, fraction);
+
+    histogram[bin] += (1.0f - fraction) * intensity;
+    if (fraction > 0.0f)
+        histogram[bin + 1] += fraction * intensity;
+}
+
+// Correlation kernels of the modulation for a histogram, kernel needs Model::num_buckets * bins entries
+template <typename Model, typename T>
+static TRANSIENT_HOSTDEVICE void transient_correlation_kernel(const tof_modulation<T>& modulation, unsigned int bins, T bin_width, T* kernel)
+{
+    for (unsigned int bin = 0; bin < bins; ++bin)
+    {
+        tof_buckets<Model, T> buckets = tof_make_buckets<Model, T>();
+        tof_accumulate(modulation, tof_travel_time((T)bin * bin_width), (T)1, buckets);
+
+        for (int k = 0; k < Model::num_buckets; ++k)
+            kernel[k * bins + bin] = buckets.value[k];
+    }
+}
+
+// Buckets of one pixel from its histogram and ambient light
+template <typename Model, typename T>
+static TRANSIENT_HOSTDEVICE tof_buckets<Model, T> transient_correlate(const T* kernel, unsigned int bins, const T* histogram, T ambient)
+{
+    tof_buckets<Model, T> buckets = tof_make_buckets<Model, T>();
+    for (int k = 0; k < Model::num_buckets; ++k)
+    {
+        T sum = (T)0;
+        for (unsigned int bin = 0; bin < bins; ++bin)
+            sum += kernel[k * bins + bin] * histogram[bin];
+        buckets.value[k] = sum;
+    }
+    tof_accumulate_ambient(ambient, buckets);
+    return buckets;
+}
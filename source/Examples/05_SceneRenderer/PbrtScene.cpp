@@ -1,162 +1,56 @@
 #include <Resources/BowResources.h>
 #include <CoreSystems/BowMath.h>
-#include <Platform/BowFileReader.h>
+#include <Platform/BowMappedFile.h>
+#include <Resources/FileLoader/SceneLoader/BowPbrtTokenizer.h>
 #include "PbrtScene.h"
 
-#include <sstream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
-#include <algorithm> 
-#include <cctype>
-#include <locale>
+#include <set>
+#include <thread>
 
-struct Argument
+// Content of the first quoted string of the values
+std::string parseString(const bow::PbrtToken& values)
 {
-	std::string key;
-	std::string values;
-};
-
-// trim from start (in place)
-static inline void ltrim(std::string &s) {
-	s.erase(s.begin(), std::find_if(s.begin(), s.end(), [](int ch) {
-		return !std::isspace(ch);
-	}));
-}
-
-// trim from end (in place)
-static inline void rtrim(std::string &s) {
-	s.erase(std::find_if(s.rbegin(), s.rend(), [](int ch) {
-		return !std::isspace(ch);
-	}).base(), s.end());
-}
-
-// trim from both ends (in place)
-static inline void trim(std::string &s) {
-	ltrim(s);
-	rtrim(s);
-}
-
-// trim from both ends (in place)
-static inline std::vector<std::pair<std::string, std::string>> tokenize(const std::string& parameterString) 
-{
-	char waitForEnding = '\0';
-	std::vector<std::pair<std::string, std::string>> tokens;
-	for(unsigned int currentIndex = 0; currentIndex < parameterString.length(); currentIndex++)
-	{
-		char c = parameterString[currentIndex];
-		if (waitForEnding == '\0')
-		{
-			if (c == '\"')
-			{
-				waitForEnding = '\"';
-				tokens.push_back(std::pair<std::string, std::string>());
-			}
-			else if (c == '[')
-			{
-				waitForEnding = ']';
-			}
-			continue;
-		}
-
-		if (c != waitForEnding)
-		{
-			if (waitForEnding == '\"')
-			{
-				tokens.back().first.push_back(c);
-			}
-			else if(waitForEnding == ']')
-			{
-				tokens.back().second.push_back(c);
-			}
-		}
-		else
-		{
-			waitForEnding = '\0';
-		}
-	}
-	return tokens;
-}
-
-// trim from both ends (in place)
-static inline std::vector<std::string> split(const std::string& line)
-{
-	std::vector<std::string> tokens;
-	tokens.clear();
-
-	auto begin = line.begin();
-	const auto end = line.end();
-	auto eot = begin;
-	while (eot != end)
-	{
-		// Skip all delimiters.
-		while (begin != end && *begin == ' ')
-		{
-			++begin;
-		}
-		eot = std::find(begin, end, ' ');
-
-		tokens.emplace_back(begin, eot);
-		if (eot != end)
-		{
-			// Move begin after delimiter.
-			begin = eot + 1;
-		}
-	}
-
-	return tokens;
-}
+	const char* begin = std::find(values.begin, values.end, '"');
+	if (begin == values.end)
+		return "";
 
-std::string parseString(std::string argument)
-{
-	std::string result;
-	char waitForEnding = '\0';
-	for (unsigned int currentIndex = 0; currentIndex < argument.length(); currentIndex++)
-	{
-		char c = argument[currentIndex];
-		if (waitForEnding == '\0')
-		{
-			if (c == '\"')
-			{
-				waitForEnding = '\"';
-			}
-			continue;
-		}
+	const char* end = std::find(begin + 1, values.end, '"');
+	if (end == values.end)
+		return "";
 
-		if (c != waitForEnding)
-		{
-			if (waitForEnding == '\"')
-			{
-				result.push_back(c);
-			}
-		}
-		else
-		{
-			waitForEnding = '\0';
-			return result;
-		}
-	}
-	return "";
+	return std::string(begin + 1, end);
 }
 
-bow::Vector3<float> parseVec3(std::string argument)
+// The file buffer is terminated, strtod stops at the latest at the closing bracket or the terminator
+bow::Vector3<float> parseVec3(const bow::PbrtToken& values)
 {
-	std::vector<std::string> values = split(argument);
-	return bow::Vector3<float>(std::stod(values[0]), std::stod(values[1]), std::stod(values[2]));
+	char* end;
+	float x = (float)std::strtod(values.begin, &end);
+	float y = (float)std::strtod(end, &end);
+	float z = (float)std::strtod(end, &end);
+	return bow::Vector3<float>(x, y, z);
 }
 
-float parseFloat(std::string argument)
+float parseFloat(const bow::PbrtToken& values)
 {
-	return (float)std::stod(argument);
+	return (float)std::strtod(values.begin, nullptr);
 }
 
-float parseBool(std::string argument)
+float parseBool(const bow::PbrtToken& values)
 {
-	std::string value = parseString(argument);
+	std::string value = parseString(values);
 	return value == "true";
 }
 
 
 // Konstruktor: Default Werte setzen
-PbrtScene::PbrtScene()
+PbrtScene::PbrtScene() : m_numLoadThreads(0)
 {
 
 }
@@ -169,33 +63,24 @@ PbrtScene::~PbrtScene()
 
 bool PbrtScene::parseFile(std::string filePath)
 {
-	bow::FileReader reader;
+	auto start = std::chrono::high_resolution_clock::now();
 
-	char*	dataFromDisk; 
-	size_t	sizeInBytes;
-	if (reader.Open(filePath.c_str()))
+	bow::MappedFile file;
+	if (file.Open(filePath.c_str(), bow::FileAccessHint::Sequential))
 	{
-		sizeInBytes = reader.GetSizeOfFile();
-		dataFromDisk = new char[sizeInBytes];
-		dataFromDisk[sizeInBytes - 1] = '\0';
-
-		unsigned int readedBytes = 0;
-		char buffer[1024];
-
-		reader.Seek(0);
-		for (size_t i = 0; !reader.EndOfFile(); i += readedBytes)
-		{
-			readedBytes = (unsigned int)reader.Read(buffer, 1024);
-			memcpy(dataFromDisk + i, buffer, readedBytes);
-		}
+		std::string path = filePath.substr(0, filePath.find_last_of('/') + 1);
 
-		reader.Close();
+		// the mapping is terminated, so numbers at the very end of the file can be parsed in place
+		parse(path, file.GetData(), file.GetSizeInBytes());
+		file.Close();
 
-		std::string path = filePath.substr(0, filePath.find_last_of('/') + 1);
+		auto parsed = std::chrono::high_resolution_clock::now();
 
-		parse(path, dataFromDisk);
+		loadResources();
 
-		delete[] dataFromDisk;
+		auto loaded = std::chrono::high_resolution_clock::now();
+		std::cout << "PbrtScene: parsed '" << filePath << "' in " << std::chrono::duration<double, std::milli>(parsed - start).count() << " ms, "
+			<< "loaded " << m_meshes.size() << " meshes and " << m_textures.size() << " textures in " << std::chrono::duration<double, std::milli>(loaded - parsed).count() << " ms" << std::endl;
 		return true;
 	}
 	else
@@ -205,52 +90,24 @@ bool PbrtScene::parseFile(std::string filePath)
 	}
 }
 
-void PbrtScene::parse(const std::string& filepath, char* dataFromDisk)
+void PbrtScene::parse(const std::string& filepath, const char* data, size_t sizeInBytes)
 {
-	std::string line;
-	std::istringstream dataStream(dataFromDisk);
-
-	std::vector<std::pair<std::string, std::string>> tokens;
-	while (safeGetline(dataStream, line))
-	{
-		auto begin = line.begin();
-		const auto end = line.end();
-		auto eot = begin;
-
-		// Skip all delimiters.
-		while (begin != end && *begin == ' ')
-		{
-			++begin;
-		}
-		eot = std::find(begin, end, ' ');
-
-		std::string token = std::string(begin, eot);
-		trim(token);
-
-		if (token.size() > 0)
-		{
-			if (eot != end)
-			{
-				tokens.emplace_back(std::pair<std::string, std::string>(token, std::string(eot + 1, end)));
-			}
-			else
-			{
-				tokens.emplace_back(std::pair<std::string, std::string>(token, ""));
-			}
-		}
-	}
+	std::vector<bow::PbrtStatement> statements;
+	std::vector<bow::PbrtParameter> parameters;
+	bow::PbrtTokenizer::Tokenize(data, data + sizeInBytes, statements, parameters);
 
-	for (unsigned int lineIndex = 0; lineIndex < tokens.size(); lineIndex++) 
+	for (unsigned int statementIndex = 0; statementIndex < statements.size(); statementIndex++)
 	{
-		std::pair<std::string, std::string> token_params_pair = tokens[lineIndex];
+		const bow::PbrtStatement& statement = statements[statementIndex];
 
-		std::string token = token_params_pair.first;
-		std::string parameters = token_params_pair.second;
+		const bow::PbrtToken& token = statement.directive;
+		const bow::PbrtParameter* params = parameters.data() + statement.firstParameter;
+		const size_t numParams = statement.numParameters;
 
 		if (token.empty())
 			continue;
 
-		switch (token[0]) {
+		switch (token.begin[0]) {
 		case 'A':
 			if (token == "AttributeBegin")
 			{
@@ -349,7 +206,7 @@ void PbrtScene::parse(const std::string& filepath, char* dataFromDisk)
 		case 'M':
 			if (token == "MakeNamedMaterial")
 			{
-				loadMaterial(filepath, parameters);
+				loadMaterial(filepath, params, numParams);
 			}
 			else if (token == "MakeNamedMedium")
 			{
@@ -372,8 +229,8 @@ void PbrtScene::parse(const std::string& filepath, char* dataFromDisk)
 		case 'N':
 			if (token == "NamedMaterial")
 			{
-				std::vector<std::pair<std::string, std::string>> tokens = tokenize(parameters);
-				m_currentMaterialName = tokens[0].first;
+				if (numParams > 0)
+					m_currentMaterialName = params[0].name.str();
 			}
 			else
 			{
@@ -429,7 +286,7 @@ void PbrtScene::parse(const std::string& filepath, char* dataFromDisk)
 		case 'S':
 			if (token == "Shape")
 			{
-				loadShape(filepath, parameters);
+				loadShape(filepath, params, numParams);
 			}
 			else if (token == "Sampler")
 			{
@@ -468,7 +325,7 @@ void PbrtScene::parse(const std::string& filepath, char* dataFromDisk)
 			}
 			else if (token == "Texture")
 			{
-				loadTexture(filepath, parameters);
+				loadTexture(filepath, params, numParams);
 			}
 			else
 			{
@@ -499,128 +356,193 @@ void PbrtScene::parse(const std::string& filepath, char* dataFromDisk)
 	}
 }
 
-void PbrtScene::loadShape(const std::string& filepath, const std::string& parameters)
+void PbrtScene::loadShape(const std::string& filepath, const bow::PbrtParameter* parameters, size_t numParameters)
 {
-	std::vector<std::pair<std::string, std::string>> tokens = tokenize(parameters);
-	if (tokens[0].first == "plymesh")
+	if (numParameters == 0)
+		return;
+
+	if (parameters[0].name == "plymesh")
 	{
-		for (unsigned int i = 0; i < tokens.size(); i++)
+		for (unsigned int i = 0; i < numParameters; i++)
 		{
-			if (tokens[i].first == "string filename")
+			if (parameters[i].name == "string filename")
 			{
-				std::string filename = parseString(tokens[i].second);
-				bow::MeshPtr mesh = bow::MeshManager::GetInstance().Load(filepath + filename);
-				AddToScene(mesh);
+				std::string filename = parseString(parameters[i].values);
+
+				// only registered here, the file is loaded by loadResources
+				PendingShape shape;
+				shape.mesh = std::static_pointer_cast<bow::Mesh>(bow::MeshManager::GetInstance().CreateOrRetrieve(filepath + filename));
+				shape.materialName = m_currentMaterialName;
+				m_pendingShapes.push_back(shape);
 			}
 		}
 	}
-	else if (tokens[0].first == "trianglemesh")
+	else if (parameters[0].name == "trianglemesh")
 	{
 
 	}
 }
 
-void PbrtScene::loadTexture(const std::string & filepath, const std::string & parameters)
+void PbrtScene::loadTexture(const std::string & filepath, const bow::PbrtParameter* parameters, size_t numParameters)
 {
-	std::vector<std::pair<std::string, std::string>> tokens = tokenize(parameters);
-	for (unsigned int i = 0; i < tokens.size(); i++)
+	for (unsigned int i = 0; i < numParameters; i++)
 	{
-		if (tokens[i].first == "string filename")
+		if (parameters[i].name == "string filename")
 		{
-			std::string filename = parseString(tokens[i].second);
-			bow::ImagePtr image = bow::ImageManager::GetInstance().Load(filepath + filename);
-			AddToScene(tokens[0].first, image);
+			std::string filename = parseString(parameters[i].values);
+
+			PendingTexture texture;
+			texture.name = parameters[0].name.str();
+			texture.image = std::static_pointer_cast<bow::Image>(bow::ImageManager::GetInstance().CreateOrRetrieve(filepath + filename));
+			m_pendingTextures.push_back(texture);
 		}
 	}
 }
 
-void PbrtScene::loadMaterial(const std::string & filepath, const std::string & parameters)
+void PbrtScene::loadMaterial(const std::string & filepath, const bow::PbrtParameter* parameters, size_t numParameters)
 {
-	std::vector<std::pair<std::string, std::string>> tokens = tokenize(parameters);
+	if (numParameters == 0)
+		return;
 
 	PbrtMaterial material;
-	material.name = tokens[0].first;
-	for (unsigned int i = 0; i < tokens.size(); i++)
+	material.name = parameters[0].name.str();
+	for (unsigned int i = 0; i < numParameters; i++)
 	{
-		if (tokens[i].first == "string type")
+		const bow::PbrtToken& name = parameters[i].name;
+		const bow::PbrtToken& values = parameters[i].values;
+
+		if (name == "string type")
 		{
-			material.type = parseString(tokens[i].second);
+			material.type = parseString(values);
 		} 
-		else if (tokens[i].first == "rgb Kd")
+		else if (name == "rgb Kd")
 		{
-			material.Kd = parseVec3(tokens[i].second);
+			material.Kd = parseVec3(values);
 		}
-		else if (tokens[i].first == "rgb Ks")
+		else if (name == "rgb Ks")
 		{
-			material.Ks = parseVec3(tokens[i].second);
+			material.Ks = parseVec3(values);
 		}
-		else if (tokens[i].first == "rgb Kt")
+		else if (name == "rgb Kt")
 		{
-			material.Kt = parseVec3(tokens[i].second);
+			material.Kt = parseVec3(values);
 		}
-		else if (tokens[i].first == "rgb k")
+		else if (name == "rgb k")
 		{
-			material.k = parseVec3(tokens[i].second);
+			material.k = parseVec3(values);
 		}
-		else if (tokens[i].first == "rgb eta")
+		else if (name == "rgb eta")
 		{
-			material.eta = parseVec3(tokens[i].second);
+			material.eta = parseVec3(values);
 		}
-		else if (tokens[i].first == "rgb opacity")
+		else if (name == "rgb opacity")
 		{
-			material.opacity = parseVec3(tokens[i].second);
+			material.opacity = parseVec3(values);
 		}
-		else if (tokens[i].first == "float index")
+		else if (name == "float index")
 		{
-			material.index = parseFloat(tokens[i].second);
+			material.index = parseFloat(values);
 		}
-		else if (tokens[i].first == "bool remaproughness")
+		else if (name == "bool remaproughness")
 		{
-			material.remaproughness = parseBool(tokens[i].second);
+			material.remaproughness = parseBool(values);
 		}
-		else if (tokens[i].first == "float uroughness")
+		else if (name == "float uroughness")
 		{
-			material.uroughness = parseFloat(tokens[i].second);
+			material.uroughness = parseFloat(values);
 		}
-		else if (tokens[i].first == "float vroughness")
+		else if (name == "float vroughness")
 		{
-			material.vroughness = parseFloat(tokens[i].second);
+			material.vroughness = parseFloat(values);
 		}
-		else if (tokens[i].first == "float sigma")
+		else if (name == "float sigma")
 		{
-			material.sigma = parseFloat(tokens[i].second);
+			material.sigma = parseFloat(values);
 		}
-		else if (tokens[i].first == "texture Kd")
+		else if (name == "texture Kd")
 		{
-			material.tex_Kd = parseString(tokens[i].second);
+			material.tex_Kd = parseString(values);
 		}
-		else if (tokens[i].first == "texture bumpmap")
+		else if (name == "texture bumpmap")
 		{
-			material.tex_bumpmap = parseString(tokens[i].second);
+			material.tex_bumpmap = parseString(values);
 		}
-		else if (tokens[i].first == "texture opacity")
+		else if (name == "texture opacity")
 		{
-			material.tex_opacity = parseString(tokens[i].second);
+			material.tex_opacity = parseString(values);
 		}
 		else
 		{
 			if (i != 0)
 			{
-				LOG_FATAL("%s not handled", tokens[i].first);
+				LOG_FATAL("%s not handled", name.str().c_str());
 			}
 		}
 	}
 
-	AddToScene(tokens[0].first, material);
+	AddToScene(material.name, material);
+}
+
+void PbrtScene::loadResources()
+{
+	// The managers are not thread safe, but every resource was created while parsing, so the workers only load
+	// them. A file that is referenced several times is loaded once.
+	std::vector<bow::ResourcePtr> resources;
+	std::set<bow::Resource*> unique;
+	for (unsigned int i = 0; i < m_pendingShapes.size(); i++)
+	{
+		if (unique.insert(m_pendingShapes[i].mesh.get()).second)
+			resources.push_back(m_pendingShapes[i].mesh);
+	}
+	for (unsigned int i = 0; i < m_pendingTextures.size(); i++)
+	{
+		if (unique.insert(m_pendingTextures[i].image.get()).second)
+			resources.push_back(m_pendingTextures[i].image);
+	}
+
+	unsigned int numThreads = m_numLoadThreads > 0 ? m_numLoadThreads : std::thread::hardware_concurrency();
+	numThreads = std::max(1u, std::min(numThreads, (unsigned int)resources.size()));
+
+	std::atomic<size_t> nextResource(0);
+	auto worker = [&]() {
+		for (size_t i = nextResource++; i < resources.size(); i = nextResource++)
+		{
+			resources[i]->VLoad();
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (unsigned int i = 1; i < numThreads; i++)
+	{
+		workers.push_back(std::thread(worker));
+	}
+	worker();
+	for (unsigned int i = 0; i < workers.size(); i++)
+	{
+		workers[i].join();
+	}
+
+	// added in file order, as before
+	for (unsigned int i = 0; i < m_pendingShapes.size(); i++)
+	{
+		AddToScene(m_pendingShapes[i].mesh, m_pendingShapes[i].materialName);
+	}
+	for (unsigned int i = 0; i < m_pendingTextures.size(); i++)
+	{
+		AddToScene(m_pendingTextures[i].name, m_pendingTextures[i].image);
+	}
+
+	m_pendingShapes.clear();
+	m_pendingTextures.clear();
 }
 
-void PbrtScene::AddToScene(bow::MeshPtr mesh)
+void PbrtScene::AddToScene(bow::MeshPtr mesh, const std::string& materialName)
 {
 	m_meshes.push_back(mesh);
 	std::vector<bow::SubMesh*> subMeshes = mesh->GetSubMeshes();
 	for (unsigned int i = 0; i < subMeshes.size(); i++)
 	{
-		subMeshes[i]->SetMaterialName(m_currentMaterialName);
+		subMeshes[i]->SetMaterialName(materialName);
 	}
 	m_subMeshes.insert(m_subMeshes.end(), subMeshes.begin(), subMeshes.end());
 }
@@ -635,43 +557,3 @@ void PbrtScene::AddToScene(const std::string& name, PbrtMaterial& material)
 {
 
 }
-
-// See
-// http://stackoverflow.com/questions/6089231/getting-std-ifstream-to-handle-lf-cr-and-crlf
-std::istream& PbrtScene::safeGetline(std::istream &is, std::string &t)
-{
-	t.clear();
-
-	// The characters in the stream are read one-by-one using a std::streambuf.
-	// That is faster than reading them one-by-one using the std::istream.
-	// Code that uses streambuf this way must be guarded by a sentry object.
-	// The sentry object performs various tasks,
-	// such as thread synchronization and updating the stream state.
-
-	std::istream::sentry se(is, true);
-	std::streambuf *sb = is.rdbuf();
-
-	if (se)
-	{
-		for (;;)
-		{
-			int c = sb->sbumpc();
-			switch (c)
-			{
-			case '\n':
-				return is;
-			case '\r':
-				if (sb->sgetc() == '\n') sb->sbumpc();
-				return is;
-			case EOF:
-				// Also handle the case when the last line has no line ending
-				if (t.empty()) is.setstate(std::ios::eofbit);
-				return is;
-			default:
-				t += static_cast<char>(c);
-			}
-		}
-	}
-
-	return is;
-}
\ No newline at end of file
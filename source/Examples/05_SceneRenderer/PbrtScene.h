@@ -50,6 +50,10 @@ struct PbrtMaterial
 	}
 };
 
+namespace bow {
+	struct PbrtParameter;
+}
+
 class PbrtScene
 {
 public:
@@ -58,6 +62,11 @@ public:
 
 	bool parseFile(std::string filePath);
 
+	// Number of threads that load the meshes and textures of the scene, 0 uses all cores
+	void setNumLoadThreads(unsigned int numThreads) {
+		m_numLoadThreads = numThreads;
+	}
+
 	std::vector<bow::SubMesh*>& GetSubMeshes() {
 		return m_subMeshes;
 	}
@@ -67,18 +76,35 @@ public:
 	}
 	
 private:
-	std::istream& safeGetline(std::istream &is, std::string &t);
-	void parse(const std::string& filepath, char* dataFromDisk);
+	void parse(const std::string& filepath, const char* data, size_t sizeInBytes);
 
-	void loadShape(const std::string& filepath, const std::string& parameters);
-	void loadTexture(const std::string& filepath, const std::string& parameters);
-	void loadMaterial(const std::string & filepath, const std::string & parameters);
+	void loadShape(const std::string& filepath, const bow::PbrtParameter* parameters, size_t numParameters);
+	void loadTexture(const std::string& filepath, const bow::PbrtParameter* parameters, size_t numParameters);
+	void loadMaterial(const std::string & filepath, const bow::PbrtParameter* parameters, size_t numParameters);
+	void loadResources();
 
-	void AddToScene(bow::MeshPtr mesh);
+	void AddToScene(bow::MeshPtr mesh, const std::string& materialName);
 	void AddToScene(const std::string& name, bow::ImagePtr image);
 	void AddToScene(const std::string& name, PbrtMaterial& material);
 
+	// Shapes and textures found while parsing, loaded all at once afterwards
+	struct PendingShape
+	{
+		bow::MeshPtr	mesh;
+		std::string		materialName;
+	};
+
+	struct PendingTexture
+	{
+		std::string		name;
+		bow::ImagePtr	image;
+	};
+
 	std::string								m_currentMaterialName;
+	std::vector<PendingShape>				m_pendingShapes;
+	std::vector<PendingTexture>				m_pendingTextures;
+	unsigned int							m_numLoadThreads;
+
 	std::map<std::string, bow::ImagePtr>	m_textures;
 	std::map<std::string, PbrtMaterial>		m_materials;
 	std::vector<bow::SubMesh*>				m_subMeshes;
@@ -6,6 +6,7 @@
 #include "FirstPersonCamera.h"
 #include "PbrtScene.h"
 
+#include <cstdlib>
 #include <iostream>
 
 std::string vertexShader = R"(#version 140
@@ -54,7 +55,8 @@ void main(void)
 	out_Color += (0.1 * diffuseColor.rgb);
 })";
 
-int main()
+// Usage: 05_SceneRenderer [scene.pbrt] [number of load threads, 0 uses all cores]
+int main(int argc, char* argv[])
 {
 	// Creating Render Device
 	bow::RenderDevicePtr deviceOGL = bow::RenderDeviceManager::GetInstance().GetOrCreateDevice(bow::RenderDeviceAPI::OpenGL3x);
@@ -75,8 +77,14 @@ int main()
 	///////////////////////////////////////////////////////////////////
 	// Vertex Array from Mesh
 
+	std::string scenePath = argc > 1 ? argv[1] : "C:/Users/Artur/Downloads/staircase2/scene.pbrt";
+
 	PbrtScene scene;
-	scene.parseFile("C:/Users/Artur/Downloads/staircase2/scene.pbrt");
+	if (argc > 2)
+	{
+		scene.setNumLoadThreads((unsigned int)std::atoi(argv[2]));
+	}
+	scene.parseFile(scenePath);
 
 	std::vector<bow::MeshPtr> meshes = scene.GetMeshes();
 	std::vector<bow::VertexArrayPtr> vertexArrays;
@@ -0,0 +1,77 @@
+#include <RenderDevice/BowRenderer.h>
+
+#include <CoreSystems/BowLogger.h>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Upload throughput of camera sized frames into textures, the way bow::Application streams its color, IR and depth
+// images. Runs on any OpenGL 3.x driver, for the software rasterizer of Mesa start it with LIBGL_ALWAYS_SOFTWARE=1.
+
+const int g_width = 1280;
+const int g_height = 960;
+const int g_numFrames = 200;
+
+void MeasureUploads(bow::RenderDevicePtr device, const std::string& name, bow::TextureFormat textureFormat, void* image, bow::ImageFormat imageFormat, bow::ImageDatatype imageDatatype)
+{
+	bow::Texture2DPtr texture = device->VCreateTexture2D(bow::Texture2DDescription(g_width, g_height, textureFormat, false));
+
+	// first upload allocates the upload buffers
+	texture->VCopyFromSystemMemory(image, imageFormat, imageDatatype);
+	texture->VCopyToSystemMemory(imageFormat, imageDatatype);
+
+	auto start = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < g_numFrames; i++)
+	{
+		texture->VCopyFromSystemMemory(image, imageFormat, imageDatatype);
+	}
+
+	// reading the texture back waits for all uploads
+	texture->VCopyToSystemMemory(imageFormat, imageDatatype);
+	std::chrono::duration<double> duration = std::chrono::high_resolution_clock::now() - start;
+
+	const double megaBytes = (double)g_numFrames * bow::RequiredSizeInBytes(g_width, g_height, imageFormat, imageDatatype, 4) / (1024.0 * 1024.0);
+	std::cout << name << ": " << duration.count() * 1000.0 / g_numFrames << " ms per frame, " << megaBytes / duration.count() << " MB/s" << std::endl;
+}
+
+int main(int /*argc*/, char* /*argv[]*/)
+{
+	// Creating Render Device
+	bow::RenderDevicePtr deviceOGL = bow::RenderDeviceManager::GetInstance().GetOrCreateDevice(bow::RenderDeviceAPI::OpenGL3x);
+	if (deviceOGL == nullptr)
+	{
+		std::cout << "Could not create device!" << std::endl;
+		return -1;
+	}
+
+	// Creating Window, needed for the context
+	bow::GraphicsWindowPtr windowOGL = deviceOGL->VCreateWindow(320, 240, "TextureUpload", bow::WindowType::Windowed);
+	if (windowOGL == nullptr)
+	{
+		std::cout << "Could not create window!" << std::endl;
+		return -1;
+	}
+
+	std::vector<unsigned char> rgbImage(g_width * g_height * 3);
+	std::vector<float> rgbFloatImage(g_width * g_height * 3);
+	std::vector<float> depthImage(g_width * g_height);
+	for (int i = 0; i < g_width * g_height; i++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			rgbImage[i * 3 + c] = (unsigned char)((i + c * 85) % 256);
+			rgbFloatImage[i * 3 + c] = rgbImage[i * 3 + c] / 255.0f;
+		}
+		depthImage[i] = (float)(i % g_width) / g_width;
+	}
+
+	std::cout << g_width << "x" << g_height << ", " << g_numFrames << " frames" << std::endl;
+	MeasureUploads(deviceOGL, "RGB8 from unsigned byte", bow::TextureFormat::RedGreenBlue8, rgbImage.data(), bow::ImageFormat::RedGreenBlue, bow::ImageDatatype::UnsignedByte);
+	MeasureUploads(deviceOGL, "RGB8 from float", bow::TextureFormat::RedGreenBlue8, rgbFloatImage.data(), bow::ImageFormat::RedGreenBlue, bow::ImageDatatype::Float);
+	MeasureUploads(deviceOGL, "R32F from float", bow::TextureFormat::Red32f, depthImage.data(), bow::ImageFormat::Red, bow::ImageDatatype::Float);
+	MeasureUploads(deviceOGL, "R8 from float", bow::TextureFormat::Red8, depthImage.data(), bow::ImageFormat::Red, bow::ImageDatatype::Float);
+
+	return 0;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "CameraUtils/CameraUtils_api.h"
+
+#include "CoreSystems/BowCoreSystems.h"
+
+//opencv
+#include <opencv2/opencv.hpp>
+
+namespace bow {
+	struct frameBufferPool_data;
+
+	/// Recycles the image memory of the per-frame intermediates of a renderer.
+	/// Acquire returns a cv::Mat whose memory comes from the pool, 64 byte aligned. The buffer goes back to the pool
+	/// when the last cv::Mat referencing it is released, so frames can be handed to the recording queues and the
+	/// FrameEncoderPool without cloning them, and they are reused as soon as the writer is done with them.
+	/// Acquire and the release of frames may happen on different threads, the pool has to outlive all frames it handed out.
+	class CAMERAUTILS_API FrameBufferPool
+	{
+	public:
+		static const size_t Alignment = 64;
+
+		/// width and height are the sensor resolution used by Acquire(type)
+		FrameBufferPool(unsigned int width, unsigned int height, unsigned int maxFreeBuffersPerSize = 16);
+		~FrameBufferPool();
+
+		/// A frame of the sensor resolution
+		cv::Mat Acquire(int type);
+		cv::Mat Acquire(int rows, int cols, int type);
+
+		/// Allocates count buffers for frames of the sensor resolution up front, so the first frames do not page fault
+		void Reserve(int type, unsigned int count);
+
+		/// Number of buffers allocated from the system and number of Acquire calls served from released buffers
+		unsigned long long GetNumAllocations() const;
+		unsigned long long GetNumReuses() const;
+
+	private:
+		FrameBufferPool(const FrameBufferPool&) {}; // You shall not copy
+		FrameBufferPool& operator=(const FrameBufferPool&) { return *this; }
+
+		frameBufferPool_data* m_data;
+	};
+}
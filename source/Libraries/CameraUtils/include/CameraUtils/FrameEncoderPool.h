@@ -0,0 +1,83 @@
+#pragma once
+#include "CameraUtils/CameraUtils_api.h"
+
+#include "CoreSystems/BowCoreSystems.h"
+
+#include <string>
+
+//opencv
+#include <opencv2/opencv.hpp>
+
+namespace bow {
+	struct frameEncoderPool_data;
+
+	/// zlib strategies that are exposed by the OpenCV png writer
+	enum class PngStrategy : int
+	{
+		Default = cv::IMWRITE_PNG_STRATEGY_DEFAULT,
+		Filtered = cv::IMWRITE_PNG_STRATEGY_FILTERED,
+		HuffmanOnly = cv::IMWRITE_PNG_STRATEGY_HUFFMAN_ONLY,
+		RLE = cv::IMWRITE_PNG_STRATEGY_RLE,
+		Fixed = cv::IMWRITE_PNG_STRATEGY_FIXED
+	};
+
+	struct CAMERAUTILS_API FrameEncoderSettings
+	{
+	public:
+		FrameEncoderSettings()
+		{
+			numWorkers = 0;
+			compressionLevel = 3;
+			strategy = PngStrategy::Default;
+			deferCompression = false;
+			discardOutput = false;
+		}
+
+		unsigned int	numWorkers;			///< 0 uses one worker per hardware thread
+		int				compressionLevel;	///< zlib level 0 (store) to 9 (smallest)
+		PngStrategy		strategy;
+		bool			deferCompression;	///< write raw frames (<file>.raw, skipped by DataLoader) while recording, compress them in CompressDeferred()
+		bool			discardOutput;		///< encode only, nothing is written to disk (throughput measurements)
+	};
+
+	/// Compresses frames to png on a pool of worker threads.
+	/// Frames are encoded concurrently but the files of one stream are always written in the order they were enqueued.
+	class CAMERAUTILS_API FrameEncoderPool
+	{
+	public:
+		FrameEncoderPool(const FrameEncoderSettings& settings = FrameEncoderSettings());
+		~FrameEncoderPool();
+
+		/// Creates a new stream of frames, the returned id is passed to Enqueue
+		unsigned int CreateStream(const std::string& name, bool swapRedBlue = false);
+
+		/// Queues a frame for encoding, the pool takes a reference to the frame data so the caller must not modify it afterwards
+		void Enqueue(unsigned int stream, const std::string& fileName, const cv::Mat& frame);
+
+		/// Blocks until all queued frames have been written
+		void Flush();
+
+		/// Queues all raw frames written in deferred mode for compression and returns immediately
+		void CompressDeferred();
+
+		bool IsBusy();
+
+		/// Frames of all streams that could not be encoded or written since the last ResetStatistics, every failure is logged
+		unsigned long long GetNumFailedFrames();
+
+		const FrameEncoderSettings& GetSettings() const;
+
+		/// Prints frame count and frames per second of every stream
+		void PrintStatistics();
+		void ResetStatistics();
+
+		/// Encodes numFrames copies of sample at every compression level and prints the reached frames per second
+		static void MeasureThroughput(const cv::Mat& sample, unsigned int numFrames, const FrameEncoderSettings& settings);
+
+	private:
+		FrameEncoderPool(const FrameEncoderPool&) {}; // You shall not copy
+		FrameEncoderPool& operator=(const FrameEncoderPool&) { return *this; }
+
+		frameEncoderPool_data* m_data;
+	};
+}
@@ -22,6 +22,12 @@ namespace bow {
 			calibration_checkerboard_width = 8;
 			calibration_checkerboard_height = 5;
 			calibration_checkerboard_squareSize = 36.0f;
+
+			recording_encoder_threads = 0;
+			recording_png_compression = 3;
+			recording_png_strategy = 0;
+			recording_defer_compression = false;
+			recording_compress_depth = true;
 		}
 		~RenderingConfigs(){}
 
@@ -34,6 +40,12 @@ namespace bow {
 		int calibration_checkerboard_width;
 		int calibration_checkerboard_height;
 		float calibration_checkerboard_squareSize;
+
+		int recording_encoder_threads;		// 0 = one per hardware thread
+		int recording_png_compression;		// zlib level 0-9
+		int recording_png_strategy;			// cv::IMWRITE_PNG_STRATEGY_*
+		bool recording_defer_compression;	// store raw frames and compress when the recording stops
+		bool recording_compress_depth;		// write depth and range frames with the lossless DepthCodec
 	};
 
 	class CAMERAUTILS_API ConfigLoader
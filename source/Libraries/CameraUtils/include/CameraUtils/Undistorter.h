@@ -0,0 +1,55 @@
+#pragma once
+#include "CameraUtils/CameraUtils_api.h"
+
+#include "CameraUtils/CameraCalibration.h"
+
+#include <mutex>
+#include <vector>
+
+//opencv
+#include <opencv2/opencv.hpp>
+
+namespace bow {
+
+	/// Replacement for per frame cv::undistort calls.
+	/// The undistortion maps are built once per set of intrinsic parameters and image size (fixed-point CV_16SC2, like cv::undistort)
+	/// and reused for every following frame, so one instance can serve the rgb and ir stream of a camera at the same time.
+	/// Frames are remapped bilinearly with a constant border like cv::undistort does.
+	class CAMERAUTILS_API Undistorter
+	{
+	public:
+		Undistorter();
+		~Undistorter();
+
+		/// Removes the lens distortion of src, dst is allocated with the size and type of src
+		void Undistort(const cv::Mat& src, cv::Mat& dst, const IntrinsicCameraParameters& cameraParameters);
+
+		/// Undistorts src and folds it into the running mean of the previous frames: mean = mean * (1 - a) + undistorted * a with a = 1 / (frameIndex + 1).
+		/// mean is (re)allocated as CV_64F with the channel count of src when its size or type does not fit, frameIndex 0 overwrites it.
+		void UndistortAccumulate(const cv::Mat& src, cv::Mat& mean, unsigned int frameIndex, const IntrinsicCameraParameters& cameraParameters);
+
+		/// Releases all cached maps
+		void Clear();
+
+		unsigned int GetNumCachedMaps();
+
+	private:
+		Undistorter(const Undistorter&) {}; // You shall not copy
+		Undistorter& operator=(const Undistorter&) { return *this; }
+
+		struct UndistortionMaps
+		{
+			cv::Mat		cameraMatrix;
+			cv::Mat		distCoeffs;
+			cv::Size	imageSize;
+
+			cv::Mat		map1;	///< CV_16SC2 integer coordinates
+			cv::Mat		map2;	///< CV_16UC1 interpolation table indices
+		};
+
+		void getMaps(const IntrinsicCameraParameters& cameraParameters, const cv::Size& imageSize, cv::Mat& map1, cv::Mat& map2);
+
+		std::vector<UndistortionMaps>	m_maps;
+		std::mutex						m_mapsMutex;
+	};
+}
@@ -0,0 +1,198 @@
+#include "CameraUtils/FrameBufferPool.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#if defined(_WIN32) || defined(WIN32)
+#include <malloc.h>
+#endif
+
+namespace bow
+{
+#if CV_VERSION_MAJOR >= 4
+	typedef cv::AccessFlag MatAccessFlag;
+#else
+	typedef int MatAccessFlag;
+#endif
+
+	const size_t FrameBufferPool::Alignment;
+
+	static void* allocateAligned(size_t sizeInBytes)
+	{
+#if defined(_WIN32) || defined(WIN32)
+		return _aligned_malloc(sizeInBytes, FrameBufferPool::Alignment);
+#else
+		void* memory = nullptr;
+		return posix_memalign(&memory, FrameBufferPool::Alignment, sizeInBytes) == 0 ? memory : nullptr;
+#endif
+	}
+
+	static void freeAligned(void* memory)
+	{
+#if defined(_WIN32) || defined(WIN32)
+		_aligned_free(memory);
+#else
+		free(memory);
+#endif
+	}
+
+	// Allocator of the frames handed out by the pool, OpenCV calls deallocate once the last cv::Mat of a buffer is gone
+	class PoolMatAllocator : public cv::MatAllocator
+	{
+	public:
+		PoolMatAllocator(unsigned int maxFreeBuffersPerSize) : m_maxFreeBuffersPerSize(maxFreeBuffersPerSize), m_numAllocations(0), m_numReuses(0) {}
+
+		~PoolMatAllocator()
+		{
+			for (std::multimap<size_t, void*>::iterator it = m_freeBuffers.begin(); it != m_freeBuffers.end(); ++it)
+			{
+				freeAligned(it->second);
+			}
+		}
+
+		cv::UMatData* allocate(int dims, const int* sizes, int type, void* data0, size_t* step, MatAccessFlag /*flags*/, cv::UMatUsageFlags /*usageFlags*/) const
+		{
+			// frames are always continuous
+			size_t total = CV_ELEM_SIZE(type);
+			for (int i = dims - 1; i >= 0; i--)
+			{
+				if (step)
+				{
+					step[i] = total;
+				}
+				total *= sizes[i];
+			}
+
+			uchar* data = data0 ? (uchar*)data0 : (uchar*)acquire(total);
+			if (data == nullptr)
+			{
+				CV_Error(cv::Error::StsNoMem, "FrameBufferPool: out of memory");
+			}
+
+			cv::UMatData* u = new cv::UMatData(this);
+			u->data = u->origdata = data;
+			u->size = total;
+			if (data0)
+			{
+				u->flags |= cv::UMatData::USER_ALLOCATED;
+			}
+			return u;
+		}
+
+		bool allocate(cv::UMatData* u, MatAccessFlag /*accessFlags*/, cv::UMatUsageFlags /*usageFlags*/) const
+		{
+			return u != nullptr;
+		}
+
+		void deallocate(cv::UMatData* u) const
+		{
+			if (u == nullptr)
+				return;
+
+			CV_Assert(u->urefcount == 0);
+			CV_Assert(u->refcount == 0);
+			if (!(u->flags & cv::UMatData::USER_ALLOCATED))
+			{
+				release(u->origdata, u->size);
+			}
+			delete u;
+		}
+
+		void* acquire(size_t sizeInBytes) const
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				std::multimap<size_t, void*>::iterator it = m_freeBuffers.find(sizeInBytes);
+				if (it != m_freeBuffers.end())
+				{
+					void* memory = it->second;
+					m_freeBuffers.erase(it);
+					m_numReuses++;
+					return memory;
+				}
+				m_numAllocations++;
+			}
+			return allocateAligned(sizeInBytes);
+		}
+
+		void release(void* memory, size_t sizeInBytes) const
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (m_freeBuffers.count(sizeInBytes) < m_maxFreeBuffersPerSize)
+				{
+					m_freeBuffers.insert(std::make_pair(sizeInBytes, memory));
+					return;
+				}
+			}
+			// the writer fell behind and has caught up, more buffers of this size than needed
+			freeAligned(memory);
+		}
+
+		unsigned int						m_maxFreeBuffersPerSize;
+		mutable std::mutex					m_mutex;
+		mutable std::multimap<size_t, void*> m_freeBuffers;
+		mutable unsigned long long			m_numAllocations;
+		mutable unsigned long long			m_numReuses;
+	};
+
+	struct frameBufferPool_data
+	{
+		frameBufferPool_data(unsigned int width, unsigned int height, unsigned int maxFreeBuffersPerSize) : width(width), height(height), allocator(maxFreeBuffersPerSize) {}
+
+		unsigned int		width;
+		unsigned int		height;
+		PoolMatAllocator	allocator;
+	};
+
+	// ======================================================================
+
+	FrameBufferPool::FrameBufferPool(unsigned int width, unsigned int height, unsigned int maxFreeBuffersPerSize) : m_data(new frameBufferPool_data(width, height, maxFreeBuffersPerSize))
+	{
+	}
+
+	FrameBufferPool::~FrameBufferPool()
+	{
+		delete m_data;
+		m_data = nullptr;
+	}
+
+	cv::Mat FrameBufferPool::Acquire(int type)
+	{
+		return Acquire(m_data->height, m_data->width, type);
+	}
+
+	cv::Mat FrameBufferPool::Acquire(int rows, int cols, int type)
+	{
+		cv::Mat frame;
+		frame.allocator = &m_data->allocator;
+		frame.create(rows, cols, type);
+		return frame;
+	}
+
+	void FrameBufferPool::Reserve(int type, unsigned int count)
+	{
+		// held at the same time, otherwise every Acquire would get the same buffer back
+		std::vector<cv::Mat> frames(count);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			frames[i] = Acquire(type);
+			memset(frames[i].data, 0, frames[i].total() * frames[i].elemSize());
+		}
+	}
+
+	unsigned long long FrameBufferPool::GetNumAllocations() const
+	{
+		std::lock_guard<std::mutex> lock(m_data->allocator.m_mutex);
+		return m_data->allocator.m_numAllocations;
+	}
+
+	unsigned long long FrameBufferPool::GetNumReuses() const
+	{
+		std::lock_guard<std::mutex> lock(m_data->allocator.m_mutex);
+		return m_data->allocator.m_numReuses;
+	}
+}
@@ -0,0 +1,475 @@
+#include "CameraUtils/FrameEncoderPool.h"
+
+#include "CoreSystems/BowLogger.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace bow
+{
+	typedef std::chrono::high_resolution_clock EncoderClock;
+
+	struct EncodeJob
+	{
+		unsigned int		stream;
+		unsigned long long	sequence;
+		std::string			fileName;		// final png file
+		std::string			rawFileName;	// set when the job compresses a deferred raw frame
+		cv::Mat				frame;
+	};
+
+	struct EncodedFrame
+	{
+		std::string			fileName;
+		std::string			removeAfterWrite;
+		std::string			deferredFileName;
+		std::vector<uchar>	buffer;		// empty if the frame could not be encoded
+		double				encodeSeconds;
+	};
+
+	struct EncoderStream
+	{
+		std::string			name;
+		bool				swapRedBlue;
+		bool				writing;
+		unsigned long long	nextSequence;
+		unsigned long long	nextToWrite;
+		std::map<unsigned long long, EncodedFrame> pending;
+		std::vector<std::string> deferredFiles;
+
+		unsigned long long	framesWritten;
+		unsigned long long	framesFailed;	// not encoded or not written, a deferred raw frame is kept
+		size_t				bytesWritten;
+		double				encodeSeconds;
+		EncoderClock::time_point firstEnqueue;
+		EncoderClock::time_point lastWrite;
+	};
+
+	struct frameEncoderPool_data
+	{
+		FrameEncoderSettings		settings;
+		std::vector<std::thread>	workers;
+		std::vector<EncoderStream>	streams;
+		std::deque<EncodeJob>		jobs;
+		unsigned long long			outstandingFrames;	// enqueued but not yet written
+		bool						stop;
+
+		std::mutex					mutex;
+		std::condition_variable		jobAvailable;
+		std::condition_variable		allWritten;
+	};
+
+	// ======================================================================
+
+	static std::string rawFileNameFor(const std::string& fileName)
+	{
+		return fileName + ".raw";
+	}
+
+	static void serializeRaw(const cv::Mat& frame, std::vector<uchar>& buffer)
+	{
+		int header[3] = { frame.rows, frame.cols, frame.type() };
+		size_t rowBytes = frame.cols * frame.elemSize();
+
+		buffer.resize(sizeof(header) + rowBytes * frame.rows);
+		memcpy(&buffer[0], header, sizeof(header));
+		for (int row = 0; row < frame.rows; row++)
+		{
+			memcpy(&buffer[sizeof(header) + row * rowBytes], frame.ptr(row), rowBytes);
+		}
+	}
+
+	static cv::Mat loadRaw(const std::string& fileName)
+	{
+		cv::Mat frame;
+		FILE* pFile = fopen(fileName.c_str(), "rb");
+		if (pFile == nullptr)
+		{
+			LOG_ERROR("FrameEncoderPool: Could not open raw frame %s.", fileName.c_str());
+			return frame;
+		}
+
+		int header[3];
+		if (fread(header, sizeof(int), 3, pFile) == 3 && header[0] > 0 && header[1] > 0)
+		{
+			frame.create(header[0], header[1], header[2]);
+			size_t numBytes = frame.total() * frame.elemSize();
+			if (fread(frame.data, 1, numBytes, pFile) != numBytes)
+			{
+				LOG_ERROR("FrameEncoderPool: Raw frame %s is truncated.", fileName.c_str());
+				frame.release();
+			}
+		}
+		fclose(pFile);
+		return frame;
+	}
+
+	static bool writeFile(const std::string& fileName, const std::vector<uchar>& buffer)
+	{
+		FILE* pFile = fopen(fileName.c_str(), "wb");
+		if (pFile == nullptr)
+		{
+			LOG_ERROR("FrameEncoderPool: Could not open %s for writing.", fileName.c_str());
+			return false;
+		}
+		size_t written = fwrite(buffer.data(), 1, buffer.size(), pFile);
+		fclose(pFile);
+		if (written != buffer.size())
+		{
+			LOG_ERROR("FrameEncoderPool: Could not write %s.", fileName.c_str());
+			return false;
+		}
+		return true;
+	}
+
+	static void encodeJob(frameEncoderPool_data* data, EncodeJob& job, bool swapRedBlue, EncodedFrame& result)
+	{
+		EncoderClock::time_point start = EncoderClock::now();
+
+		if (data->settings.deferCompression && job.rawFileName.empty())
+		{
+			// cheap path while recording, the frame is compressed later on
+			serializeRaw(job.frame, result.buffer);
+			result.fileName = rawFileNameFor(job.fileName);
+			result.deferredFileName = job.fileName;
+		}
+		else
+		{
+			cv::Mat frame = job.rawFileName.empty() ? job.frame : loadRaw(job.rawFileName);
+			if (swapRedBlue && frame.channels() == 3)
+			{
+				cv::Mat swapped;
+				cv::cvtColor(frame, swapped, CV_BGR2RGB);
+				frame = swapped;
+			}
+
+			std::vector<int> params;
+			params.push_back(cv::IMWRITE_PNG_COMPRESSION);
+			params.push_back(data->settings.compressionLevel);
+			params.push_back(cv::IMWRITE_PNG_STRATEGY);
+			params.push_back((int)data->settings.strategy);
+
+			if (frame.empty() || !cv::imencode(".png", frame, result.buffer, params))
+			{
+				result.buffer.clear();
+				LOG_ERROR("FrameEncoderPool: Could not encode %s%s.", job.fileName.c_str(), job.rawFileName.empty() ? "" : ", the raw frame is kept");
+			}
+			result.fileName = job.fileName;
+			result.removeAfterWrite = job.rawFileName;
+		}
+
+		result.encodeSeconds = std::chrono::duration<double>(EncoderClock::now() - start).count();
+	}
+
+	// Writes all frames of the stream that are next in line. Only one thread writes a stream at a time,
+	// lock has to be held when calling and is held again on return.
+	static void commitFrames(frameEncoderPool_data* data, unsigned int streamId, std::unique_lock<std::mutex>& lock)
+	{
+		EncoderStream* stream = &data->streams[streamId];
+		if (stream->writing)
+		{
+			return;
+		}
+		stream->writing = true;
+
+		for (;;)
+		{
+			std::map<unsigned long long, EncodedFrame>::iterator next = stream->pending.find(stream->nextToWrite);
+			if (next == stream->pending.end())
+			{
+				break;
+			}
+
+			EncodedFrame frame;
+			std::swap(frame, next->second);
+			stream->pending.erase(next);
+
+			lock.unlock();
+			bool written = !frame.buffer.empty();
+			if (written && !data->settings.discardOutput)
+			{
+				written = writeFile(frame.fileName, frame.buffer);
+				if (written && !frame.removeAfterWrite.empty())
+				{
+					remove(frame.removeAfterWrite.c_str());
+				}
+			}
+			lock.lock();
+
+			// streams may have been added while unlocked
+			stream = &data->streams[streamId];
+			stream->nextToWrite++;
+			if (!written)
+			{
+				stream->framesFailed++;
+				data->outstandingFrames--;
+				continue;
+			}
+			stream->framesWritten++;
+			stream->bytesWritten += frame.buffer.size();
+			stream->encodeSeconds += frame.encodeSeconds;
+			stream->lastWrite = EncoderClock::now();
+			if (!frame.deferredFileName.empty())
+			{
+				stream->deferredFiles.push_back(frame.deferredFileName);
+			}
+
+			data->outstandingFrames--;
+		}
+
+		stream->writing = false;
+		if (data->outstandingFrames == 0)
+		{
+			data->allWritten.notify_all();
+		}
+	}
+
+	static void encoderWorkerProc(frameEncoderPool_data* data)
+	{
+		std::unique_lock<std::mutex> lock(data->mutex);
+		for (;;)
+		{
+			data->jobAvailable.wait(lock, [data]() { return data->stop || !data->jobs.empty(); });
+			if (data->jobs.empty())
+			{
+				return; // stop requested and nothing left to do
+			}
+
+			EncodeJob job = data->jobs.front();
+			data->jobs.pop_front();
+			bool swapRedBlue = data->streams[job.stream].swapRedBlue;
+			lock.unlock();
+
+			EncodedFrame result;
+			encodeJob(data, job, swapRedBlue, result);
+			job.frame.release();
+
+			lock.lock();
+			data->streams[job.stream].pending[job.sequence] = std::move(result);
+			commitFrames(data, job.stream, lock);
+		}
+	}
+
+	// ======================================================================
+
+	FrameEncoderPool::FrameEncoderPool(const FrameEncoderSettings& settings)
+	{
+		m_data = new frameEncoderPool_data();
+		m_data->settings = settings;
+		m_data->settings.compressionLevel = std::max(0, std::min(9, settings.compressionLevel));
+		m_data->outstandingFrames = 0;
+		m_data->stop = false;
+
+		unsigned int numWorkers = settings.numWorkers;
+		if (numWorkers == 0)
+		{
+			numWorkers = std::max(1u, std::thread::hardware_concurrency());
+		}
+
+		for (unsigned int i = 0; i < numWorkers; i++)
+		{
+			m_data->workers.push_back(std::thread(encoderWorkerProc, m_data));
+		}
+	}
+
+	FrameEncoderPool::~FrameEncoderPool()
+	{
+		if (m_data->settings.deferCompression)
+		{
+			// don't leave raw frames behind
+			CompressDeferred();
+		}
+		Flush();
+
+		{
+			std::lock_guard<std::mutex> lock(m_data->mutex);
+			m_data->stop = true;
+		}
+		m_data->jobAvailable.notify_all();
+
+		for (size_t i = 0; i < m_data->workers.size(); i++)
+		{
+			m_data->workers[i].join();
+		}
+
+		delete m_data;
+		m_data = nullptr;
+	}
+
+	unsigned int FrameEncoderPool::CreateStream(const std::string& name, bool swapRedBlue)
+	{
+		std::lock_guard<std::mutex> lock(m_data->mutex);
+
+		EncoderStream stream;
+		stream.name = name;
+		stream.swapRedBlue = swapRedBlue;
+		stream.writing = false;
+		stream.nextSequence = 0;
+		stream.nextToWrite = 0;
+		stream.framesWritten = 0;
+		stream.framesFailed = 0;
+		stream.bytesWritten = 0;
+		stream.encodeSeconds = 0.0;
+		m_data->streams.push_back(stream);
+
+		return (unsigned int)m_data->streams.size() - 1;
+	}
+
+	void FrameEncoderPool::Enqueue(unsigned int stream, const std::string& fileName, const cv::Mat& frame)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_data->mutex);
+			if (stream >= m_data->streams.size())
+			{
+				std::cout << "FrameEncoderPool: unknown stream " << stream << std::endl;
+				return;
+			}
+
+			EncoderStream& encoderStream = m_data->streams[stream];
+			if (encoderStream.framesWritten == 0 && encoderStream.nextSequence == encoderStream.nextToWrite)
+			{
+				encoderStream.firstEnqueue = EncoderClock::now();
+			}
+
+			EncodeJob job;
+			job.stream = stream;
+			job.sequence = encoderStream.nextSequence++;
+			job.fileName = fileName;
+			job.frame = frame;
+			m_data->jobs.push_back(job);
+			m_data->outstandingFrames++;
+		}
+		m_data->jobAvailable.notify_one();
+	}
+
+	void FrameEncoderPool::Flush()
+	{
+		std::unique_lock<std::mutex> lock(m_data->mutex);
+		m_data->allWritten.wait(lock, [this]() { return m_data->outstandingFrames == 0; });
+	}
+
+	void FrameEncoderPool::CompressDeferred()
+	{
+		// raw frames still in flight have to reach the disk before they can be compressed
+		Flush();
+
+		{
+			std::lock_guard<std::mutex> lock(m_data->mutex);
+			for (size_t s = 0; s < m_data->streams.size(); s++)
+			{
+				EncoderStream& stream = m_data->streams[s];
+				for (size_t i = 0; i < stream.deferredFiles.size(); i++)
+				{
+					EncodeJob job;
+					job.stream = (unsigned int)s;
+					job.sequence = stream.nextSequence++;
+					job.fileName = stream.deferredFiles[i];
+					job.rawFileName = rawFileNameFor(stream.deferredFiles[i]);
+					m_data->jobs.push_back(job);
+					m_data->outstandingFrames++;
+				}
+
+				if (!stream.deferredFiles.empty())
+				{
+					std::cout << "Compressing " << stream.deferredFiles.size() << " deferred " << stream.name << " frames in the background" << std::endl;
+				}
+				stream.deferredFiles.clear();
+			}
+		}
+		m_data->jobAvailable.notify_all();
+	}
+
+	bool FrameEncoderPool::IsBusy()
+	{
+		std::lock_guard<std::mutex> lock(m_data->mutex);
+		return m_data->outstandingFrames > 0;
+	}
+
+	unsigned long long FrameEncoderPool::GetNumFailedFrames()
+	{
+		std::lock_guard<std::mutex> lock(m_data->mutex);
+		unsigned long long numFailed = 0;
+		for (size_t s = 0; s < m_data->streams.size(); s++)
+		{
+			numFailed += m_data->streams[s].framesFailed;
+		}
+		return numFailed;
+	}
+
+	const FrameEncoderSettings& FrameEncoderPool::GetSettings() const
+	{
+		return m_data->settings;
+	}
+
+	void FrameEncoderPool::PrintStatistics()
+	{
+		std::lock_guard<std::mutex> lock(m_data->mutex);
+		for (size_t s = 0; s < m_data->streams.size(); s++)
+		{
+			const EncoderStream& stream = m_data->streams[s];
+			if (stream.framesFailed > 0)
+			{
+				std::cout << "[" << stream.name << "] " << stream.framesFailed << " frames could not be written" << std::endl;
+			}
+			if (stream.framesWritten == 0)
+			{
+				continue;
+			}
+
+			double wallSeconds = std::chrono::duration<double>(stream.lastWrite - stream.firstEnqueue).count();
+			std::cout << "[" << stream.name << "] " << stream.framesWritten << " frames"
+				<< ", level " << m_data->settings.compressionLevel
+				<< ", " << m_data->workers.size() << " workers"
+				<< (m_data->settings.deferCompression ? ", deferred" : "")
+				<< ": " << std::fixed << std::setprecision(1) << (wallSeconds > 0.0 ? stream.framesWritten / wallSeconds : 0.0) << " fps"
+				<< ", " << std::setprecision(2) << 1000.0 * stream.encodeSeconds / stream.framesWritten << " ms/frame encode"
+				<< ", " << std::setprecision(1) << stream.bytesWritten / (1024.0 * stream.framesWritten) << " KiB/frame" << std::endl;
+		}
+	}
+
+	void FrameEncoderPool::ResetStatistics()
+	{
+		std::lock_guard<std::mutex> lock(m_data->mutex);
+		for (size_t s = 0; s < m_data->streams.size(); s++)
+		{
+			EncoderStream& stream = m_data->streams[s];
+			stream.framesWritten = 0;
+			stream.framesFailed = 0;
+			stream.bytesWritten = 0;
+			stream.encodeSeconds = 0.0;
+			stream.firstEnqueue = EncoderClock::now();
+		}
+	}
+
+	void FrameEncoderPool::MeasureThroughput(const cv::Mat& sample, unsigned int numFrames, const FrameEncoderSettings& settings)
+	{
+		std::cout << "Measuring png throughput for " << sample.cols << "x" << sample.rows << " frames..." << std::endl;
+
+		for (int level = 0; level <= 9; level++)
+		{
+			FrameEncoderSettings levelSettings = settings;
+			levelSettings.compressionLevel = level;
+			levelSettings.deferCompression = false;
+			levelSettings.discardOutput = true;
+
+			FrameEncoderPool pool(levelSettings);
+			unsigned int stream = pool.CreateStream("Level " + std::to_string(level));
+			for (unsigned int i = 0; i < numFrames; i++)
+			{
+				pool.Enqueue(stream, "", sample);
+			}
+			pool.Flush();
+			pool.PrintStatistics();
+		}
+	}
+}
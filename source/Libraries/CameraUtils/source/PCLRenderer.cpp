@@ -2,15 +2,13 @@
 
 #include <CameraUtils/FirstPersonCamera.h>
 
+#include <algorithm>
 #include <mutex>
 
 #ifdef __unix__ 
 #include <unistd.h>
 #endif
 
-//opencv
-#include <opencv2/opencv.hpp>
-
 namespace bow
 {
 
@@ -164,6 +162,49 @@ namespace bow
 
 	std::mutex update_data_mutex;
 
+	// Vertex buffer of one attribute of a point cloud. It only grows, smaller clouds are written into the front.
+	struct pointAttributeBuffer
+	{
+		bow::VertexBufferPtr	buffer;
+		unsigned int			numPoints;
+		unsigned int			capacity;
+	};
+
+	pointAttributeBuffer CreatePointAttributeBuffer(RenderDevicePtr renderDevice)
+	{
+		pointAttributeBuffer attribute;
+		attribute.buffer = renderDevice->VCreateVertexBuffer(bow::BufferHint::DynamicDraw, 1 * sizeof(float) * 3);
+		attribute.numPoints = 0;
+		attribute.capacity = 1;
+		return attribute;
+	}
+
+	// Copies points to the buffer, returns true if a larger buffer had to be created which has to be set at the vertex arrays
+	bool UploadPoints(RenderDevicePtr renderDevice, pointAttributeBuffer& attribute, const std::vector<bow::Vector3<float>>& points)
+	{
+		const unsigned int numPoints = (unsigned int)points.size();
+
+		bool replaced = false;
+		if (numPoints > attribute.capacity)
+		{
+			// some headroom, clouds of a camera vary a little in size from frame to frame
+			attribute.capacity = std::max(numPoints, attribute.capacity + attribute.capacity / 2);
+			attribute.buffer = renderDevice->VCreateVertexBuffer(bow::BufferHint::DynamicDraw, (int)attribute.capacity * sizeof(float) * 3);
+			replaced = true;
+		}
+		else
+		{
+			attribute.buffer->VInvalidate();
+		}
+
+		if (numPoints > 0)
+		{
+			attribute.buffer->VCopyFromSystemMemory((void*)points.data(), 0, (int)numPoints * sizeof(bow::Vector3<float>));
+		}
+		attribute.numPoints = numPoints;
+		return replaced;
+	}
+
 	struct renderThread_data
 	{
 		bool		stopThread;
@@ -236,21 +277,24 @@ namespace bow
 		///////////////////////////////////////////////////////////////////
 		// Vertex Array for Pointclouds
 
-		bow::VertexBufferPtr vertexBuffer = renderDevice->VCreateVertexBuffer(bow::BufferHint::StaticDraw, 1 * sizeof(float) * 3);
-		bow::VertexBufferPtr colorBuffer = renderDevice->VCreateVertexBuffer(bow::BufferHint::StaticDraw, 1 * sizeof(float) * 3);
+		// The buffers are kept for the lifetime of the thread and only replaced when a cloud does not fit
+		pointAttributeBuffer vertexBuffer = CreatePointAttributeBuffer(renderDevice);
+		pointAttributeBuffer colorBuffer = CreatePointAttributeBuffer(renderDevice);
+		pointAttributeBuffer refVertexBuffer = CreatePointAttributeBuffer(renderDevice);
+		pointAttributeBuffer refColorBuffer = CreatePointAttributeBuffer(renderDevice);
 		bow::VertexBufferPtr normalBuffer = renderDevice->VCreateVertexBuffer(bow::BufferHint::StaticDraw, 1 * sizeof(float) * 3);
 
 		bow::VertexArrayPtr referencePointCloudVertexArray = ContextOGL->VCreateVertexArray();
-		referencePointCloudVertexArray->VSetAttribute(pointCloudShaderProgram->VGetVertexAttribute("in_Position"), bow::VertexBufferAttributePtr(new bow::VertexBufferAttribute(vertexBuffer, bow::ComponentDatatype::Float, 3)));
-		referencePointCloudVertexArray->VSetAttribute(pointCloudShaderProgram->VGetVertexAttribute("in_Color"), bow::VertexBufferAttributePtr(new bow::VertexBufferAttribute(colorBuffer, bow::ComponentDatatype::Float, 3)));
+		referencePointCloudVertexArray->VSetAttribute(pointCloudShaderProgram->VGetVertexAttribute("in_Position"), bow::VertexBufferAttributePtr(new bow::VertexBufferAttribute(refVertexBuffer.buffer, bow::ComponentDatatype::Float, 3)));
+		referencePointCloudVertexArray->VSetAttribute(pointCloudShaderProgram->VGetVertexAttribute("in_Color"), bow::VertexBufferAttributePtr(new bow::VertexBufferAttribute(refColorBuffer.buffer, bow::ComponentDatatype::Float, 3)));
 
 		bow::VertexArrayPtr pointCloudVertexArray = ContextOGL->VCreateVertexArray();
-		pointCloudVertexArray->VSetAttribute(pointCloudShaderProgram->VGetVertexAttribute("in_Position"), bow::VertexBufferAttributePtr(new bow::VertexBufferAttribute(vertexBuffer, bow::ComponentDatatype::Float, 3)));
-		pointCloudVertexArray->VSetAttribute(pointCloudShaderProgram->VGetVertexAttribute("in_Color"), bow::VertexBufferAttributePtr(new bow::VertexBufferAttribute(colorBuffer, bow::ComponentDatatype::Float, 3)));
+		pointCloudVertexArray->VSetAttribute(pointCloudShaderProgram->VGetVertexAttribute("in_Position"), bow::VertexBufferAttributePtr(new bow::VertexBufferAttribute(vertexBuffer.buffer, bow::ComponentDatatype::Float, 3)));
+		pointCloudVertexArray->VSetAttribute(pointCloudShaderProgram->VGetVertexAttribute("in_Color"), bow::VertexBufferAttributePtr(new bow::VertexBufferAttribute(colorBuffer.buffer, bow::ComponentDatatype::Float, 3)));
 
 		bow::VertexArrayPtr litPointCloudVertexArray = ContextOGL->VCreateVertexArray();
-		litPointCloudVertexArray->VSetAttribute(litPointCloudShaderProgram->VGetVertexAttribute("in_Position"), bow::VertexBufferAttributePtr(new bow::VertexBufferAttribute(vertexBuffer, bow::ComponentDatatype::Float, 3)));
-		litPointCloudVertexArray->VSetAttribute(litPointCloudShaderProgram->VGetVertexAttribute("in_Color"), bow::VertexBufferAttributePtr(new bow::VertexBufferAttribute(colorBuffer, bow::ComponentDatatype::Float, 3)));
+		litPointCloudVertexArray->VSetAttribute(litPointCloudShaderProgram->VGetVertexAttribute("in_Position"), bow::VertexBufferAttributePtr(new bow::VertexBufferAttribute(vertexBuffer.buffer, bow::ComponentDatatype::Float, 3)));
+		litPointCloudVertexArray->VSetAttribute(litPointCloudShaderProgram->VGetVertexAttribute("in_Color"), bow::VertexBufferAttributePtr(new bow::VertexBufferAttribute(colorBuffer.buffer, bow::ComponentDatatype::Float, 3)));
 		litPointCloudVertexArray->VSetAttribute(litPointCloudShaderProgram->VGetVertexAttribute("in_Normal"), bow::VertexBufferAttributePtr(new bow::VertexBufferAttribute(normalBuffer, bow::ComponentDatatype::Float, 3)));
 
 		///////////////////////////////////////////////////////////////////
@@ -361,6 +405,11 @@ namespace bow
 
 		bow::FramebufferPtr refDepthRenderingFrameBuffer = ContextOGL->VCreateFramebuffer();
 
+		// Attachments of the framebuffer, recreated only when the requested resolution changes
+		bow::Texture2DPtr colorRenderTarget;
+		bow::Texture2DPtr depthRenderTarget;
+		bow::Texture2DPtr depthTarget;
+
 		///////////////////////////////////////////////////////////////////
 		// RenderState
 
@@ -393,8 +442,14 @@ namespace bow
 		bow::Vector3<long> lastCursorPosition = mouse->VGetAbsolutePositionInsideWindow();
 		auto lastFrameTime = std::chrono::high_resolution_clock::now(); // Take time
 
+		// Clouds taken over from the producer, uploaded after the mutex is released
 		std::vector<bow::Vector3<float>> points;
 		std::vector<bow::Vector3<float>> colors;
+		std::vector<bow::Vector3<float>> refPoints;
+		std::vector<bow::Vector3<float>> refColors;
+
+		unsigned int numFrames = 0;
+		double totalFrameTime = 0.0;
 
 		bool add_pressed = false;
 		bool minus_pressed = false;
@@ -407,59 +462,43 @@ namespace bow
 				my_data->shouldStop = true;
 			}
 
+			points.clear();
+			colors.clear();
+			refPoints.clear();
+			refColors.clear();
+
 			update_data_mutex.lock();
 			if (my_data->newVertices.size() > 0 && my_data->newColors.size() > 0)
 			{
-				vertexBuffer = renderDevice->VCreateVertexBuffer(bow::BufferHint::StaticDraw, (int)my_data->newVertices.size() * sizeof(float) * 3);
-				colorBuffer = renderDevice->VCreateVertexBuffer(bow::BufferHint::StaticDraw, (int)my_data->newColors.size() * sizeof(float) * 3);
-
-				pointCloudVertexArray->VSetAttribute(pointCloudShaderProgram->VGetVertexAttribute("in_Position"), bow::VertexBufferAttributePtr(new bow::VertexBufferAttribute(vertexBuffer, bow::ComponentDatatype::Float, 3)));
-				pointCloudVertexArray->VSetAttribute(pointCloudShaderProgram->VGetVertexAttribute("in_Color"), bow::VertexBufferAttributePtr(new bow::VertexBufferAttribute(colorBuffer, bow::ComponentDatatype::Float, 3)));
-
-				points.resize(my_data->newVertices.size());
-				for (unsigned int i = 0; i < my_data->newVertices.size(); i++)
-				{
-					points[i] = bow::Vector3<float>(my_data->newVertices[i]);
-				}
-				vertexBuffer->VCopyFromSystemMemory((char*)(&points[0]), (int)points.size() * sizeof(bow::Vector3<float>));
-
-				colors.resize(my_data->newColors.size());
-				for (unsigned int i = 0; i < my_data->newColors.size(); i++)
-				{
-					colors[i] = bow::Vector3<float>(my_data->newColors[i]);
-				}
-				colorBuffer->VCopyFromSystemMemory((char*)(&colors[0]), (int)colors.size() * sizeof(bow::Vector3<float>));
-
-				my_data->newVertices.clear();
-				my_data->newColors.clear();
+				points.swap(my_data->newVertices);
+				colors.swap(my_data->newColors);
 			}
+			refPoints.swap(my_data->newRefVertices);
+			refColors.swap(my_data->newRefColors);
+			update_data_mutex.unlock();
 
-			if (my_data->newRefVertices.size() > 0 || my_data->newRefColors.size() > 0)
+			if (points.size() > 0)
 			{
-				vertexBuffer = renderDevice->VCreateVertexBuffer(bow::BufferHint::StaticDraw, (int)my_data->newRefVertices.size() * sizeof(float) * 3);
-				colorBuffer = renderDevice->VCreateVertexBuffer(bow::BufferHint::StaticDraw, (int)my_data->newRefColors.size() * sizeof(float) * 3);
-			
-				referencePointCloudVertexArray->VSetAttribute(pointCloudShaderProgram->VGetVertexAttribute("in_Position"), bow::VertexBufferAttributePtr(new bow::VertexBufferAttribute(vertexBuffer, bow::ComponentDatatype::Float, 3)));
-				referencePointCloudVertexArray->VSetAttribute(pointCloudShaderProgram->VGetVertexAttribute("in_Color"), bow::VertexBufferAttributePtr(new bow::VertexBufferAttribute(colorBuffer, bow::ComponentDatatype::Float, 3)));
-				
-				points.resize(my_data->newRefVertices.size());
-				for (unsigned int i = 0; i < my_data->newRefVertices.size(); i++)
-				{
-					points[i] = bow::Vector3<float>(my_data->newRefVertices[i]);
-				}
-				vertexBuffer->VCopyFromSystemMemory((char*)(&points[0]), (int)points.size() * sizeof(bow::Vector3<float>));
-
-				colors.resize(my_data->newRefColors.size());
-				for (unsigned int i = 0; i < my_data->newRefColors.size(); i++)
-				{
-					colors[i] = bow::Vector3<float>(my_data->newRefColors[i]);
-				}
-				colorBuffer->VCopyFromSystemMemory((char*)(&colors[0]), (int)colors.size() * sizeof(bow::Vector3<float>));
+				if (UploadPoints(renderDevice, vertexBuffer, points))
+					pointCloudVertexArray->VSetAttribute(pointCloudShaderProgram->VGetVertexAttribute("in_Position"), bow::VertexBufferAttributePtr(new bow::VertexBufferAttribute(vertexBuffer.buffer, bow::ComponentDatatype::Float, 3)));
+				if (UploadPoints(renderDevice, colorBuffer, colors))
+					pointCloudVertexArray->VSetAttribute(pointCloudShaderProgram->VGetVertexAttribute("in_Color"), bow::VertexBufferAttributePtr(new bow::VertexBufferAttribute(colorBuffer.buffer, bow::ComponentDatatype::Float, 3)));
+			}
 
-				my_data->newRefVertices.clear();
-				my_data->newRefColors.clear();
+			// vertices and colors of the reference are updated independently
+			if (refPoints.size() > 0)
+			{
+				if (UploadPoints(renderDevice, refVertexBuffer, refPoints))
+					referencePointCloudVertexArray->VSetAttribute(pointCloudShaderProgram->VGetVertexAttribute("in_Position"), bow::VertexBufferAttributePtr(new bow::VertexBufferAttribute(refVertexBuffer.buffer, bow::ComponentDatatype::Float, 3)));
 			}
-			update_data_mutex.unlock();
+			if (refColors.size() > 0)
+			{
+				if (UploadPoints(renderDevice, refColorBuffer, refColors))
+					referencePointCloudVertexArray->VSetAttribute(pointCloudShaderProgram->VGetVertexAttribute("in_Color"), bow::VertexBufferAttributePtr(new bow::VertexBufferAttribute(refColorBuffer.buffer, bow::ComponentDatatype::Float, 3)));
+			}
+
+			const int numPoints = (int)std::min(vertexBuffer.numPoints, colorBuffer.numPoints);
+			const int numRefPoints = (int)std::min(refVertexBuffer.numPoints, refColorBuffer.numPoints);
 
 			// ============================================
 			// Handle Input
@@ -469,6 +508,8 @@ namespace bow
 			float deltaTime = (float)frameduration.count();
 
 			lastFrameTime = currentFrameTime; // Take time
+			numFrames++;
+			totalFrameTime += frameduration.count();
 			double moveSpeed = 100.0;
 
 			if (keyboard->VIsPressed(bow::Key::K_LEFT_SHIFT))
@@ -571,12 +612,14 @@ namespace bow
 			// ============================================
 			// Render Reference Point Cloud
 
-			ContextOGL->VDraw(bow::PrimitiveType::Points, referencePointCloudVertexArray, pointCloudShaderProgram, pointCloudRenderState);
+			if (numRefPoints > 0)
+				ContextOGL->VDraw(bow::PrimitiveType::Points, 0, numRefPoints, referencePointCloudVertexArray, pointCloudShaderProgram, pointCloudRenderState);
 
 			// ============================================
 			// Render Point Cloud
 
-			ContextOGL->VDraw(bow::PrimitiveType::Points, pointCloudVertexArray, pointCloudShaderProgram, pointCloudRenderState);
+			if (numPoints > 0)
+				ContextOGL->VDraw(bow::PrimitiveType::Points, 0, numPoints, pointCloudVertexArray, pointCloudShaderProgram, pointCloudRenderState);
 
 			// ============================================
 			// Render Geometry 
@@ -597,13 +640,16 @@ namespace bow
 			update_data_mutex.lock();
 			if (my_data->waitForRender)
 			{
-				bow::Texture2DPtr colorRenderTarget = renderDevice->VCreateTexture2D(bow::Texture2DDescription(my_data->width, my_data->height, bow::TextureFormat::RedGreenBlue8));
-				bow::Texture2DPtr depthRenderTarget = renderDevice->VCreateTexture2D(bow::Texture2DDescription(my_data->width, my_data->height, bow::TextureFormat::Red32f));
-				bow::Texture2DPtr depthTarget = renderDevice->VCreateTexture2D(bow::Texture2DDescription(my_data->width, my_data->height, bow::TextureFormat::Depth16));
+				if (depthRenderTarget == nullptr || depthRenderTarget->VGetDescription().GetWidth() != (int)my_data->width || depthRenderTarget->VGetDescription().GetHeight() != (int)my_data->height)
+				{
+					colorRenderTarget = renderDevice->VCreateTexture2D(bow::Texture2DDescription(my_data->width, my_data->height, bow::TextureFormat::RedGreenBlue8));
+					depthRenderTarget = renderDevice->VCreateTexture2D(bow::Texture2DDescription(my_data->width, my_data->height, bow::TextureFormat::Red32f));
+					depthTarget = renderDevice->VCreateTexture2D(bow::Texture2DDescription(my_data->width, my_data->height, bow::TextureFormat::Depth16));
 
-				refDepthRenderingFrameBuffer->VSetColorAttachment(pointCloudShaderProgram->VGetFragmentOutputLocation("out_Color"), colorRenderTarget);
-				refDepthRenderingFrameBuffer->VSetColorAttachment(pointCloudShaderProgram->VGetFragmentOutputLocation("out_Depth"), depthRenderTarget);
-				refDepthRenderingFrameBuffer->VSetDepthAttachment(depthTarget);
+					refDepthRenderingFrameBuffer->VSetColorAttachment(pointCloudShaderProgram->VGetFragmentOutputLocation("out_Color"), colorRenderTarget);
+					refDepthRenderingFrameBuffer->VSetColorAttachment(pointCloudShaderProgram->VGetFragmentOutputLocation("out_Depth"), depthRenderTarget);
+					refDepthRenderingFrameBuffer->VSetDepthAttachment(depthTarget);
+				}
 
 				ContextOGL->VSetFramebuffer(refDepthRenderingFrameBuffer);
 				ContextOGL->VSetViewport(bow::Viewport(0, 0, my_data->width, my_data->height));
@@ -611,15 +657,8 @@ namespace bow
 
 				pointCloudShaderProgram->VSetUniform("u_worldView", (Matrix4x4<float>)my_data->newViewMatrix);
 				pointCloudShaderProgram->VSetUniform("u_projection", (Matrix4x4<float>)my_data->newProjMatrix);
-				ContextOGL->VDraw(bow::PrimitiveType::Points, referencePointCloudVertexArray, pointCloudShaderProgram, pointCloudRenderState);
-
-				// ============================================
-				// Color
-
-				bow::Texture2DDescription colorTargetDescription = colorRenderTarget->VGetDescription();
-				auto colorData = colorRenderTarget->VCopyToSystemMemory(bow::ImageFormat::RedGreenBlue, bow::ImageDatatype::UnsignedByte);
-				cv::Mat_<cv::Vec3b> colorMat = cv::Mat_<cv::Vec3b>(colorTargetDescription.GetHeight(), colorTargetDescription.GetWidth());
-				memcpy(colorMat.data, colorData.get(), colorTargetDescription.GetHeight() * colorTargetDescription.GetWidth() * sizeof(cv::Vec3b));
+				if (numRefPoints > 0)
+					ContextOGL->VDraw(bow::PrimitiveType::Points, 0, numRefPoints, referencePointCloudVertexArray, pointCloudShaderProgram, pointCloudRenderState);
 
 				// ============================================
 				// Depth
@@ -628,7 +667,7 @@ namespace bow
 				auto depthData = depthRenderTarget->VCopyToSystemMemory(bow::ImageFormat::Red, bow::ImageDatatype::Float);
 
 				unsigned int marker_numElements = depthTargetDescription.GetHeight() * depthTargetDescription.GetWidth();
-				my_data->out_depth = std::vector<ushort>(marker_numElements);
+				my_data->out_depth.resize(marker_numElements);
 
 				float* values = (float*)(depthData.get());
 				for (unsigned int i = 0; i < marker_numElements; i++)
@@ -641,6 +680,10 @@ namespace bow
 			update_data_mutex.unlock();
 		}
 
+		if (numFrames > 0)
+		{
+			std::cout << "Rendered " << numFrames << " frames, mean frame time " << totalFrameTime / numFrames << " ms" << std::endl;
+		}
 		std::cout << "Stopping Render Thread" << std::endl;
 
 		my_data->isRunning = false;
@@ -712,7 +755,7 @@ namespace bow
 	bool PCLRenderer::UpdateColors(std::vector<bow::Vector3<float>> colors)
 	{
 		update_data_mutex.lock();
-		m_renderThreadData->newColors = colors;
+		m_renderThreadData->newColors = std::move(colors);
 		update_data_mutex.unlock();
 		return true;
 	}
@@ -720,7 +763,7 @@ namespace bow
 	bool PCLRenderer::UpdatePointCloud(std::vector<bow::Vector3<float>> vertices)
 	{
 		update_data_mutex.lock();
-		m_renderThreadData->newVertices = vertices;
+		m_renderThreadData->newVertices = std::move(vertices);
 		update_data_mutex.unlock();
 		return true;
 	}
@@ -728,8 +771,8 @@ namespace bow
 	bool PCLRenderer::UpdatePointCloud(std::vector<bow::Vector3<float>> vertices, std::vector<bow::Vector3<float>> normals)
 	{
 		update_data_mutex.lock();
-		m_renderThreadData->newVertices = vertices;
-		m_renderThreadData->newNormals = normals;
+		m_renderThreadData->newVertices = std::move(vertices);
+		m_renderThreadData->newNormals = std::move(normals);
 		update_data_mutex.unlock();
 		return true;
 	}
@@ -738,7 +781,7 @@ namespace bow
 	bool PCLRenderer::UpdateReferencePointCloud(std::vector<bow::Vector3<float>> vertices)
 	{
 		update_data_mutex.lock();
-		m_renderThreadData->newRefVertices = vertices;
+		m_renderThreadData->newRefVertices = std::move(vertices);
 		update_data_mutex.unlock();
 		return true;
 	}
@@ -746,8 +789,8 @@ namespace bow
 	bool PCLRenderer::UpdateReferencePointCloud(std::vector<bow::Vector3<float>> vertices, std::vector<bow::Vector3<float>> normals)
 	{
 		update_data_mutex.lock();
-		m_renderThreadData->newRefVertices = vertices;
-		m_renderThreadData->newRefNormals = normals;
+		m_renderThreadData->newRefVertices = std::move(vertices);
+		m_renderThreadData->newRefNormals = std::move(normals);
 		update_data_mutex.unlock();
 		return true;
 	}
@@ -755,9 +798,9 @@ namespace bow
 	bool PCLRenderer::UpdateReferencePointCloud(std::vector<bow::Vector3<float>> vertices, std::vector<bow::Vector3<float>> colors, std::vector<bow::Vector3<float>> normals)
 	{
 		update_data_mutex.lock();
-		m_renderThreadData->newRefVertices = vertices;
-		m_renderThreadData->newRefColors = colors;
-		m_renderThreadData->newRefNormals = normals;
+		m_renderThreadData->newRefVertices = std::move(vertices);
+		m_renderThreadData->newRefColors = std::move(colors);
+		m_renderThreadData->newRefNormals = std::move(normals);
 		update_data_mutex.unlock();
 		return true;
 	}
@@ -17,6 +17,26 @@ namespace bow
 			loadFileStorage["calibration_checkerboard_width"] >> config.calibration_checkerboard_width;
 			loadFileStorage["calibration_checkerboard_height"] >> config.calibration_checkerboard_height;
 			loadFileStorage["calibration_checkerboard_squareSize"] >> config.calibration_checkerboard_squareSize;
+
+			// optional, older config files don't contain the recording settings
+			if (!loadFileStorage["recording_encoder_threads"].empty())
+				loadFileStorage["recording_encoder_threads"] >> config.recording_encoder_threads;
+			if (!loadFileStorage["recording_png_compression"].empty())
+				loadFileStorage["recording_png_compression"] >> config.recording_png_compression;
+			if (!loadFileStorage["recording_png_strategy"].empty())
+				loadFileStorage["recording_png_strategy"] >> config.recording_png_strategy;
+			if (!loadFileStorage["recording_defer_compression"].empty())
+			{
+				int defer = 0;
+				loadFileStorage["recording_defer_compression"] >> defer;
+				config.recording_defer_compression = defer != 0;
+			}
+			if (!loadFileStorage["recording_compress_depth"].empty())
+			{
+				int compressDepth = 1;
+				loadFileStorage["recording_compress_depth"] >> compressDepth;
+				config.recording_compress_depth = compressDepth != 0;
+			}
 			loadFileStorage.release();
 		}
 
@@ -32,6 +52,12 @@ namespace bow
 			saveFileStorage << "calibration_checkerboard_width" << config.calibration_checkerboard_width;
 			saveFileStorage << "calibration_checkerboard_height" << config.calibration_checkerboard_height;
 			saveFileStorage << "calibration_checkerboard_squareSize" << config.calibration_checkerboard_squareSize;
+
+			saveFileStorage << "recording_encoder_threads" << config.recording_encoder_threads;
+			saveFileStorage << "recording_png_compression" << config.recording_png_compression;
+			saveFileStorage << "recording_png_strategy" << config.recording_png_strategy;
+			saveFileStorage << "recording_defer_compression" << (int)config.recording_defer_compression;
+			saveFileStorage << "recording_compress_depth" << (int)config.recording_compress_depth;
 			saveFileStorage.release();
 		}
 
@@ -0,0 +1,166 @@
+#include "CameraUtils/Undistorter.h"
+
+#include <algorithm>
+
+namespace bow {
+
+	// rows remapped by one task, small enough to balance the stripes over all threads
+	static const int g_rowsPerStripe = 32;
+
+	static bool isSameMatrix(const cv::Mat& a, const cv::Mat& b)
+	{
+		if (a.empty() || b.empty())
+		{
+			return a.empty() && b.empty();
+		}
+		if (a.size() != b.size() || a.type() != b.type())
+		{
+			return false;
+		}
+		return cv::norm(a, b, cv::NORM_INF) == 0.0;
+	}
+
+	class ParallelRemap : public cv::ParallelLoopBody
+	{
+	public:
+		ParallelRemap(const cv::Mat& src, cv::Mat& dst, const cv::Mat& map1, const cv::Mat& map2) :
+			m_src(src), m_dst(dst), m_map1(map1), m_map2(map2)
+		{
+		}
+
+		virtual void operator()(const cv::Range& range) const
+		{
+			int firstRow = range.start * g_rowsPerStripe;
+			int lastRow = std::min(range.end * g_rowsPerStripe, m_dst.rows);
+
+			// remap writes into the preallocated rows of dst
+			cv::Mat dstRows = m_dst.rowRange(firstRow, lastRow);
+			cv::remap(m_src, dstRows, m_map1.rowRange(firstRow, lastRow), m_map2.rowRange(firstRow, lastRow), cv::INTER_LINEAR, cv::BORDER_CONSTANT);
+		}
+
+	private:
+		const cv::Mat&	m_src;
+		cv::Mat&		m_dst;
+		const cv::Mat&	m_map1;
+		const cv::Mat&	m_map2;
+	};
+
+	class ParallelRemapAccumulate : public cv::ParallelLoopBody
+	{
+	public:
+		ParallelRemapAccumulate(const cv::Mat& src, cv::Mat& mean, double weight, const cv::Mat& map1, const cv::Mat& map2) :
+			m_src(src), m_mean(mean), m_weight(weight), m_map1(map1), m_map2(map2)
+		{
+		}
+
+		virtual void operator()(const cv::Range& range) const
+		{
+			int firstRow = range.start * g_rowsPerStripe;
+			int lastRow = std::min(range.end * g_rowsPerStripe, m_mean.rows);
+
+			// the undistorted stripe stays in cache until it is added to the mean
+			cv::Mat undistortedRows;
+			cv::remap(m_src, undistortedRows, m_map1.rowRange(firstRow, lastRow), m_map2.rowRange(firstRow, lastRow), cv::INTER_LINEAR, cv::BORDER_CONSTANT);
+
+			cv::Mat meanRows = m_mean.rowRange(firstRow, lastRow);
+			cv::accumulateWeighted(undistortedRows, meanRows, m_weight);
+		}
+
+	private:
+		const cv::Mat&	m_src;
+		cv::Mat&		m_mean;
+		double			m_weight;
+		const cv::Mat&	m_map1;
+		const cv::Mat&	m_map2;
+	};
+
+	Undistorter::Undistorter()
+	{
+	}
+
+	Undistorter::~Undistorter()
+	{
+		Clear();
+	}
+
+	void Undistorter::Undistort(const cv::Mat& src, cv::Mat& dst, const IntrinsicCameraParameters& cameraParameters)
+	{
+		if (src.empty())
+		{
+			dst.release();
+			return;
+		}
+
+		cv::Mat map1, map2;
+		getMaps(cameraParameters, src.size(), map1, map2);
+
+		// dst must not share its data with src, remap reads the whole source for every stripe
+		if (dst.data == src.data)
+		{
+			dst.release();
+		}
+		dst.create(src.size(), src.type());
+
+		int numStripes = (src.rows + g_rowsPerStripe - 1) / g_rowsPerStripe;
+		cv::parallel_for_(cv::Range(0, numStripes), ParallelRemap(src, dst, map1, map2));
+	}
+
+	void Undistorter::UndistortAccumulate(const cv::Mat& src, cv::Mat& mean, unsigned int frameIndex, const IntrinsicCameraParameters& cameraParameters)
+	{
+		if (src.empty())
+		{
+			return;
+		}
+
+		cv::Mat map1, map2;
+		getMaps(cameraParameters, src.size(), map1, map2);
+
+		int meanType = CV_MAKETYPE(CV_64F, src.channels());
+		if (mean.size() != src.size() || mean.type() != meanType)
+		{
+			mean = cv::Mat::zeros(src.size(), meanType);
+		}
+
+		double weight = 1.0 / (double)(frameIndex + 1);
+		int numStripes = (src.rows + g_rowsPerStripe - 1) / g_rowsPerStripe;
+		cv::parallel_for_(cv::Range(0, numStripes), ParallelRemapAccumulate(src, mean, weight, map1, map2));
+	}
+
+	void Undistorter::Clear()
+	{
+		std::lock_guard<std::mutex> lock(m_mapsMutex);
+		m_maps.clear();
+	}
+
+	unsigned int Undistorter::GetNumCachedMaps()
+	{
+		std::lock_guard<std::mutex> lock(m_mapsMutex);
+		return (unsigned int)m_maps.size();
+	}
+
+	void Undistorter::getMaps(const IntrinsicCameraParameters& cameraParameters, const cv::Size& imageSize, cv::Mat& map1, cv::Mat& map2)
+	{
+		std::lock_guard<std::mutex> lock(m_mapsMutex);
+
+		for (unsigned int i = 0; i < m_maps.size(); i++)
+		{
+			if (m_maps[i].imageSize == imageSize && isSameMatrix(m_maps[i].cameraMatrix, cameraParameters.cameraMatrix) && isSameMatrix(m_maps[i].distCoeffs, cameraParameters.distCoeffs))
+			{
+				map1 = m_maps[i].map1;
+				map2 = m_maps[i].map2;
+				return;
+			}
+		}
+
+		// same maps as cv::undistort builds internally for every call
+		UndistortionMaps maps;
+		maps.cameraMatrix = cameraParameters.cameraMatrix.clone();
+		maps.distCoeffs = cameraParameters.distCoeffs.clone();
+		maps.imageSize = imageSize;
+		cv::initUndistortRectifyMap(cameraParameters.cameraMatrix, cameraParameters.distCoeffs, cv::Mat(), cameraParameters.cameraMatrix, imageSize, CV_16SC2, maps.map1, maps.map2);
+		m_maps.push_back(maps);
+
+		map1 = maps.map1;
+		map2 = maps.map2;
+	}
+}
@@ -38,10 +38,11 @@ namespace bow {
 
 		static std::vector<MarkerDescription> LoadMarkerMapFromFile(const std::string& filePath);
 		static std::vector<Marker> detectMarker(const cv::Mat& inputImage, const cv::Mat& cameraMatrix, const cv::Mat& distCoeffs, float markerSideLengthInMM, const std::vector<MarkerDescription> markerMap = std::vector<MarkerDescription>());
+		static std::vector<Marker> estimateMarkerPoses(const std::vector<int>& markerIds, const std::vector<std::vector<cv::Point2f>>& markerCorners, const cv::Mat& cameraMatrix, const cv::Mat& distCoeffs, float markerSideLengthInMM);
 
 		static bool getTransformationFromMarkerMap(const std::vector<MarkerDescription>& markerMap, const cv::Mat& inputImage, const cv::Mat& cameraMatrix, const cv::Mat& distCoeffs, cv::Matx<float, 4, 4>& global_Transform);
 		static bool getTransformationFromMarkerMap(const std::vector<MarkerDescription>& markerMap, std::vector<Marker>& detectedMarker, cv::Matx<float, 4, 4>& global_Transform);
 	private:
-
+		static Marker createMarker(int id, const cv::Vec3d& rvec, const cv::Vec3d& tvec);
 	};
 }
@@ -0,0 +1,68 @@
+#pragma once
+#include "EvaluationUtils/EvaluationUtils_api.h"
+
+#include "EvaluationUtils/ArucoHelper.h"
+
+//opencv
+#include <opencv2/opencv.hpp>
+
+namespace bow {
+	struct markerTracker_data;
+
+	struct EVALUATIONUTILS_API MarkerTrackerSettings
+	{
+	public:
+		MarkerTrackerSettings()
+		{
+			trackBetweenFrames = true;
+			regionMargin = 0.5f;
+			fullFrameInterval = 30;
+		}
+
+		bool			trackBetweenFrames;	///< search only around the markers of the previous frame
+		float			regionMargin;		///< border added around a previous marker, relative to its size in pixels
+		unsigned int	fullFrameInterval;	///< run a full frame detection every n frames to pick up new markers, 0 disables it
+	};
+
+	struct EVALUATIONUTILS_API MarkerTrackerStatistics
+	{
+	public:
+		MarkerTrackerStatistics() : frames(0), fullFrameDetections(0), regionDetections(0), lostMarkerFallbacks(0) {}
+
+		unsigned int frames;
+		unsigned int fullFrameDetections;
+		unsigned int regionDetections;
+		unsigned int lostMarkerFallbacks;	///< region detections that missed a marker and were repeated on the full frame
+	};
+
+	/// Stateful replacement for ArucoHelper::detectMarker.
+	/// Dictionary and detector parameters are created once, and consecutive frames of a recording are only searched
+	/// in the regions around the markers found in the previous frame. As soon as one of them is lost the frame is
+	/// searched completely again.
+	class EVALUATIONUTILS_API MarkerTracker
+	{
+	public:
+		MarkerTracker(const cv::Mat& cameraMatrix, const cv::Mat& distCoeffs, float markerSideLengthInMM, const MarkerTrackerSettings& settings = MarkerTrackerSettings());
+		~MarkerTracker();
+
+		/// Detects the markers of the next frame of a sequence
+		std::vector<Marker> Track(const cv::Mat& inputImage);
+
+		/// Detects the markers of independent frames in parallel, the tracking state is not used or changed
+		std::vector<std::vector<Marker>> DetectBatch(const std::vector<cv::Mat>& inputImages);
+
+		/// Forgets the markers of the previous frame, call it before a new sequence starts
+		void Reset();
+
+		const MarkerTrackerStatistics& GetStatistics() const;
+
+		/// Detects the markers of all images with ArucoHelper::detectMarker, Track and DetectBatch and prints latency and recall compared to ArucoHelper::detectMarker
+		static void MeasureAgainstReference(const std::vector<cv::Mat>& inputImages, const cv::Mat& cameraMatrix, const cv::Mat& distCoeffs, float markerSideLengthInMM, const MarkerTrackerSettings& settings = MarkerTrackerSettings());
+
+	private:
+		MarkerTracker(const MarkerTracker&) {}; // You shall not copy
+		MarkerTracker& operator=(const MarkerTracker&) { return *this; }
+
+		markerTracker_data* m_data;
+	};
+}
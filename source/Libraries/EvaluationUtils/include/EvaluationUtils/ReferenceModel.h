@@ -0,0 +1,57 @@
+#pragma once
+#include "EvaluationUtils/EvaluationUtils_api.h"
+
+#include "EvaluationUtils/DataLoader.h"
+
+//opencv
+#include <opencv2/opencv.hpp>
+
+namespace bow {
+	struct referenceModel_data;
+
+	/// Per pixel mean and variance of the frames of a background recording, e.g. the Run_0 folder of a recording set.
+	/// The statistics are computed once and written to a cache file together with a key of the names, sizes and
+	/// modification times of the frames. Later loads of the same frames map the cache file instead of decoding every
+	/// frame again; if any frame was added, removed or changed the model is computed and written again.
+	class EVALUATIONUTILS_API ReferenceModel
+	{
+	public:
+		ReferenceModel();
+		~ReferenceModel();
+
+		/// Maps the model of the frames from cacheFilePath or computes it and writes it there. False if none of the frames could be loaded
+		bool Load(const std::vector<FrameData>& frames, const std::string& cacheFilePath);
+
+		void Unload();
+
+		bool IsLoaded() const;
+
+		/// True if the last Load mapped an existing cache file
+		bool IsFromCache() const;
+
+		unsigned int GetWidth() const;
+		unsigned int GetHeight() const;
+
+		/// Number of frames the model was computed from, frames that could not be loaded or differ in size are left out
+		unsigned int GetNumFrames() const;
+
+		/// Row major width x height values
+		const float* GetMeanData() const;
+		const float* GetVarianceData() const;
+
+		cv::Mat_<double> GetMean() const;
+		cv::Mat_<double> GetVariance() const;
+
+		/// difference = mean - reference for every pixel. False if mean differs in size from the model
+		bool ComputeDifference(const cv::Mat_<double>& mean, cv::Mat_<float>& difference) const;
+
+		/// Path of the cache file of a recording folder, next to the folder like the other outputs of the analyses
+		static std::string GetCacheFilePath(const std::string& recordingsFolderPath, const std::string& folderName, const std::string& channel);
+
+	private:
+		ReferenceModel(const ReferenceModel&) {}; // You shall not copy
+		ReferenceModel& operator=(const ReferenceModel&) { return *this; }
+
+		referenceModel_data* m_data;
+	};
+}
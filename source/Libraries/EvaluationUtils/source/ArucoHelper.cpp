@@ -63,8 +63,6 @@ namespace bow
 
 	std::vector<Marker> ArucoHelper::detectMarker(const cv::Mat& inputImage, const cv::Mat& cameraMatrix, const cv::Mat& distCoeffs, float markerSideLengthInMM, const std::vector<MarkerDescription> markerMap)
 	{
-		std::vector<Marker> result;
-
 		std::vector<int> markerIds;
 		std::vector<std::vector<cv::Point2f>> markerCorners;
 		std::vector<std::vector<cv::Point2f>> rejectedCandidates;
@@ -85,60 +83,71 @@ namespace bow
 
 		cv::aruco::detectMarkers(inputImage, cv::aruco::getPredefinedDictionary(cv::aruco::DICT_ARUCO_ORIGINAL), markerCorners, markerIds, parameters, rejectedCandidates, cameraMatrix, distCoeffs);
 		
+		//cv::aruco::drawDetectedMarkers(inputImage, markerCorners, markerIds);
+		//cv::imshow("markerImage", inputImage);
+		//cv::waitKey(1);
+
+		return estimateMarkerPoses(markerIds, markerCorners, cameraMatrix, distCoeffs, markerSideLengthInMM);
+	}
+
+	std::vector<Marker> ArucoHelper::estimateMarkerPoses(const std::vector<int>& markerIds, const std::vector<std::vector<cv::Point2f>>& markerCorners, const cv::Mat& cameraMatrix, const cv::Mat& distCoeffs, float markerSideLengthInMM)
+	{
+		std::vector<Marker> result;
 		if (markerIds.size() == 0)
 			return result;
 
 		std::vector<cv::Vec3d> rvecs, tvecs;
 		cv::aruco::estimatePoseSingleMarkers(markerCorners, markerSideLengthInMM, cameraMatrix, distCoeffs, rvecs, tvecs);
 
-		//cv::aruco::drawDetectedMarkers(inputImage, markerCorners, markerIds);
-		//cv::imshow("markerImage", inputImage);
-		//cv::waitKey(1);
-
 		for (unsigned int i = 0; i < markerIds.size(); i++)
 		{
 			if (markerIds[i] == 0)
 				continue;
 
-			Marker newMarker;
-			newMarker.Id = markerIds[i];
-			newMarker.RotationVector = rvecs[i];
-			newMarker.TranslationVector = tvecs[i];
-
-			cv::Mat cameraRotationMatrix;
-			cv::Rodrigues(newMarker.RotationVector, cameraRotationMatrix);
-			cv::Mat cameraTranslationVector = cv::Mat(newMarker.TranslationVector);
-
-			newMarker.ModelMatrix = cv::Mat::zeros(4, 4, CV_32FC1);
-			newMarker.ModelMatrix.at<float>(0) = cameraRotationMatrix.at<double>(0, 0);
-			newMarker.ModelMatrix.at<float>(1) = cameraRotationMatrix.at<double>(0, 1);
-			newMarker.ModelMatrix.at<float>(2) = cameraRotationMatrix.at<double>(0, 2);
-			newMarker.ModelMatrix.at<float>(3) = cameraTranslationVector.at<double>(0, 0);
-
-			newMarker.ModelMatrix.at<float>(4) = cameraRotationMatrix.at<double>(1, 0);
-			newMarker.ModelMatrix.at<float>(5) = cameraRotationMatrix.at<double>(1, 1);
-			newMarker.ModelMatrix.at<float>(6) = cameraRotationMatrix.at<double>(1, 2);
-			newMarker.ModelMatrix.at<float>(7) = cameraTranslationVector.at<double>(1, 0);
-
-			newMarker.ModelMatrix.at<float>(8) = cameraRotationMatrix.at<double>(2, 0);
-			newMarker.ModelMatrix.at<float>(9) = cameraRotationMatrix.at<double>(2, 1);
-			newMarker.ModelMatrix.at<float>(10) = cameraRotationMatrix.at<double>(2, 2);
-			newMarker.ModelMatrix.at<float>(11) = cameraTranslationVector.at<double>(2, 0);
-
-			newMarker.ModelMatrix.at<float>(12) = 0.0;
-			newMarker.ModelMatrix.at<float>(13) = 0.0;
-			newMarker.ModelMatrix.at<float>(14) = 0.0;
-			newMarker.ModelMatrix.at<float>(15) = 1.0;
-
-			//std::cout << newMarker.ModelMatrix << std::endl;
-			newMarker.Ignored = false;
-
-			result.push_back(newMarker);
+			result.push_back(createMarker(markerIds[i], rvecs[i], tvecs[i]));
 		}
 
 		return result;
 	}
 
+	Marker ArucoHelper::createMarker(int id, const cv::Vec3d& rvec, const cv::Vec3d& tvec)
+	{
+		Marker newMarker;
+		newMarker.Id = id;
+		newMarker.RotationVector = rvec;
+		newMarker.TranslationVector = tvec;
+
+		cv::Mat cameraRotationMatrix;
+		cv::Rodrigues(newMarker.RotationVector, cameraRotationMatrix);
+		cv::Mat cameraTranslationVector = cv::Mat(newMarker.TranslationVector);
+
+		newMarker.ModelMatrix = cv::Mat::zeros(4, 4, CV_32FC1);
+		newMarker.ModelMatrix.at<float>(0) = cameraRotationMatrix.at<double>(0, 0);
+		newMarker.ModelMatrix.at<float>(1) = cameraRotationMatrix.at<double>(0, 1);
+		newMarker.ModelMatrix.at<float>(2) = cameraRotationMatrix.at<double>(0, 2);
+		newMarker.ModelMatrix.at<float>(3) = cameraTranslationVector.at<double>(0, 0);
+
+		newMarker.ModelMatrix.at<float>(4) = cameraRotationMatrix.at<double>(1, 0);
+		newMarker.ModelMatrix.at<float>(5) = cameraRotationMatrix.at<double>(1, 1);
+		newMarker.ModelMatrix.at<float>(6) = cameraRotationMatrix.at<double>(1, 2);
+		newMarker.ModelMatrix.at<float>(7) = cameraTranslationVector.at<double>(1, 0);
+
+		newMarker.ModelMatrix.at<float>(8) = cameraRotationMatrix.at<double>(2, 0);
+		newMarker.ModelMatrix.at<float>(9) = cameraRotationMatrix.at<double>(2, 1);
+		newMarker.ModelMatrix.at<float>(10) = cameraRotationMatrix.at<double>(2, 2);
+		newMarker.ModelMatrix.at<float>(11) = cameraTranslationVector.at<double>(2, 0);
+
+		newMarker.ModelMatrix.at<float>(12) = 0.0;
+		newMarker.ModelMatrix.at<float>(13) = 0.0;
+		newMarker.ModelMatrix.at<float>(14) = 0.0;
+		newMarker.ModelMatrix.at<float>(15) = 1.0;
+
+		//std::cout << newMarker.ModelMatrix << std::endl;
+		newMarker.Ignored = false;
+
+		return newMarker;
+	}
+
 
 	bool ArucoHelper::getTransformationFromMarkerMap(const std::vector<MarkerDescription>& markerMap, const cv::Mat& inputImage, const cv::Mat& cameraMatrix, const cv::Mat& distCoeffs, cv::Matx<float, 4, 4>& global_Transform)
 	{
@@ -206,40 +215,7 @@ namespace bow
 			if (markerIds[i] == 0)
 				continue;
 
-			Marker newMarker;
-			newMarker.Id = markerIds[i];
-			newMarker.RotationVector = rvecs[i];
-			newMarker.TranslationVector = tvecs[i];
-
-			cv::Mat cameraRotationMatrix;
-			cv::Rodrigues(newMarker.RotationVector, cameraRotationMatrix);
-			cv::Mat cameraTranslationVector = cv::Mat(newMarker.TranslationVector);
-
-			newMarker.ModelMatrix = cv::Mat::zeros(4, 4, CV_32FC1);
-			newMarker.ModelMatrix.at<float>(0) = cameraRotationMatrix.at<double>(0, 0);
-			newMarker.ModelMatrix.at<float>(1) = cameraRotationMatrix.at<double>(0, 1);
-			newMarker.ModelMatrix.at<float>(2) = cameraRotationMatrix.at<double>(0, 2);
-			newMarker.ModelMatrix.at<float>(3) = cameraTranslationVector.at<double>(0, 0);
-
-			newMarker.ModelMatrix.at<float>(4) = cameraRotationMatrix.at<double>(1, 0);
-			newMarker.ModelMatrix.at<float>(5) = cameraRotationMatrix.at<double>(1, 1);
-			newMarker.ModelMatrix.at<float>(6) = cameraRotationMatrix.at<double>(1, 2);
-			newMarker.ModelMatrix.at<float>(7) = cameraTranslationVector.at<double>(1, 0);
-
-			newMarker.ModelMatrix.at<float>(8) = cameraRotationMatrix.at<double>(2, 0);
-			newMarker.ModelMatrix.at<float>(9) = cameraRotationMatrix.at<double>(2, 1);
-			newMarker.ModelMatrix.at<float>(10) = cameraRotationMatrix.at<double>(2, 2);
-			newMarker.ModelMatrix.at<float>(11) = cameraTranslationVector.at<double>(2, 0);
-
-			newMarker.ModelMatrix.at<float>(12) = 0.0;
-			newMarker.ModelMatrix.at<float>(13) = 0.0;
-			newMarker.ModelMatrix.at<float>(14) = 0.0;
-			newMarker.ModelMatrix.at<float>(15) = 1.0;
-
-			//std::cout << newMarker.ModelMatrix << std::endl;
-			newMarker.Ignored = false;
-
-			result.push_back(newMarker);
+			result.push_back(createMarker(markerIds[i], rvecs[i], tvecs[i]));
 		}
 		
 		return ArucoHelper::getTransformationFromMarkerMap(markerMap, result, global_Transform);
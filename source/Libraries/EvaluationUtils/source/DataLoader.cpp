@@ -1,5 +1,7 @@
 #include "EvaluationUtils/DataLoader.h"
 
+#include <Resources/Codecs/BowDepthCodec.h>
+
 #include <iostream> 
 #include <chrono>
 #include <thread>
@@ -109,6 +111,12 @@ namespace bow
 		return (stat(name.c_str(), &buffer) == 0);
 	}
 
+	static bool isDeferredRawFile(const std::string& filename)
+	{
+		static const std::string extension = ".raw";
+		return filename.size() >= extension.size() && filename.compare(filename.size() - extension.size(), extension.size(), extension) == 0;
+	}
+
 	DataLoader::DataLoader()
 	{
 
@@ -148,6 +156,10 @@ namespace bow
 
 			for (unsigned int i = 0; i < filenames.size(); i++)
 			{
+				// raw frames of a deferred recording, e.g. Image_123.png.raw, are no frames until they are compressed
+				if (isDeferredRawFile(filenames[i]))
+					continue;
+
 				if (filenames[i].find("Image_") != std::string::npos)
 				{
 					FrameData frame;
@@ -259,6 +271,24 @@ namespace bow
 		if (file.is_open())
 		{
 			std::streampos size = file.tellg();
+			std::vector<unsigned char> fileData((size_t)size);
+
+			file.seekg(0, std::ios::beg);
+			file.read((char*)fileData.data(), size);
+			file.close();
+
+			// frames written by the DepthCodec carry their own size
+			unsigned int width, height;
+			if (DepthCodec::ReadHeader(fileData.data(), fileData.size(), width, height))
+			{
+				depthMat = cv::Mat_<ushort>(height, width);
+				if (!DepthCodec::Decode(fileData.data(), fileData.size(), (unsigned short*)depthMat.data))
+				{
+					std::cout << "Corrupt depth file " << depth_filePath << std::endl;
+					depthMat.release();
+				}
+				return depthMat;
+			}
 
 			if (1280 * 960 * sizeof(unsigned short) == size)
 			{
@@ -285,9 +315,10 @@ namespace bow
 				depthMat = cv::Mat_<ushort>(132, 176);
 			}
 
-			file.seekg(0, std::ios::beg);
-			file.read((char*)&(depthMat.data[0]), size);
-			file.close();
+			if (!depthMat.empty())
+			{
+				memcpy(depthMat.data, fileData.data(), fileData.size());
+			}
 		}
 
 		return depthMat;
@@ -0,0 +1,308 @@
+#include "EvaluationUtils/MarkerTracker.h"
+
+//opencv
+#include <opencv2/opencv.hpp>
+#include <opencv2/aruco.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+namespace bow
+{
+	// border in pixels that is always added around a tracked marker, the corner refinement window has to fit into it
+	static const int g_minimumRegionBorder = 8;
+
+	struct markerTracker_data
+	{
+		cv::Ptr<cv::aruco::Dictionary>			dictionary;
+		cv::Ptr<cv::aruco::DetectorParameters>	smallImageParameters;
+		cv::Ptr<cv::aruco::DetectorParameters>	largeImageParameters;
+
+		cv::Mat									cameraMatrix;
+		cv::Mat									distCoeffs;
+		float									markerSideLengthInMM;
+		MarkerTrackerSettings					settings;
+
+		std::vector<int>						lastMarkerIds;
+		std::vector<std::vector<cv::Point2f>>	lastMarkerCorners;
+		unsigned int							framesSinceFullFrameDetection;
+
+		MarkerTrackerStatistics					statistics;
+
+		const cv::Ptr<cv::aruco::DetectorParameters>& getParameters(const cv::Mat& inputImage) const
+		{
+			if (inputImage.rows < 480 && inputImage.cols < 640)
+				return smallImageParameters;
+			return largeImageParameters;
+		}
+	};
+
+	// same parameters as ArucoHelper::detectMarker
+	static cv::Ptr<cv::aruco::DetectorParameters> createDetectorParameters(int cornerRefinementWinSize)
+	{
+		cv::Ptr<cv::aruco::DetectorParameters> parameters = cv::aruco::DetectorParameters::create();
+		parameters->cornerRefinementMethod = cv::aruco::CORNER_REFINE_SUBPIX;
+
+		parameters->cornerRefinementMaxIterations = 100;
+		parameters->cornerRefinementMinAccuracy = 0.01;
+		parameters->cornerRefinementWinSize = cornerRefinementWinSize;
+
+		parameters->adaptiveThreshWinSizeMin = 3;
+		parameters->adaptiveThreshWinSizeMax = 23;
+		parameters->adaptiveThreshWinSizeStep = 5;
+		return parameters;
+	}
+
+	// bounding boxes of the previous markers grown by the margin, overlapping boxes are merged so every marker is searched only once
+	static std::vector<cv::Rect> predictRegions(const std::vector<std::vector<cv::Point2f>>& markerCorners, const cv::Size& imageSize, float margin)
+	{
+		const cv::Rect imageRect(0, 0, imageSize.width, imageSize.height);
+
+		std::vector<cv::Rect> regions;
+		for (unsigned int i = 0; i < markerCorners.size(); i++)
+		{
+			cv::Rect region = cv::boundingRect(markerCorners[i]);
+			int border = (int)(std::max(region.width, region.height) * margin) + g_minimumRegionBorder;
+
+			region.x -= border;
+			region.y -= border;
+			region.width += 2 * border;
+			region.height += 2 * border;
+			region &= imageRect;
+
+			if (region.area() > 0)
+				regions.push_back(region);
+		}
+
+		bool merged = true;
+		while (merged)
+		{
+			merged = false;
+			for (unsigned int i = 0; i < regions.size() && !merged; i++)
+			{
+				for (unsigned int j = i + 1; j < regions.size(); j++)
+				{
+					if ((regions[i] & regions[j]).area() > 0)
+					{
+						regions[i] |= regions[j];
+						regions.erase(regions.begin() + j);
+						merged = true;
+						break;
+					}
+				}
+			}
+		}
+
+		return regions;
+	}
+
+	class ParallelMarkerDetection : public cv::ParallelLoopBody
+	{
+	public:
+		ParallelMarkerDetection(const markerTracker_data* data, const std::vector<cv::Mat>& inputImages, std::vector<std::vector<Marker>>& results) :
+			m_data(data), m_inputImages(inputImages), m_results(results)
+		{
+		}
+
+		virtual void operator()(const cv::Range& range) const
+		{
+			for (int i = range.start; i < range.end; i++)
+			{
+				std::vector<int> markerIds;
+				std::vector<std::vector<cv::Point2f>> markerCorners;
+				std::vector<std::vector<cv::Point2f>> rejectedCandidates;
+				cv::aruco::detectMarkers(m_inputImages[i], m_data->dictionary, markerCorners, markerIds, m_data->getParameters(m_inputImages[i]), rejectedCandidates, m_data->cameraMatrix, m_data->distCoeffs);
+
+				m_results[i] = ArucoHelper::estimateMarkerPoses(markerIds, markerCorners, m_data->cameraMatrix, m_data->distCoeffs, m_data->markerSideLengthInMM);
+			}
+		}
+
+	private:
+		const markerTracker_data*			m_data;
+		const std::vector<cv::Mat>&			m_inputImages;
+		std::vector<std::vector<Marker>>&	m_results;
+	};
+
+	MarkerTracker::MarkerTracker(const cv::Mat& cameraMatrix, const cv::Mat& distCoeffs, float markerSideLengthInMM, const MarkerTrackerSettings& settings)
+	{
+		m_data = new markerTracker_data();
+		m_data->dictionary = cv::aruco::getPredefinedDictionary(cv::aruco::DICT_ARUCO_ORIGINAL);
+		m_data->smallImageParameters = createDetectorParameters(2);
+		m_data->largeImageParameters = createDetectorParameters(5);
+
+		m_data->cameraMatrix = cameraMatrix.clone();
+		m_data->distCoeffs = distCoeffs.clone();
+		m_data->markerSideLengthInMM = markerSideLengthInMM;
+		m_data->settings = settings;
+		m_data->framesSinceFullFrameDetection = 0;
+	}
+
+	MarkerTracker::~MarkerTracker()
+	{
+		delete m_data;
+	}
+
+	std::vector<Marker> MarkerTracker::Track(const cv::Mat& inputImage)
+	{
+		m_data->statistics.frames++;
+
+		const cv::Ptr<cv::aruco::DetectorParameters>& parameters = m_data->getParameters(inputImage);
+
+		std::vector<int> markerIds;
+		std::vector<std::vector<cv::Point2f>> markerCorners;
+
+		bool fullFrameDetection = !m_data->settings.trackBetweenFrames || m_data->lastMarkerIds.empty()
+			|| (m_data->settings.fullFrameInterval > 0 && m_data->framesSinceFullFrameDetection >= m_data->settings.fullFrameInterval);
+
+		if (!fullFrameDetection)
+		{
+			std::vector<cv::Rect> regions = predictRegions(m_data->lastMarkerCorners, inputImage.size(), m_data->settings.regionMargin);
+			for (unsigned int i = 0; i < regions.size(); i++)
+			{
+				std::vector<int> regionMarkerIds;
+				std::vector<std::vector<cv::Point2f>> regionMarkerCorners;
+				cv::aruco::detectMarkers(inputImage(regions[i]), m_data->dictionary, regionMarkerCorners, regionMarkerIds, parameters);
+
+				for (unsigned int j = 0; j < regionMarkerIds.size(); j++)
+				{
+					if (std::find(markerIds.begin(), markerIds.end(), regionMarkerIds[j]) != markerIds.end())
+						continue;
+
+					for (unsigned int c = 0; c < regionMarkerCorners[j].size(); c++)
+					{
+						regionMarkerCorners[j][c].x += (float)regions[i].x;
+						regionMarkerCorners[j][c].y += (float)regions[i].y;
+					}
+					markerIds.push_back(regionMarkerIds[j]);
+					markerCorners.push_back(regionMarkerCorners[j]);
+				}
+			}
+			m_data->statistics.regionDetections++;
+			m_data->framesSinceFullFrameDetection++;
+
+			for (unsigned int i = 0; i < m_data->lastMarkerIds.size(); i++)
+			{
+				if (std::find(markerIds.begin(), markerIds.end(), m_data->lastMarkerIds[i]) == markerIds.end())
+				{
+					m_data->statistics.lostMarkerFallbacks++;
+					fullFrameDetection = true;
+					break;
+				}
+			}
+		}
+
+		if (fullFrameDetection)
+		{
+			markerIds.clear();
+			markerCorners.clear();
+
+			std::vector<std::vector<cv::Point2f>> rejectedCandidates;
+			cv::aruco::detectMarkers(inputImage, m_data->dictionary, markerCorners, markerIds, parameters, rejectedCandidates, m_data->cameraMatrix, m_data->distCoeffs);
+
+			m_data->statistics.fullFrameDetections++;
+			m_data->framesSinceFullFrameDetection = 0;
+		}
+
+		m_data->lastMarkerIds = markerIds;
+		m_data->lastMarkerCorners = markerCorners;
+
+		return ArucoHelper::estimateMarkerPoses(markerIds, markerCorners, m_data->cameraMatrix, m_data->distCoeffs, m_data->markerSideLengthInMM);
+	}
+
+	std::vector<std::vector<Marker>> MarkerTracker::DetectBatch(const std::vector<cv::Mat>& inputImages)
+	{
+		std::vector<std::vector<Marker>> results(inputImages.size());
+		cv::parallel_for_(cv::Range(0, (int)inputImages.size()), ParallelMarkerDetection(m_data, inputImages, results));
+		return results;
+	}
+
+	void MarkerTracker::Reset()
+	{
+		m_data->lastMarkerIds.clear();
+		m_data->lastMarkerCorners.clear();
+		m_data->framesSinceFullFrameDetection = 0;
+	}
+
+	const MarkerTrackerStatistics& MarkerTracker::GetStatistics() const
+	{
+		return m_data->statistics;
+	}
+
+	// share of the reference markers that were found again and the mean distance between both poses
+	static void compareDetections(const std::vector<std::vector<Marker>>& reference, const std::vector<std::vector<Marker>>& detections, double& recall, double& meanTranslationDifference)
+	{
+		unsigned int referenceCount = 0;
+		unsigned int foundCount = 0;
+		double translationDifferenceSum = 0.0;
+
+		for (unsigned int frame = 0; frame < reference.size(); frame++)
+		{
+			for (unsigned int i = 0; i < reference[frame].size(); i++)
+			{
+				referenceCount++;
+				for (unsigned int j = 0; j < detections[frame].size(); j++)
+				{
+					if (detections[frame][j].Id == reference[frame][i].Id)
+					{
+						foundCount++;
+						translationDifferenceSum += cv::norm(detections[frame][j].TranslationVector - reference[frame][i].TranslationVector);
+						break;
+					}
+				}
+			}
+		}
+
+		recall = referenceCount > 0 ? (double)foundCount / (double)referenceCount : 1.0;
+		meanTranslationDifference = foundCount > 0 ? translationDifferenceSum / (double)foundCount : 0.0;
+	}
+
+	void MarkerTracker::MeasureAgainstReference(const std::vector<cv::Mat>& inputImages, const cv::Mat& cameraMatrix, const cv::Mat& distCoeffs, float markerSideLengthInMM, const MarkerTrackerSettings& settings)
+	{
+		typedef std::chrono::high_resolution_clock Clock;
+
+		if (inputImages.empty())
+		{
+			std::cout << "No images to measure the marker tracker with" << std::endl;
+			return;
+		}
+
+		std::vector<std::vector<Marker>> reference(inputImages.size());
+		Clock::time_point start = Clock::now();
+		for (unsigned int i = 0; i < inputImages.size(); i++)
+		{
+			reference[i] = ArucoHelper::detectMarker(inputImages[i], cameraMatrix, distCoeffs, markerSideLengthInMM);
+		}
+		double referenceSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+		MarkerTracker tracker(cameraMatrix, distCoeffs, markerSideLengthInMM, settings);
+		std::vector<std::vector<Marker>> tracked(inputImages.size());
+		start = Clock::now();
+		for (unsigned int i = 0; i < inputImages.size(); i++)
+		{
+			tracked[i] = tracker.Track(inputImages[i]);
+		}
+		double trackSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+		start = Clock::now();
+		std::vector<std::vector<Marker>> batch = tracker.DetectBatch(inputImages);
+		double batchSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+		double trackRecall, trackDifference, batchRecall, batchDifference;
+		compareDetections(reference, tracked, trackRecall, trackDifference);
+		compareDetections(reference, batch, batchRecall, batchDifference);
+
+		double msPerFrame = 1000.0 / (double)inputImages.size();
+		const MarkerTrackerStatistics& statistics = tracker.GetStatistics();
+
+		std::cout << "Marker detection on " << inputImages.size() << " frames" << std::endl;
+		std::cout << std::fixed << std::setprecision(2);
+		std::cout << "  ArucoHelper::detectMarker  " << std::setw(8) << referenceSeconds * msPerFrame << " ms/frame" << std::endl;
+		std::cout << "  MarkerTracker::Track       " << std::setw(8) << trackSeconds * msPerFrame << " ms/frame"
+			<< "  recall " << trackRecall * 100.0 << "%  mean difference " << trackDifference << " mm"
+			<< "  (" << statistics.regionDetections << " region, " << statistics.fullFrameDetections << " full frame, " << statistics.lostMarkerFallbacks << " lost)" << std::endl;
+		std::cout << "  MarkerTracker::DetectBatch " << std::setw(8) << batchSeconds * msPerFrame << " ms/frame"
+			<< "  recall " << batchRecall * 100.0 << "%  mean difference " << batchDifference << " mm" << std::endl;
+	}
+}
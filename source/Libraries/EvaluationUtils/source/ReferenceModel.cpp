@@ -0,0 +1,367 @@
+#include "EvaluationUtils/ReferenceModel.h"
+
+#include <CoreSystems/BowLogger.h>
+#include <Platform/BowMappedFile.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sys/stat.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BOW_REFERENCEMODEL_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace bow
+{
+	static const char g_referenceModelMagic[4] = { 'B', 'R', 'M', '1' };
+
+	struct referenceModelHeader
+	{
+		char				magic[4];
+		unsigned int		width;
+		unsigned int		height;
+		unsigned int		numFrames;
+		unsigned long long	key;	///< hash of the names, sizes and modification times of the frames
+	};
+
+	struct referenceModel_data
+	{
+		referenceModel_data() : meanData(nullptr), varianceData(nullptr), width(0), height(0), numFrames(0), fromCache(false) {}
+
+		MappedFile			file;
+
+		// the model computed by Load, empty if it was mapped from the cache file
+		std::vector<float>	mean;
+		std::vector<float>	variance;
+
+		const float*		meanData;
+		const float*		varianceData;
+		unsigned int		width;
+		unsigned int		height;
+		unsigned int		numFrames;
+		bool				fromCache;
+	};
+
+	// FNV-1a
+	static void hashBytes(const void* data, size_t sizeInBytes, unsigned long long& hash)
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < sizeInBytes; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 0x100000001b3ull;
+		}
+	}
+
+	// Hashes the base names rather than the full paths, plus the size and modification time of every frame, so the
+	// cache survives moving the recording set but not a change to any of its frames
+	static unsigned long long computeKey(const std::vector<FrameData>& frames)
+	{
+		unsigned long long hash = 0xcbf29ce484222325ull;
+		for (unsigned int i = 0; i < frames.size(); i++)
+		{
+			const std::string& filename = frames[i].filename;
+			const size_t separator = filename.find_last_of("\\/");
+			const std::string name = separator == std::string::npos ? filename : filename.substr(separator + 1);
+			hashBytes(name.c_str(), name.size() + 1, hash);
+
+			long long size = -1;
+			long long modificationTime = -1;
+			struct stat buffer;
+			if (stat(filename.c_str(), &buffer) == 0)
+			{
+				size = (long long)buffer.st_size;
+				modificationTime = (long long)buffer.st_mtime;
+			}
+			hashBytes(&size, sizeof(size), hash);
+			hashBytes(&modificationTime, sizeof(modificationTime), hash);
+		}
+		return hash;
+	}
+
+	// Adds the values of a frame and their squares to the sums. Depth and intensity values are integers, so the sums
+	// are exact and the same for any order of the frames.
+	static void accumulateFrame(const cv::Mat_<ushort>& frame, double* sums, double* squaredSums)
+	{
+		for (int row = 0; row < frame.rows; row++)
+		{
+			const ushort* values = frame.ptr<ushort>(row);
+			double* rowSums = sums + (size_t)row * frame.cols;
+			double* rowSquaredSums = squaredSums + (size_t)row * frame.cols;
+
+			int col = 0;
+#ifdef BOW_REFERENCEMODEL_USE_SSE2
+			const __m128i zero = _mm_setzero_si128();
+			for (; col + 8 <= frame.cols; col += 8)
+			{
+				__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + col));
+				__m128i low = _mm_unpacklo_epi16(v, zero);
+				__m128i high = _mm_unpackhi_epi16(v, zero);
+
+				__m128d d[4];
+				d[0] = _mm_cvtepi32_pd(low);
+				d[1] = _mm_cvtepi32_pd(_mm_shuffle_epi32(low, _MM_SHUFFLE(1, 0, 3, 2)));
+				d[2] = _mm_cvtepi32_pd(high);
+				d[3] = _mm_cvtepi32_pd(_mm_shuffle_epi32(high, _MM_SHUFFLE(1, 0, 3, 2)));
+				for (int k = 0; k < 4; k++)
+				{
+					double* s = rowSums + col + k * 2;
+					double* q = rowSquaredSums + col + k * 2;
+					_mm_storeu_pd(s, _mm_add_pd(_mm_loadu_pd(s), d[k]));
+					_mm_storeu_pd(q, _mm_add_pd(_mm_loadu_pd(q), _mm_mul_pd(d[k], d[k])));
+				}
+			}
+#endif
+			for (; col < frame.cols; col++)
+			{
+				const double value = values[col];
+				rowSums[col] += value;
+				rowSquaredSums[col] += value * value;
+			}
+		}
+	}
+
+	static bool computeModel(const std::vector<FrameData>& frames, referenceModel_data* data)
+	{
+		// the first frame that can be loaded fixes the size of the model
+		unsigned int first = 0;
+		cv::Mat_<ushort> firstFrame;
+		for (; first < frames.size(); first++)
+		{
+			firstFrame = DataLoader::loadDepthFromFile(frames[first].filename);
+			if (firstFrame.cols > 0 && firstFrame.rows > 0)
+				break;
+		}
+		if (first == frames.size())
+			return false;
+
+		const int width = firstFrame.cols;
+		const int height = firstFrame.rows;
+		const size_t numPixels = (size_t)width * height;
+
+		std::vector<double> sums(numPixels, 0.0);
+		std::vector<double> squaredSums(numPixels, 0.0);
+		accumulateFrame(firstFrame, sums.data(), squaredSums.data());
+		unsigned int numFrames = 1;
+		firstFrame.release();
+
+		#pragma omp parallel
+		{
+			// every thread loads and sums its own frames, the sums are merged at the end
+			std::vector<double> threadSums(numPixels, 0.0);
+			std::vector<double> threadSquaredSums(numPixels, 0.0);
+			unsigned int threadFrames = 0;
+
+			#pragma omp for schedule(dynamic, 1)
+			for (int i = (int)first + 1; i < (int)frames.size(); i++)
+			{
+				cv::Mat_<ushort> frame = DataLoader::loadDepthFromFile(frames[i].filename);
+				if (frame.cols != width || frame.rows != height)
+					continue;
+
+				accumulateFrame(frame, threadSums.data(), threadSquaredSums.data());
+				threadFrames++;
+			}
+
+			#pragma omp critical
+			{
+				for (size_t p = 0; p < numPixels; p++)
+				{
+					sums[p] += threadSums[p];
+					squaredSums[p] += threadSquaredSums[p];
+				}
+				numFrames += threadFrames;
+			}
+		}
+
+		data->mean.resize(numPixels);
+		data->variance.resize(numPixels);
+		const double inverseNumFrames = 1.0 / numFrames;
+		for (size_t p = 0; p < numPixels; p++)
+		{
+			const double mean = sums[p] * inverseNumFrames;
+			data->mean[p] = (float)mean;
+			data->variance[p] = (float)std::max(0.0, squaredSums[p] * inverseNumFrames - mean * mean);
+		}
+
+		data->meanData = data->mean.data();
+		data->varianceData = data->variance.data();
+		data->width = (unsigned int)width;
+		data->height = (unsigned int)height;
+		data->numFrames = numFrames;
+		return true;
+	}
+
+	static bool mapModel(const std::string& cacheFilePath, unsigned long long key, referenceModel_data* data)
+	{
+		if (!data->file.Open(cacheFilePath.c_str()))
+			return false;
+
+		referenceModelHeader header;
+		if (data->file.GetSizeInBytes() < sizeof(header))
+		{
+			data->file.Close();
+			return false;
+		}
+		memcpy(&header, data->file.GetData(), sizeof(header));
+
+		const size_t numPixels = (size_t)header.width * header.height;
+		if (memcmp(header.magic, g_referenceModelMagic, sizeof(header.magic)) != 0 || header.key != key ||
+			data->file.GetSizeInBytes() != sizeof(header) + numPixels * 2 * sizeof(float))
+		{
+			data->file.Close();
+			return false;
+		}
+
+		const float* values = reinterpret_cast<const float*>(data->file.GetData() + sizeof(header));
+		data->meanData = values;
+		data->varianceData = values + numPixels;
+		data->width = header.width;
+		data->height = header.height;
+		data->numFrames = header.numFrames;
+		data->fromCache = true;
+		return true;
+	}
+
+	static bool writeModel(const std::string& cacheFilePath, unsigned long long key, const referenceModel_data* data)
+	{
+		std::ofstream file(cacheFilePath, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+			return false;
+
+		referenceModelHeader header;
+		memcpy(header.magic, g_referenceModelMagic, sizeof(header.magic));
+		header.width = data->width;
+		header.height = data->height;
+		header.numFrames = data->numFrames;
+		header.key = key;
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(data->mean.data()), data->mean.size() * sizeof(float));
+		file.write(reinterpret_cast<const char*>(data->variance.data()), data->variance.size() * sizeof(float));
+		return file.good();
+	}
+
+	ReferenceModel::ReferenceModel() : m_data(new referenceModel_data())
+	{
+
+	}
+
+	ReferenceModel::~ReferenceModel()
+	{
+		delete m_data;
+	}
+
+	bool ReferenceModel::Load(const std::vector<FrameData>& frames, const std::string& cacheFilePath)
+	{
+		Unload();
+
+		const unsigned long long key = computeKey(frames);
+		if (mapModel(cacheFilePath, key, m_data))
+			return true;
+
+		if (!computeModel(frames, m_data))
+			return false;
+
+		if (!writeModel(cacheFilePath, key, m_data))
+		{
+			LOG_ERROR("ReferenceModel::Load: Could not write cache file %s.", cacheFilePath.c_str());
+		}
+		return true;
+	}
+
+	void ReferenceModel::Unload()
+	{
+		m_data->file.Close();
+		std::vector<float>().swap(m_data->mean);
+		std::vector<float>().swap(m_data->variance);
+		m_data->meanData = nullptr;
+		m_data->varianceData = nullptr;
+		m_data->width = 0;
+		m_data->height = 0;
+		m_data->numFrames = 0;
+		m_data->fromCache = false;
+	}
+
+	bool ReferenceModel::IsLoaded() const
+	{
+		return m_data->meanData != nullptr;
+	}
+
+	bool ReferenceModel::IsFromCache() const
+	{
+		return m_data->fromCache;
+	}
+
+	unsigned int ReferenceModel::GetWidth() const
+	{
+		return m_data->width;
+	}
+
+	unsigned int ReferenceModel::GetHeight() const
+	{
+		return m_data->height;
+	}
+
+	unsigned int ReferenceModel::GetNumFrames() const
+	{
+		return m_data->numFrames;
+	}
+
+	const float* ReferenceModel::GetMeanData() const
+	{
+		return m_data->meanData;
+	}
+
+	const float* ReferenceModel::GetVarianceData() const
+	{
+		return m_data->varianceData;
+	}
+
+	cv::Mat_<double> ReferenceModel::GetMean() const
+	{
+		if (!IsLoaded())
+			return cv::Mat_<double>();
+
+		cv::Mat_<double> mean;
+		cv::Mat_<float>(m_data->height, m_data->width, const_cast<float*>(m_data->meanData)).convertTo(mean, CV_64F);
+		return mean;
+	}
+
+	cv::Mat_<double> ReferenceModel::GetVariance() const
+	{
+		if (!IsLoaded())
+			return cv::Mat_<double>();
+
+		cv::Mat_<double> variance;
+		cv::Mat_<float>(m_data->height, m_data->width, const_cast<float*>(m_data->varianceData)).convertTo(variance, CV_64F);
+		return variance;
+	}
+
+	bool ReferenceModel::ComputeDifference(const cv::Mat_<double>& mean, cv::Mat_<float>& difference) const
+	{
+		if (!IsLoaded() || mean.cols != (int)m_data->width || mean.rows != (int)m_data->height)
+			return false;
+
+		if (difference.cols != mean.cols || difference.rows != mean.rows)
+			difference = cv::Mat_<float>(mean.rows, mean.cols);
+
+		#pragma omp parallel for
+		for (int row = 0; row < mean.rows; row++)
+		{
+			const double* values = mean.ptr<double>(row);
+			const float* reference = m_data->meanData + (size_t)row * m_data->width;
+			float* out = difference.ptr<float>(row);
+			for (int col = 0; col < mean.cols; col++)
+				out[col] = (float)(values[col] - reference[col]);
+		}
+		return true;
+	}
+
+	std::string ReferenceModel::GetCacheFilePath(const std::string& recordingsFolderPath, const std::string& folderName, const std::string& channel)
+	{
+		return recordingsFolderPath + "\\" + folderName + "_" + channel + "_reference.bin";
+	}
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "Platform/Platform_api.h"
+#include "Platform/BowPlatformPredeclares.h"
+
+#include <cstddef>
+
+namespace bow {
+
+	enum class FileAccessHint : char
+	{
+		Sequential,		// read once from front to back, the kernel reads ahead aggressively
+		RandomAccess	// scattered reads, no read ahead
+	};
+
+	// ---------------------------------------------------------------------------
+	/** @brief Read-only view of a whole file.
+
+	On POSIX systems the file is mapped into memory and the access hint is passed to madvise, elsewhere it is read
+	into a buffer in one go. In both cases GetData()[GetSizeInBytes()] is a readable '\0', so text loaders can parse
+	the data in place.
+	*/
+	class PLATFORM_API MappedFile
+	{
+	public:
+		MappedFile();
+		~MappedFile();
+
+		bool Open(const char* filePath, FileAccessHint hint = FileAccessHint::Sequential);
+
+		void Close();
+
+		/// Changes the hint for the following reads
+		void Advise(FileAccessHint hint);
+
+		const char* GetData() const;
+
+		size_t GetSizeInBytes() const;
+
+		/// False if the file was read into a buffer instead
+		bool IsMapped() const;
+
+	private:
+		MappedFile(const MappedFile&) {}; // You shall not copy
+		MappedFile& operator=(const MappedFile&) { return *this; }
+
+		const char*	m_data;
+		size_t		m_sizeInBytes;
+		size_t		m_mappedSizeInBytes;
+		char*		m_buffer;
+	};
+	/*----------------------------------------------------------------*/
+}
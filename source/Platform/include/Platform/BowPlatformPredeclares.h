@@ -5,5 +5,6 @@ namespace bow {
 
 	class PLATFORM_API FileReader;
 	class PLATFORM_API FileWriter;
+	class PLATFORM_API MappedFile;
 }
 
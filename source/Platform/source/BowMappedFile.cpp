@@ -0,0 +1,158 @@
+#include <Masterthesis/Masterthesis-version.h>
+#include "Platform/BowMappedFile.h"
+
+#include <cstdio>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define BOW_MAPPED_FILE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace bow
+{
+	static const char g_emptyFile[1] = { '\0' };
+
+	MappedFile::MappedFile()
+		: m_data(nullptr)
+		, m_sizeInBytes(0)
+		, m_mappedSizeInBytes(0)
+		, m_buffer(nullptr)
+	{
+	}
+
+	MappedFile::~MappedFile()
+	{
+		Close();
+	}
+
+	bool MappedFile::Open(const char* filePath, FileAccessHint hint)
+	{
+		Close();
+
+#ifdef BOW_MAPPED_FILE_MMAP
+		int fileDescriptor = open(filePath, O_RDONLY);
+		if (fileDescriptor < 0)
+		{
+			return false;
+		}
+
+		struct stat fileStatus;
+		if (fstat(fileDescriptor, &fileStatus) == 0 && S_ISREG(fileStatus.st_mode))
+		{
+			m_sizeInBytes = (size_t)fileStatus.st_size;
+			if (m_sizeInBytes == 0)
+			{
+				close(fileDescriptor);
+				m_data = g_emptyFile;
+				return true;
+			}
+
+			// The bytes between the end of the file and the end of its last page read as zero. One more anonymous
+			// page behind it keeps the terminator readable when the size is a multiple of the page size.
+			const size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+			const size_t reservedSize = (m_sizeInBytes + pageSize - 1) / pageSize * pageSize + pageSize;
+
+			void* reserved = mmap(nullptr, reservedSize, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (reserved != MAP_FAILED)
+			{
+				void* mapped = mmap(reserved, m_sizeInBytes, PROT_READ, MAP_PRIVATE | MAP_FIXED, fileDescriptor, 0);
+				if (mapped != MAP_FAILED)
+				{
+					close(fileDescriptor);
+
+					m_data = (const char*)mapped;
+					m_mappedSizeInBytes = reservedSize;
+					Advise(hint);
+					return true;
+				}
+				munmap(reserved, reservedSize);
+			}
+		}
+		close(fileDescriptor);
+#endif
+
+		// buffered fallback
+		FILE* file = fopen(filePath, "rb");
+		if (file == nullptr)
+		{
+			return false;
+		}
+
+		fseek(file, 0, SEEK_END);
+		long size = ftell(file);
+		fseek(file, 0, SEEK_SET);
+		if (size < 0)
+		{
+			fclose(file);
+			return false;
+		}
+
+		m_buffer = new char[(size_t)size + 1];
+		m_sizeInBytes = fread(m_buffer, 1, (size_t)size, file);
+		m_buffer[m_sizeInBytes] = '\0';
+		m_data = m_buffer;
+
+		fclose(file);
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+#ifdef BOW_MAPPED_FILE_MMAP
+		if (m_mappedSizeInBytes > 0)
+		{
+			munmap((void*)m_data, m_mappedSizeInBytes);
+		}
+#endif
+		if (m_buffer != nullptr)
+		{
+			delete[] m_buffer;
+		}
+
+		m_data = nullptr;
+		m_sizeInBytes = 0;
+		m_mappedSizeInBytes = 0;
+		m_buffer = nullptr;
+	}
+
+	void MappedFile::Advise(FileAccessHint hint)
+	{
+#ifdef BOW_MAPPED_FILE_MMAP
+		if (m_mappedSizeInBytes == 0)
+		{
+			return;
+		}
+
+		if (hint == FileAccessHint::Sequential)
+		{
+			// start reading the whole file right away, the loaders touch every page anyway
+			madvise((void*)m_data, m_sizeInBytes, MADV_SEQUENTIAL);
+			madvise((void*)m_data, m_sizeInBytes, MADV_WILLNEED);
+		}
+		else
+		{
+			madvise((void*)m_data, m_sizeInBytes, MADV_RANDOM);
+		}
+#else
+		(void)hint;
+#endif
+	}
+
+	const char* MappedFile::GetData() const
+	{
+		return m_data;
+	}
+
+	size_t MappedFile::GetSizeInBytes() const
+	{
+		return m_sizeInBytes;
+	}
+
+	bool MappedFile::IsMapped() const
+	{
+		return m_mappedSizeInBytes > 0;
+	}
+}
@@ -14,6 +14,10 @@ namespace bow {
 
 		virtual void VCopyFromSystemMemory(void* bufferInSystemMemory, int destinationOffsetInBytes, int lengthInBytes) = 0;
 
+		// Discards the content. A buffer that is rewritten every frame calls this first, so the following copy
+		// gets new storage instead of waiting for draws that still read the old one.
+		virtual void VInvalidate() = 0;
+
 		virtual std::shared_ptr<void> VCopyToSystemMemory()
 		{
 			return VCopyToSystemMemory(0, VGetSizeInBytes());
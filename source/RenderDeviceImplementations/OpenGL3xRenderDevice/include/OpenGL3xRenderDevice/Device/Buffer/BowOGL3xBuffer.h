@@ -14,6 +14,7 @@ namespace bow {
 
 		void CopyFromSystemMemory(void* bufferInSystemMemory, int destinationOffsetInBytes, int lengthInBytes);
 		std::shared_ptr<void> CopyToSystemMemory(int offsetInBytes, int lengthInBytes);
+		void Invalidate();
 
 		int GetSizeInBytes();
 		BufferHint GetUsageHint();
@@ -16,6 +16,7 @@ namespace bow {
 		//void CopyFromBitmap(Bitmap bitmap)
 
 		std::shared_ptr<void> CopyToSystemMemory(int offsetInBytes, int sizeInBytes);
+		void Invalidate();
 		//Bitmap CopyToBitmap(int width, int height, ImagingPixelFormat pixelFormat);
 
 		int GetSizeInBytes() const;
@@ -16,6 +16,7 @@ namespace bow {
 		static void UnBind();
 
 		void VCopyFromSystemMemory(void* bufferInSystemMemory, int destinationOffsetInBytes, int lengthInBytes);
+		void VInvalidate();
 		std::shared_ptr<void> VCopyToSystemMemory(int offsetInBytes, int sizeInBytes);
 
 		int			VGetSizeInBytes();
@@ -16,6 +16,7 @@ namespace bow {
 
 		void VCopyFromSystemMemory(void* bufferInSystemMemory, int destinationOffsetInBytes, int lengthInBytes);
 		std::shared_ptr<void> VCopyToSystemMemory(int offsetInBytes, int sizeInBytes);
+		void Invalidate();
 
 		int				VGetSizeInBytes() const;
 		PixelBufferHint	VGetUsageHint() const;
@@ -8,6 +8,7 @@
 namespace bow {
 
 	class OGLTextureSampler;
+	typedef std::shared_ptr<class OGLWritePixelBuffer> OGLWritePixelBufferPtr;
 
 	class OGLTexture2D : public ITexture2D
 	{
@@ -29,14 +30,22 @@ namespace bow {
 		Texture2DDescription VGetDescription();
 
 	private:
+		void AllocateStorage();
 		void GenerateMipmaps();
 		void ApplySampler(OGLTextureSampler sampler);
 
+		// Uploads from system memory go through a ring of pixel unpack buffers, so glTexSubImage2D returns
+		// before the transfer is done and the next upload does not wait for the previous one.
+		static const int			UploadBufferCount = 3;
+
 		const GLenum				m_target;
 		const Texture2DDescription	m_Description;
 		GLenum						m_lastTextureUnit;
 
 		unsigned int				m_TextureHandle;
+
+		OGLWritePixelBufferPtr		m_uploadBuffers[UploadBufferCount];
+		int							m_nextUploadBuffer;
 	};
 
 	typedef std::shared_ptr<OGLTexture2D> OGLTexture2DPtr;
@@ -55,6 +55,17 @@ namespace bow {
 		return std::shared_ptr<void>(bufferInSystemMemory, [](void* ptr) { delete[] ptr; });
 	}
 
+	void OGLBuffer::Invalidate()
+	{
+		//
+		// Orphaning: GL.BufferData with the same size and no data lets the driver
+		// hand out fresh storage, the old one is released once pending draws are done.
+		//
+		glBindVertexArray(0);
+		Bind();
+		glBufferData(m_type, m_sizeInBytes, nullptr, m_UsageHint);
+	}
+
 	int OGLBuffer::GetSizeInBytes()
 	{
 		return m_sizeInBytes;
@@ -44,6 +44,14 @@ namespace bow {
 	}
 
 
+	void OGLPixelBuffer::Invalidate()
+	{
+		// Orphaning, see OGLBuffer::Invalidate
+		Bind();
+		glBufferData(m_target, m_sizeInBytes, nullptr, m_UsageHint);
+	}
+
+
 	int OGLPixelBuffer::GetSizeInBytes() const
 	{
 		return m_sizeInBytes;
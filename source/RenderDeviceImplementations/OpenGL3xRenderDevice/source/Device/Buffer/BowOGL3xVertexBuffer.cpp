@@ -26,6 +26,11 @@ namespace bow {
 		m_BufferObject.CopyFromSystemMemory(bufferInSystemMemory, destinationOffsetInBytes, lengthInBytes);
 	}
 
+	void OGLVertexBuffer::VInvalidate()
+	{
+		m_BufferObject.Invalidate();
+	}
+
 	std::shared_ptr<void> OGLVertexBuffer::VCopyToSystemMemory(int offsetInBytes, int sizeInBytes)
 	{
 		return m_BufferObject.CopyToSystemMemory(offsetInBytes, sizeInBytes);
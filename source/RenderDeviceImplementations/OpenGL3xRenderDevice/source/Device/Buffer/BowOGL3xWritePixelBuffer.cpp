@@ -9,10 +9,11 @@
 
 namespace bow {
 
+	// the application writes, GL reads: *Draw hints
 	BufferHint wpb_bufferHints[] = {
-		BufferHint::StreamRead,
-		BufferHint::StaticRead,
-		BufferHint::DynamicRead
+		BufferHint::StreamDraw,
+		BufferHint::StaticDraw,
+		BufferHint::DynamicDraw
 	};
 
 
@@ -45,6 +46,12 @@ namespace bow {
 	}
 
 
+	void OGLWritePixelBuffer::Invalidate()
+	{
+		m_BufferObject.Invalidate();
+	}
+
+
 	int	OGLWritePixelBuffer::VGetSizeInBytes() const
 	{
 		return m_BufferObject.GetSizeInBytes();
@@ -3,8 +3,11 @@
 #include <OpenGL3xRenderDevice/Device/Buffer/BowOGL3xReadPixelBuffer.h>
 #include <OpenGL3xRenderDevice/Device/Buffer/BowOGL3xWritePixelBuffer.h>
 #include <OpenGL3xRenderDevice/BowOGL3xTypeConverter.h>
+#include <RenderDevice/Device/Buffer/BowPixelBufferHint.h>
 #include <CoreSystems/BowLogger.h>
 
+#include <algorithm>
+
 #include <GL/glew.h>
 #if defined(_WIN32)
 #include <GL/wglew.h>
@@ -12,7 +15,7 @@
 
 namespace bow {
 
-	OGLTexture2D::OGLTexture2D(Texture2DDescription description, GLenum textureTarget) : m_Description(description), m_target(textureTarget), m_TextureHandle(0)
+	OGLTexture2D::OGLTexture2D(Texture2DDescription description, GLenum textureTarget) : m_Description(description), m_target(textureTarget), m_TextureHandle(0), m_nextUploadBuffer(0)
 	{
 		m_TextureHandle = 0;
 		glGenTextures(1, &m_TextureHandle);
@@ -34,14 +37,7 @@ namespace bow {
 		OGLWritePixelBuffer::UnBind();
 		BindToLastTextureUnit();
 
-		glTexImage2D(m_target, 0,
-			OGLTypeConverter::To(description.GetTextureFormat()),
-			description.GetWidth(),
-			description.GetHeight(),
-			0,
-			OGLTypeConverter::TextureToPixelFormat(description.GetTextureFormat()),
-			OGLTypeConverter::TextureToPixelType(description.GetTextureFormat()),
-			nullptr);
+		AllocateStorage();
 
 		//
 		// Default sampler, compatiable when attaching a non-mimapped 
@@ -108,6 +104,7 @@ namespace bow {
 		BindToLastTextureUnit();
 		glPixelStorei(GL_UNPACK_ALIGNMENT, rowAlignment);
 		glTexSubImage2D(m_target, 0, xOffset, yOffset, width, height, OGLTypeConverter::To(format), OGLTypeConverter::To(dataType), nullptr);
+		OGLWritePixelBuffer::UnBind();
 
 		GenerateMipmaps();
 	}
@@ -120,11 +117,34 @@ namespace bow {
 
 		VerifyRowAlignment(rowAlignment);
 
-		BindToLastTextureUnit();
+		//
+		// The storage was allocated in the constructor, only its content is replaced.
+		// The pixels are copied to the next buffer of the ring, which is orphaned first
+		// in case the GPU still reads it for an earlier upload.
+		//
+		const int sizeInBytes = RequiredSizeInBytes(width, height, format, dataType, rowAlignment);
 
-		ApplySampler(OGLTextureSampler(TextureMinificationFilter::Linear, TextureMagnificationFilter::Linear, TextureWrap::Clamp, TextureWrap::Clamp));
+		// GL does not read the padding behind the last row, the bitmap does not need to have it
+		const int lengthInBytes = RequiredSizeInBytes(width, height - 1, format, dataType, rowAlignment) + width * NumberOfChannels(format) * SizeInBytes(dataType);
 
-		glTexImage2D(m_target, 0, GL_RGBA, width, height, 0, OGLTypeConverter::To(format), OGLTypeConverter::To(dataType), bitmapInSystemMemory);
+		OGLWritePixelBufferPtr& uploadBuffer = m_uploadBuffers[m_nextUploadBuffer];
+		m_nextUploadBuffer = (m_nextUploadBuffer + 1) % UploadBufferCount;
+
+		if (uploadBuffer == nullptr || uploadBuffer->VGetSizeInBytes() < sizeInBytes)
+		{
+			uploadBuffer = OGLWritePixelBufferPtr(new OGLWritePixelBuffer(PixelBufferHint::Stream, sizeInBytes));
+		}
+		else
+		{
+			uploadBuffer->Invalidate();
+		}
+		uploadBuffer->VCopyFromSystemMemory(bitmapInSystemMemory, 0, lengthInBytes);
+
+		uploadBuffer->Bind();
+		BindToLastTextureUnit();
+		glPixelStorei(GL_UNPACK_ALIGNMENT, rowAlignment);
+		glTexSubImage2D(m_target, 0, 0, 0, width, height, OGLTypeConverter::To(format), OGLTypeConverter::To(dataType), nullptr);
+		OGLWritePixelBuffer::UnBind();
 
 		GenerateMipmaps();
 	}
@@ -165,6 +185,40 @@ namespace bow {
 	}
 
 
+	void OGLTexture2D::AllocateStorage()
+	{
+		const GLenum internalFormat = OGLTypeConverter::To(m_Description.GetTextureFormat());
+
+		int levels = 1;
+		if (m_Description.GenerateMipmaps())
+		{
+			for (int size = std::max(m_Description.GetWidth(), m_Description.GetHeight()); size > 1; size /= 2)
+				levels++;
+		}
+
+		// Immutable storage where available, the driver does not have to expect a redefinition on upload
+		if (GLEW_ARB_texture_storage)
+		{
+			glTexStorage2D(m_target, levels, internalFormat, m_Description.GetWidth(), m_Description.GetHeight());
+			return;
+		}
+
+		int width = m_Description.GetWidth();
+		int height = m_Description.GetHeight();
+		for (int level = 0; level < levels; level++)
+		{
+			glTexImage2D(m_target, level, internalFormat, width, height, 0,
+				OGLTypeConverter::TextureToPixelFormat(m_Description.GetTextureFormat()),
+				OGLTypeConverter::TextureToPixelType(m_Description.GetTextureFormat()),
+				nullptr);
+
+			width = std::max(1, width / 2);
+			height = std::max(1, height / 2);
+		}
+		glTexParameteri(m_target, GL_TEXTURE_MAX_LEVEL, levels - 1);
+	}
+
+
 	void OGLTexture2D::GenerateMipmaps()
 	{
 		if (m_Description.GenerateMipmaps())
@@ -7,6 +7,9 @@ namespace bow {
 
 	typedef unsigned long long int ResourceHandle;
 
+	// Platform
+	class MappedFile;
+
 	// Resources
 	class RESOURCES_API Resource;
 		typedef std::shared_ptr<Resource> ResourcePtr;
@@ -0,0 +1,51 @@
+#pragma once
+#include "Resources/Resources_api.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace bow {
+
+	enum class DepthPredictor : unsigned char
+	{
+		RowDelta = 0,	///< predicts from the pixel above, encodes and decodes a whole row with SIMD
+		MED = 1			///< LOCO-I median edge detector, better ratio but sequential along a row
+	};
+
+	/** Lossless codec for 16 bit depth, range and ir frames.
+
+	The frame is split into blocks of RowsPerBlock rows that are coded independently, so blocks
+	can be decoded in parallel and single rows can be read without decoding the whole frame.
+	Every pixel is predicted from its already coded neighbours, the residual is zigzag mapped
+	and groups of GroupSize residuals are bit-packed with the smallest width that fits them.
+
+	Layout (little endian):
+		char[4]		magic "BDC1"
+		uint32		width, height
+		uint8		predictor, uint8 rows per block, uint16 reserved
+		uint32		number of blocks
+		uint32		block offsets [number of blocks + 1], relative to the first block
+		...			blocks
+	*/
+	class RESOURCES_API DepthCodec
+	{
+	public:
+		static const unsigned int RowsPerBlock = 16;
+		static const unsigned int GroupSize = 32;
+
+		/// Encodes width * height pixels into output, returns false for empty frames
+		static bool Encode(const unsigned short* pixels, unsigned int width, unsigned int height, std::vector<unsigned char>& output, DepthPredictor predictor = DepthPredictor::RowDelta);
+
+		/// Checks the magic and reads the frame size without decoding
+		static bool ReadHeader(const unsigned char* data, size_t sizeInBytes, unsigned int& width, unsigned int& height);
+
+		/// Decodes the complete frame into pixels, which has to hold width * height values
+		static bool Decode(const unsigned char* data, size_t sizeInBytes, unsigned short* pixels);
+
+		/// Decodes only the blocks covering [firstRow, firstRow + numRows) into pixels, which has to hold numRows * width values
+		static bool DecodeRows(const unsigned char* data, size_t sizeInBytes, unsigned int firstRow, unsigned int numRows, unsigned short* pixels);
+
+	private:
+		DepthCodec();
+	};
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "Resources/Resources_api.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace bow {
+
+	/** Storage for the time resolved output of the time-of-flight renderer.
+
+	Every pixel holds a histogram of the modulated light over the path length, bin i covers the
+	path length i * binWidth in meters, and the unmodulated light that reached the pixel. Both are
+	the mean over all samples of the pixel. The bins are stored as half floats, which keeps the
+	relative error of a bin below 2^-11 at half the size of the render buffer.
+
+	Correlate multiplies the histograms with the kernels of a modulation (see cuda/transient_histogram.h),
+	so the buckets of any model and frequency can be computed from one rendered frame.
+
+	Layout (little endian):
+		char[4]		magic "BTH1"
+		uint32		width, height
+		uint32		bins per pixel
+		float32		bin width in meters of path length
+		float32		ambient light [width * height]
+		float16		bins [width * height * bins], bins of a pixel are contiguous
+	*/
+	class RESOURCES_API TransientHistogram
+	{
+	public:
+		/** Encodes width * height * bins histogram values and width * height ambient values into output.
+		If pixelWeights is given, histogram and ambient light of pixel p are multiplied by pixelWeights[p],
+		e.g. 1 / samples to store the sums accumulated by the renderer as mean. */
+		static bool Encode(const float* histogram, const float* ambient, unsigned int width, unsigned int height, unsigned int bins, float binWidth, std::vector<unsigned char>& output, const float* pixelWeights = nullptr);
+
+		/// Checks the magic and the size of the data and reads the header
+		static bool ReadHeader(const unsigned char* data, size_t sizeInBytes, unsigned int& width, unsigned int& height, unsigned int& bins, float& binWidth);
+
+		/// Decodes the histograms into histogram (width * height * bins values) and the ambient light into ambient (width * height values)
+		static bool Decode(const unsigned char* data, size_t sizeInBytes, float* histogram, float* ambient);
+
+		/// Decodes only the ambient light, ambient has to hold width * height values
+		static bool DecodeAmbient(const unsigned char* data, size_t sizeInBytes, float* ambient);
+
+		/** Correlates the histogram of every pixel with numKernels kernels of bins values each.
+		Kernel k starts at kernels[k * bins], the result of pixel p is written to output[p * numKernels + k].
+		The ambient light is not included. */
+		static bool Correlate(const unsigned char* data, size_t sizeInBytes, const float* kernels, unsigned int numKernels, float* output);
+
+		/// Conversion between float and IEEE half floats, rounding to nearest even
+		static void FloatToHalf(const float* values, size_t count, unsigned short* halfs);
+		static void HalfToFloat(const unsigned short* halfs, size_t count, float* values);
+
+	private:
+		TransientHistogram();
+	};
+}
@@ -12,8 +12,13 @@ namespace bow {
 		ImageLoader_hdr();
 		~ImageLoader_hdr();
 
-		void ImportImage(const char* inputData, Image* outputImage);
+		/** Decodes a Radiance RGBE image that is fully resident in memory.
+		The header is parsed and the scanline offsets are indexed in a single
+		sequential pass, afterwards the scanlines are RLE decoded and converted
+		to float RGBA in parallel. inputData does not need to be NUL terminated.
+		*/
+		void ImportImage(const char* inputData, size_t sizeInBytes, Image* outputImage);
 
 	private:
 	};
-}
\ No newline at end of file
+}
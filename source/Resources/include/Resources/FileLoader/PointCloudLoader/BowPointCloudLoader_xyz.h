@@ -22,16 +22,9 @@ namespace bow {
 		This method imports data from loaded data opened from a .xyz file and places it's
 		contents into the PointCloud object which is passed in.
 		@param inputData The Data holding the mesh.
+		@param sizeInBytes Size of inputData, the data ends earlier at a '\0'.
 		@param outputMesh Pointer to the PointCloud object which will receive the data. Should be blank already.
 		*/
-		void ImportPointCloud(const char* inputData, PointCloud* outputMesh);
-
-	private:
-		std::istream &safeGetline(std::istream &is, std::string &t);
-
-		inline void parseReal3(float *x, float *y, float *z, const char **token, const float default_x = 0.0, const float default_y = 0.0, const float default_z = 0.0);
-		inline float parseReal(const char **token, float default_value = 0.0);
-
-		bool tryParsefloat(const char *s, const char *s_end, float *result);
+		void ImportPointCloud(const char* inputData, size_t sizeInBytes, PointCloud* outputMesh);
 	};
 }
@@ -0,0 +1,45 @@
+#pragma once
+#include "Resources/Resources_api.h"
+
+#include <cstddef>
+
+namespace bow {
+	struct pointCloudTextScanner_data;
+
+	// ---------------------------------------------------------------------------
+	/** @brief Parser shared by the text point cloud formats (.xyz, .xtc, .xcn).
+
+	Every line that is not empty is a point of up to numColumns floats separated by spaces or tabs, lines end
+	with "\n", "\r\n" or "\r". Columns that are missing or do not parse get their default value, further columns
+	are ignored. The data ends at sizeInBytes or at the first '\0'.
+
+	The data is split into chunks of whole lines. The constructor counts the points of all chunks in parallel,
+	so the caller can size its arrays before Parse writes the points of every chunk in parallel to their index.
+	*/
+	class RESOURCES_API PointCloudTextScanner
+	{
+	public:
+		PointCloudTextScanner(const char* data, size_t sizeInBytes);
+		~PointCloudTextScanner();
+
+		size_t GetNumPoints() const;
+
+		/** Parses the points into attributes of three columns each. Column c of point i is written to
+		attributes[c / 3][i * 3 + c % 3], so every attribute array has to hold 3 * GetNumPoints() floats.
+		@param numColumns Columns per point, a multiple of 3.
+		@param defaults numColumns values used for missing columns.
+		*/
+		void Parse(unsigned int numColumns, const float* defaults, float* const* attributes) const;
+
+		/** Tries to parse a floating point number located at s, reading stops at s_end.
+		If the parsing is a success, result is set to the parsed value and true is returned.
+		*/
+		static bool ParseFloat(const char* s, const char* s_end, float* result);
+
+	private:
+		PointCloudTextScanner(const PointCloudTextScanner&) {}; // You shall not copy
+		PointCloudTextScanner& operator=(const PointCloudTextScanner&) { return *this; }
+
+		pointCloudTextScanner_data* m_data;
+	};
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include "Resources/Resources_api.h"
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace bow {
+
+	// A token of the scene file, points into the file buffer
+	struct PbrtToken
+	{
+		const char* begin;
+		const char* end;
+
+		PbrtToken() : begin(nullptr), end(nullptr) {}
+		PbrtToken(const char* begin, const char* end) : begin(begin), end(end) {}
+
+		bool empty() const { return begin == end; }
+		size_t size() const { return end - begin; }
+		std::string str() const { return std::string(begin, end); }
+
+		bool operator==(const char* text) const
+		{
+			const size_t length = strlen(text);
+			return size() == length && memcmp(begin, text, length) == 0;
+		}
+		bool operator!=(const char* text) const { return !(*this == text); }
+	};
+
+	// A quoted string of a statement and the values that follow it, e.g. "string filename" [ "mesh.ply" ].
+	// Bare values after the directive, e.g. Translate 1 2 3, are parameters without name.
+	struct PbrtParameter
+	{
+		PbrtToken name;
+		PbrtToken values;
+	};
+
+	// A directive and its parameters, which are stored in one array for the whole file
+	struct PbrtStatement
+	{
+		PbrtToken	directive;
+		size_t		firstParameter;
+		size_t		numParameters;
+	};
+
+	// ---------------------------------------------------------------------------
+	/** @brief Splits a pbrt scene into statements in a single pass.
+
+	Statements may span several lines, comments run from '#' to the end of the line, and every word that starts
+	with a letter outside of brackets begins a new statement. A quoted string whose first word is a pbrt type,
+	e.g. "string type" or "rgb Kd", names a typed parameter and takes the following string or bracket as its
+	value. Any other string, e.g. the name of a material or texture, is a parameter of its own, also if it
+	contains spaces.
+	*/
+	class RESOURCES_API PbrtTokenizer
+	{
+	public:
+		static void Tokenize(const char* data, const char* dataEnd, std::vector<PbrtStatement>& statements, std::vector<PbrtParameter>& parameters);
+
+		/// True for "<type> <name>" with one of the parameter types of pbrt
+		static bool IsTypedParameterName(const PbrtToken& name);
+
+	private:
+		PbrtTokenizer();
+	};
+}
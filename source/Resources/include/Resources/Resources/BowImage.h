@@ -45,7 +45,7 @@ namespace bow
 		/// @copydoc Resource::VUnloadImpl
 		void VUnloadImpl(void);
 
-		char* m_dataFromDisk;
+		MappedFile* m_dataFromDisk;
 
 		int	m_width;
 		int	m_height;
@@ -159,7 +159,7 @@ namespace bow {
 		/// @copydoc Resource::VUnloadImpl
 		void VUnloadImpl(void);
 
-		char* m_dataFromDisk;
+		MappedFile* m_dataFromDisk;
 
 		std::vector<Material*>	m_materialList;
 		std::map<std::string, unsigned short>	m_materialNameMap;
@@ -212,7 +212,7 @@ namespace bow {
 		/// @copydoc Resource::VUnloadImpl
 		void VUnloadImpl(void);
 
-		char* m_dataFromDisk;
+		MappedFile* m_dataFromDisk;
 
 		/** A list of submeshes which make up this mesh.
 		Each mesh is made up of 1 or more submeshes, which
@@ -29,6 +29,11 @@ namespace bow {
 
 		AABB<float> GetBoundingBox();
 
+		/** Sorts the points along the Morton curve of their positions, so that points close in space are close in
+		memory. Colors and normals are kept with their points.
+		*/
+		void SortByMortonOrder();
+
 	private:
 		/** Loads the mesh from disk.  This call only performs IO, it
 		does not parse the bytestream or check for any errors therein.
@@ -53,7 +58,7 @@ namespace bow {
 		/// @copydoc Resource::VCalculateSize
 		size_t VCalculateSize(void) const;
 
-		char* m_dataFromDisk;
+		MappedFile* m_dataFromDisk;
 
 		std::vector<Vector3<float>> m_vertices;
 		std::vector<Vector3<float>> m_colors;
@@ -0,0 +1,53 @@
+#pragma once
+#include "Resources/Resources_api.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace bow {
+
+	// ---------------------------------------------------------------------------
+	/** @brief Z-order (Morton) codes and reordering of points and pixels along them.
+
+	Points that are close in space get close codes, so a cloud sorted by code is scanned with far fewer cache misses
+	by neighbour queries, filters and splatting than one in scan order. 3D codes interleave 21 bits per axis (x in
+	bit 0), 2D codes 16 bits per axis. The bits are interleaved with pdep where BMI2 is enabled at compile time,
+	with shifts and masks otherwise; both give the same codes.
+
+	The permutations map a sorted position to the original index, sorted[i] = original[permutation[i]].
+	*/
+	class RESOURCES_API MortonOrder
+	{
+	public:
+		static unsigned long long Encode(unsigned int x, unsigned int y, unsigned int z);
+
+		static void Decode(unsigned long long code, unsigned int& x, unsigned int& y, unsigned int& z);
+
+		static unsigned int Encode2D(unsigned int x, unsigned int y);
+
+		/** Codes of the cells of size cellSize that contain the numPoints points (xyz), counted from the lower corner
+		of the bounds of the cloud. A cellSize of 0 spreads the bounds over the full 2^21 cells per axis.
+		*/
+		static void ComputeCodes(const float* points, size_t numPoints, float cellSize, unsigned long long* codes);
+
+		/** Stable parallel LSD radix sort of the codes, which have to fit into numBits bits; fewer bits take fewer
+		passes. Runs in the same fixed blocks for any number of threads.
+		*/
+		static void SortPermutation(const unsigned long long* codes, size_t numCodes, std::vector<unsigned int>& permutation, unsigned int numBits = 63);
+
+		/// Permutation of cloud (xyz) into the Morton order of its points at full resolution
+		static void SortPermutation(const float* points, size_t numPoints, std::vector<unsigned int>& permutation);
+
+		/// Morton order of the pixels of a row major width x height image, e.g. of the points of a depth frame
+		static void PixelPermutation(unsigned int width, unsigned int height, std::vector<unsigned int>& permutation);
+
+		/// Copies the elements of elementSize bytes of input to output in the order of the permutation
+		static void Reorder(const void* input, size_t elementSize, const std::vector<unsigned int>& permutation, void* output);
+
+		/// Reorders the elements of elementSize bytes of data in place
+		static void Reorder(void* data, size_t elementSize, const std::vector<unsigned int>& permutation);
+
+	private:
+		MortonOrder();
+	};
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include "Resources/Resources_api.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace bow {
+
+	// ---------------------------------------------------------------------------
+	/** @brief Reduction and clean up of point clouds before they are compared or displayed.
+
+	Points, colors and normals are numPoints xyz triples, e.g. &vertices[0].x of the vertices of a PointCloud.
+	The outlier filters return the indices of the points they keep in ascending order, Gather copies the matching
+	colors or other attributes. All filters run in parallel and give the same result for any number of threads.
+	*/
+	class RESOURCES_API PointCloudFilters
+	{
+	public:
+		/** Replaces the points of every occupied voxel by their centroid, and their colors by the mean color if
+		colors is not null. The points are sorted by the Morton code of their voxel, so the output is ordered along
+		a space filling curve. The cloud may span up to 2^21 voxels along every axis.
+		@return Number of output points.
+		*/
+		static size_t VoxelDownsample(const float* points, const float* colors, size_t numPoints, float voxelSize, std::vector<float>& outPoints, std::vector<float>& outColors);
+
+		/// Keeps the points with at least minNeighbours other points within radius
+		static size_t RemoveRadiusOutliers(const float* points, size_t numPoints, float radius, unsigned int minNeighbours, std::vector<unsigned int>& inliers);
+
+		/** Keeps the points whose mean distance to their k nearest neighbours is at most stddevMultiplier standard
+		deviations above the mean of that distance over the whole cloud, as in PCL's StatisticalOutlierRemoval.
+		*/
+		static size_t RemoveStatisticalOutliers(const float* points, size_t numPoints, unsigned int k, float stddevMultiplier, std::vector<unsigned int>& inliers);
+
+		/** Normal of every point from the covariance of its k nearest neighbours (the point included): the
+		eigenvector of the smallest eigenvalue. Normals are flipped to face viewpoint (xyz) if it is not null, e.g. the
+		camera at the origin for a depth frame. curvatures (optional) receives the surface variation
+		lambda0 / (lambda0 + lambda1 + lambda2).
+		*/
+		static void EstimateNormals(const float* points, size_t numPoints, unsigned int k, const float* viewpoint, float* normals, float* curvatures = nullptr);
+
+		/// Copies the xyz triples of attribute at indices to output
+		static void Gather(const float* attribute, const std::vector<unsigned int>& indices, std::vector<float>& output);
+
+	private:
+		PointCloudFilters();
+	};
+}
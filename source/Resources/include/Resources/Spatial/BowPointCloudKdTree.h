@@ -0,0 +1,59 @@
+#pragma once
+#include "Resources/Resources_api.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace bow {
+	struct pointCloudKdTree_data;
+
+	// ---------------------------------------------------------------------------
+	/** @brief Static KD-tree over the positions of a point cloud.
+
+	Points are numPoints xyz triples, e.g. &vertices[0].x of the vertices of a PointCloud. The tree keeps its own
+	copy of the points, sorted by leaf, so the data may be freed after construction. Indices returned by the
+	queries refer to the order of the points given to the constructor.
+
+	Inner nodes split the widest side of their bounding box at the median, queries descend into the closer child
+	first and skip the other one by the distance to its bounds, as in nanoflann. All queries are const and may
+	run concurrently, the batched queries are parallel over the query points.
+	*/
+	class RESOURCES_API PointCloudKdTree
+	{
+	public:
+		/// Index written for missing neighbours, with an infinite distance
+		static const unsigned int InvalidIndex = 0xffffffffu;
+
+		PointCloudKdTree(const float* points, size_t numPoints, unsigned int maxPointsPerLeaf = 10);
+		~PointCloudKdTree();
+
+		size_t GetNumPoints() const;
+
+		/** Finds the k points closest to query (xyz), sorted by distance.
+		@return Number of neighbours found, less than k only if the tree has less than k points.
+		*/
+		size_t FindNearest(const float* query, size_t k, unsigned int* indices, float* squaredDistances) const;
+
+		/// Finds all points within radius of query, sorted by distance
+		size_t FindInRadius(const float* query, float radius, std::vector<unsigned int>& indices, std::vector<float>& squaredDistances) const;
+
+		/** k nearest neighbours of numQueries points at once. The neighbours of query q are written to
+		indices[q * k + i] and squaredDistances[q * k + i], squaredDistances may be null.
+		*/
+		void FindNearest(const float* queries, size_t numQueries, size_t k, unsigned int* indices, float* squaredDistances) const;
+
+		/** Distance from every query point to its closest point, the cloud to cloud distance. Queries without a
+		point closer than maxDistance get an infinite distance, which also shortens the search.
+		*/
+		void FindNearestDistances(const float* queries, size_t numQueries, float* distances, float maxDistance = -1.0f) const;
+
+		/// Number of points within radius of every query point
+		void CountInRadius(const float* queries, size_t numQueries, float radius, unsigned int* counts) const;
+
+	private:
+		PointCloudKdTree(const PointCloudKdTree&) {}; // You shall not copy
+		PointCloudKdTree& operator=(const PointCloudKdTree&) { return *this; }
+
+		pointCloudKdTree_data* m_data;
+	};
+}
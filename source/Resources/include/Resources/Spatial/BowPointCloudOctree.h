@@ -0,0 +1,61 @@
+#pragma once
+#include "Resources/Resources_api.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace bow {
+	struct pointCloudOctree_data;
+
+	// ---------------------------------------------------------------------------
+	/** @brief Disk backed octree with level of detail for point clouds that do not fit into memory.
+
+	Build streams a point file (.bin, .xyz, .xtc or .xcn) three times: for the bounds, for the number of points
+	per cell of a 2^maxDepth grid, and to distribute the points into the leaves, which are the largest nodes with
+	at most maxPointsPerNode points. Every inner node then keeps a subsample of its subtree, the point closest to
+	the centre of every occupied cell of a lodGridSize^3 grid over the node; the sampled points are moved out of
+	the children, so every point is stored exactly once. Memory stays bounded by the cell counts and a few nodes.
+
+	The octree is stored next to each other in octreeFilePath (hierarchy) and octreeFilePath + ".points" (xyz
+	floats and rgba8 per point, native byte order). Open only reads the hierarchy, the points are mapped and read
+	on demand by Query.
+	*/
+	class RESOURCES_API PointCloudOctree
+	{
+	public:
+		static bool Build(const std::string& pointFilePath, const std::string& octreeFilePath, unsigned int maxPointsPerNode = 20000, unsigned int lodGridSize = 64, unsigned int maxDepth = 7);
+
+		/** Planes of the view frustum from an OpenGL view projection matrix (16 floats, column major, clip = M * p).
+		The planes are near, far, left, right, top and bottom like in the frustum of the camera. A point p is inside
+		if planes[i][0] * p.x + planes[i][1] * p.y + planes[i][2] * p.z + planes[i][3] >= 0 for all six planes.
+		*/
+		static void ExtractFrustumPlanes(const float* viewProjection, float planes[6][4]);
+
+		PointCloudOctree();
+		~PointCloudOctree();
+
+		bool Open(const std::string& octreeFilePath);
+
+		void Close();
+
+		size_t GetNumPoints() const;
+
+		size_t GetNumNodes() const;
+
+		/// Axis aligned cube of the root node
+		void GetBounds(float* boundsMin, float* boundsMax) const;
+
+		/** Points of the nodes inside the frustum, coarse nodes first, then refined by their size as seen from the
+		eye, until the next node would exceed pointBudget. Positions (xyz) and colors (rgb in [0, 1]) are appended.
+		@return Number of points appended.
+		*/
+		size_t Query(const float planes[6][4], const float* eye, size_t pointBudget, std::vector<float>& positions, std::vector<float>& colors) const;
+
+	private:
+		PointCloudOctree(const PointCloudOctree&) {}; // You shall not copy
+		PointCloudOctree& operator=(const PointCloudOctree&) { return *this; }
+
+		pointCloudOctree_data* m_data;
+	};
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "Resources/Resources_api.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace bow {
+	struct pointCloudVoxelGrid_data;
+
+	// ---------------------------------------------------------------------------
+	/** @brief Hashed uniform grid over the positions of a point cloud.
+
+	The points (numPoints xyz triples) are sorted by voxel, a hash table maps every occupied voxel to its range
+	of points, so memory only grows with the number of points. The cloud may span up to 2^21 voxels along every
+	axis. Queries visit the voxels around the query point and are fastest when the search radius is a few voxel
+	sizes; for unbounded nearest neighbour queries use PointCloudKdTree. Indices refer to the order of the points
+	given to the constructor.
+
+	All queries are const and may run concurrently, the batched queries are parallel over the query points.
+	*/
+	class RESOURCES_API PointCloudVoxelGrid
+	{
+	public:
+		/// Index written for missing neighbours, with an infinite distance
+		static const unsigned int InvalidIndex = 0xffffffffu;
+
+		PointCloudVoxelGrid(const float* points, size_t numPoints, float voxelSize);
+		~PointCloudVoxelGrid();
+
+		size_t GetNumPoints() const;
+
+		size_t GetNumOccupiedVoxels() const;
+
+		float GetVoxelSize() const;
+
+		/** Finds the k points within maxDistance closest to query (xyz), sorted by distance.
+		@return Number of neighbours found.
+		*/
+		size_t FindNearest(const float* query, size_t k, float maxDistance, unsigned int* indices, float* squaredDistances) const;
+
+		/// Finds all points within radius of query, sorted by distance
+		size_t FindInRadius(const float* query, float radius, std::vector<unsigned int>& indices, std::vector<float>& squaredDistances) const;
+
+		/** k nearest neighbours within maxDistance of numQueries points at once. The neighbours of query q are written
+		to indices[q * k + i] and squaredDistances[q * k + i], squaredDistances may be null. Missing neighbours get
+		InvalidIndex and an infinite distance.
+		*/
+		void FindNearest(const float* queries, size_t numQueries, size_t k, float maxDistance, unsigned int* indices, float* squaredDistances) const;
+
+		/** Distance from every query point to its closest point within maxDistance, infinite for queries without
+		such a point.
+		*/
+		void FindNearestDistances(const float* queries, size_t numQueries, float* distances, float maxDistance) const;
+
+		/// Number of points within radius of every query point
+		void CountInRadius(const float* queries, size_t numQueries, float radius, unsigned int* counts) const;
+
+	private:
+		PointCloudVoxelGrid(const PointCloudVoxelGrid&) {}; // You shall not copy
+		PointCloudVoxelGrid& operator=(const PointCloudVoxelGrid&) { return *this; }
+
+		pointCloudVoxelGrid_data* m_data;
+	};
+}
@@ -0,0 +1,488 @@
+#include "Resources/Codecs/BowDepthCodec.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BOW_DEPTHCODEC_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace bow {
+
+	const unsigned int DepthCodec::RowsPerBlock;
+	const unsigned int DepthCodec::GroupSize;
+
+	static const unsigned char s_magic[4] = { 'B', 'D', 'C', '1' };
+	static const size_t s_headerSize = 20;
+
+	static void writeUInt32(unsigned char* dst, unsigned int value)
+	{
+		dst[0] = (unsigned char)(value);
+		dst[1] = (unsigned char)(value >> 8);
+		dst[2] = (unsigned char)(value >> 16);
+		dst[3] = (unsigned char)(value >> 24);
+	}
+
+	static unsigned int readUInt32(const unsigned char* src)
+	{
+		return (unsigned int)src[0] | ((unsigned int)src[1] << 8) | ((unsigned int)src[2] << 16) | ((unsigned int)src[3] << 24);
+	}
+
+	static inline unsigned short zigzag(unsigned short residual)
+	{
+		return (unsigned short)((residual << 1) ^ (unsigned short)(0 - (residual >> 15)));
+	}
+
+	static inline unsigned short unzigzag(unsigned short z)
+	{
+		return (unsigned short)((z >> 1) ^ (unsigned short)(-(short)(z & 1)));
+	}
+
+	static inline unsigned short predictMED(unsigned short a, unsigned short b, unsigned short c)
+	{
+		unsigned short minAB = std::min(a, b);
+		unsigned short maxAB = std::max(a, b);
+		if (c >= maxAB)
+			return minAB;
+		if (c <= minAB)
+			return maxAB;
+		return (unsigned short)(a + b - c);
+	}
+
+	// ======================================================================
+	// Residuals
+	// ======================================================================
+
+	// first row of a block only has its left neighbour
+	static void residualsFirstRow(const unsigned short* row, unsigned int width, unsigned short* out)
+	{
+		unsigned short left = 0;
+		for (unsigned int x = 0; x < width; x++)
+		{
+			out[x] = zigzag((unsigned short)(row[x] - left));
+			left = row[x];
+		}
+	}
+
+	static void residualsRowDelta(const unsigned short* row, const unsigned short* up, unsigned int width, unsigned short* out)
+	{
+		unsigned int x = 0;
+#ifdef BOW_DEPTHCODEC_USE_SSE2
+		for (; x + 8 <= width; x += 8)
+		{
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x));
+			__m128i u = _mm_loadu_si128(reinterpret_cast<const __m128i*>(up + x));
+			__m128i r = _mm_sub_epi16(v, u);
+			__m128i z = _mm_xor_si128(_mm_slli_epi16(r, 1), _mm_srai_epi16(r, 15));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), z);
+		}
+#endif
+		for (; x < width; x++)
+		{
+			out[x] = zigzag((unsigned short)(row[x] - up[x]));
+		}
+	}
+
+	static void residualsMED(const unsigned short* row, const unsigned short* up, unsigned int width, unsigned short* out)
+	{
+		out[0] = zigzag((unsigned short)(row[0] - up[0]));
+		for (unsigned int x = 1; x < width; x++)
+		{
+			out[x] = zigzag((unsigned short)(row[x] - predictMED(row[x - 1], up[x], up[x - 1])));
+		}
+	}
+
+	static void reconstructFirstRow(const unsigned short* residuals, unsigned int width, unsigned short* row)
+	{
+		unsigned short left = 0;
+		for (unsigned int x = 0; x < width; x++)
+		{
+			left = (unsigned short)(left + unzigzag(residuals[x]));
+			row[x] = left;
+		}
+	}
+
+	static void reconstructRowDelta(const unsigned short* residuals, const unsigned short* up, unsigned int width, unsigned short* row)
+	{
+		unsigned int x = 0;
+#ifdef BOW_DEPTHCODEC_USE_SSE2
+		const __m128i one = _mm_set1_epi16(1);
+		const __m128i zero = _mm_setzero_si128();
+		for (; x + 8 <= width; x += 8)
+		{
+			__m128i z = _mm_loadu_si128(reinterpret_cast<const __m128i*>(residuals + x));
+			__m128i u = _mm_loadu_si128(reinterpret_cast<const __m128i*>(up + x));
+			__m128i r = _mm_xor_si128(_mm_srli_epi16(z, 1), _mm_sub_epi16(zero, _mm_and_si128(z, one)));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(row + x), _mm_add_epi16(u, r));
+		}
+#endif
+		for (; x < width; x++)
+		{
+			row[x] = (unsigned short)(up[x] + unzigzag(residuals[x]));
+		}
+	}
+
+	static void reconstructMED(const unsigned short* residuals, const unsigned short* up, unsigned int width, unsigned short* row)
+	{
+		row[0] = (unsigned short)(up[0] + unzigzag(residuals[0]));
+		for (unsigned int x = 1; x < width; x++)
+		{
+			row[x] = (unsigned short)(predictMED(row[x - 1], up[x], up[x - 1]) + unzigzag(residuals[x]));
+		}
+	}
+
+	// ======================================================================
+	// Bit-packing
+	// ======================================================================
+
+	static unsigned int groupBitWidth(const unsigned short* values, unsigned int count)
+	{
+		unsigned int combined = 0;
+		unsigned int i = 0;
+#ifdef BOW_DEPTHCODEC_USE_SSE2
+		if (count == DepthCodec::GroupSize)
+		{
+			__m128i acc = _mm_setzero_si128();
+			for (; i < count; i += 8)
+			{
+				acc = _mm_or_si128(acc, _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i)));
+			}
+			acc = _mm_or_si128(acc, _mm_srli_si128(acc, 8));
+			acc = _mm_or_si128(acc, _mm_srli_si128(acc, 4));
+			acc = _mm_or_si128(acc, _mm_srli_si128(acc, 2));
+			combined = (unsigned int)_mm_cvtsi128_si32(acc) & 0xffff;
+		}
+#endif
+		for (; i < count; i++)
+		{
+			combined |= values[i];
+		}
+
+		unsigned int bits = 0;
+		while (combined >> bits)
+		{
+			bits++;
+		}
+		return bits;
+	}
+
+	static void packGroup(const unsigned short* values, unsigned int count, std::vector<unsigned char>& out)
+	{
+		unsigned int bits = groupBitWidth(values, count);
+		out.push_back((unsigned char)bits);
+		if (bits == 0)
+		{
+			return;
+		}
+
+		size_t start = out.size();
+		out.resize(start + (count * bits + 7) / 8);
+		unsigned char* dst = &out[start];
+
+		unsigned long long acc = 0;
+		unsigned int filled = 0;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			acc |= (unsigned long long)values[i] << filled;
+			filled += bits;
+			while (filled >= 8)
+			{
+				*dst++ = (unsigned char)acc;
+				acc >>= 8;
+				filled -= 8;
+			}
+		}
+		if (filled > 0)
+		{
+			*dst = (unsigned char)acc;
+		}
+	}
+
+	// returns the number of consumed bytes, 0 if the group does not fit into the remaining data
+	static size_t unpackGroup(const unsigned char* src, size_t available, unsigned int count, unsigned short* values)
+	{
+		if (available < 1)
+			return 0;
+
+		unsigned int bits = src[0];
+		if (bits > 16)
+			return 0;
+
+		size_t numBytes = 1 + (count * bits + 7) / 8;
+		if (numBytes > available)
+			return 0;
+
+		if (bits == 0)
+		{
+			memset(values, 0, count * sizeof(unsigned short));
+			return numBytes;
+		}
+
+		const unsigned char* p = src + 1;
+		const unsigned int mask = (1u << bits) - 1;
+		unsigned long long acc = 0;
+		unsigned int filled = 0;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			while (filled < bits)
+			{
+				acc |= (unsigned long long)(*p++) << filled;
+				filled += 8;
+			}
+			values[i] = (unsigned short)(acc & mask);
+			acc >>= bits;
+			filled -= bits;
+		}
+		return numBytes;
+	}
+
+	// ======================================================================
+	// Blocks
+	// ======================================================================
+
+	static void encodeBlock(const unsigned short* pixels, unsigned int width, unsigned int firstRow, unsigned int lastRow, DepthPredictor predictor, std::vector<unsigned char>& out)
+	{
+		std::vector<unsigned short> residuals(width);
+		for (unsigned int y = firstRow; y < lastRow; y++)
+		{
+			const unsigned short* row = pixels + (size_t)y * width;
+			const unsigned short* up = row - width;
+
+			if (y == firstRow)
+				residualsFirstRow(row, width, &residuals[0]);
+			else if (predictor == DepthPredictor::RowDelta)
+				residualsRowDelta(row, up, width, &residuals[0]);
+			else
+				residualsMED(row, up, width, &residuals[0]);
+
+			for (unsigned int x = 0; x < width; x += DepthCodec::GroupSize)
+			{
+				packGroup(&residuals[x], std::min(DepthCodec::GroupSize, width - x), out);
+			}
+		}
+	}
+
+	// pixels points to the first row of the block
+	static bool decodeBlock(const unsigned char* src, size_t size, unsigned int width, unsigned int numRows, DepthPredictor predictor, unsigned short* pixels)
+	{
+		std::vector<unsigned short> residuals(width);
+		for (unsigned int y = 0; y < numRows; y++)
+		{
+			for (unsigned int x = 0; x < width; x += DepthCodec::GroupSize)
+			{
+				size_t consumed = unpackGroup(src, size, std::min(DepthCodec::GroupSize, width - x), &residuals[x]);
+				if (consumed == 0)
+				{
+					return false;
+				}
+				src += consumed;
+				size -= consumed;
+			}
+
+			unsigned short* row = pixels + (size_t)y * width;
+			const unsigned short* up = row - width;
+
+			if (y == 0)
+				reconstructFirstRow(&residuals[0], width, row);
+			else if (predictor == DepthPredictor::RowDelta)
+				reconstructRowDelta(&residuals[0], up, width, row);
+			else
+				reconstructMED(&residuals[0], up, width, row);
+		}
+		return true;
+	}
+
+	struct DepthCodecHeader
+	{
+		unsigned int	width;
+		unsigned int	height;
+		DepthPredictor	predictor;
+		unsigned int	rowsPerBlock;
+		unsigned int	numBlocks;
+		const unsigned char* offsets;
+		const unsigned char* payload;
+		size_t			payloadSize;
+	};
+
+	static bool parseHeader(const unsigned char* data, size_t sizeInBytes, DepthCodecHeader& header)
+	{
+		if (data == nullptr || sizeInBytes < s_headerSize || memcmp(data, s_magic, 4) != 0)
+		{
+			return false;
+		}
+
+		header.width = readUInt32(data + 4);
+		header.height = readUInt32(data + 8);
+		header.predictor = (DepthPredictor)data[12];
+		header.rowsPerBlock = data[13];
+		header.numBlocks = readUInt32(data + 16);
+
+		if (header.width == 0 || header.height == 0 || header.rowsPerBlock == 0 || data[12] > (unsigned char)DepthPredictor::MED)
+		{
+			return false;
+		}
+
+		if (header.numBlocks != (header.height + header.rowsPerBlock - 1) / header.rowsPerBlock)
+		{
+			return false;
+		}
+
+		size_t tableSize = ((size_t)header.numBlocks + 1) * 4;
+		if (sizeInBytes < s_headerSize + tableSize)
+		{
+			return false;
+		}
+
+		header.offsets = data + s_headerSize;
+		header.payload = header.offsets + tableSize;
+		header.payloadSize = sizeInBytes - s_headerSize - tableSize;
+
+		return readUInt32(header.offsets + header.numBlocks * 4) <= header.payloadSize;
+	}
+
+	static bool decodeBlockOfHeader(const DepthCodecHeader& header, unsigned int block, unsigned short* pixels)
+	{
+		unsigned int begin = readUInt32(header.offsets + block * 4);
+		unsigned int end = readUInt32(header.offsets + (block + 1) * 4);
+		if (begin > end || end > header.payloadSize)
+		{
+			return false;
+		}
+
+		unsigned int firstRow = block * header.rowsPerBlock;
+		unsigned int numRows = std::min(header.rowsPerBlock, header.height - firstRow);
+		return decodeBlock(header.payload + begin, end - begin, header.width, numRows, header.predictor, pixels);
+	}
+
+	// ======================================================================
+
+	bool DepthCodec::Encode(const unsigned short* pixels, unsigned int width, unsigned int height, std::vector<unsigned char>& output, DepthPredictor predictor)
+	{
+		if (pixels == nullptr || width == 0 || height == 0)
+		{
+			return false;
+		}
+
+		const int numBlocks = (int)((height + RowsPerBlock - 1) / RowsPerBlock);
+		std::vector<std::vector<unsigned char>> blocks(numBlocks);
+
+		#pragma omp parallel for schedule(dynamic)
+		for (int block = 0; block < numBlocks; block++)
+		{
+			unsigned int firstRow = block * RowsPerBlock;
+			unsigned int lastRow = std::min(firstRow + RowsPerBlock, height);
+
+			// worst case is 16 bits per residual plus one width byte per group
+			blocks[block].reserve((size_t)(lastRow - firstRow) * (width * 2 + (width + GroupSize - 1) / GroupSize));
+			encodeBlock(pixels, width, firstRow, lastRow, predictor, blocks[block]);
+		}
+
+		size_t tableSize = ((size_t)numBlocks + 1) * 4;
+		size_t payloadSize = 0;
+		for (int block = 0; block < numBlocks; block++)
+		{
+			payloadSize += blocks[block].size();
+		}
+
+		output.resize(s_headerSize + tableSize + payloadSize);
+		unsigned char* dst = &output[0];
+		memcpy(dst, s_magic, 4);
+		writeUInt32(dst + 4, width);
+		writeUInt32(dst + 8, height);
+		dst[12] = (unsigned char)predictor;
+		dst[13] = (unsigned char)RowsPerBlock;
+		dst[14] = 0;
+		dst[15] = 0;
+		writeUInt32(dst + 16, (unsigned int)numBlocks);
+
+		unsigned char* table = dst + s_headerSize;
+		unsigned char* payload = table + tableSize;
+		size_t offset = 0;
+		for (int block = 0; block < numBlocks; block++)
+		{
+			writeUInt32(table + block * 4, (unsigned int)offset);
+			if (!blocks[block].empty())
+			{
+				memcpy(payload + offset, &blocks[block][0], blocks[block].size());
+			}
+			offset += blocks[block].size();
+		}
+		writeUInt32(table + numBlocks * 4, (unsigned int)offset);
+
+		return true;
+	}
+
+	bool DepthCodec::ReadHeader(const unsigned char* data, size_t sizeInBytes, unsigned int& width, unsigned int& height)
+	{
+		DepthCodecHeader header;
+		if (!parseHeader(data, sizeInBytes, header))
+		{
+			return false;
+		}
+
+		width = header.width;
+		height = header.height;
+		return true;
+	}
+
+	bool DepthCodec::Decode(const unsigned char* data, size_t sizeInBytes, unsigned short* pixels)
+	{
+		DepthCodecHeader header;
+		if (pixels == nullptr || !parseHeader(data, sizeInBytes, header))
+		{
+			return false;
+		}
+
+		const int numBlocks = (int)header.numBlocks;
+		bool success = true;
+
+		#pragma omp parallel for schedule(dynamic)
+		for (int block = 0; block < numBlocks; block++)
+		{
+			unsigned short* blockPixels = pixels + (size_t)block * header.rowsPerBlock * header.width;
+			if (!decodeBlockOfHeader(header, block, blockPixels))
+			{
+				#pragma omp critical
+				success = false;
+			}
+		}
+		return success;
+	}
+
+	bool DepthCodec::DecodeRows(const unsigned char* data, size_t sizeInBytes, unsigned int firstRow, unsigned int numRows, unsigned short* pixels)
+	{
+		DepthCodecHeader header;
+		if (pixels == nullptr || !parseHeader(data, sizeInBytes, header))
+		{
+			return false;
+		}
+
+		if (numRows == 0 || firstRow >= header.height || numRows > header.height - firstRow)
+		{
+			return false;
+		}
+
+		unsigned int firstBlock = firstRow / header.rowsPerBlock;
+		unsigned int lastBlock = (firstRow + numRows - 1) / header.rowsPerBlock;
+		std::vector<unsigned short> blockPixels((size_t)header.rowsPerBlock * header.width);
+
+		for (unsigned int block = firstBlock; block <= lastBlock; block++)
+		{
+			if (!decodeBlockOfHeader(header, block, &blockPixels[0]))
+			{
+				return false;
+			}
+
+			unsigned int blockFirstRow = block * header.rowsPerBlock;
+			unsigned int blockRows = std::min(header.rowsPerBlock, header.height - blockFirstRow);
+			unsigned int copyBegin = std::max(firstRow, blockFirstRow);
+			unsigned int copyEnd = std::min(firstRow + numRows, blockFirstRow + blockRows);
+
+			memcpy(pixels + (size_t)(copyBegin - firstRow) * header.width,
+				&blockPixels[(size_t)(copyBegin - blockFirstRow) * header.width],
+				(size_t)(copyEnd - copyBegin) * header.width * sizeof(unsigned short));
+		}
+		return true;
+	}
+}
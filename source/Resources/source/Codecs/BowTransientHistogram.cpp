@@ -0,0 +1,394 @@
+#include "Resources/Codecs/BowTransientHistogram.h"
+
+#include <half_float.h>
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BOW_TRANSIENT_USE_SSE2
+#include <emmintrin.h>
+#include <xmmintrin.h>
+#endif
+
+#if defined(__F16C__) || defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+namespace bow {
+
+	static const unsigned char s_magic[4] = { 'B', 'T', 'H', '1' };
+	static const size_t s_headerSize = 20;
+
+	static void writeUInt32(unsigned char* dst, unsigned int value)
+	{
+		dst[0] = (unsigned char)(value);
+		dst[1] = (unsigned char)(value >> 8);
+		dst[2] = (unsigned char)(value >> 16);
+		dst[3] = (unsigned char)(value >> 24);
+	}
+
+	static unsigned int readUInt32(const unsigned char* src)
+	{
+		return (unsigned int)src[0] | ((unsigned int)src[1] << 8) | ((unsigned int)src[2] << 16) | ((unsigned int)src[3] << 24);
+	}
+
+	static void writeFloat(unsigned char* dst, float value)
+	{
+		unsigned int bits;
+		memcpy(&bits, &value, 4);
+		writeUInt32(dst, bits);
+	}
+
+	static float readFloat(const unsigned char* src)
+	{
+		unsigned int bits = readUInt32(src);
+		float value;
+		memcpy(&value, &bits, 4);
+		return value;
+	}
+
+	// ======================================================================
+	// Half floats
+	// ======================================================================
+
+	// The scalar conversions are the ones of the renderer (half_float.h), the vector paths give the same bits
+
+#if defined(BOW_TRANSIENT_USE_SSE2) && !defined(__F16C__)
+	// half_to_float for four halfs in the low 16 bits of every lane
+	static inline __m128 halfToFloat4(__m128i halfs)
+	{
+		const __m128i exponentMantissaMask = _mm_set1_epi32(0x7fff);
+		const __m128 magic = _mm_castsi128_ps(_mm_set1_epi32((254 - 15) << 23));
+		const __m128i largestFinite = _mm_set1_epi32(0x7bff);
+		const __m128 infinityExponent = _mm_castsi128_ps(_mm_set1_epi32(255 << 23));
+
+		__m128i exponentMantissa = _mm_and_si128(halfs, exponentMantissaMask);
+		__m128i sign = _mm_slli_epi32(_mm_xor_si128(halfs, exponentMantissa), 16);
+		__m128 scaled = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(exponentMantissa, 13)), magic);
+		__m128 infNan = _mm_and_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(exponentMantissa, largestFinite)), infinityExponent);
+		return _mm_or_ps(scaled, _mm_or_ps(_mm_castsi128_ps(sign), infNan));
+	}
+#endif
+
+	// src holds count little endian halfs and does not need to be aligned
+	static void halfsToFloats(const unsigned char* src, size_t count, float* dst)
+	{
+		size_t i = 0;
+#if defined(__F16C__)
+		for (; i + 8 <= count; i += 8)
+		{
+			__m128i halfs = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+			_mm256_storeu_ps(dst + i, _mm256_cvtph_ps(halfs));
+		}
+#elif defined(BOW_TRANSIENT_USE_SSE2)
+		const __m128i zero = _mm_setzero_si128();
+		for (; i + 8 <= count; i += 8)
+		{
+			__m128i halfs = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+			_mm_storeu_ps(dst + i, halfToFloat4(_mm_unpacklo_epi16(halfs, zero)));
+			_mm_storeu_ps(dst + i + 4, halfToFloat4(_mm_unpackhi_epi16(halfs, zero)));
+		}
+#endif
+		for (; i < count; i++)
+		{
+			dst[i] = half_to_float((unsigned short)(src[i * 2] | (src[i * 2 + 1] << 8)));
+		}
+	}
+
+	static void floatsToHalfs(const float* src, size_t count, unsigned char* dst)
+	{
+		size_t i = 0;
+#if defined(__F16C__)
+		for (; i + 8 <= count; i += 8)
+		{
+			__m128i halfs = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 2), halfs);
+		}
+#endif
+		for (; i < count; i++)
+		{
+			unsigned short half = float_to_half(src[i]);
+			dst[i * 2] = (unsigned char)half;
+			dst[i * 2 + 1] = (unsigned char)(half >> 8);
+		}
+	}
+
+	// ======================================================================
+	// Correlation
+	// ======================================================================
+
+	static float dot(const float* a, const float* b, unsigned int count)
+	{
+		unsigned int i = 0;
+		float sum = 0.0f;
+#if defined(__AVX__)
+		__m256 acc0 = _mm256_setzero_ps();
+		__m256 acc1 = _mm256_setzero_ps();
+		for (; i + 16 <= count; i += 16)
+		{
+			acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+			acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8)));
+		}
+		__m128 acc = _mm_add_ps(_mm256_castps256_ps128(_mm256_add_ps(acc0, acc1)), _mm256_extractf128_ps(_mm256_add_ps(acc0, acc1), 1));
+		acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+		acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+		sum = _mm_cvtss_f32(acc);
+#elif defined(BOW_TRANSIENT_USE_SSE2)
+		__m128 acc0 = _mm_setzero_ps();
+		__m128 acc1 = _mm_setzero_ps();
+		for (; i + 8 <= count; i += 8)
+		{
+			acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+			acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+		}
+		__m128 acc = _mm_add_ps(acc0, acc1);
+		acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+		acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+		sum = _mm_cvtss_f32(acc);
+#endif
+		for (; i < count; i++)
+		{
+			sum += a[i] * b[i];
+		}
+		return sum;
+	}
+
+	// Four kernels at once, so every value of the histogram is loaded once for four products
+	static void dot4(const float* kernels, size_t stride, const float* values, unsigned int count, float* result)
+	{
+		const float* k0 = kernels;
+		const float* k1 = kernels + stride;
+		const float* k2 = kernels + stride * 2;
+		const float* k3 = kernels + stride * 3;
+
+		unsigned int i = 0;
+		float sums[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+#if defined(__AVX__)
+		__m256 acc0 = _mm256_setzero_ps();
+		__m256 acc1 = _mm256_setzero_ps();
+		__m256 acc2 = _mm256_setzero_ps();
+		__m256 acc3 = _mm256_setzero_ps();
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256 v = _mm256_loadu_ps(values + i);
+			acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(k0 + i), v));
+			acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(_mm256_loadu_ps(k1 + i), v));
+			acc2 = _mm256_add_ps(acc2, _mm256_mul_ps(_mm256_loadu_ps(k2 + i), v));
+			acc3 = _mm256_add_ps(acc3, _mm256_mul_ps(_mm256_loadu_ps(k3 + i), v));
+		}
+		__m128 a0 = _mm_add_ps(_mm256_castps256_ps128(acc0), _mm256_extractf128_ps(acc0, 1));
+		__m128 a1 = _mm_add_ps(_mm256_castps256_ps128(acc1), _mm256_extractf128_ps(acc1, 1));
+		__m128 a2 = _mm_add_ps(_mm256_castps256_ps128(acc2), _mm256_extractf128_ps(acc2, 1));
+		__m128 a3 = _mm_add_ps(_mm256_castps256_ps128(acc3), _mm256_extractf128_ps(acc3, 1));
+		_MM_TRANSPOSE4_PS(a0, a1, a2, a3);
+		_mm_storeu_ps(sums, _mm_add_ps(_mm_add_ps(a0, a1), _mm_add_ps(a2, a3)));
+#elif defined(BOW_TRANSIENT_USE_SSE2)
+		__m128 acc0 = _mm_setzero_ps();
+		__m128 acc1 = _mm_setzero_ps();
+		__m128 acc2 = _mm_setzero_ps();
+		__m128 acc3 = _mm_setzero_ps();
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 v = _mm_loadu_ps(values + i);
+			acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(k0 + i), v));
+			acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(k1 + i), v));
+			acc2 = _mm_add_ps(acc2, _mm_mul_ps(_mm_loadu_ps(k2 + i), v));
+			acc3 = _mm_add_ps(acc3, _mm_mul_ps(_mm_loadu_ps(k3 + i), v));
+		}
+		_MM_TRANSPOSE4_PS(acc0, acc1, acc2, acc3);
+		_mm_storeu_ps(sums, _mm_add_ps(_mm_add_ps(acc0, acc1), _mm_add_ps(acc2, acc3)));
+#endif
+		for (; i < count; i++)
+		{
+			sums[0] += k0[i] * values[i];
+			sums[1] += k1[i] * values[i];
+			sums[2] += k2[i] * values[i];
+			sums[3] += k3[i] * values[i];
+		}
+		result[0] = sums[0];
+		result[1] = sums[1];
+		result[2] = sums[2];
+		result[3] = sums[3];
+	}
+
+	// ======================================================================
+
+	struct TransientHistogramHeader
+	{
+		unsigned int	width;
+		unsigned int	height;
+		unsigned int	bins;
+		float			binWidth;
+		const unsigned char* ambient;
+		const unsigned char* halfs;
+	};
+
+	static bool parseHeader(const unsigned char* data, size_t sizeInBytes, TransientHistogramHeader& header)
+	{
+		if (data == nullptr || sizeInBytes < s_headerSize || memcmp(data, s_magic, 4) != 0)
+		{
+			return false;
+		}
+
+		header.width = readUInt32(data + 4);
+		header.height = readUInt32(data + 8);
+		header.bins = readUInt32(data + 12);
+		header.binWidth = readFloat(data + 16);
+
+		if (header.width == 0 || header.height == 0 || header.bins == 0 || !(header.binWidth > 0.0f))
+		{
+			return false;
+		}
+
+		const size_t numPixels = (size_t)header.width * header.height;
+		if ((sizeInBytes - s_headerSize) / (4 + (size_t)header.bins * 2) < numPixels)
+		{
+			return false;
+		}
+
+		header.ambient = data + s_headerSize;
+		header.halfs = header.ambient + numPixels * 4;
+		return true;
+	}
+
+	bool TransientHistogram::Encode(const float* histogram, const float* ambient, unsigned int width, unsigned int height, unsigned int bins, float binWidth, std::vector<unsigned char>& output, const float* pixelWeights)
+	{
+		if (histogram == nullptr || ambient == nullptr || width == 0 || height == 0 || bins == 0 || !(binWidth > 0.0f))
+		{
+			return false;
+		}
+
+		const int numPixels = (int)(width * height);
+		output.resize(s_headerSize + (size_t)numPixels * (4 + (size_t)bins * 2));
+
+		unsigned char* dst = &output[0];
+		memcpy(dst, s_magic, 4);
+		writeUInt32(dst + 4, width);
+		writeUInt32(dst + 8, height);
+		writeUInt32(dst + 12, bins);
+		writeFloat(dst + 16, binWidth);
+
+		unsigned char* ambientDst = dst + s_headerSize;
+		unsigned char* halfsDst = ambientDst + (size_t)numPixels * 4;
+
+		#pragma omp parallel
+		{
+			std::vector<float> weighted(pixelWeights != nullptr ? bins : 0);
+
+			#pragma omp for schedule(static)
+			for (int pixel = 0; pixel < numPixels; pixel++)
+			{
+				const float* pixelHistogram = histogram + (size_t)pixel * bins;
+				float pixelAmbient = ambient[pixel];
+				if (pixelWeights != nullptr)
+				{
+					for (unsigned int bin = 0; bin < bins; bin++)
+					{
+						weighted[bin] = pixelHistogram[bin] * pixelWeights[pixel];
+					}
+					pixelHistogram = &weighted[0];
+					pixelAmbient *= pixelWeights[pixel];
+				}
+
+				writeFloat(ambientDst + (size_t)pixel * 4, pixelAmbient);
+				floatsToHalfs(pixelHistogram, bins, halfsDst + (size_t)pixel * bins * 2);
+			}
+		}
+		return true;
+	}
+
+	bool TransientHistogram::ReadHeader(const unsigned char* data, size_t sizeInBytes, unsigned int& width, unsigned int& height, unsigned int& bins, float& binWidth)
+	{
+		TransientHistogramHeader header;
+		if (!parseHeader(data, sizeInBytes, header))
+		{
+			return false;
+		}
+
+		width = header.width;
+		height = header.height;
+		bins = header.bins;
+		binWidth = header.binWidth;
+		return true;
+	}
+
+	bool TransientHistogram::Decode(const unsigned char* data, size_t sizeInBytes, float* histogram, float* ambient)
+	{
+		TransientHistogramHeader header;
+		if (histogram == nullptr || !parseHeader(data, sizeInBytes, header) || !DecodeAmbient(data, sizeInBytes, ambient))
+		{
+			return false;
+		}
+
+		const int numPixels = (int)(header.width * header.height);
+
+		#pragma omp parallel for schedule(static)
+		for (int pixel = 0; pixel < numPixels; pixel++)
+		{
+			halfsToFloats(header.halfs + (size_t)pixel * header.bins * 2, header.bins, histogram + (size_t)pixel * header.bins);
+		}
+		return true;
+	}
+
+	bool TransientHistogram::DecodeAmbient(const unsigned char* data, size_t sizeInBytes, float* ambient)
+	{
+		TransientHistogramHeader header;
+		if (ambient == nullptr || !parseHeader(data, sizeInBytes, header))
+		{
+			return false;
+		}
+
+		const size_t numPixels = (size_t)header.width * header.height;
+		for (size_t pixel = 0; pixel < numPixels; pixel++)
+		{
+			ambient[pixel] = readFloat(header.ambient + pixel * 4);
+		}
+		return true;
+	}
+
+	bool TransientHistogram::Correlate(const unsigned char* data, size_t sizeInBytes, const float* kernels, unsigned int numKernels, float* output)
+	{
+		TransientHistogramHeader header;
+		if (kernels == nullptr || numKernels == 0 || output == nullptr || !parseHeader(data, sizeInBytes, header))
+		{
+			return false;
+		}
+
+		const int numPixels = (int)(header.width * header.height);
+		const unsigned int bins = header.bins;
+
+		// every pixel is converted once and correlated with all kernels while it is in the cache
+		#pragma omp parallel
+		{
+			std::vector<float> histogram(bins);
+
+			#pragma omp for schedule(static)
+			for (int pixel = 0; pixel < numPixels; pixel++)
+			{
+				halfsToFloats(header.halfs + (size_t)pixel * bins * 2, bins, &histogram[0]);
+
+				float* result = output + (size_t)pixel * numKernels;
+				unsigned int k = 0;
+				for (; k + 4 <= numKernels; k += 4)
+				{
+					dot4(kernels + (size_t)k * bins, bins, &histogram[0], bins, result + k);
+				}
+				for (; k < numKernels; k++)
+				{
+					result[k] = dot(kernels + (size_t)k * bins, &histogram[0], bins);
+				}
+			}
+		}
+		return true;
+	}
+
+	void TransientHistogram::FloatToHalf(const float* values, size_t count, unsigned short* halfs)
+	{
+		floatsToHalfs(values, count, reinterpret_cast<unsigned char*>(halfs));
+	}
+
+	void TransientHistogram::HalfToFloat(const unsigned short* halfs, size_t count, float* values)
+	{
+		halfsToFloats(reinterpret_cast<const unsigned char*>(halfs), count, values);
+	}
+}
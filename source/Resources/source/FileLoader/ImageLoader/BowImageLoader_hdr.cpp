@@ -1,12 +1,17 @@
 #include "Resources/FileLoader/ImageLoader/BowImageLoader_hdr.h"
 #include "Resources/BowResources.h"
 
-#include <sstream>
 #include <math.h>
-#include <fstream>
-#include <iostream>
 #include <string>
+#include <vector>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BOW_HDR_USE_SSE2
+#include <emmintrin.h>
+#endif
 
 union RGBe
 {
@@ -17,92 +22,118 @@ union RGBe
 	unsigned char v[4];
 };
 
-inline void RGBEtoFloats(const RGBe &RV, float *FV, float inv_img_exposure)
+// Scale factors 2^(e - 136) for every possible shared exponent, e == 0 encodes black.
+struct RGBeExponentTable
 {
-	if (RV.e == 0)
-		FV[0] = FV[1] = FV[2] = 0.0f;
-	else
+	RGBeExponentTable()
 	{
 		const int HDR_EXPON_BIAS = 128;
-		float s = (float)ldexp(1.0, (int(RV.e) - (HDR_EXPON_BIAS + 8)));
-		s *= inv_img_exposure;
-		FV[0] = (RV.r + 0.5f)*s;
-		FV[1] = (RV.g + 0.5f)*s;
-		FV[2] = (RV.b + 0.5f)*s;
+		scale[0] = 0.0f;
+		for (int e = 1; e < 256; e++)
+		{
+			scale[e] = (float)ldexp(1.0, e - (HDR_EXPON_BIAS + 8));
+		}
 	}
-}
 
+	float scale[256];
+};
+
+static const RGBeExponentTable s_exponentTable;
 
-void ReadScanlineNoRLE(std::istringstream &inf, RGBe *RGBEline, const size_t wid)
+static bool ReadHeaderLine(const char*& cursor, const char* end, std::string& line)
 {
-	inf.read(reinterpret_cast<char *>(RGBEline), wid * sizeof(RGBe));
+	if (cursor >= end)
+	{
+		return false;
+	}
 
-	if (inf.eof())
+	const char* lineEnd = (const char*)memchr(cursor, '\n', end - cursor);
+	if (lineEnd == nullptr)
 	{
-		LOG_ERROR("Premature file end in ReadScanlineNoRLE");
-		return;
+		lineEnd = end;
 	}
+
+	size_t length = lineEnd - cursor;
+	if (length > 0 && cursor[length - 1] == '\r')
+	{
+		length--;
+	}
+
+	line.assign(cursor, length);
+	cursor = (lineEnd < end) ? lineEnd + 1 : end;
+	return true;
 }
 
-void ReadScanline(std::istringstream &inf, RGBe *RGBEline, const size_t wid)
+static bool IsRLEScanline(const unsigned char* data, size_t available, const size_t wid)
 {
 	const size_t MinLen = 8, MaxLen = 0x7fff;
 
-	if (wid<MinLen || wid>MaxLen)
-		return ReadScanlineNoRLE(inf, RGBEline, wid);
+	if (wid < MinLen || wid > MaxLen || available < 4)
+		return false;
 
-	char c0, c1, c2, c3;
-	inf.get(c0);
-	inf.get(c1);
-	inf.get(c2);
-	inf.get(c3);
-
-	if (inf.eof())
-	{
-		LOG_ERROR("Premature file end in ReadScanline 1");
-		return;
-	}
+	// Old-format scanlines don't start with the 2 2 marker
+	return data[0] == 2 && data[1] == 2 && !(data[2] & 0x80);
+}
 
-	if (c0 != 2 || c1 != 2 || (c2 & 0x80))
+// Walks over one scanline without decoding it and returns its size in bytes, 0 if the scanline is broken.
+static size_t MeasureScanline(const unsigned char* data, size_t available, const size_t wid)
+{
+	if (!IsRLEScanline(data, available, wid))
 	{
-		inf.putback(c3);
-		inf.putback(c2);
-		inf.putback(c1);
-		inf.putback(c0);
-		return ReadScanlineNoRLE(inf, RGBEline, wid); // Found an old-format scanline
+		size_t flatSize = wid * sizeof(RGBe);
+		return (flatSize <= available) ? flatSize : 0;
 	}
 
-	if (size_t(size_t(c2) << 8 | size_t(c3)) != wid)
+	if ((size_t(data[2]) << 8 | size_t(data[3])) != wid)
 	{
 		LOG_ERROR("Scanline width inconsistent");
-		return;
+		return 0;
 	}
 
-	// This scanline is RLE.
-	for (unsigned int ch = 0; ch<4; ch++)
+	size_t offset = 4;
+	for (unsigned int ch = 0; ch < 4; ch++)
 	{
-		for (unsigned int x = 0; x<wid; )
+		for (size_t x = 0; x < wid; )
 		{
-			unsigned char code;
-			inf.get(reinterpret_cast<char &>(code));
+			if (offset >= available)
+				return 0;
+
+			unsigned char code = data[offset++];
+			size_t count = (code > 0x80) ? size_t(code & 0x7f) : size_t(code);
 
-			if (inf.eof())
+			if (count == 0 || x + count > wid)
 			{
-				LOG_ERROR("Premature file end in ReadScanline 2");
-				return;
+				LOG_ERROR("Invalid RLE span in scanline");
+				return 0;
 			}
 
-			if (code > 0x80)
-			{ // RLE span
-				char pix;
-				inf.get(pix);
+			offset += (code > 0x80) ? 1 : count;
+			x += count;
+		}
+	}
 
-				if (inf.eof())
-				{
-					LOG_ERROR("Premature file end in ReadScanline 3");
-					return;
-				}
+	return (offset <= available) ? offset : 0;
+}
+
+// Decodes a scanline that has already been validated by MeasureScanline.
+static void DecodeScanline(const unsigned char* data, size_t size, RGBe* RGBEline, const size_t wid)
+{
+	if (!IsRLEScanline(data, size, wid))
+	{
+		memcpy(RGBEline, data, wid * sizeof(RGBe));
+		return;
+	}
+
+	const unsigned char* src = data + 4;
+	for (unsigned int ch = 0; ch < 4; ch++)
+	{
+		for (size_t x = 0; x < wid; )
+		{
+			unsigned char code = *src++;
 
+			if (code > 0x80)
+			{ // RLE span
+				unsigned char pix = *src++;
 				code = code & 0x7f;
 
 				while (code--)
@@ -111,20 +142,57 @@ void ReadScanline(std::istringstream &inf, RGBe *RGBEline, const size_t wid)
 			else
 			{ // Arbitrary span
 				while (code--)
-				{
-					inf.get(reinterpret_cast<char &>(RGBEline[x++].v[ch]));
-
-					if (inf.eof())
-					{
-						LOG_ERROR("Premature file end in ReadScanline 4");
-						return;
-					}
-				}
+					RGBEline[x++].v[ch] = *src++;
 			}
 		}
 	}
 }
 
+static void ConvertScanline(const RGBe* RGBEline, float* FV, const size_t wid, const float* scale)
+{
+	size_t x = 0;
+
+#ifdef BOW_HDR_USE_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 rgbMask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+
+	// 4 pixels per iteration: widen the bytes to int32, add the half-step and scale by the exponent,
+	// the alpha lane is cleared to match the scalar path
+	for (; x + 4 <= wid; x += 4)
+	{
+		__m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(RGBEline + x));
+		__m128i lo = _mm_unpacklo_epi8(packed, zero);
+		__m128i hi = _mm_unpackhi_epi8(packed, zero);
+
+		__m128i p[4] = {
+			_mm_unpacklo_epi16(lo, zero),
+			_mm_unpackhi_epi16(lo, zero),
+			_mm_unpacklo_epi16(hi, zero),
+			_mm_unpackhi_epi16(hi, zero)
+		};
+
+		for (int i = 0; i < 4; i++)
+		{
+			__m128 s = _mm_set1_ps(scale[RGBEline[x + i].e]);
+			__m128 f = _mm_mul_ps(_mm_add_ps(_mm_cvtepi32_ps(p[i]), half), s);
+			_mm_storeu_ps(FV + (x + i) * 4, _mm_and_ps(f, rgbMask));
+		}
+	}
+#endif
+
+	for (; x < wid; x++)
+	{
+		const RGBe& RV = RGBEline[x];
+		float* out = FV + x * 4;
+		float s = scale[RV.e];
+		out[0] = (RV.r + 0.5f)*s;
+		out[1] = (RV.g + 0.5f)*s;
+		out[2] = (RV.b + 0.5f)*s;
+		out[3] = 0.0f;
+	}
+}
+
 namespace bow {
 
 	ImageLoader_hdr::ImageLoader_hdr()
@@ -139,15 +207,15 @@ namespace bow {
 	}
 
 
-	void ImageLoader_hdr::ImportImage(const char* inputData, Image* outputImage)
+	void ImageLoader_hdr::ImportImage(const char* inputData, size_t sizeInBytes, Image* outputImage)
 	{
+		const char* cursor = inputData;
+		const char* end = inputData + sizeInBytes;
+
 		std::string magic, comment;
 		float exposure = 1.0f;
 
-		std::string linebuf;
-		std::istringstream dataStream((const char*)&inputData[0]);
-
-		std::getline(dataStream, magic);
+		ReadHeaderLine(cursor, end, magic);
 		if (magic != "#?RADIANCE" && magic != "#?RGBE")
 		{
 			LOG_ERROR("File isn't Radiance.");
@@ -156,14 +224,16 @@ namespace bow {
 
 		for (;;)
 		{
-			std::getline(dataStream, comment);
+			if (!ReadHeaderLine(cursor, end, comment))
+			{
+				LOG_ERROR("Premature file end in Radiance header");
+				return;
+			}
 
-			// VS2010 doesn't let you look at the 0th element of a 0 length string, so this was tripping
-			// debug asserts
 			if (comment.empty()) break;
 			if (comment[0] == '#') continue;
 
-			if (comment.find("FORMAT") != std::string::npos) 
+			if (comment.find("FORMAT") != std::string::npos)
 			{
 				if (comment == "FORMAT=32-bit_rle_rgbe")
 				{
@@ -178,43 +248,79 @@ namespace bow {
 			}
 
 			size_t ofs = comment.find("EXPOSURE=");
-			if (ofs != std::string::npos) 
+			if (ofs != std::string::npos)
 			{
 				exposure = (float)atof(comment.c_str() + ofs + 9);
 			}
 		}
 
-		std::string major, minor;
-		dataStream >> minor >> outputImage->m_height >> major >> outputImage->m_width;
+		std::string resolution;
+		ReadHeaderLine(cursor, end, resolution);
 
-		if (minor != "-Y" || major != "+X") 
+		char minor[3] = { 0 }, major[3] = { 0 };
+		int height = 0, width = 0;
+		if (sscanf(resolution.c_str(), "%2s %d %2s %d", minor, &height, major, &width) != 4)
+		{
+			LOG_ERROR("Invalid resolution string in Radiance header");
+			return;
+		}
+
+		if (strcmp(minor, "-Y") != 0 || strcmp(major, "+X") != 0)
 		{
 			LOG_ERROR("Can only handle -Y +X ordering");
 			return;
 		}
 
-		if (outputImage->m_width <= 0 || outputImage->m_height <= 0)
+		if (width <= 0 || height <= 0)
 		{
 			LOG_ERROR("Invalid image dimensions");
 			return;
 		}
 
-		std::getline(dataStream, comment); // Read the last newline of the header
+		// Index the scanlines first, RLE scanlines have no fixed size so this pass has to be sequential.
+		const unsigned char* pixels = reinterpret_cast<const unsigned char*>(cursor);
+		const size_t pixelBytes = end - cursor;
+		std::vector<size_t> scanlineOffsets(height + 1);
 
-		RGBe *RGBERaster = new RGBe[outputImage->m_width * outputImage->m_height];
-		for (unsigned int y = 0; y < outputImage->m_height; y++) {
-			ReadScanline(dataStream, RGBERaster + outputImage->m_width * y, outputImage->m_width);
+		size_t offset = 0;
+		for (int y = 0; y < height; y++)
+		{
+			scanlineOffsets[y] = offset;
+			size_t scanlineSize = MeasureScanline(pixels + offset, pixelBytes - offset, width);
+			if (scanlineSize == 0)
+			{
+				LOG_ERROR("Premature file end or corrupt scanline %d in Radiance file", y);
+				return;
+			}
+			offset += scanlineSize;
 		}
+		scanlineOffsets[height] = offset;
 
+		outputImage->m_width = width;
+		outputImage->m_height = height;
 		outputImage->m_numberOfChannels = 4;
-		outputImage->m_sizeInBytes = 4 * sizeof(float) * outputImage->m_width * outputImage->m_height;
-		outputImage->m_data.resize(outputImage->m_numberOfChannels * outputImage->m_width * outputImage->m_height);
+		outputImage->m_sizeInBytes = 4 * sizeof(float) * width * height;
+		outputImage->m_data.resize(outputImage->m_numberOfChannels * width * height);
 
+		float scale[256];
 		float inv_img_exposure = 1.0f / exposure;
-		for (unsigned int i = 0; i < outputImage->m_width * outputImage->m_height; i++) 
+		for (int e = 0; e < 256; e++)
 		{
-			RGBEtoFloats(RGBERaster[i], (&outputImage->m_data[0]) + (i * 4), inv_img_exposure);
+			scale[e] = s_exponentTable.scale[e] * inv_img_exposure;
+		}
+
+		float* output = &outputImage->m_data[0];
+
+		#pragma omp parallel
+		{
+			std::vector<RGBe> RGBEline(width);
+
+			#pragma omp for schedule(static)
+			for (int y = 0; y < height; y++)
+			{
+				DecodeScanline(pixels + scanlineOffsets[y], scanlineOffsets[y + 1] - scanlineOffsets[y], &RGBEline[0], width);
+				ConvertScanline(&RGBEline[0], output + (size_t)y * width * 4, width, scale);
+			}
 		}
-		delete[] RGBERaster;
 	}
 }
@@ -0,0 +1,287 @@
+#include "Resources/FileLoader/PointCloudLoader/BowPointCloudTextScanner.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace bow {
+
+#define IS_DIGIT(x) (static_cast<unsigned int>((x) - '0') < static_cast<unsigned int>(10))
+
+	// Bytes per chunk, chunks end at the next line start
+	static const size_t ChunkSize = 1 << 20;
+
+	struct pointCloudTextScanner_data
+	{
+		const char*			data;
+		std::vector<size_t>	chunkBegin;			// numChunks + 1 entries, the last one is the end of the data
+		std::vector<size_t>	chunkFirstPoint;	// numChunks + 1 entries, the last one is the number of points
+	};
+
+	static bool isLineStart(const char* data, size_t sizeInBytes, size_t position)
+	{
+		if (position == 0 || position >= sizeInBytes)
+			return true;
+		return data[position - 1] == '\n' || (data[position - 1] == '\r' && data[position] != '\n');
+	}
+
+	// Calls pointLine(begin, end) for every line of [begin, end) that is not empty
+	template <typename Function>
+	static void forEachPointLine(const char* begin, const char* end, Function pointLine)
+	{
+		const char* line = begin;
+		while (line < end)
+		{
+			const char* lineEnd = line;
+			while (lineEnd < end && *lineEnd != '\n' && *lineEnd != '\r')
+				lineEnd++;
+
+			if (lineEnd > line)
+				pointLine(line, lineEnd);
+
+			// '\r\n' is one line break
+			if (lineEnd < end && *lineEnd == '\r' && lineEnd + 1 < end && lineEnd[1] == '\n')
+				lineEnd++;
+			line = lineEnd + 1;
+		}
+	}
+
+	PointCloudTextScanner::PointCloudTextScanner(const char* data, size_t sizeInBytes) : m_data(new pointCloudTextScanner_data())
+	{
+		const char* terminator = static_cast<const char*>(memchr(data, '\0', sizeInBytes));
+		if (terminator != nullptr)
+			sizeInBytes = terminator - data;
+
+		m_data->data = data;
+		m_data->chunkBegin.push_back(0);
+		for (size_t position = ChunkSize; position < sizeInBytes; position += ChunkSize)
+		{
+			size_t begin = std::max(position, m_data->chunkBegin.back());
+			while (!isLineStart(data, sizeInBytes, begin))
+				begin++;
+			if (begin < sizeInBytes && begin > m_data->chunkBegin.back())
+				m_data->chunkBegin.push_back(begin);
+		}
+		m_data->chunkBegin.push_back(sizeInBytes);
+
+		const int numChunks = (int)m_data->chunkBegin.size() - 1;
+		m_data->chunkFirstPoint.resize(numChunks + 1, 0);
+
+		#pragma omp parallel for schedule(dynamic)
+		for (int chunk = 0; chunk < numChunks; chunk++)
+		{
+			size_t points = 0;
+			forEachPointLine(data + m_data->chunkBegin[chunk], data + m_data->chunkBegin[chunk + 1], [&points](const char*, const char*) { points++; });
+			m_data->chunkFirstPoint[chunk + 1] = points;
+		}
+
+		for (int chunk = 0; chunk < numChunks; chunk++)
+		{
+			m_data->chunkFirstPoint[chunk + 1] += m_data->chunkFirstPoint[chunk];
+		}
+	}
+
+	PointCloudTextScanner::~PointCloudTextScanner()
+	{
+		delete m_data;
+		m_data = nullptr;
+	}
+
+	size_t PointCloudTextScanner::GetNumPoints() const
+	{
+		return m_data->chunkFirstPoint.back();
+	}
+
+	void PointCloudTextScanner::Parse(unsigned int numColumns, const float* defaults, float* const* attributes) const
+	{
+		const int numChunks = (int)m_data->chunkBegin.size() - 1;
+
+		#pragma omp parallel for schedule(dynamic)
+		for (int chunk = 0; chunk < numChunks; chunk++)
+		{
+			size_t point = m_data->chunkFirstPoint[chunk];
+			forEachPointLine(m_data->data + m_data->chunkBegin[chunk], m_data->data + m_data->chunkBegin[chunk + 1], [&](const char* token, const char* lineEnd)
+			{
+				for (unsigned int column = 0; column < numColumns; column++)
+				{
+					while (token < lineEnd && (*token == ' ' || *token == '\t'))
+						token++;
+					const char* end = token;
+					while (end < lineEnd && *end != ' ' && *end != '\t')
+						end++;
+
+					float value = defaults[column];
+					ParseFloat(token, end, &value);
+					attributes[column / 3][point * 3 + column % 3] = value;
+					token = end;
+				}
+				point++;
+			});
+		}
+	}
+
+	// Tries to parse a floating point number located at s.
+	//
+	// s_end should be a location in the string where reading should absolutely
+	// stop. For example at the end of the string, to prevent buffer overflows.
+	//
+	// Parses the following EBNF grammar:
+	//   sign    = "+" | "-" ;
+	//   END     = ? anything not in digit ?
+	//   digit   = "0" | "1" | "2" | "3" | "4" | "5" | "6" | "7" | "8" | "9" ;
+	//   integer = [sign] , digit , {digit} ;
+	//   decimal = integer , ["." , integer] ;
+	//   float   = ( decimal , END ) | ( decimal , ("E" | "e") , integer , END ) ;
+	//
+	//  Valid strings are for example:
+	//   -0  +3.1417e+2  -0.0E-3  1.0324  -1.41   11e2
+	//
+	// If the parsing is a success, result is set to the parsed value and true
+	// is returned.
+	//
+	// The function is greedy and will parse until any of the following happens:
+	//  - a non-conforming character is encountered.
+	//  - s_end is reached.
+	//
+	// The following situations triggers a failure:
+	//  - s >= s_end.
+	//  - parse failure.
+	//
+	bool PointCloudTextScanner::ParseFloat(const char *s, const char *s_end, float *result)
+	{
+		if (s >= s_end)
+		{
+			return false;
+		}
+
+		float mantissa = 0.0;
+		// This exponent is base 2 rather than 10.
+		// However the exponent we parse is supposed to be one of ten,
+		// thus we must take care to convert the exponent/and or the
+		// mantissa to a * 2^E, where a is the mantissa and E is the
+		// exponent.
+		// To get the final float we will use ldexp, it requires the
+		// exponent to be in base 2.
+		int exponent = 0;
+
+		// NOTE: THESE MUST BE DECLARED HERE SINCE WE ARE NOT ALLOWED
+		// TO JUMP OVER DEFINITIONS.
+		char sign = '+';
+		char exp_sign = '+';
+		char const *curr = s;
+
+		// How many characters were read in a loop.
+		int read = 0;
+		// Tells whether a loop terminated due to reaching s_end.
+		bool end_not_reached = false;
+
+		/*
+		BEGIN PARSING.
+		*/
+
+		// Find out what sign we've got.
+		if (*curr == '+' || *curr == '-')
+		{
+			sign = *curr;
+			curr++;
+		}
+		else if (IS_DIGIT(*curr))
+		{
+			/* Pass through. */
+		}
+		else
+		{
+			goto fail;
+		}
+
+		// Read the integer part.
+		end_not_reached = (curr != s_end);
+		while (end_not_reached && IS_DIGIT(*curr))
+		{
+			mantissa *= 10;
+			mantissa += static_cast<int>(*curr - 0x30);
+			curr++;
+			read++;
+			end_not_reached = (curr != s_end);
+		}
+
+		// We must make sure we actually got something.
+		if (read == 0) goto fail;
+		// We allow numbers of form "#", "###" etc.
+		if (!end_not_reached) goto assemble;
+
+		// Read the decimal part.
+		if (*curr == '.')
+		{
+			curr++;
+			read = 1;
+			end_not_reached = (curr != s_end);
+			while (end_not_reached && IS_DIGIT(*curr))
+			{
+				static const float pow_lut[] = {
+					1.0, 0.1, 0.01, 0.001, 0.0001, 0.00001, 0.000001, 0.0000001,
+				};
+				const int lut_entries = sizeof pow_lut / sizeof pow_lut[0];
+
+				// NOTE: Don't use powf here, it will absolutely murder precision.
+				mantissa += static_cast<int>(*curr - 0x30) *
+					(read < lut_entries ? pow_lut[read] : std::pow(10.0, -read));
+				read++;
+				curr++;
+				end_not_reached = (curr != s_end);
+			}
+		}
+		else if (*curr == 'e' || *curr == 'E')
+		{
+
+		}
+		else
+		{
+			goto assemble;
+		}
+
+		if (!end_not_reached) goto assemble;
+
+		// Read the exponent part.
+		if (*curr == 'e' || *curr == 'E')
+		{
+			curr++;
+			// Figure out if a sign is present and if it is.
+			end_not_reached = (curr != s_end);
+			if (end_not_reached && (*curr == '+' || *curr == '-'))
+			{
+				exp_sign = *curr;
+				curr++;
+			}
+			else if (end_not_reached && IS_DIGIT(*curr))
+			{
+				/* Pass through. */
+			}
+			else
+			{
+				// Empty E is not allowed.
+				goto fail;
+			}
+
+			read = 0;
+			end_not_reached = (curr != s_end);
+			while (end_not_reached && IS_DIGIT(*curr))
+			{
+				exponent *= 10;
+				exponent += static_cast<int>(*curr - 0x30);
+				curr++;
+				read++;
+				end_not_reached = (curr != s_end);
+			}
+			exponent *= (exp_sign == '+' ? 1 : -1);
+			if (read == 0) goto fail;
+		}
+
+	assemble:
+		*result = (sign == '+' ? 1 : -1) * (exponent ? std::ldexp(mantissa * std::pow(5.0, exponent), exponent) : mantissa);
+		return true;
+	fail:
+		return false;
+	}
+}
@@ -0,0 +1,129 @@
+#include "Resources/FileLoader/SceneLoader/BowPbrtTokenizer.h"
+
+#include <algorithm>
+#include <cctype>
+
+namespace bow {
+
+	static const char* const s_parameterTypes[] = {
+		"integer", "float", "point", "point2", "point3", "vector", "vector2", "vector3", "normal", "normal3",
+		"rgb", "color", "spectrum", "blackbody", "bool", "string", "texture"
+	};
+
+	static inline bool isSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+	}
+
+	bool PbrtTokenizer::IsTypedParameterName(const PbrtToken& name)
+	{
+		const char* typeBegin = name.begin;
+		while (typeBegin != name.end && isSpace(*typeBegin))
+			++typeBegin;
+		const char* typeEnd = typeBegin;
+		while (typeEnd != name.end && !isSpace(*typeEnd))
+			++typeEnd;
+
+		// a type alone, e.g. the "color" of a texture, is no parameter name
+		const char* nameBegin = typeEnd;
+		while (nameBegin != name.end && isSpace(*nameBegin))
+			++nameBegin;
+		if (nameBegin == name.end)
+			return false;
+
+		const PbrtToken type(typeBegin, typeEnd);
+		for (size_t i = 0; i < sizeof(s_parameterTypes) / sizeof(s_parameterTypes[0]); i++)
+		{
+			if (type == s_parameterTypes[i])
+				return true;
+		}
+		return false;
+	}
+
+	void PbrtTokenizer::Tokenize(const char* data, const char* dataEnd, std::vector<PbrtStatement>& statements, std::vector<PbrtParameter>& parameters)
+	{
+		const char* c = data;
+		while (c != dataEnd)
+		{
+			if (isSpace(*c))
+			{
+				++c;
+			}
+			else if (*c == '#')
+			{
+				while (c != dataEnd && *c != '\n' && *c != '\r')
+					++c;
+			}
+			else if (*c == '"')
+			{
+				const char* begin = c;
+				const char* end = std::find(c + 1, dataEnd, '"');
+				c = end == dataEnd ? end : end + 1;
+
+				if (statements.empty())
+					continue;
+
+				// a string after a typed parameter name is its value, otherwise it is a new parameter
+				PbrtStatement& statement = statements.back();
+				if (statement.numParameters > 0)
+				{
+					PbrtParameter& last = parameters.back();
+					if (last.values.empty() && IsTypedParameterName(last.name))
+					{
+						last.values = PbrtToken(begin, c);
+						continue;
+					}
+				}
+
+				PbrtParameter parameter;
+				parameter.name = PbrtToken(begin + 1, end);
+				parameters.push_back(parameter);
+				statement.numParameters++;
+			}
+			else if (*c == '[')
+			{
+				const char* begin = c + 1;
+				const char* end = std::find(begin, dataEnd, ']');
+				c = end == dataEnd ? end : end + 1;
+
+				if (statements.empty())
+					continue;
+
+				PbrtStatement& statement = statements.back();
+				if (statement.numParameters > 0 && parameters.back().values.empty() && IsTypedParameterName(parameters.back().name))
+				{
+					parameters.back().values = PbrtToken(begin, end);
+				}
+				else
+				{
+					PbrtParameter parameter;
+					parameter.values = PbrtToken(begin, end);
+					parameters.push_back(parameter);
+					statement.numParameters++;
+				}
+			}
+			else
+			{
+				const char* begin = c;
+				while (c != dataEnd && !isSpace(*c) && *c != '"' && *c != '[' && *c != '#')
+					++c;
+
+				if (std::isalpha((unsigned char)*begin))
+				{
+					PbrtStatement statement;
+					statement.directive = PbrtToken(begin, c);
+					statement.firstParameter = parameters.size();
+					statement.numParameters = 0;
+					statements.push_back(statement);
+				}
+				else if (!statements.empty())
+				{
+					PbrtParameter parameter;
+					parameter.values = PbrtToken(begin, c);
+					parameters.push_back(parameter);
+					statements.back().numParameters++;
+				}
+			}
+		}
+	}
+}
@@ -7,7 +7,7 @@
 
 #include "CoreSystems/BowLogger.h"
 
-#include "Platform/BowFileReader.h"
+#include "Platform/BowMappedFile.h"
 
 namespace bow
 {
@@ -49,31 +49,19 @@ namespace bow
 
 	void Image::VPrepareImpl(void)
 	{
-		// fully prebuffer into host RAM
+		// map the whole file, the loaders parse it in place
 		std::string filePath = VGetName();
 
-		FileReader reader;
-
-		if (reader.Open(filePath.c_str()))
+		m_dataFromDisk = new MappedFile();
+		if (m_dataFromDisk->Open(filePath.c_str(), FileAccessHint::Sequential))
 		{
-			m_sizeInBytes = reader.GetSizeOfFile();
-			m_dataFromDisk = new char[m_sizeInBytes];
-			m_dataFromDisk[m_sizeInBytes - 1] = '\0';
-
-			unsigned int readedBytes = 0;
-			char buffer[1024];
-
-			reader.Seek(0);
-			for (size_t i = 0; !reader.EndOfFile(); i += readedBytes)
-			{
-				readedBytes = (unsigned int)reader.Read(buffer, 1024);
-				memcpy(m_dataFromDisk + i, buffer, readedBytes);
-			}
-
-			reader.Close();
+			// the loaders expect the size to include the terminator
+			m_sizeInBytes = m_dataFromDisk->GetSizeInBytes() + 1;
 		}
 		else
 		{
+			delete m_dataFromDisk;
+			m_dataFromDisk = nullptr;
 			LOG_ERROR("Could not open File '%s'!", filePath.c_str());
 		}
 	}
@@ -82,7 +70,7 @@ namespace bow
 	{
 		if (m_dataFromDisk != nullptr)
 		{
-			delete[] m_dataFromDisk;
+			delete m_dataFromDisk;
 			m_dataFromDisk = nullptr;
 		}
 	}
@@ -104,23 +92,23 @@ namespace bow
 			if (extension == "bmp")
 			{
 				ImageLoader_bmp loader;
-				loader.ImportImage(m_dataFromDisk, this);
+				loader.ImportImage(m_dataFromDisk->GetData(), this);
 			}
 			else if (extension == "hdr" || extension == "HDR")
 			{
 				ImageLoader_hdr loader;
-				loader.ImportImage(m_dataFromDisk, this);
+				loader.ImportImage(m_dataFromDisk->GetData(), m_sizeInBytes, this);
 			}
 			else if (extension == "png")
 			{
 				ImageLoader_png loader;
-				std::vector<unsigned char> raw_data(m_dataFromDisk, m_dataFromDisk + m_sizeInBytes);
+				std::vector<unsigned char> raw_data(m_dataFromDisk->GetData(), m_dataFromDisk->GetData() + m_sizeInBytes);
 				loader.ImportImage(raw_data, this);
 			}
 			else if (extension == "tga")
 			{
 				ImageLoader_tga loader;
-				loader.ImportImage(m_dataFromDisk, this);
+				loader.ImportImage(m_dataFromDisk->GetData(), this);
 			}
 			else
 			{
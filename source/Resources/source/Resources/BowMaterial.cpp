@@ -2,7 +2,7 @@
 
 #include "Resources/FileLoader/MeshLoader/BowModelLoader_obj.h"
 
-#include "Platform/BowFileReader.h"
+#include "Platform/BowMappedFile.h"
 
 namespace bow {
 
@@ -109,31 +109,19 @@ namespace bow {
 
 	void MaterialCollection::VPrepareImpl(void)
 	{
-		// fully prebuffer into host RAM
+		// map the whole file, the loaders parse it in place
 		std::string filePath = VGetName();
 
-		FileReader reader;
-
-		if (reader.Open(filePath.c_str()))
+		m_dataFromDisk = new MappedFile();
+		if (m_dataFromDisk->Open(filePath.c_str(), FileAccessHint::Sequential))
 		{
-			m_sizeInBytes = reader.GetSizeOfFile();
-			m_dataFromDisk = new char[m_sizeInBytes];
-			m_dataFromDisk[m_sizeInBytes - 1] = '\0';
-
-			unsigned int readedBytes = 0;
-			char buffer[1024];
-
-			reader.Seek(0);
-			for (size_t i = 0; !reader.EndOfFile(); i += readedBytes)
-			{
-				readedBytes = (unsigned int)reader.Read(buffer, 1024);
-				memcpy(m_dataFromDisk + i, buffer, readedBytes);
-			}
-
-			reader.Close();
+			// the loaders expect the size to include the terminator
+			m_sizeInBytes = m_dataFromDisk->GetSizeInBytes() + 1;
 		}
 		else
 		{
+			delete m_dataFromDisk;
+			m_dataFromDisk = nullptr;
 			LOG_ERROR("Could not open File '%s'!", filePath.c_str());
 		}
 	}
@@ -142,7 +130,7 @@ namespace bow {
 	{
 		if (m_dataFromDisk != nullptr)
 		{
-			delete[] m_dataFromDisk;
+			delete m_dataFromDisk;
 			m_dataFromDisk = nullptr;
 		}
 	}
@@ -164,7 +152,7 @@ namespace bow {
 			if (extension == "mtl")
 			{
 				ModelLoader_obj loader;
-				loader.ImportMaterial(m_dataFromDisk, this);
+				loader.ImportMaterial(m_dataFromDisk->GetData(), this);
 			}
 			else
 			{
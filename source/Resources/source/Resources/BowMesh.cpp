@@ -8,7 +8,7 @@
 #include "CoreSystems/Geometry/VertexAttributes/BowVertexAttributeFloatVec2.h"
 #include "CoreSystems/Geometry/VertexAttributes/BowVertexAttributeFloatVec3.h"
 
-#include "Platform/BowFileReader.h"
+#include "Platform/BowMappedFile.h"
 
 #include <limits>
 #include <iostream>
@@ -342,31 +342,19 @@ namespace bow {
 
 	void Mesh::VPrepareImpl(void)
 	{
-		// fully prebuffer into host RAM
+		// map the whole file, the loaders parse it in place
 		std::string filePath = VGetName();
 
-		FileReader reader;
-
-		if (reader.Open(filePath.c_str()))
+		m_dataFromDisk = new MappedFile();
+		if (m_dataFromDisk->Open(filePath.c_str(), FileAccessHint::Sequential))
 		{
-			m_sizeInBytes = reader.GetSizeOfFile();
-			m_dataFromDisk = new char[m_sizeInBytes];
-			m_dataFromDisk[m_sizeInBytes - 1] = '\0';
-
-			unsigned int readedBytes = 0;
-			char buffer[1024];
-
-			reader.Seek(0);
-			for (size_t i = 0; !reader.EndOfFile(); i += readedBytes)
-			{
-				readedBytes = (unsigned int)reader.Read(buffer, 1024);
-				memcpy(m_dataFromDisk + i, buffer, readedBytes);
-			}
-
-			reader.Close();
+			// the loaders expect the size to include the terminator
+			m_sizeInBytes = m_dataFromDisk->GetSizeInBytes() + 1;
 		}
 		else
 		{
+			delete m_dataFromDisk;
+			m_dataFromDisk = nullptr;
 			LOG_ERROR("Could not open File '%s'!", filePath.c_str());
 		}
 	}
@@ -375,7 +363,7 @@ namespace bow {
 	{
 		if (m_dataFromDisk != nullptr)
 		{
-			delete[] m_dataFromDisk;
+			delete m_dataFromDisk;
 			m_dataFromDisk = nullptr;
 		}
 	}
@@ -397,12 +385,12 @@ namespace bow {
 			if (extension == "obj")
 			{
 				ModelLoader_obj loader;
-				loader.ImportMesh(m_dataFromDisk, this);
+				loader.ImportMesh(m_dataFromDisk->GetData(), this);
 			}
 			else if (extension == "ply")
 			{
 				ModelLoader_ply loader;
-				loader.ImportMesh(m_dataFromDisk, this);
+				loader.ImportMesh(m_dataFromDisk->GetData(), this);
 			}
 			else
 			{
@@ -4,11 +4,12 @@
 #include "Resources/FileLoader/PointCloudLoader/BowPointCloudLoader_xcn.h"
 #include "Resources/FileLoader/PointCloudLoader/BowPointCloudLoader_xtc.h"
 #include "Resources/FileLoader/PointCloudLoader/BowPointCloudLoader_xyz.h"
+#include "Resources/Spatial/BowMortonOrder.h"
 
 #include "CoreSystems/Geometry/BowMeshAttribute.h"
 #include "CoreSystems/Geometry/VertexAttributes/BowVertexAttributeFloatVec3.h"
 
-#include "Platform/BowFileReader.h"
+#include "Platform/BowMappedFile.h"
 
 #undef max
 #undef min
@@ -93,31 +94,19 @@ namespace bow {
 
 	void PointCloud::VPrepareImpl(void)
 	{
-		// fully prebuffer into host RAM
+		// map the whole file, the loaders parse it in place
 		std::string filePath = VGetName();
 
-		FileReader reader;
-
-		if (reader.Open(filePath.c_str()))
+		m_dataFromDisk = new MappedFile();
+		if (m_dataFromDisk->Open(filePath.c_str(), FileAccessHint::Sequential))
 		{
-			m_sizeInBytes = reader.GetSizeOfFile();
-			m_dataFromDisk = new char[m_sizeInBytes];
-			m_dataFromDisk[m_sizeInBytes - 1] = '\0';
-
-			unsigned int readedBytes = 0;
-			char buffer[1024];
-
-			reader.Seek(0);
-			for (size_t i = 0; !reader.EndOfFile(); i += readedBytes)
-			{
-				readedBytes = reader.Read(buffer, 1024);
-				memcpy(m_dataFromDisk + i, buffer, readedBytes);
-			}
-
-			reader.Close();
+			// the loaders expect the size to include the terminator
+			m_sizeInBytes = m_dataFromDisk->GetSizeInBytes() + 1;
 		}
 		else
 		{
+			delete m_dataFromDisk;
+			m_dataFromDisk = nullptr;
 			LOG_ERROR("Could not open File '%s'!", filePath.c_str());
 		}
 	}
@@ -126,7 +115,7 @@ namespace bow {
 	{
 		if (m_dataFromDisk != nullptr)
 		{
-			delete[] m_dataFromDisk;
+			delete m_dataFromDisk;
 			m_dataFromDisk = nullptr;
 		}
 	}
@@ -148,7 +137,7 @@ namespace bow {
 			if (extension == "bin")
 			{
 				PointCloudLoader_bin loader;
-				loader.ImportPointCloud(m_dataFromDisk, m_sizeInBytes, this);
+				loader.ImportPointCloud(m_dataFromDisk->GetData(), m_sizeInBytes, this);
 
 				m_colors.resize(m_vertices.size());
 				for (unsigned int i = 0; i < m_colors.size(); i++)
@@ -159,7 +148,7 @@ namespace bow {
 			else if (extension == "xyz")
 			{
 				PointCloudLoader_xyz loader;
-				loader.ImportPointCloud(m_dataFromDisk, this);
+				loader.ImportPointCloud(m_dataFromDisk->GetData(), m_sizeInBytes, this);
 
 				m_colors.resize(m_vertices.size());
 				for (unsigned int i = 0; i < m_colors.size(); i++)
@@ -170,12 +159,12 @@ namespace bow {
 			else if (extension == "xtc")
 			{
 				PointCloudLoader_xtc loader;
-				loader.ImportPointCloud(m_dataFromDisk, this);
+				loader.ImportPointCloud(m_dataFromDisk->GetData(), m_sizeInBytes, this);
 			}
 			else if (extension == "xcn")
 			{
 				PointCloudLoader_xcn loader;
-				loader.ImportPointCloud(m_dataFromDisk, this);
+				loader.ImportPointCloud(m_dataFromDisk->GetData(), m_sizeInBytes, this);
 			}
 			else
 			{
@@ -194,6 +183,27 @@ namespace bow {
 		m_vertices.clear();
 	}
 
+	void PointCloud::SortByMortonOrder()
+	{
+		if (m_vertices.empty())
+		{
+			return;
+		}
+
+		std::vector<unsigned int> permutation;
+		MortonOrder::SortPermutation(&m_vertices[0].x, m_vertices.size(), permutation);
+
+		MortonOrder::Reorder(&m_vertices[0], sizeof(Vector3<float>), permutation);
+		if (m_colors.size() == m_vertices.size())
+		{
+			MortonOrder::Reorder(&m_colors[0], sizeof(Vector3<float>), permutation);
+		}
+		if (m_normals.size() == m_vertices.size())
+		{
+			MortonOrder::Reorder(&m_normals[0], sizeof(Vector3<float>), permutation);
+		}
+	}
+
 	size_t PointCloud::VCalculateSize(void) const
 	{
 		// calculate GPU size
@@ -0,0 +1,229 @@
+#include "Resources/Spatial/BowMortonOrder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#if (defined(__BMI2__) || defined(__AVX2__)) && (defined(__x86_64__) || defined(_M_X64))
+#define BOW_MORTON_USE_BMI2
+#include <immintrin.h>
+#endif
+
+namespace bow {
+
+	// Every third bit, starting at x, y and z
+	static const unsigned long long mortonMaskX = 0x1249249249249249ull;
+	static const unsigned long long mortonMaskY = 0x2492492492492492ull;
+	static const unsigned long long mortonMaskZ = 0x4924924924924924ull;
+
+	// Radix sort in blocks of fixed size, so the result does not depend on the number of threads
+	static const size_t radixBlockSize = 1 << 16;
+	static const unsigned int radixBits = 11;
+	static const unsigned int radixSize = 1 << radixBits;
+
+#ifndef BOW_MORTON_USE_BMI2
+	// Inserts two zero bits above each of the lower 21 bits
+	static inline unsigned long long spreadBits3(unsigned long long x)
+	{
+		x &= 0x1fffffull;
+		x = (x | x << 32) & 0x1f00000000ffffull;
+		x = (x | x << 16) & 0x1f0000ff0000ffull;
+		x = (x | x << 8) & 0x100f00f00f00f00full;
+		x = (x | x << 4) & 0x10c30c30c30c30c3ull;
+		x = (x | x << 2) & 0x1249249249249249ull;
+		return x;
+	}
+
+	static inline unsigned int compactBits3(unsigned long long x)
+	{
+		x &= 0x1249249249249249ull;
+		x = (x ^ (x >> 2)) & 0x10c30c30c30c30c3ull;
+		x = (x ^ (x >> 4)) & 0x100f00f00f00f00full;
+		x = (x ^ (x >> 8)) & 0x1f0000ff0000ffull;
+		x = (x ^ (x >> 16)) & 0x1f00000000ffffull;
+		x = (x ^ (x >> 32)) & 0x1fffffull;
+		return (unsigned int)x;
+	}
+
+	// Inserts a zero bit above each of the lower 16 bits
+	static inline unsigned int spreadBits2(unsigned int x)
+	{
+		x &= 0xffffu;
+		x = (x | x << 8) & 0x00ff00ffu;
+		x = (x | x << 4) & 0x0f0f0f0fu;
+		x = (x | x << 2) & 0x33333333u;
+		x = (x | x << 1) & 0x55555555u;
+		return x;
+	}
+#endif
+
+	unsigned long long MortonOrder::Encode(unsigned int x, unsigned int y, unsigned int z)
+	{
+#ifdef BOW_MORTON_USE_BMI2
+		return _pdep_u64(x, mortonMaskX) | _pdep_u64(y, mortonMaskY) | _pdep_u64(z, mortonMaskZ);
+#else
+		return spreadBits3(x) | (spreadBits3(y) << 1) | (spreadBits3(z) << 2);
+#endif
+	}
+
+	void MortonOrder::Decode(unsigned long long code, unsigned int& x, unsigned int& y, unsigned int& z)
+	{
+#ifdef BOW_MORTON_USE_BMI2
+		x = (unsigned int)_pext_u64(code, mortonMaskX);
+		y = (unsigned int)_pext_u64(code, mortonMaskY);
+		z = (unsigned int)_pext_u64(code, mortonMaskZ);
+#else
+		x = compactBits3(code);
+		y = compactBits3(code >> 1);
+		z = compactBits3(code >> 2);
+#endif
+	}
+
+	unsigned int MortonOrder::Encode2D(unsigned int x, unsigned int y)
+	{
+#ifdef BOW_MORTON_USE_BMI2
+		return (unsigned int)(_pdep_u64(x & 0xffffu, 0x55555555ull) | _pdep_u64(y & 0xffffu, 0xaaaaaaaaull));
+#else
+		return spreadBits2(x) | (spreadBits2(y) << 1);
+#endif
+	}
+
+	void MortonOrder::ComputeCodes(const float* points, size_t numPoints, float cellSize, unsigned long long* codes)
+	{
+		if (numPoints == 0)
+			return;
+
+		float boundsMin[3] = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+		float boundsMax[3] = { -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max() };
+		for (size_t i = 0; i < numPoints; i++)
+		{
+			for (int d = 0; d < 3; d++)
+			{
+				boundsMin[d] = std::min(boundsMin[d], points[i * 3 + d]);
+				boundsMax[d] = std::max(boundsMax[d], points[i * 3 + d]);
+			}
+		}
+
+		const int maxCell = (1 << 21) - 1;
+		if (cellSize <= 0.0f)
+		{
+			const float extent = std::max(boundsMax[0] - boundsMin[0], std::max(boundsMax[1] - boundsMin[1], boundsMax[2] - boundsMin[2]));
+			cellSize = extent > 0.0f ? extent / maxCell : 1.0f;
+		}
+
+		// cells are counted from the cell of the lower bound, like the voxels of a grid anchored at the origin
+		const float inverseCellSize = 1.0f / cellSize;
+		int origin[3];
+		for (int d = 0; d < 3; d++)
+			origin[d] = (int)std::floor(boundsMin[d] * inverseCellSize);
+
+		#pragma omp parallel for
+		for (int i = 0; i < (int)numPoints; i++)
+		{
+			unsigned int cell[3];
+			for (int d = 0; d < 3; d++)
+			{
+				const int c = (int)std::floor(points[size_t(i) * 3 + d] * inverseCellSize) - origin[d];
+				cell[d] = (unsigned int)std::min(std::max(c, 0), maxCell);
+			}
+			codes[i] = Encode(cell[0], cell[1], cell[2]);
+		}
+	}
+
+	void MortonOrder::SortPermutation(const unsigned long long* codes, size_t numCodes, std::vector<unsigned int>& permutation, unsigned int numBits)
+	{
+		permutation.resize(numCodes);
+		const size_t numBlocks = (numCodes + radixBlockSize - 1) / radixBlockSize;
+
+		std::vector<unsigned long long> keys(codes, codes + numCodes), sortedKeys(numCodes);
+		std::vector<unsigned int> sortedIndices(numCodes);
+		for (size_t i = 0; i < numCodes; i++)
+			permutation[i] = (unsigned int)i;
+
+		// counts of every digit in every block, then the first output position of every digit in every block
+		std::vector<size_t> offsets(numBlocks * radixSize);
+		for (unsigned int shift = 0; shift < std::min(numBits, 64u); shift += radixBits)
+		{
+			#pragma omp parallel for
+			for (int b = 0; b < (int)numBlocks; b++)
+			{
+				size_t* counts = &offsets[size_t(b) * radixSize];
+				std::fill(counts, counts + radixSize, 0);
+				const size_t end = std::min(numCodes, (b + 1) * radixBlockSize);
+				for (size_t i = b * radixBlockSize; i < end; i++)
+					counts[(keys[i] >> shift) & (radixSize - 1)]++;
+			}
+
+			// a digit shared by all keys does not change the order
+			bool allSame = false;
+			size_t position = 0;
+			for (unsigned int digit = 0; digit < radixSize; digit++)
+			{
+				const size_t digitBegin = position;
+				for (size_t b = 0; b < numBlocks; b++)
+				{
+					const size_t count = offsets[b * radixSize + digit];
+					offsets[b * radixSize + digit] = position;
+					position += count;
+				}
+				allSame = allSame || position - digitBegin == numCodes;
+			}
+			if (allSame)
+				continue;
+
+			#pragma omp parallel for
+			for (int b = 0; b < (int)numBlocks; b++)
+			{
+				size_t* next = &offsets[size_t(b) * radixSize];
+				const size_t end = std::min(numCodes, (b + 1) * radixBlockSize);
+				for (size_t i = b * radixBlockSize; i < end; i++)
+				{
+					const size_t to = next[(keys[i] >> shift) & (radixSize - 1)]++;
+					sortedKeys[to] = keys[i];
+					sortedIndices[to] = permutation[i];
+				}
+			}
+			keys.swap(sortedKeys);
+			permutation.swap(sortedIndices);
+		}
+	}
+
+	void MortonOrder::SortPermutation(const float* points, size_t numPoints, std::vector<unsigned int>& permutation)
+	{
+		std::vector<unsigned long long> codes(numPoints);
+		ComputeCodes(points, numPoints, 0.0f, codes.data());
+		SortPermutation(codes.data(), numPoints, permutation);
+	}
+
+	void MortonOrder::PixelPermutation(unsigned int width, unsigned int height, std::vector<unsigned int>& permutation)
+	{
+		const size_t numPixels = size_t(width) * height;
+		std::vector<unsigned long long> codes(numPixels);
+
+		#pragma omp parallel for
+		for (int y = 0; y < (int)height; y++)
+		{
+			for (unsigned int x = 0; x < width; x++)
+				codes[size_t(y) * width + x] = Encode2D(x, (unsigned int)y);
+		}
+		SortPermutation(codes.data(), numPixels, permutation, 32);
+	}
+
+	void MortonOrder::Reorder(const void* input, size_t elementSize, const std::vector<unsigned int>& permutation, void* output)
+	{
+		const char* from = static_cast<const char*>(input);
+		char* to = static_cast<char*>(output);
+
+		#pragma omp parallel for
+		for (int i = 0; i < (int)permutation.size(); i++)
+			memcpy(to + size_t(i) * elementSize, from + size_t(permutation[i]) * elementSize, elementSize);
+	}
+
+	void MortonOrder::Reorder(void* data, size_t elementSize, const std::vector<unsigned int>& permutation)
+	{
+		std::vector<char> copy(static_cast<char*>(data), static_cast<char*>(data) + permutation.size() * elementSize);
+		Reorder(copy.data(), elementSize, permutation, data);
+	}
+}
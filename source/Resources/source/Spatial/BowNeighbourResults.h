@@ -0,0 +1,122 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <vector>
+
+// Result sets shared by the spatial indices. Worst() is the squared distance a candidate must not exceed, the
+// indices use it to skip nodes and voxels that are too far away.
+
+namespace bow {
+
+	// The k closest candidates, kept sorted by insertion
+	class NearestResults
+	{
+	public:
+		NearestResults(size_t k, unsigned int* indices, float* squaredDistances, float maxSquaredDistance)
+			: m_k(k), m_count(0), m_indices(indices), m_squaredDistances(squaredDistances), m_maxSquaredDistance(maxSquaredDistance)
+		{
+		}
+
+		float Worst() const
+		{
+			return m_count < m_k ? m_maxSquaredDistance : m_squaredDistances[m_k - 1];
+		}
+
+		void Add(unsigned int index, float squaredDistance)
+		{
+			if (m_k == 0 || squaredDistance > Worst() || (m_count == m_k && squaredDistance == Worst()))
+				return;
+
+			size_t i = m_count < m_k ? m_count++ : m_k - 1;
+			for (; i > 0 && m_squaredDistances[i - 1] > squaredDistance; i--)
+			{
+				m_indices[i] = m_indices[i - 1];
+				m_squaredDistances[i] = m_squaredDistances[i - 1];
+			}
+			m_indices[i] = index;
+			m_squaredDistances[i] = squaredDistance;
+		}
+
+		size_t Count() const { return m_count; }
+
+		bool Full() const { return m_count == m_k; }
+
+	private:
+		size_t			m_k;
+		size_t			m_count;
+		unsigned int*	m_indices;
+		float*			m_squaredDistances;
+		float			m_maxSquaredDistance;
+	};
+
+	// All candidates within a radius, sorted by Finish
+	class RadiusResults
+	{
+	public:
+		RadiusResults(float squaredRadius, std::vector<unsigned int>& indices, std::vector<float>& squaredDistances)
+			: m_squaredRadius(squaredRadius), m_indices(indices), m_squaredDistances(squaredDistances)
+		{
+			m_indices.clear();
+			m_squaredDistances.clear();
+		}
+
+		float Worst() const { return m_squaredRadius; }
+
+		void Add(unsigned int index, float squaredDistance)
+		{
+			if (squaredDistance <= m_squaredRadius)
+				m_neighbours.push_back(std::make_pair(squaredDistance, index));
+		}
+
+		size_t Finish()
+		{
+			std::sort(m_neighbours.begin(), m_neighbours.end());
+			m_indices.resize(m_neighbours.size());
+			m_squaredDistances.resize(m_neighbours.size());
+			for (size_t i = 0; i < m_neighbours.size(); i++)
+			{
+				m_squaredDistances[i] = m_neighbours[i].first;
+				m_indices[i] = m_neighbours[i].second;
+			}
+			return m_neighbours.size();
+		}
+
+	private:
+		float									m_squaredRadius;
+		std::vector<unsigned int>&				m_indices;
+		std::vector<float>&						m_squaredDistances;
+		std::vector<std::pair<float, unsigned int>>	m_neighbours;
+	};
+
+	// Number of candidates within a radius
+	class CountResults
+	{
+	public:
+		explicit CountResults(float squaredRadius) : m_squaredRadius(squaredRadius), m_count(0) {}
+
+		float Worst() const { return m_squaredRadius; }
+
+		void Add(unsigned int, float squaredDistance)
+		{
+			if (squaredDistance <= m_squaredRadius)
+				m_count++;
+		}
+
+		unsigned int Count() const { return m_count; }
+
+	private:
+		float			m_squaredRadius;
+		unsigned int	m_count;
+	};
+
+	static inline float squaredDistance3(const float* a, const float* b)
+	{
+		const float dx = a[0] - b[0];
+		const float dy = a[1] - b[1];
+		const float dz = a[2] - b[2];
+		return dx * dx + dy * dy + dz * dz;
+	}
+}
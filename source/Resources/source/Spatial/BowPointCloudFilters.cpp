@@ -0,0 +1,270 @@
+#include "Resources/Spatial/BowPointCloudFilters.h"
+#include "Resources/Spatial/BowMortonOrder.h"
+#include "Resources/Spatial/BowPointCloudKdTree.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace bow {
+
+	// Cyclic Jacobi rotations on the symmetric matrix a, the eigenvalues end up on its diagonal and the
+	// eigenvectors in the columns of vectors
+	static void symmetricEigen3(double a[3][3], double vectors[3][3])
+	{
+		for (int i = 0; i < 3; i++)
+			for (int j = 0; j < 3; j++)
+				vectors[i][j] = i == j ? 1.0 : 0.0;
+
+		static const int pairs[3][2] = { { 0, 1 }, { 0, 2 }, { 1, 2 } };
+		for (int sweep = 0; sweep < 16; sweep++)
+		{
+			const double diagonal = std::fabs(a[0][0]) + std::fabs(a[1][1]) + std::fabs(a[2][2]);
+			const double offDiagonal = std::fabs(a[0][1]) + std::fabs(a[0][2]) + std::fabs(a[1][2]);
+			if (offDiagonal <= diagonal * 1e-15)
+				break;
+
+			for (int r = 0; r < 3; r++)
+			{
+				const int p = pairs[r][0];
+				const int q = pairs[r][1];
+				if (a[p][q] == 0.0)
+					continue;
+
+				const double theta = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+				const double t = (theta >= 0.0 ? 1.0 : -1.0) / (std::fabs(theta) + std::sqrt(theta * theta + 1.0));
+				const double c = 1.0 / std::sqrt(t * t + 1.0);
+				const double s = t * c;
+
+				for (int k = 0; k < 3; k++)
+				{
+					const double kp = a[k][p], kq = a[k][q];
+					a[k][p] = c * kp - s * kq;
+					a[k][q] = s * kp + c * kq;
+				}
+				for (int k = 0; k < 3; k++)
+				{
+					const double pk = a[p][k], qk = a[q][k];
+					a[p][k] = c * pk - s * qk;
+					a[q][k] = s * pk + c * qk;
+				}
+				for (int k = 0; k < 3; k++)
+				{
+					const double kp = vectors[k][p], kq = vectors[k][q];
+					vectors[k][p] = c * kp - s * kq;
+					vectors[k][q] = s * kp + c * kq;
+				}
+			}
+		}
+	}
+
+	size_t PointCloudFilters::VoxelDownsample(const float* points, const float* colors, size_t numPoints, float voxelSize, std::vector<float>& outPoints, std::vector<float>& outColors)
+	{
+		outPoints.clear();
+		outColors.clear();
+		if (numPoints == 0)
+			return 0;
+
+		// the radix sort is stable, so every voxel sums its points in input order
+		std::vector<unsigned long long> codes(numPoints);
+		std::vector<unsigned int> order;
+		MortonOrder::ComputeCodes(points, numPoints, voxelSize, codes.data());
+		MortonOrder::SortPermutation(codes.data(), numPoints, order);
+
+		std::vector<unsigned int> voxelBegin;
+		for (size_t i = 0; i < numPoints; i++)
+		{
+			if (i == 0 || codes[order[i]] != codes[order[i - 1]])
+				voxelBegin.push_back((unsigned int)i);
+		}
+		voxelBegin.push_back((unsigned int)numPoints);
+
+		const size_t numVoxels = voxelBegin.size() - 1;
+		outPoints.resize(numVoxels * 3);
+		if (colors != nullptr)
+			outColors.resize(numVoxels * 3);
+
+		#pragma omp parallel for schedule(dynamic, 256)
+		for (int v = 0; v < (int)numVoxels; v++)
+		{
+			double position[3] = { 0.0, 0.0, 0.0 };
+			double color[3] = { 0.0, 0.0, 0.0 };
+			for (unsigned int i = voxelBegin[v]; i < voxelBegin[v + 1]; i++)
+			{
+				const size_t index = order[i];
+				for (int d = 0; d < 3; d++)
+				{
+					position[d] += points[index * 3 + d];
+					if (colors != nullptr)
+						color[d] += colors[index * 3 + d];
+				}
+			}
+
+			const double count = voxelBegin[v + 1] - voxelBegin[v];
+			for (int d = 0; d < 3; d++)
+			{
+				outPoints[size_t(v) * 3 + d] = (float)(position[d] / count);
+				if (colors != nullptr)
+					outColors[size_t(v) * 3 + d] = (float)(color[d] / count);
+			}
+		}
+		return numVoxels;
+	}
+
+	size_t PointCloudFilters::RemoveRadiusOutliers(const float* points, size_t numPoints, float radius, unsigned int minNeighbours, std::vector<unsigned int>& inliers)
+	{
+		inliers.clear();
+		if (numPoints == 0)
+			return 0;
+
+		PointCloudKdTree tree(points, numPoints);
+		std::vector<unsigned int> counts(numPoints);
+		tree.CountInRadius(points, numPoints, radius, counts.data());
+
+		// the counts include the point itself
+		for (size_t i = 0; i < numPoints; i++)
+		{
+			if (counts[i] > minNeighbours)
+				inliers.push_back((unsigned int)i);
+		}
+		return inliers.size();
+	}
+
+	size_t PointCloudFilters::RemoveStatisticalOutliers(const float* points, size_t numPoints, unsigned int k, float stddevMultiplier, std::vector<unsigned int>& inliers)
+	{
+		inliers.clear();
+		if (numPoints == 0)
+			return 0;
+
+		PointCloudKdTree tree(points, numPoints);
+		std::vector<float> meanDistances(numPoints);
+
+		#pragma omp parallel
+		{
+			// the closest neighbour is the point itself
+			std::vector<unsigned int> indices(k + 1);
+			std::vector<float> squaredDistances(k + 1);
+
+			#pragma omp for schedule(dynamic, 256)
+			for (int i = 0; i < (int)numPoints; i++)
+			{
+				const size_t found = tree.FindNearest(points + size_t(i) * 3, k + 1, indices.data(), squaredDistances.data());
+				float sum = 0.0f;
+				for (size_t n = 1; n < found; n++)
+					sum += std::sqrt(squaredDistances[n]);
+				meanDistances[i] = found > 1 ? sum / (found - 1) : 0.0f;
+			}
+		}
+
+		double sum = 0.0, squaredSum = 0.0;
+		for (size_t i = 0; i < numPoints; i++)
+		{
+			sum += meanDistances[i];
+			squaredSum += double(meanDistances[i]) * meanDistances[i];
+		}
+		const double mean = sum / numPoints;
+		const double variance = std::max(0.0, squaredSum / numPoints - mean * mean);
+		const double threshold = mean + stddevMultiplier * std::sqrt(variance);
+
+		for (size_t i = 0; i < numPoints; i++)
+		{
+			if (meanDistances[i] <= threshold)
+				inliers.push_back((unsigned int)i);
+		}
+		return inliers.size();
+	}
+
+	void PointCloudFilters::EstimateNormals(const float* points, size_t numPoints, unsigned int k, const float* viewpoint, float* normals, float* curvatures)
+	{
+		if (numPoints == 0)
+			return;
+
+		PointCloudKdTree tree(points, numPoints);
+
+		#pragma omp parallel
+		{
+			std::vector<unsigned int> indices(k);
+			std::vector<float> squaredDistances(k);
+
+			#pragma omp for schedule(dynamic, 256)
+			for (int i = 0; i < (int)numPoints; i++)
+			{
+				const float* point = points + size_t(i) * 3;
+				float* normal = normals + size_t(i) * 3;
+				const size_t found = tree.FindNearest(point, k, indices.data(), squaredDistances.data());
+				if (found < 3)
+				{
+					normal[0] = normal[1] = normal[2] = 0.0f;
+					if (curvatures != nullptr)
+						curvatures[i] = 0.0f;
+					continue;
+				}
+
+				// covariance around the centroid, relative to the point for precision far from the origin
+				double mean[3] = { 0.0, 0.0, 0.0 };
+				double covariance[3][3] = { { 0.0, 0.0, 0.0 }, { 0.0, 0.0, 0.0 }, { 0.0, 0.0, 0.0 } };
+				for (size_t n = 0; n < found; n++)
+				{
+					const float* neighbour = points + size_t(indices[n]) * 3;
+					double offset[3];
+					for (int d = 0; d < 3; d++)
+					{
+						offset[d] = double(neighbour[d]) - point[d];
+						mean[d] += offset[d];
+					}
+					for (int r = 0; r < 3; r++)
+						for (int c = r; c < 3; c++)
+							covariance[r][c] += offset[r] * offset[c];
+				}
+				for (int d = 0; d < 3; d++)
+					mean[d] /= found;
+				for (int r = 0; r < 3; r++)
+					for (int c = r; c < 3; c++)
+						covariance[c][r] = covariance[r][c] = covariance[r][c] / found - mean[r] * mean[c];
+
+				double vectors[3][3];
+				symmetricEigen3(covariance, vectors);
+
+				int smallest = 0;
+				for (int e = 1; e < 3; e++)
+				{
+					if (covariance[e][e] < covariance[smallest][smallest])
+						smallest = e;
+				}
+
+				double orientation = 0.0;
+				for (int d = 0; d < 3; d++)
+				{
+					normal[d] = (float)vectors[d][smallest];
+					if (viewpoint != nullptr)
+						orientation += normal[d] * (viewpoint[d] - point[d]);
+				}
+				if (orientation < 0.0)
+				{
+					for (int d = 0; d < 3; d++)
+						normal[d] = -normal[d];
+				}
+
+				if (curvatures != nullptr)
+				{
+					const double total = std::max(0.0, covariance[0][0]) + std::max(0.0, covariance[1][1]) + std::max(0.0, covariance[2][2]);
+					curvatures[i] = total > 0.0 ? (float)(std::max(0.0, covariance[smallest][smallest]) / total) : 0.0f;
+				}
+			}
+		}
+	}
+
+	void PointCloudFilters::Gather(const float* attribute, const std::vector<unsigned int>& indices, std::vector<float>& output)
+	{
+		output.resize(indices.size() * 3);
+
+		#pragma omp parallel for
+		for (int i = 0; i < (int)indices.size(); i++)
+		{
+			const float* value = attribute + size_t(indices[i]) * 3;
+			output[size_t(i) * 3 + 0] = value[0];
+			output[size_t(i) * 3 + 1] = value[1];
+			output[size_t(i) * 3 + 2] = value[2];
+		}
+	}
+}
@@ -0,0 +1,263 @@
+#include "Resources/Spatial/BowPointCloudKdTree.h"
+#include "BowNeighbourResults.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace bow {
+
+	// Leaves have lowChild == 0, the high child of an inner node follows its low child
+	struct kdNode
+	{
+		unsigned int	begin;
+		unsigned int	end;
+		unsigned int	lowChild;
+		unsigned int	dimension;
+		float			divLow;		// largest coordinate of the low child along dimension
+		float			divHigh;	// smallest coordinate of the high child along dimension
+	};
+
+	struct pointCloudKdTree_data
+	{
+		std::vector<float>			points;		// xyz, sorted by leaf
+		std::vector<unsigned int>	indices;	// index of every sorted point in the input
+		std::vector<kdNode>			nodes;
+		float						boundsMin[3];
+		float						boundsMax[3];
+		unsigned int				maxPointsPerLeaf;
+	};
+
+	static void buildNode(pointCloudKdTree_data* data, const float* points, unsigned int nodeIndex, unsigned int begin, unsigned int end)
+	{
+		kdNode node;
+		node.begin = begin;
+		node.end = end;
+		node.lowChild = 0;
+		node.dimension = 0;
+		node.divLow = node.divHigh = 0.0f;
+
+		if (end - begin > data->maxPointsPerLeaf)
+		{
+			float boundsMin[3] = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+			float boundsMax[3] = { -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max() };
+			for (unsigned int i = begin; i < end; i++)
+			{
+				const float* point = points + size_t(data->indices[i]) * 3;
+				for (int d = 0; d < 3; d++)
+				{
+					boundsMin[d] = std::min(boundsMin[d], point[d]);
+					boundsMax[d] = std::max(boundsMax[d], point[d]);
+				}
+			}
+
+			unsigned int dimension = 0;
+			for (unsigned int d = 1; d < 3; d++)
+			{
+				if (boundsMax[d] - boundsMin[d] > boundsMax[dimension] - boundsMin[dimension])
+					dimension = d;
+			}
+
+			// all points at the same position stay in one leaf
+			if (boundsMax[dimension] > boundsMin[dimension])
+			{
+				const unsigned int middle = begin + (end - begin) / 2;
+				std::nth_element(data->indices.begin() + begin, data->indices.begin() + middle, data->indices.begin() + end,
+					[points, dimension](unsigned int a, unsigned int b) { return points[size_t(a) * 3 + dimension] < points[size_t(b) * 3 + dimension]; });
+
+				node.dimension = dimension;
+				node.divHigh = points[size_t(data->indices[middle]) * 3 + dimension];
+				node.divLow = -std::numeric_limits<float>::max();
+				for (unsigned int i = begin; i < middle; i++)
+					node.divLow = std::max(node.divLow, points[size_t(data->indices[i]) * 3 + dimension]);
+
+				node.lowChild = (unsigned int)data->nodes.size();
+				data->nodes.resize(data->nodes.size() + 2);
+				buildNode(data, points, node.lowChild, begin, middle);
+				buildNode(data, points, node.lowChild + 1, middle, end);
+			}
+		}
+
+		data->nodes[nodeIndex] = node;
+	}
+
+	// Descends into the closer child first. distances holds the squared distance of the query to the bounds of
+	// the current node along every dimension, minDistance is their sum.
+	template <typename Results>
+	static void searchNode(const pointCloudKdTree_data* data, const kdNode& node, const float* query, Results& results, float minDistance, float* distances)
+	{
+		if (node.lowChild == 0)
+		{
+			const float* points = data->points.data();
+			for (unsigned int i = node.begin; i < node.end; i++)
+			{
+				const float distance = squaredDistance3(query, points + size_t(i) * 3);
+				if (distance <= results.Worst())
+					results.Add(data->indices[i], distance);
+			}
+			return;
+		}
+
+		const unsigned int dimension = node.dimension;
+		const float toLow = query[dimension] - node.divLow;
+		const float toHigh = query[dimension] - node.divHigh;
+
+		const kdNode* closer;
+		const kdNode* further;
+		float cutDistance;
+		if (toLow + toHigh < 0.0f)
+		{
+			closer = &data->nodes[node.lowChild];
+			further = &data->nodes[node.lowChild + 1];
+			cutDistance = toHigh * toHigh;
+		}
+		else
+		{
+			closer = &data->nodes[node.lowChild + 1];
+			further = &data->nodes[node.lowChild];
+			cutDistance = toLow * toLow;
+		}
+
+		searchNode(data, *closer, query, results, minDistance, distances);
+
+		const float previous = distances[dimension];
+		minDistance = minDistance + cutDistance - previous;
+		distances[dimension] = cutDistance;
+		if (minDistance <= results.Worst())
+			searchNode(data, *further, query, results, minDistance, distances);
+		distances[dimension] = previous;
+	}
+
+	template <typename Results>
+	static void search(const pointCloudKdTree_data* data, const float* query, Results& results)
+	{
+		if (data->nodes.empty())
+			return;
+
+		float distances[3];
+		float minDistance = 0.0f;
+		for (int d = 0; d < 3; d++)
+		{
+			distances[d] = 0.0f;
+			if (query[d] < data->boundsMin[d])
+				distances[d] = (data->boundsMin[d] - query[d]) * (data->boundsMin[d] - query[d]);
+			else if (query[d] > data->boundsMax[d])
+				distances[d] = (query[d] - data->boundsMax[d]) * (query[d] - data->boundsMax[d]);
+			minDistance += distances[d];
+		}
+
+		if (minDistance <= results.Worst())
+			searchNode(data, data->nodes[0], query, results, minDistance, distances);
+	}
+
+	const unsigned int PointCloudKdTree::InvalidIndex;
+
+	PointCloudKdTree::PointCloudKdTree(const float* points, size_t numPoints, unsigned int maxPointsPerLeaf) : m_data(new pointCloudKdTree_data())
+	{
+		m_data->maxPointsPerLeaf = std::max(1u, maxPointsPerLeaf);
+		for (int d = 0; d < 3; d++)
+		{
+			m_data->boundsMin[d] = std::numeric_limits<float>::max();
+			m_data->boundsMax[d] = -std::numeric_limits<float>::max();
+		}
+
+		if (numPoints == 0)
+			return;
+
+		m_data->indices.resize(numPoints);
+		for (size_t i = 0; i < numPoints; i++)
+		{
+			m_data->indices[i] = (unsigned int)i;
+			for (int d = 0; d < 3; d++)
+			{
+				m_data->boundsMin[d] = std::min(m_data->boundsMin[d], points[i * 3 + d]);
+				m_data->boundsMax[d] = std::max(m_data->boundsMax[d], points[i * 3 + d]);
+			}
+		}
+
+		m_data->nodes.reserve(2 * numPoints / m_data->maxPointsPerLeaf + 1);
+		m_data->nodes.resize(1);
+		buildNode(m_data, points, 0, 0, (unsigned int)numPoints);
+
+		// copy the points in leaf order, a leaf is scanned from contiguous memory
+		m_data->points.resize(numPoints * 3);
+		for (size_t i = 0; i < numPoints; i++)
+		{
+			const float* point = points + size_t(m_data->indices[i]) * 3;
+			m_data->points[i * 3 + 0] = point[0];
+			m_data->points[i * 3 + 1] = point[1];
+			m_data->points[i * 3 + 2] = point[2];
+		}
+	}
+
+	PointCloudKdTree::~PointCloudKdTree()
+	{
+		delete m_data;
+	}
+
+	size_t PointCloudKdTree::GetNumPoints() const
+	{
+		return m_data->indices.size();
+	}
+
+	size_t PointCloudKdTree::FindNearest(const float* query, size_t k, unsigned int* indices, float* squaredDistances) const
+	{
+		NearestResults results(k, indices, squaredDistances, std::numeric_limits<float>::infinity());
+		search(m_data, query, results);
+		for (size_t i = results.Count(); i < k; i++)
+		{
+			indices[i] = InvalidIndex;
+			squaredDistances[i] = std::numeric_limits<float>::infinity();
+		}
+		return results.Count();
+	}
+
+	size_t PointCloudKdTree::FindInRadius(const float* query, float radius, std::vector<unsigned int>& indices, std::vector<float>& squaredDistances) const
+	{
+		RadiusResults results(radius * radius, indices, squaredDistances);
+		search(m_data, query, results);
+		return results.Finish();
+	}
+
+	void PointCloudKdTree::FindNearest(const float* queries, size_t numQueries, size_t k, unsigned int* indices, float* squaredDistances) const
+	{
+		#pragma omp parallel
+		{
+			std::vector<float> localDistances(squaredDistances == nullptr ? k : 0);
+
+			#pragma omp for schedule(dynamic, 256)
+			for (int q = 0; q < (int)numQueries; q++)
+			{
+				float* distances = squaredDistances == nullptr ? localDistances.data() : squaredDistances + size_t(q) * k;
+				FindNearest(queries + size_t(q) * 3, k, indices + size_t(q) * k, distances);
+			}
+		}
+	}
+
+	void PointCloudKdTree::FindNearestDistances(const float* queries, size_t numQueries, float* distances, float maxDistance) const
+	{
+		const float maxSquaredDistance = maxDistance < 0.0f ? std::numeric_limits<float>::infinity() : maxDistance * maxDistance;
+
+		#pragma omp parallel for schedule(dynamic, 256)
+		for (int q = 0; q < (int)numQueries; q++)
+		{
+			unsigned int index;
+			float squaredDistance;
+			NearestResults results(1, &index, &squaredDistance, maxSquaredDistance);
+			search(m_data, queries + size_t(q) * 3, results);
+			distances[q] = results.Count() > 0 ? std::sqrt(squaredDistance) : std::numeric_limits<float>::infinity();
+		}
+	}
+
+	void PointCloudKdTree::CountInRadius(const float* queries, size_t numQueries, float radius, unsigned int* counts) const
+	{
+		#pragma omp parallel for schedule(dynamic, 256)
+		for (int q = 0; q < (int)numQueries; q++)
+		{
+			CountResults results(radius * radius);
+			search(m_data, queries + size_t(q) * 3, results);
+			counts[q] = results.Count();
+		}
+	}
+}
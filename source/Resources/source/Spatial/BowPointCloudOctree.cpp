@@ -0,0 +1,658 @@
+#include "Resources/Spatial/BowPointCloudOctree.h"
+#include "Resources/FileLoader/PointCloudLoader/BowPointCloudTextScanner.h"
+
+#include "CoreSystems/BowLogger.h"
+#include "Platform/BowMappedFile.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace bow {
+
+	// xyz and rgba8, the layout of the .points file
+	struct octreePoint
+	{
+		float			position[3];
+		unsigned char	color[4];
+	};
+
+	// The children of a node follow each other from firstChild on, in the order of the bits of childMask. Bit i
+	// is the octant that lies in the upper half along x, y and z for the bits 0, 1 and 2 of i.
+	struct octreeNode
+	{
+		unsigned long long	offset;		// first point in the .points file
+		unsigned int		numPoints;
+		unsigned int		firstChild;
+		unsigned char		childMask;
+		unsigned char		depth;
+		unsigned short		reserved0;
+		unsigned int		reserved1;
+	};
+
+	struct octreeHeader
+	{
+		char				magic[4];	// "BPO1"
+		unsigned int		numNodes;
+		unsigned long long	numPoints;
+		float				boundsMin[3];
+		float				size;		// edge length of the root cube
+	};
+
+	struct pointCloudOctree_data
+	{
+		octreeHeader				header;
+		std::vector<octreeNode>		nodes;
+		std::vector<float>			nodeMin;	// lower corner of every node, xyz
+		MappedFile					points;
+	};
+
+	static const char octreeMagic[4] = { 'B', 'P', 'O', '1' };
+
+	// Text files are parsed in chunks of whole lines, binary files in chunks of points
+	static const size_t pointChunkSizeInBytes = 64 * 1024 * 1024;
+
+	// ---------------------------------------------------------------------------
+	// Reads the points of a .bin, .xyz, .xtc or .xcn file chunk by chunk, so a pass over the file only needs
+	// memory for one chunk
+	class pointFileStream
+	{
+	public:
+		bool Open(const std::string& filePath)
+		{
+			const size_t dot = filePath.find_last_of('.');
+			std::string extension = dot == std::string::npos ? "" : filePath.substr(dot + 1);
+			std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+			if (extension == "bin")
+				m_numColumns = 0;
+			else if (extension == "xyz")
+				m_numColumns = 3;
+			else if (extension == "xtc")
+				m_numColumns = 6;
+			else if (extension == "xcn")
+				m_numColumns = 9;
+			else
+				return false;
+
+			m_position = 0;
+			return m_file.Open(filePath.c_str(), FileAccessHint::Sequential);
+		}
+
+		void Rewind()
+		{
+			m_position = 0;
+			m_file.Advise(FileAccessHint::Sequential);
+		}
+
+		/// False once all points were read, a chunk may be empty
+		bool Next(std::vector<octreePoint>& points)
+		{
+			points.clear();
+
+			const char* data = m_file.GetData();
+			const size_t sizeInBytes = m_file.GetSizeInBytes();
+			if (m_numColumns == 0)
+			{
+				// x y z w
+				const size_t pointSize = 4 * sizeof(float);
+				const size_t numPoints = std::min((sizeInBytes - std::min(sizeInBytes, m_position)) / pointSize, pointChunkSizeInBytes / pointSize);
+				if (numPoints == 0)
+					return false;
+
+				points.resize(numPoints);
+				for (size_t i = 0; i < numPoints; i++)
+				{
+					memcpy(points[i].position, data + m_position + i * pointSize, 3 * sizeof(float));
+					memset(points[i].color, 255, 4);
+				}
+				m_position += numPoints * pointSize;
+				return true;
+			}
+
+			if (m_position >= sizeInBytes)
+				return false;
+
+			size_t end = std::min(sizeInBytes, m_position + pointChunkSizeInBytes);
+			while (end < sizeInBytes && data[end - 1] != '\n' && data[end - 1] != '\r')
+				end++;
+
+			PointCloudTextScanner scanner(data + m_position, end - m_position);
+			m_position = end;
+
+			const size_t numPoints = scanner.GetNumPoints();
+			if (numPoints == 0)
+				return true;
+
+			// x y z r g b nx ny nz
+			const float defaults[9] = { 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 0.0f };
+			m_attributes.resize(3 * 3 * numPoints);
+			float* const attributes[3] = { &m_attributes[0], &m_attributes[3 * numPoints], &m_attributes[6 * numPoints] };
+			std::fill(attributes[1], attributes[1] + 3 * numPoints, 1.0f);
+			scanner.Parse(m_numColumns, defaults, attributes);
+
+			points.resize(numPoints);
+			for (size_t i = 0; i < numPoints; i++)
+			{
+				for (int d = 0; d < 3; d++)
+				{
+					points[i].position[d] = attributes[0][i * 3 + d];
+					const float color = std::min(std::max(attributes[1][i * 3 + d], 0.0f), 1.0f);
+					points[i].color[d] = (unsigned char)(color * 255.0f + 0.5f);
+				}
+				points[i].color[3] = 255;
+			}
+			return true;
+		}
+
+	private:
+		MappedFile			m_file;
+		unsigned int		m_numColumns;
+		size_t				m_position;
+		std::vector<float>	m_attributes;
+	};
+
+	// ---------------------------------------------------------------------------
+	// Cells of the finest level are numbered in Morton order, so the cells of every node form a contiguous range
+	static inline unsigned int mortonCode(unsigned int x, unsigned int y, unsigned int z, unsigned int numBits)
+	{
+		unsigned int code = 0;
+		for (unsigned int bit = 0; bit < numBits; bit++)
+		{
+			code |= ((x >> bit) & 1u) << (3 * bit);
+			code |= ((y >> bit) & 1u) << (3 * bit + 1);
+			code |= ((z >> bit) & 1u) << (3 * bit + 2);
+		}
+		return code;
+	}
+
+	static inline void mortonDecode(unsigned int code, unsigned int numBits, unsigned int* cell)
+	{
+		cell[0] = cell[1] = cell[2] = 0;
+		for (unsigned int bit = 0; bit < numBits; bit++)
+		{
+			cell[0] |= ((code >> (3 * bit)) & 1u) << bit;
+			cell[1] |= ((code >> (3 * bit + 1)) & 1u) << bit;
+			cell[2] |= ((code >> (3 * bit + 2)) & 1u) << bit;
+		}
+	}
+
+	static inline unsigned int childSlot(unsigned char childMask, unsigned int octant)
+	{
+		unsigned int slot = 0;
+		for (unsigned int i = 0; i < octant; i++)
+			slot += (childMask >> i) & 1u;
+		return slot;
+	}
+
+	struct octreeBuilder
+	{
+		octreeHeader					header;
+		unsigned int					maxDepth;
+		unsigned int					gridSize;		// cells per axis of the finest level
+		unsigned int					lodGridSize;
+		std::vector<octreeNode>			nodes;
+		std::vector<unsigned int>		cellBegin;		// first cell of every node
+		std::vector<unsigned long long>	cellStart;		// number of points in the cells before, numCells + 1 entries
+		std::fstream					leafFile;		// points sorted by leaf
+		std::ofstream					pointsFile;
+		unsigned long long				numWritten;
+
+		unsigned int cellOf(const float* position) const
+		{
+			unsigned int cell[3];
+			for (int d = 0; d < 3; d++)
+			{
+				const float coordinate = (position[d] - header.boundsMin[d]) / header.size * gridSize;
+				cell[d] = (unsigned int)std::min(std::max(coordinate, 0.0f), float(gridSize - 1));
+			}
+			return mortonCode(cell[0], cell[1], cell[2], maxDepth);
+		}
+
+		unsigned int leafOf(unsigned int cell) const
+		{
+			unsigned int index = 0;
+			while (nodes[index].childMask != 0)
+			{
+				const octreeNode& node = nodes[index];
+				const unsigned int octant = (cell >> (3 * (maxDepth - node.depth - 1))) & 7u;
+				index = node.firstChild + childSlot(node.childMask, octant);
+			}
+			return index;
+		}
+
+		unsigned long long numPointsOf(unsigned int index) const
+		{
+			const size_t numCells = size_t(1) << (3 * (maxDepth - nodes[index].depth));
+			return cellStart[cellBegin[index] + numCells] - cellStart[cellBegin[index]];
+		}
+
+		void write(const octreePoint* points, size_t numPoints)
+		{
+			pointsFile.write(reinterpret_cast<const char*>(points), numPoints * sizeof(octreePoint));
+			numWritten += numPoints;
+		}
+	};
+
+	// Post order: the points of a leaf are read back from the leaf file, an inner node keeps the point closest to
+	// the centre of every occupied cell of the LOD grid from the points its children hand up. The children store
+	// the rest, the points of the node are returned to its parent.
+	static void sampleNode(octreeBuilder& builder, unsigned int index, std::vector<octreePoint>& points)
+	{
+		const octreeNode node = builder.nodes[index];
+		if (node.childMask == 0)
+		{
+			points.resize((size_t)builder.numPointsOf(index));
+			builder.leafFile.seekg(builder.cellStart[builder.cellBegin[index]] * sizeof(octreePoint));
+			builder.leafFile.read(reinterpret_cast<char*>(points.data()), points.size() * sizeof(octreePoint));
+			return;
+		}
+
+		std::vector<octreePoint> candidates;
+		std::vector<size_t> childEnd;
+		std::vector<octreePoint> childPoints;
+		for (unsigned int child = node.firstChild; child < node.firstChild + childSlot(node.childMask, 8); child++)
+		{
+			sampleNode(builder, child, childPoints);
+			candidates.insert(candidates.end(), childPoints.begin(), childPoints.end());
+			childEnd.push_back(candidates.size());
+		}
+
+		unsigned int cell[3];
+		mortonDecode(builder.cellBegin[index], builder.maxDepth, cell);
+		const float cellSize = builder.header.size / builder.gridSize;
+		const float nodeSize = builder.header.size / float(1u << node.depth);
+		const float lodCellSize = nodeSize / builder.lodGridSize;
+		float nodeMin[3];
+		for (int d = 0; d < 3; d++)
+			nodeMin[d] = builder.header.boundsMin[d] + cell[d] * cellSize;
+
+		std::unordered_map<unsigned int, std::pair<float, size_t>> closest;
+		closest.reserve(std::min(candidates.size(), size_t(builder.lodGridSize) * builder.lodGridSize * 6));
+		for (size_t i = 0; i < candidates.size(); i++)
+		{
+			unsigned int lodCell[3];
+			float distance = 0.0f;
+			for (int d = 0; d < 3; d++)
+			{
+				const float coordinate = (candidates[i].position[d] - nodeMin[d]) / lodCellSize;
+				lodCell[d] = (unsigned int)std::min(std::max(coordinate, 0.0f), float(builder.lodGridSize - 1));
+				const float offset = coordinate - (lodCell[d] + 0.5f);
+				distance += offset * offset;
+			}
+
+			const unsigned int key = (lodCell[2] * builder.lodGridSize + lodCell[1]) * builder.lodGridSize + lodCell[0];
+			std::unordered_map<unsigned int, std::pair<float, size_t>>::iterator it = closest.find(key);
+			if (it == closest.end())
+				closest.insert(std::make_pair(key, std::make_pair(distance, i)));
+			else if (distance < it->second.first)
+				it->second = std::make_pair(distance, i);
+		}
+
+		std::vector<char> sampled(candidates.size(), 0);
+		for (std::unordered_map<unsigned int, std::pair<float, size_t>>::const_iterator it = closest.begin(); it != closest.end(); ++it)
+			sampled[it->second.second] = 1;
+
+		points.clear();
+		points.reserve(closest.size());
+		for (unsigned int child = 0, begin = 0; child < childEnd.size(); begin = (unsigned int)childEnd[child], child++)
+		{
+			childPoints.clear();
+			for (size_t i = begin; i < childEnd[child]; i++)
+			{
+				if (sampled[i])
+					points.push_back(candidates[i]);
+				else
+					childPoints.push_back(candidates[i]);
+			}
+
+			octreeNode& childNode = builder.nodes[node.firstChild + child];
+			childNode.offset = builder.numWritten;
+			childNode.numPoints = (unsigned int)childPoints.size();
+			builder.write(childPoints.data(), childPoints.size());
+		}
+	}
+
+	bool PointCloudOctree::Build(const std::string& pointFilePath, const std::string& octreeFilePath, unsigned int maxPointsPerNode, unsigned int lodGridSize, unsigned int maxDepth)
+	{
+		pointFileStream input;
+		if (!input.Open(pointFilePath))
+		{
+			LOG_ERROR("PointCloudOctree::Build: Could not read the point file %s.", pointFilePath.c_str());
+			return false;
+		}
+
+		octreeBuilder builder;
+		memcpy(builder.header.magic, octreeMagic, 4);
+		// at depth 8 the point counts of the cells take 128 MB
+		builder.maxDepth = std::min(std::max(maxDepth, 1u), 8u);
+		builder.gridSize = 1u << builder.maxDepth;
+		builder.lodGridSize = std::min(std::max(lodGridSize, 1u), 1024u);
+		builder.numWritten = 0;
+		maxPointsPerNode = std::max(maxPointsPerNode, 1u);
+
+		// 1. bounds
+		std::vector<octreePoint> chunk;
+		float boundsMin[3] = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+		float boundsMax[3] = { -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max() };
+		unsigned long long numPoints = 0;
+		while (input.Next(chunk))
+		{
+			numPoints += chunk.size();
+			for (size_t i = 0; i < chunk.size(); i++)
+			{
+				for (int d = 0; d < 3; d++)
+				{
+					boundsMin[d] = std::min(boundsMin[d], chunk[i].position[d]);
+					boundsMax[d] = std::max(boundsMax[d], chunk[i].position[d]);
+				}
+			}
+		}
+
+		builder.header.numPoints = numPoints;
+		builder.header.size = 0.0f;
+		for (int d = 0; d < 3; d++)
+		{
+			builder.header.boundsMin[d] = numPoints > 0 ? boundsMin[d] : 0.0f;
+			builder.header.size = std::max(builder.header.size, numPoints > 0 ? boundsMax[d] - boundsMin[d] : 0.0f);
+		}
+		if (builder.header.size <= 0.0f)
+			builder.header.size = 1.0f;
+
+		// 2. points per cell of the finest level
+		const size_t numCells = size_t(1) << (3 * builder.maxDepth);
+		builder.cellStart.assign(numCells + 1, 0);
+		input.Rewind();
+		while (input.Next(chunk))
+		{
+			for (size_t i = 0; i < chunk.size(); i++)
+				builder.cellStart[builder.cellOf(chunk[i].position) + 1]++;
+		}
+		for (size_t i = 0; i < numCells; i++)
+			builder.cellStart[i + 1] += builder.cellStart[i];
+
+		// 3. hierarchy, breadth first: nodes with more than maxPointsPerNode points are split
+		octreeNode root = { 0, 0, 0, 0, 0, 0, 0 };
+		builder.nodes.push_back(root);
+		builder.cellBegin.push_back(0);
+		for (size_t i = 0; i < builder.nodes.size(); i++)
+		{
+			const unsigned int depth = builder.nodes[i].depth;
+			if (depth == builder.maxDepth || builder.numPointsOf((unsigned int)i) <= maxPointsPerNode)
+				continue;
+
+			const unsigned int childCells = 1u << (3 * (builder.maxDepth - depth - 1));
+			builder.nodes[i].firstChild = (unsigned int)builder.nodes.size();
+			for (unsigned int octant = 0; octant < 8; octant++)
+			{
+				const unsigned int begin = builder.cellBegin[i] + octant * childCells;
+				if (builder.cellStart[begin + childCells] == builder.cellStart[begin])
+					continue;
+
+				builder.nodes[i].childMask |= (unsigned char)(1u << octant);
+				octreeNode child = { 0, 0, 0, 0, (unsigned char)(depth + 1), 0, 0 };
+				builder.nodes.push_back(child);
+				builder.cellBegin.push_back(begin);
+			}
+		}
+
+		// 4. points into the range of their leaf, the leaves are ordered like their cells
+		const std::string leafFilePath = octreeFilePath + ".tmp";
+		builder.leafFile.open(leafFilePath.c_str(), std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+		builder.pointsFile.open((octreeFilePath + ".points").c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!builder.leafFile.is_open() || !builder.pointsFile.is_open())
+		{
+			LOG_ERROR("PointCloudOctree::Build: Could not create the octree files %s.", octreeFilePath.c_str());
+			return false;
+		}
+
+		std::vector<unsigned long long> leafCursor(builder.nodes.size());
+		for (size_t i = 0; i < builder.nodes.size(); i++)
+			leafCursor[i] = builder.cellStart[builder.cellBegin[i]];
+
+		std::vector<std::pair<unsigned int, unsigned int>> leaves;
+		std::vector<octreePoint> sorted;
+		input.Rewind();
+		while (input.Next(chunk))
+		{
+			leaves.resize(chunk.size());
+			for (size_t i = 0; i < chunk.size(); i++)
+				leaves[i] = std::make_pair(builder.leafOf(builder.cellOf(chunk[i].position)), (unsigned int)i);
+			std::sort(leaves.begin(), leaves.end());
+
+			sorted.resize(chunk.size());
+			for (size_t i = 0; i < chunk.size(); i++)
+				sorted[i] = chunk[leaves[i].second];
+
+			// one write per leaf
+			for (size_t begin = 0; begin < sorted.size();)
+			{
+				const unsigned int leaf = leaves[begin].first;
+				size_t end = begin + 1;
+				while (end < sorted.size() && leaves[end].first == leaf)
+					end++;
+
+				builder.leafFile.seekp(leafCursor[leaf] * sizeof(octreePoint));
+				builder.leafFile.write(reinterpret_cast<const char*>(&sorted[begin]), (end - begin) * sizeof(octreePoint));
+				leafCursor[leaf] += end - begin;
+				begin = end;
+			}
+		}
+		builder.leafFile.flush();
+
+		// 5. level of detail, the root keeps what is left
+		std::vector<octreePoint> rootPoints;
+		sampleNode(builder, 0, rootPoints);
+		builder.nodes[0].offset = builder.numWritten;
+		builder.nodes[0].numPoints = (unsigned int)rootPoints.size();
+		builder.write(rootPoints.data(), rootPoints.size());
+
+		const bool pointsWritten = !builder.leafFile.fail() && !builder.pointsFile.fail();
+		builder.leafFile.close();
+		builder.pointsFile.close();
+		remove(leafFilePath.c_str());
+
+		builder.header.numNodes = (unsigned int)builder.nodes.size();
+		std::ofstream hierarchyFile(octreeFilePath.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+		hierarchyFile.write(reinterpret_cast<const char*>(&builder.header), sizeof(octreeHeader));
+		hierarchyFile.write(reinterpret_cast<const char*>(builder.nodes.data()), builder.nodes.size() * sizeof(octreeNode));
+		if (!pointsWritten || hierarchyFile.fail())
+		{
+			LOG_ERROR("PointCloudOctree::Build: Could not write the octree %s.", octreeFilePath.c_str());
+			return false;
+		}
+		return true;
+	}
+
+	void PointCloudOctree::ExtractFrustumPlanes(const float* viewProjection, float planes[6][4])
+	{
+		// row r of the column major matrix is viewProjection[r], [4 + r], [8 + r], [12 + r]
+		const float* m = viewProjection;
+		for (int c = 0; c < 4; c++)
+		{
+			const int i = c * 4;
+			planes[0][c] = m[i + 3] + m[i + 2];	// near
+			planes[1][c] = m[i + 3] - m[i + 2];	// far
+			planes[2][c] = m[i + 3] + m[i + 0];	// left
+			planes[3][c] = m[i + 3] - m[i + 0];	// right
+			planes[4][c] = m[i + 3] - m[i + 1];	// top
+			planes[5][c] = m[i + 3] + m[i + 1];	// bottom
+		}
+
+		for (int p = 0; p < 6; p++)
+		{
+			const float norm = std::sqrt(planes[p][0] * planes[p][0] + planes[p][1] * planes[p][1] + planes[p][2] * planes[p][2]);
+			for (int c = 0; c < 4; c++)
+				planes[p][c] = norm != 0.0f ? planes[p][c] / norm : 0.0f;
+		}
+	}
+
+	PointCloudOctree::PointCloudOctree() : m_data(new pointCloudOctree_data())
+	{
+		memset(&m_data->header, 0, sizeof(octreeHeader));
+	}
+
+	PointCloudOctree::~PointCloudOctree()
+	{
+		delete m_data;
+	}
+
+	bool PointCloudOctree::Open(const std::string& octreeFilePath)
+	{
+		Close();
+
+		MappedFile hierarchyFile;
+		if (!hierarchyFile.Open(octreeFilePath.c_str()) || hierarchyFile.GetSizeInBytes() < sizeof(octreeHeader))
+		{
+			LOG_ERROR("PointCloudOctree::Open: Could not read the octree %s.", octreeFilePath.c_str());
+			return false;
+		}
+
+		octreeHeader header;
+		memcpy(&header, hierarchyFile.GetData(), sizeof(octreeHeader));
+		if (memcmp(header.magic, octreeMagic, 4) != 0 || hierarchyFile.GetSizeInBytes() != sizeof(octreeHeader) + size_t(header.numNodes) * sizeof(octreeNode))
+		{
+			LOG_ERROR("PointCloudOctree::Open: %s is not an octree.", octreeFilePath.c_str());
+			return false;
+		}
+
+		const std::string pointsFilePath = octreeFilePath + ".points";
+		if (!m_data->points.Open(pointsFilePath.c_str(), FileAccessHint::RandomAccess) || m_data->points.GetSizeInBytes() != header.numPoints * sizeof(octreePoint))
+		{
+			LOG_ERROR("PointCloudOctree::Open: Could not read the points %s.", pointsFilePath.c_str());
+			m_data->points.Close();
+			return false;
+		}
+
+		m_data->header = header;
+		m_data->nodes.resize(header.numNodes);
+		memcpy(m_data->nodes.data(), hierarchyFile.GetData() + sizeof(octreeHeader), header.numNodes * sizeof(octreeNode));
+
+		// children are stored after their parent
+		m_data->nodeMin.resize(m_data->nodes.size() * 3);
+		if (!m_data->nodes.empty())
+			memcpy(&m_data->nodeMin[0], header.boundsMin, 3 * sizeof(float));
+		for (size_t i = 0; i < m_data->nodes.size(); i++)
+		{
+			const octreeNode& node = m_data->nodes[i];
+			const float childSize = header.size / float(2u << node.depth);
+			for (unsigned int octant = 0, child = node.firstChild; octant < 8; octant++)
+			{
+				if ((node.childMask & (1u << octant)) == 0)
+					continue;
+
+				for (int d = 0; d < 3; d++)
+					m_data->nodeMin[child * 3 + d] = m_data->nodeMin[i * 3 + d] + ((octant >> d) & 1u) * childSize;
+				child++;
+			}
+		}
+		return true;
+	}
+
+	void PointCloudOctree::Close()
+	{
+		m_data->points.Close();
+		m_data->nodes.clear();
+		m_data->nodeMin.clear();
+		memset(&m_data->header, 0, sizeof(octreeHeader));
+	}
+
+	size_t PointCloudOctree::GetNumPoints() const
+	{
+		return (size_t)m_data->header.numPoints;
+	}
+
+	size_t PointCloudOctree::GetNumNodes() const
+	{
+		return m_data->nodes.size();
+	}
+
+	void PointCloudOctree::GetBounds(float* boundsMin, float* boundsMax) const
+	{
+		for (int d = 0; d < 3; d++)
+		{
+			boundsMin[d] = m_data->header.boundsMin[d];
+			boundsMax[d] = m_data->header.boundsMin[d] + m_data->header.size;
+		}
+	}
+
+	// Tests the corner of the cube furthest along the normal of every plane. The cube is grown a little, points
+	// on its faces may be off by rounding.
+	static bool intersectsFrustum(const float planes[6][4], const float* cubeMin, float size)
+	{
+		const float margin = size * 1e-4f;
+		for (int p = 0; p < 6; p++)
+		{
+			float distance = planes[p][3];
+			for (int d = 0; d < 3; d++)
+				distance += planes[p][d] * (planes[p][d] >= 0.0f ? cubeMin[d] + size + margin : cubeMin[d] - margin);
+			if (distance < 0.0f)
+				return false;
+		}
+		return true;
+	}
+
+	size_t PointCloudOctree::Query(const float planes[6][4], const float* eye, size_t pointBudget, std::vector<float>& positions, std::vector<float>& colors) const
+	{
+		if (m_data->nodes.empty())
+			return 0;
+
+		// nodes that appear largest from the eye first, parents are always taken before their children
+		typedef std::pair<float, unsigned int> queueEntry;
+		std::priority_queue<queueEntry> queue;
+		const float* nodeMin = m_data->nodeMin.data();
+		auto push = [&](unsigned int index)
+		{
+			const float size = m_data->header.size / float(1u << m_data->nodes[index].depth);
+			if (!intersectsFrustum(planes, nodeMin + index * 3, size))
+				return;
+
+			float distance = 0.0f;
+			for (int d = 0; d < 3; d++)
+			{
+				const float offset = nodeMin[index * 3 + d] + 0.5f * size - eye[d];
+				distance += offset * offset;
+			}
+			queue.push(queueEntry(size / std::sqrt(distance), index));
+		};
+		push(0);
+
+		const octreePoint* points = reinterpret_cast<const octreePoint*>(m_data->points.GetData());
+		size_t numPoints = 0;
+		while (!queue.empty())
+		{
+			const octreeNode& node = m_data->nodes[queue.top().second];
+			queue.pop();
+			if (numPoints + node.numPoints > pointBudget)
+				break;
+
+			// both are appended to, they need not hold the same number of values on entry
+			const size_t firstPosition = positions.size();
+			const size_t firstColor = colors.size();
+			positions.resize(firstPosition + size_t(node.numPoints) * 3);
+			colors.resize(firstColor + size_t(node.numPoints) * 3);
+			for (unsigned int i = 0; i < node.numPoints; i++)
+			{
+				const octreePoint& point = points[node.offset + i];
+				for (int d = 0; d < 3; d++)
+				{
+					positions[firstPosition + i * 3 + d] = point.position[d];
+					colors[firstColor + i * 3 + d] = point.color[d] / 255.0f;
+				}
+			}
+			numPoints += node.numPoints;
+
+			for (unsigned int child = node.firstChild; child < node.firstChild + childSlot(node.childMask, 8); child++)
+				push(child);
+		}
+		return numPoints;
+	}
+}
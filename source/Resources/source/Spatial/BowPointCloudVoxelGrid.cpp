@@ -0,0 +1,278 @@
+#include "Resources/Spatial/BowPointCloudVoxelGrid.h"
+#include "BowNeighbourResults.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace bow {
+
+	// 21 bits per axis, a cloud may span up to 2^21 voxels along every axis
+	static inline unsigned long long voxelKey(int x, int y, int z)
+	{
+		const unsigned long long mask = (1ull << 21) - 1;
+		return ((unsigned long long)(x & mask) << 42) | ((unsigned long long)(y & mask) << 21) | (unsigned long long)(z & mask);
+	}
+
+	struct voxelEntry
+	{
+		unsigned long long	key;
+		unsigned int		begin;	// range of the sorted points, empty for unused slots
+		unsigned int		end;
+	};
+
+	struct pointCloudVoxelGrid_data
+	{
+		float						voxelSize;
+		float						inverseVoxelSize;
+		std::vector<float>			points;		// xyz, sorted by voxel
+		std::vector<unsigned int>	indices;	// index of every sorted point in the input
+		std::vector<voxelEntry>		table;		// open addressing, power of two size
+		size_t						numVoxels;
+
+		int cell(float coordinate) const
+		{
+			return (int)std::floor(coordinate * inverseVoxelSize);
+		}
+
+		size_t slot(unsigned long long key) const
+		{
+			return (size_t)((key * 0x9E3779B97F4A7C15ull) >> 20) & (table.size() - 1);
+		}
+
+		const voxelEntry* find(int x, int y, int z) const
+		{
+			if (table.empty())
+				return nullptr;
+
+			const unsigned long long key = voxelKey(x, y, z);
+			for (size_t i = slot(key);; i = (i + 1) & (table.size() - 1))
+			{
+				const voxelEntry& entry = table[i];
+				if (entry.begin == entry.end)
+					return nullptr;
+				if (entry.key == key)
+					return &entry;
+			}
+		}
+	};
+
+	// Squared distance from the query to the closest point of a voxel
+	static inline float voxelDistance(const pointCloudVoxelGrid_data* data, const float* query, int x, int y, int z)
+	{
+		const int cell[3] = { x, y, z };
+		float distance = 0.0f;
+		for (int d = 0; d < 3; d++)
+		{
+			const float low = cell[d] * data->voxelSize;
+			const float high = low + data->voxelSize;
+			if (query[d] < low)
+				distance += (low - query[d]) * (low - query[d]);
+			else if (query[d] > high)
+				distance += (query[d] - high) * (query[d] - high);
+		}
+		return distance;
+	}
+
+	template <typename Results>
+	static void searchVoxel(const pointCloudVoxelGrid_data* data, const float* query, int x, int y, int z, Results& results)
+	{
+		if (voxelDistance(data, query, x, y, z) > results.Worst())
+			return;
+
+		const voxelEntry* entry = data->find(x, y, z);
+		if (entry == nullptr)
+			return;
+
+		const float* points = data->points.data();
+		for (unsigned int i = entry->begin; i < entry->end; i++)
+		{
+			const float distance = squaredDistance3(query, points + size_t(i) * 3);
+			if (distance <= results.Worst())
+				results.Add(data->indices[i], distance);
+		}
+	}
+
+	// Visits every voxel that overlaps the sphere of the radius
+	template <typename Results>
+	static void searchRadius(const pointCloudVoxelGrid_data* data, const float* query, float radius, Results& results)
+	{
+		const int minX = data->cell(query[0] - radius), maxX = data->cell(query[0] + radius);
+		const int minY = data->cell(query[1] - radius), maxY = data->cell(query[1] + radius);
+		const int minZ = data->cell(query[2] - radius), maxZ = data->cell(query[2] + radius);
+		for (int x = minX; x <= maxX; x++)
+			for (int y = minY; y <= maxY; y++)
+				for (int z = minZ; z <= maxZ; z++)
+					searchVoxel(data, query, x, y, z, results);
+	}
+
+	// Visits the voxels in shells of growing Chebyshev distance around the voxel of the query. After shell r every
+	// point that was not visited is at least r voxel sizes away, so the search ends once the results are full
+	// and closer than that.
+	static void searchNearest(const pointCloudVoxelGrid_data* data, const float* query, float maxDistance, NearestResults& results)
+	{
+		const int cx = data->cell(query[0]);
+		const int cy = data->cell(query[1]);
+		const int cz = data->cell(query[2]);
+		const int maxShell = (int)std::ceil(maxDistance * data->inverseVoxelSize);
+
+		for (int shell = 0; shell <= maxShell; shell++)
+		{
+			for (int dx = -shell; dx <= shell; dx++)
+			{
+				for (int dy = -shell; dy <= shell; dy++)
+				{
+					// inside the shell only the two faces along z are left
+					const bool onShell = std::abs(dx) == shell || std::abs(dy) == shell;
+					const int step = onShell ? 1 : std::max(1, 2 * shell);
+					for (int dz = -shell; dz <= shell; dz += step)
+						searchVoxel(data, query, cx + dx, cy + dy, cz + dz, results);
+				}
+			}
+
+			const float covered = shell * data->voxelSize;
+			if (results.Full() && results.Worst() <= covered * covered)
+				break;
+		}
+	}
+
+	const unsigned int PointCloudVoxelGrid::InvalidIndex;
+
+	PointCloudVoxelGrid::PointCloudVoxelGrid(const float* points, size_t numPoints, float voxelSize) : m_data(new pointCloudVoxelGrid_data())
+	{
+		m_data->voxelSize = voxelSize;
+		m_data->inverseVoxelSize = 1.0f / voxelSize;
+		m_data->numVoxels = 0;
+
+		if (numPoints == 0)
+			return;
+
+		std::vector<std::pair<unsigned long long, unsigned int>> keys(numPoints);
+
+		#pragma omp parallel for
+		for (int i = 0; i < (int)numPoints; i++)
+		{
+			const float* point = points + size_t(i) * 3;
+			keys[i] = std::make_pair(voxelKey(m_data->cell(point[0]), m_data->cell(point[1]), m_data->cell(point[2])), (unsigned int)i);
+		}
+		std::sort(keys.begin(), keys.end());
+
+		m_data->points.resize(numPoints * 3);
+		m_data->indices.resize(numPoints);
+		for (size_t i = 0; i < numPoints; i++)
+		{
+			const float* point = points + size_t(keys[i].second) * 3;
+			m_data->points[i * 3 + 0] = point[0];
+			m_data->points[i * 3 + 1] = point[1];
+			m_data->points[i * 3 + 2] = point[2];
+			m_data->indices[i] = keys[i].second;
+
+			if (i == 0 || keys[i].first != keys[i - 1].first)
+				m_data->numVoxels++;
+		}
+
+		// at most half full
+		size_t tableSize = 16;
+		while (tableSize < 2 * m_data->numVoxels)
+			tableSize *= 2;
+
+		voxelEntry empty = { 0, 0, 0 };
+		m_data->table.assign(tableSize, empty);
+		for (size_t begin = 0; begin < numPoints;)
+		{
+			size_t end = begin + 1;
+			while (end < numPoints && keys[end].first == keys[begin].first)
+				end++;
+
+			size_t i = m_data->slot(keys[begin].first);
+			while (m_data->table[i].begin != m_data->table[i].end)
+				i = (i + 1) & (tableSize - 1);
+
+			m_data->table[i].key = keys[begin].first;
+			m_data->table[i].begin = (unsigned int)begin;
+			m_data->table[i].end = (unsigned int)end;
+			begin = end;
+		}
+	}
+
+	PointCloudVoxelGrid::~PointCloudVoxelGrid()
+	{
+		delete m_data;
+	}
+
+	size_t PointCloudVoxelGrid::GetNumPoints() const
+	{
+		return m_data->indices.size();
+	}
+
+	size_t PointCloudVoxelGrid::GetNumOccupiedVoxels() const
+	{
+		return m_data->numVoxels;
+	}
+
+	float PointCloudVoxelGrid::GetVoxelSize() const
+	{
+		return m_data->voxelSize;
+	}
+
+	size_t PointCloudVoxelGrid::FindNearest(const float* query, size_t k, float maxDistance, unsigned int* indices, float* squaredDistances) const
+	{
+		NearestResults results(k, indices, squaredDistances, maxDistance * maxDistance);
+		searchNearest(m_data, query, maxDistance, results);
+		for (size_t i = results.Count(); i < k; i++)
+		{
+			indices[i] = InvalidIndex;
+			squaredDistances[i] = std::numeric_limits<float>::infinity();
+		}
+		return results.Count();
+	}
+
+	size_t PointCloudVoxelGrid::FindInRadius(const float* query, float radius, std::vector<unsigned int>& indices, std::vector<float>& squaredDistances) const
+	{
+		RadiusResults results(radius * radius, indices, squaredDistances);
+		searchRadius(m_data, query, radius, results);
+		return results.Finish();
+	}
+
+	void PointCloudVoxelGrid::FindNearest(const float* queries, size_t numQueries, size_t k, float maxDistance, unsigned int* indices, float* squaredDistances) const
+	{
+		#pragma omp parallel
+		{
+			std::vector<float> localDistances(squaredDistances == nullptr ? k : 0);
+
+			#pragma omp for schedule(dynamic, 256)
+			for (int q = 0; q < (int)numQueries; q++)
+			{
+				float* distances = squaredDistances == nullptr ? localDistances.data() : squaredDistances + size_t(q) * k;
+				FindNearest(queries + size_t(q) * 3, k, maxDistance, indices + size_t(q) * k, distances);
+			}
+		}
+	}
+
+	void PointCloudVoxelGrid::FindNearestDistances(const float* queries, size_t numQueries, float* distances, float maxDistance) const
+	{
+		#pragma omp parallel for schedule(dynamic, 256)
+		for (int q = 0; q < (int)numQueries; q++)
+		{
+			unsigned int index;
+			float squaredDistance;
+			NearestResults results(1, &index, &squaredDistance, maxDistance * maxDistance);
+			searchNearest(m_data, queries + size_t(q) * 3, maxDistance, results);
+			distances[q] = results.Count() > 0 ? std::sqrt(squaredDistance) : std::numeric_limits<float>::infinity();
+		}
+	}
+
+	void PointCloudVoxelGrid::CountInRadius(const float* queries, size_t numQueries, float radius, unsigned int* counts) const
+	{
+		#pragma omp parallel for schedule(dynamic, 256)
+		for (int q = 0; q < (int)numQueries; q++)
+		{
+			CountResults results(radius * radius);
+			searchRadius(m_data, queries + size_t(q) * 3, radius, results);
+			counts[q] = results.Count();
+		}
+	}
+}
@@ -4,11 +4,14 @@
 
 #include <CameraUtils/CameraCalibration.h>
 #include <CameraUtils/RenderingConfigs.h>
+#include <CameraUtils/Undistorter.h>
 #include <EvaluationUtils/ArucoHelper.h>
 #include <EvaluationUtils/DataLoader.h>
 
 #include <Masterthesis/cuda_config.h>
 
+#include <tof_correlation.h>
+
 #include <opencv2/highgui.hpp>
 #include <opencv2/calib3d.hpp>
 #include <opencv2/aruco.hpp>
@@ -27,6 +30,7 @@ void runAnalysis(const std::string& calibrationFilePath, const std::string& reco
 	
 	bow::IntrinsicCameraParameters rgb_intrinisicCameraParameters = bow::CameraCalibration::intrinsicChessboardCalibration(configs.calibration_checkerboard_width, configs.calibration_checkerboard_height, configs.calibration_checkerboard_squareSize, std::string(PROJECT_BASE_DIR) + std::string("/data/") + configs.rgbCameraCheckerboardImagesPath);
 	bow::IntrinsicCameraParameters ir_intrinisicCameraParameters = bow::CameraCalibration::intrinsicChessboardCalibration(configs.calibration_checkerboard_width, configs.calibration_checkerboard_height, configs.calibration_checkerboard_squareSize, std::string(PROJECT_BASE_DIR) + std::string("/data/") + configs.irCameraCheckerboardImagesPath);
+	bow::Undistorter undistorter;
 	
 	cv::Mat rgb_ChessboardImage = cv::imread(std::string(PROJECT_BASE_DIR) + std::string("/data/") + configs.rgbCameraExtrinsicCheckerboardImageFilePath, cv::IMREAD_UNCHANGED);
 	cv::Mat ir_ChessboardImage = cv::imread(std::string(PROJECT_BASE_DIR) + std::string("/data/") + configs.irCameraExtrinsicCheckerboardImageFilePath, cv::IMREAD_UNCHANGED);
@@ -103,7 +107,7 @@ void runAnalysis(const std::string& calibrationFilePath, const std::string& reco
 					cv::Mat empty_DistCoeffs = cv::Mat::zeros(4, 1, CV_32F);
 
 					cv::Mat colorMat = cv::imread(recordedFiles[dirIndex].imageFiles[frameIndex].filename, CV_LOAD_IMAGE_UNCHANGED);
-					cv::undistort(colorMat, undistortedColorMat, rgb_intrinisicCameraParameters.cameraMatrix, rgb_intrinisicCameraParameters.distCoeffs);
+					undistorter.Undistort(colorMat, undistortedColorMat, rgb_intrinisicCameraParameters);
 
 					// ====================================
 					// find pose of markers
@@ -166,7 +170,7 @@ void runAnalysis(const std::string& calibrationFilePath, const std::string& reco
 				cv::Mat empty_DistCoeffs = cv::Mat::zeros(4, 1, CV_32F);
 
 				cv::Mat colorMat = bow::DataLoader::findClosestImageFile(recordedFiles[dirIndex].depthFiles[frameIndex].timestamp, recordedFiles[dirIndex].imageFiles);
-				cv::undistort(colorMat, undistortedColorMat, rgb_intrinisicCameraParameters.cameraMatrix, rgb_intrinisicCameraParameters.distCoeffs);
+				undistorter.Undistort(colorMat, undistortedColorMat, rgb_intrinisicCameraParameters);
 
 				cv::Mat_<ushort> depthMat = bow::DataLoader::loadDepthFromFile(recordedFiles[dirIndex].depthFiles[frameIndex].filename);
 				if (depthMat.cols == 0 || depthMat.rows == 0)
@@ -412,10 +416,6 @@ void runAnalysis(const std::string& calibrationFilePath, const std::string& reco
 	}
 }
 
-#ifndef M_PI
-#define M_PI       3.14159265358979323846
-#endif
-
 void runPulsedSimulationAnalysis()
 {
 	// ====================================
@@ -431,41 +431,21 @@ void runPulsedSimulationAnalysis()
 	std::ofstream datFile;
 	datFile.open("systematic_error_pulsed.csv", std::ofstream::out | std::ofstream::trunc);
 
+	const tof_modulation<double> modulation = tof_make_pulse_modulation(pulselength);
+
 	float maxDistanceInMeter = ((speedOfLight * pulselength) * 0.5f);
 	for (unsigned int original_depth = 1; original_depth < maxDistanceInMeter * 1000 && original_depth < 3500; original_depth++)
 	{
 		const double lightdist = (double)original_depth / 1000.0;
-		double deltaTime = (lightdist * 2.0f) / speedOfLight;
+		double deltaTime = tof_travel_time(lightdist * 2.0);
 
 		double attenuation = 1.0 / (lightdist * lightdist);
 		double Intensity = lightIntensity * attenuation;
 
-		double C1_start = 0.0f;
-		double C2_start = pulselength;
-
-		bow::Vector2<double> ir_result = bow::Vector2<double>(0.0, 0.0);
-
-		float begin = deltaTime;
-		float end = deltaTime + pulselength;
-
-		if ((end >= C1_start && end <= C1_start + pulselength) || (begin >= C1_start && begin <= C1_start + pulselength))
-		{
-			if (begin > C1_start)
-				ir_result.x += (((C1_start + pulselength) - begin) / pulselength) * Intensity;
-			else
-				ir_result.x += ((end - C1_start) / pulselength) * Intensity;
-		}
-
-		if ((end >= C2_start && end <= C2_start + pulselength) || (begin >= C2_start && begin <= C2_start + pulselength))
-		{
-			if (begin > C2_start)
-				ir_result.y += (((C2_start + pulselength) - begin) / pulselength) * Intensity;
-			else
-				ir_result.y += ((end - C2_start) / pulselength) * Intensity;
-		}
+		tof_buckets<tof_pulse_model, double> ir_result = tof_make_buckets<tof_pulse_model, double>();
+		tof_accumulate(modulation, deltaTime, Intensity, ir_result);
 
-		double out_distance = 0.0;
-		out_distance = (0.5f * speedOfLight * pulselength * (ir_result.y / (ir_result.x + ir_result.y)));
+		double out_distance = tof_distance(modulation, ir_result);
 
 		if (csv_file.is_open())
 		{
@@ -531,75 +511,13 @@ void runCwSimulationAnalysis()
 		for (unsigned int i = 0; i < frequencies.size(); i++)
 		{
 			const double frequency = frequencies[i];
-			const double pulselength = (1.0 / frequency) * 0.5;
-
-			const double C1_start = 0.0;
-			const double C2_start = pulselength;
-
-			const double C3_start = pulselength * 0.5;
-			const double C4_start = (pulselength * 0.5) + pulselength;
-
-			double deltaTime = (lightdist * 2.0) / speedOfLight;
-			bow::Vector4<double> ir_result = bow::Vector4<double>(0.0, 0.0, 0.0, 0.0);
-			while (deltaTime < C4_start + pulselength)
-			{
-				deltaTime = deltaTime + (pulselength * 2.0);
-			}
-
-			while (deltaTime + pulselength > 0.0)
-			{
-				double begin = deltaTime;
-				double end = deltaTime + pulselength;
-
-				if ((end >= C1_start && end <= C1_start + pulselength) || (begin >= C1_start && begin <= C1_start + pulselength))
-				{
-					if (begin > C1_start)
-						ir_result.x += (((C1_start + pulselength) - begin) / pulselength) * Intensity;
-					else
-						ir_result.x += ((end - C1_start) / pulselength) * Intensity;
-				}
-
-				if ((end >= C2_start && end <= C2_start + pulselength) || (begin >= C2_start && begin <= C2_start + pulselength))
-				{
-					if (begin > C2_start)
-						ir_result.y += (((C2_start + pulselength) - begin) / pulselength) * Intensity;
-					else
-						ir_result.y += ((end - C2_start) / pulselength) * Intensity;
-				}
-
-				if ((end >= C3_start && end <= C3_start + pulselength) || (begin >= C3_start && begin <= C3_start + pulselength))
-				{
-					if (begin > C3_start)
-						ir_result.z += (((C3_start + pulselength) - begin) / pulselength) * Intensity;
-					else
-						ir_result.z += ((end - C3_start) / pulselength) * Intensity;
-				}
-
-				if ((end >= C4_start && end <= C4_start + pulselength) || (begin >= C4_start && begin <= C4_start + pulselength))
-				{
-					if (begin > C4_start)
-						ir_result.w += (((C4_start + pulselength) - begin) / pulselength) * Intensity;
-					else
-						ir_result.w += ((end - C4_start) / pulselength) * Intensity;
-				}
-
-				deltaTime = deltaTime - (pulselength * 2.0);
-			}
+			const tof_modulation<double> modulation = tof_make_modulation(frequency);
 
-			double out_distance = 0.0;
-			if ((ir_result.x - ir_result.y) != 0.0)
-			{
-				double phi = atan2((ir_result.z - ir_result.w), (ir_result.x - ir_result.y));
+			double deltaTime = tof_travel_time(lightdist * 2.0);
+			tof_buckets<tof_rect_model, double> ir_result = tof_make_buckets<tof_rect_model, double>();
+			tof_accumulate(modulation, deltaTime, Intensity, ir_result);
 
-				if (phi < 0.0)
-					phi = (2.0 * M_PI) + phi;
-
-				out_distance = (speedOfLight / (4.0 * M_PI * frequency)) * phi;
-			}
-			else
-			{
-				out_distance = 0.0;
-			}
+			double out_distance = tof_distance(modulation, ir_result);
 
 			depthValuesByFrequencies.insert(std::pair<double, double>(frequency, out_distance));
 		}
@@ -725,11 +643,6 @@ void runCwSimulationAnalysis()
 	datFile.close();
 }
 
-double getArea(double amplitude, double frequency, double offset, double from, double to)
-{
-	return ((amplitude * (cos(2.0 * M_PI * frequency * from) - cos(2.0 * M_PI * frequency * to))) / (2.0 * M_PI * frequency)) - (offset * from) + (offset * to);
-}
-
 void runSineCwSimulationAnalysis()
 {
 	// ====================================
@@ -739,6 +652,7 @@ void runSineCwSimulationAnalysis()
 	const double speedOfLight = 299792458.0;
 
 	double frequency = 16 * 1000.0 * 1000.0;// 16 Mhz
+	const tof_modulation<double> modulation = tof_make_modulation(frequency);
 
 	double beatFrequency = 16 * 1000.0 * 1000.0;
 	double maxDistanceInMeter = (speedOfLight / (2.0 * beatFrequency));
@@ -750,37 +664,12 @@ void runSineCwSimulationAnalysis()
 		const double attenuation = 1.0 / (lightdist * lightdist);
 		const double Intensity = lightIntensity * attenuation;
 
-		const double quarterlength = 1.0 / (4.0 * frequency);
-
-		const double C1_start = 0.0 * quarterlength;
-		const double C2_start = 1.0 * quarterlength;
-
-		const double C3_start = 2.0 * quarterlength;
-		const double C4_start = 3.0 * quarterlength;
+		// Q1 to Q4 are sampled at 0, 180, 90 and 270 degrees
+		double deltaTime = tof_travel_time(lightdist * 2.0);
+		tof_buckets<tof_sine_model, double> ir_result = tof_make_buckets<tof_sine_model, double>();
+		tof_accumulate(modulation, deltaTime, Intensity, ir_result);
 
-		double deltaTime = (lightdist * 2.0) / speedOfLight;
-		bow::Vector4<double> ir_result = bow::Vector4<double>(0.0, 0.0, 0.0, 0.0);
-
-		// Calculate intensity for Q1, Q2, Q3 and Q4
-		ir_result.x = getArea(Intensity, frequency, Intensity, C1_start - deltaTime, (C1_start - deltaTime) + (2.0 * quarterlength));
-		ir_result.y = getArea(Intensity, frequency, Intensity, C2_start - deltaTime, (C2_start - deltaTime) + (2.0 * quarterlength));
-		ir_result.z = getArea(Intensity, frequency, Intensity, C3_start - deltaTime, (C3_start - deltaTime) + (2.0 * quarterlength));
-		ir_result.w = getArea(Intensity, frequency, Intensity, C4_start - deltaTime, (C4_start - deltaTime) + (2.0 * quarterlength));
-
-		double out_distance = 0.0;
-		if ((ir_result.x - ir_result.y) != 0.0)
-		{
-			double phi = atan2((ir_result.y - ir_result.w), (ir_result.x - ir_result.z));
-
-			if (phi < 0.0)
-				phi = (2.0 * M_PI) + phi;
-
-			out_distance = (speedOfLight / (4.0 * M_PI * frequency)) * phi;
-		}
-		else
-		{
-			out_distance = 0.0;
-		}
+		double out_distance = tof_distance(modulation, ir_result);
 
 		if (depthValueMap.find(original_depth) == depthValueMap.end())
 		{
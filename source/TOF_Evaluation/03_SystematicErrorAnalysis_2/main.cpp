@@ -4,8 +4,10 @@
 
 #include <CameraUtils/CameraCalibration.h>
 #include <CameraUtils/RenderingConfigs.h>
+#include <CameraUtils/Undistorter.h>
 #include <EvaluationUtils/ArucoHelper.h>
 #include <EvaluationUtils/DataLoader.h>
+#include <EvaluationUtils/MarkerTracker.h>
 
 #include <Masterthesis/cuda_config.h>
 
@@ -17,6 +19,18 @@
 #include <iostream>
 #include <limits>
 
+// The markers of a map may differ slightly in size, the analyses measure with the mean side length
+float averageSideLength(const std::vector<bow::MarkerDescription>& markerMap)
+{
+	float sideLength = 0.0f;
+	for (unsigned int markerIndex = 0; markerIndex < markerMap.size(); markerIndex++)
+		sideLength += markerMap[markerIndex].sidelengthInMM;
+
+	if (!markerMap.empty())
+		sideLength = sideLength / (float)markerMap.size();
+	return sideLength;
+}
+
 void runAnalysis(const std::string& calibrationFilePath, const std::string& recordingsFolderPath, const std::string& big_markerMapPath)
 {
 	////////////////////////////////////////////////////////////////
@@ -27,6 +41,7 @@ void runAnalysis(const std::string& calibrationFilePath, const std::string& reco
 	
 	bow::IntrinsicCameraParameters rgb_intrinisicCameraParameters = bow::CameraCalibration::intrinsicChessboardCalibration(configs.calibration_checkerboard_width, configs.calibration_checkerboard_height, configs.calibration_checkerboard_squareSize, std::string(PROJECT_BASE_DIR) + std::string("/data/") + configs.rgbCameraCheckerboardImagesPath);
 	bow::IntrinsicCameraParameters ir_intrinisicCameraParameters = bow::CameraCalibration::intrinsicChessboardCalibration(configs.calibration_checkerboard_width, configs.calibration_checkerboard_height, configs.calibration_checkerboard_squareSize, std::string(PROJECT_BASE_DIR) + std::string("/data/") + configs.irCameraCheckerboardImagesPath);
+	bow::Undistorter undistorter;
 	
 	cv::Mat rgb_ChessboardImage = cv::imread(std::string(PROJECT_BASE_DIR) + std::string("/data/") + configs.rgbCameraExtrinsicCheckerboardImageFilePath, cv::IMREAD_UNCHANGED);
 	cv::Mat ir_ChessboardImage = cv::imread(std::string(PROJECT_BASE_DIR) + std::string("/data/") + configs.irCameraExtrinsicCheckerboardImageFilePath, cv::IMREAD_UNCHANGED);
@@ -46,14 +61,8 @@ void runAnalysis(const std::string& calibrationFilePath, const std::string& reco
 	cv::Vec3f center = cv::Vec3f(0.0f, 0.0f, 0.0f);
 	unsigned int count_positions = 0;
 
-	float sideLength = 0.0f;
-	unsigned int count_sidelength = 0;
-
 	for (unsigned int markerIndex = 0; markerIndex < big_MarkerMap.size(); markerIndex++)
 	{
-		sideLength += big_MarkerMap[markerIndex].sidelengthInMM;
-		count_sidelength++;
-
 		center += big_MarkerMap[markerIndex].center;
 		count_positions++;
 	}
@@ -61,8 +70,10 @@ void runAnalysis(const std::string& calibrationFilePath, const std::string& reco
 	if (count_positions > 0)
 		center = center / (float)count_positions;
 
-	if (count_sidelength > 0)
-		sideLength = sideLength / (float)count_sidelength;
+	const float sideLength = averageSideLength(big_MarkerMap);
+
+	// images are undistorted before the detection
+	bow::MarkerTracker markerTracker(rgb_intrinisicCameraParameters.cameraMatrix, cv::Mat::zeros(4, 1, CV_32F), sideLength);
 
 	// ==============================================================
 	// Find marker in images and estimate camera position
@@ -85,6 +96,7 @@ void runAnalysis(const std::string& calibrationFilePath, const std::string& reco
 		ushort lastDistance = 0;
 		if (recordedFiles[dirIndex].imageFiles.size() > 0 && recordedFiles[dirIndex].depthFiles.size() > 0)
 		{
+			markerTracker.Reset();
 
 			std::map<ushort, unsigned int> measured_depth_count_map;
 			std::map<float, unsigned int> aruco_depth_count_map;
@@ -95,10 +107,9 @@ void runAnalysis(const std::string& calibrationFilePath, const std::string& reco
 				// ====================================
 
 				cv::Mat undistortedColorMat;
-				cv::Mat empty_DistCoeffs = cv::Mat::zeros(4, 1, CV_32F);
 
 				cv::Mat colorMat = cv::imread(recordedFiles[dirIndex].imageFiles[frameIndex].filename, CV_LOAD_IMAGE_UNCHANGED);
-				cv::undistort(colorMat, undistortedColorMat, rgb_intrinisicCameraParameters.cameraMatrix, rgb_intrinisicCameraParameters.distCoeffs);
+				undistorter.Undistort(colorMat, undistortedColorMat, rgb_intrinisicCameraParameters);
 
 				cv::Mat_<ushort> depthMat = bow::DataLoader::findClosestDepthFile(recordedFiles[dirIndex].imageFiles[frameIndex].timestamp, recordedFiles[dirIndex].depthFiles);
 				if (depthMat.cols == 0 || depthMat.rows == 0)
@@ -110,7 +121,7 @@ void runAnalysis(const std::string& calibrationFilePath, const std::string& reco
 				// find pose of markers
 				// ====================================
 
-				std::vector<bow::Marker> detectedMarkers = bow::ArucoHelper::detectMarker(undistortedColorMat, rgb_intrinisicCameraParameters.cameraMatrix, empty_DistCoeffs, sideLength, big_MarkerMap);
+				std::vector<bow::Marker> detectedMarkers = markerTracker.Track(undistortedColorMat);
 
 				cv::Matx<float, 4, 4> transform;
 				if (bow::ArucoHelper::getTransformationFromMarkerMap(big_MarkerMap, detectedMarkers, transform))
@@ -376,8 +387,41 @@ void runAnalysis(const std::string& calibrationFilePath, const std::string& reco
 	}
 }
 
+// Compares the marker tracker with ArucoHelper::detectMarker on the first frames of every recording
+void compareMarkerTracker(const std::string& calibrationFilePath, const std::string& recordingsFolderPath, const std::string& big_markerMapPath, unsigned int maxFramesPerRecording)
+{
+	bow::RenderingConfigs configs = bow::ConfigLoader::loadConfigFromFile(std::string(PROJECT_BASE_DIR) + calibrationFilePath);
+	bow::IntrinsicCameraParameters rgb_intrinisicCameraParameters = bow::CameraCalibration::intrinsicChessboardCalibration(configs.calibration_checkerboard_width, configs.calibration_checkerboard_height, configs.calibration_checkerboard_squareSize, std::string(PROJECT_BASE_DIR) + std::string("/data/") + configs.rgbCameraCheckerboardImagesPath);
+	bow::Undistorter undistorter;
+
+	std::vector<bow::MarkerDescription> big_MarkerMap = bow::ArucoHelper::LoadMarkerMapFromFile(std::string(PROJECT_BASE_DIR) + big_markerMapPath);
+	if (big_MarkerMap.empty())
+		return;
+	const float sideLength = averageSideLength(big_MarkerMap);
+
+	std::vector<bow::DepthFileData> recordedFiles = bow::DataLoader::loadRecordedFilesFromFolder(recordingsFolderPath);
+	for (unsigned int dirIndex = 0; dirIndex < recordedFiles.size(); dirIndex++)
+	{
+		std::vector<cv::Mat> undistortedColorMats;
+		for (unsigned int frameIndex = 0; frameIndex < recordedFiles[dirIndex].imageFiles.size() && frameIndex < maxFramesPerRecording; frameIndex++)
+		{
+			cv::Mat colorMat = cv::imread(recordedFiles[dirIndex].imageFiles[frameIndex].filename, CV_LOAD_IMAGE_UNCHANGED);
+			if (colorMat.cols == 0 || colorMat.rows == 0)
+				continue;
+
+			cv::Mat undistortedColorMat;
+			undistorter.Undistort(colorMat, undistortedColorMat, rgb_intrinisicCameraParameters);
+			undistortedColorMats.push_back(undistortedColorMat);
+		}
+
+		std::cout << recordedFiles[dirIndex].folderName << std::endl;
+		bow::MarkerTracker::MeasureAgainstReference(undistortedColorMats, rgb_intrinisicCameraParameters.cameraMatrix, cv::Mat::zeros(4, 1, CV_32F), sideLength);
+	}
+}
+
 int main()
 {
+	//compareMarkerTracker("/data/Kinect_v2_Calibration.xml", "D:\\Kamera_Evaluation\\Kinect_v2\\Recordings_SystematicError_2", "/data/map_systematic_error.yml", 300);
 	//runAnalysis("/data/IFM_O3D303_Calibration.xml", "F:\\Kamera_Evaluation\\03D303\\Recordings_SystematicError_2", "/data/map_systematic_error.yml");
 	//runAnalysis("/data/Kinect_v2_Calibration.xml", "D:\\Kamera_Evaluation\\Kinect_v2\\Recordings_SystematicError_2", "/data/map_systematic_error.yml");
 	//runAnalysis("/data/Xtion_2_Calibration.xml", "F:\\Kamera_Evaluation\\Xtion_2\\Recordings_SystematicError_2", "/data/map_systematic_error.yml");
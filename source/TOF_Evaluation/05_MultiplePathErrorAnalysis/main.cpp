@@ -6,6 +6,7 @@
 #include <CameraUtils/CameraCalibration.h>
 #include <CameraUtils/RenderingConfigs.h>
 #include <CameraUtils/PCLRenderer.h>
+#include <CameraUtils/Undistorter.h>
 #include <EvaluationUtils/ArucoHelper.h>
 #include <EvaluationUtils/DataLoader.h>
 
@@ -120,6 +121,9 @@ void runAnalysis(const std::string& calibrationFilePath, const std::string& reco
 	cv::Mat irToRgbCameraViewMatrix = bow::CameraCalibration::calculateChessboardCameraTransformationViewMatrix(ir_ChessboardImage, rgb_ChessboardImage, ir_intrinisicCameraParameters, rgb_intrinisicCameraParameters, configs.calibration_checkerboard_width, configs.calibration_checkerboard_height, configs.calibration_checkerboard_squareSize);
 	cv::Mat rgbToIrCameraViewMatrix = bow::CameraCalibration::calculateChessboardCameraTransformationViewMatrix(rgb_ChessboardImage, ir_ChessboardImage, rgb_intrinisicCameraParameters, ir_intrinisicCameraParameters, configs.calibration_checkerboard_width, configs.calibration_checkerboard_height, configs.calibration_checkerboard_squareSize);
 
+	// undistortion maps of the rgb and ir camera are built once and reused for all frames
+	bow::Undistorter undistorter;
+
 	// ==============================================================
 	// Load Marker Maps
 	// ==============================================================
@@ -137,7 +141,7 @@ void runAnalysis(const std::string& calibrationFilePath, const std::string& reco
 	for (unsigned int dirIndex = 0; dirIndex < recordedFiles.size(); dirIndex++)
 	{
 		cv::Mat_<double> mean_depthMat;
-		cv::Mat_<cv::Vec3b> mean_colorMat;
+		cv::Mat mean_undistortedColorMat;
 
 		if (recordedFiles[dirIndex].imageFiles.size() > 0 && recordedFiles[dirIndex].depthFiles.size() > 0)
 		{
@@ -154,15 +158,10 @@ void runAnalysis(const std::string& calibrationFilePath, const std::string& reco
 				// Load rgb image and depth map
 				// ====================================
 
-				cv::Mat undistortedColorMat;
-				cv::Mat empty_DistCoeffs = cv::Mat::zeros(4, 1, CV_32F);
-
 				cv::Mat colorMat = cv::imread(recordedFiles[dirIndex].imageFiles[frameIndex].filename, CV_LOAD_IMAGE_UNCHANGED);
 				if (colorMat.cols == 0 || colorMat.rows == 0)
 					continue;
 
-				cv::undistort(colorMat, undistortedColorMat, rgb_intrinisicCameraParameters.cameraMatrix, rgb_intrinisicCameraParameters.distCoeffs);
-
 				cv::Mat_<ushort> depthMat = bow::DataLoader::findClosestDepthFile(recordedFiles[dirIndex].imageFiles[frameIndex].timestamp, recordedFiles[dirIndex].depthFiles);
 				if (depthMat.cols == 0 || depthMat.rows == 0)
 					continue;
@@ -171,18 +170,7 @@ void runAnalysis(const std::string& calibrationFilePath, const std::string& reco
 				// calculate mean color and depth map do reduce noise
 				// ====================================
 
-				if (mean_colorMat.cols != colorMat.cols || mean_colorMat.rows != colorMat.rows)
-					mean_colorMat = cv::Mat_<cv::Vec3b>::zeros(undistortedColorMat.rows, undistortedColorMat.cols);
-
-				for (unsigned int row = 0; row < undistortedColorMat.rows; row++)
-				{
-					for (unsigned int col = 0; col < undistortedColorMat.cols; col++)
-					{
-						cv::Vec3b temp_color = undistortedColorMat.at<cv::Vec3b>(row, col);
-						double a = 1.0f / (double)(frameIndex + 1);
-						mean_colorMat.at<cv::Vec3b>(row, col) = (mean_colorMat.at<cv::Vec3b>(row, col) * (1.0 - a)) + (temp_color * a);
-					}
-				}
+				undistorter.UndistortAccumulate(colorMat, mean_undistortedColorMat, frameIndex, rgb_intrinisicCameraParameters);
 
 				if (mean_depthMat.cols != depthMat.cols || mean_depthMat.rows != depthMat.rows)
 					mean_depthMat = cv::Mat_<double>(depthMat.rows, depthMat.cols);
@@ -212,6 +200,9 @@ void runAnalysis(const std::string& calibrationFilePath, const std::string& reco
 			}
 		}
 
+		cv::Mat_<cv::Vec3b> mean_colorMat;
+		mean_undistortedColorMat.convertTo(mean_colorMat, CV_8UC3);
+
 		// ====================================
 		// calculate difference from reference
 		// ====================================
@@ -284,7 +275,7 @@ void runAnalysis(const std::string& calibrationFilePath, const std::string& reco
 				cv::flip(undistorted_ref_depth_mat, undistorted_ref_depth_mat, 0);
 
 				cv::Mat_<ushort> undistorted_depth;
-				cv::undistort(depthMat, undistorted_depth, ir_intrinisicCameraParameters.cameraMatrix, ir_intrinisicCameraParameters.distCoeffs);
+				undistorter.Undistort(depthMat, undistorted_depth, ir_intrinisicCameraParameters);
 				
 				const float max_diff_value = 100.0f;
 				cv::Mat_<uchar> diff_mat = cv::Mat_<uchar>(undistorted_depth.rows, undistorted_depth.cols);
@@ -4,6 +4,7 @@
 
 #include <CameraUtils/CameraCalibration.h>
 #include <CameraUtils/RenderingConfigs.h>
+#include <CameraUtils/Undistorter.h>
 #include <CameraUtils/PCLRenderer.h>
 #include <EvaluationUtils/ArucoHelper.h>
 #include <EvaluationUtils/DataLoader.h>
@@ -29,6 +30,7 @@ void runAnalysis(const std::string& calibrationFilePath, const std::string& reco
 
 	bow::IntrinsicCameraParameters rgb_intrinisicCameraParameters = bow::CameraCalibration::intrinsicChessboardCalibration(configs.calibration_checkerboard_width, configs.calibration_checkerboard_height, configs.calibration_checkerboard_squareSize, std::string(PROJECT_BASE_DIR) + std::string("/data/") + configs.rgbCameraCheckerboardImagesPath);
 	bow::IntrinsicCameraParameters ir_intrinisicCameraParameters = bow::CameraCalibration::intrinsicChessboardCalibration(configs.calibration_checkerboard_width, configs.calibration_checkerboard_height, configs.calibration_checkerboard_squareSize, std::string(PROJECT_BASE_DIR) + std::string("/data/") + configs.irCameraCheckerboardImagesPath);
+	bow::Undistorter undistorter;
 
 	cv::Mat rgb_ChessboardImage = cv::imread(std::string(PROJECT_BASE_DIR) + std::string("/data/") + configs.rgbCameraExtrinsicCheckerboardImageFilePath, cv::IMREAD_UNCHANGED);
 	cv::Mat ir_ChessboardImage = cv::imread(std::string(PROJECT_BASE_DIR) + std::string("/data/") + configs.irCameraExtrinsicCheckerboardImageFilePath, cv::IMREAD_UNCHANGED);
@@ -67,7 +69,7 @@ void runAnalysis(const std::string& calibrationFilePath, const std::string& reco
 				cv::Mat empty_DistCoeffs = cv::Mat::zeros(4, 1, CV_32F);
 
 				cv::Mat colorMat = cv::imread(recordedFiles[dirIndex].imageFiles[frameIndex].filename, CV_LOAD_IMAGE_UNCHANGED);
-				cv::undistort(colorMat, undistortedColorMat, rgb_intrinisicCameraParameters.cameraMatrix, rgb_intrinisicCameraParameters.distCoeffs);
+				undistorter.Undistort(colorMat, undistortedColorMat, rgb_intrinisicCameraParameters);
 
 				cv::Mat_<ushort> depthMat = bow::DataLoader::findClosestDepthFile(recordedFiles[dirIndex].imageFiles[frameIndex].timestamp, recordedFiles[dirIndex].depthFiles);
 				if (depthMat.cols == 0 || depthMat.rows == 0)
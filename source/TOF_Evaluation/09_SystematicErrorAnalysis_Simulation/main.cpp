@@ -7,6 +7,7 @@
 #include <CameraUtils/PCLRenderer.h>
 #include <EvaluationUtils/ArucoHelper.h>
 #include <EvaluationUtils/DataLoader.h>
+#include <EvaluationUtils/ReferenceModel.h>
 
 #include <Masterthesis/cuda_config.h>
 
@@ -42,11 +43,23 @@ void runAnalysis(const std::string& calibrationFilePath, const std::string& reco
 	// Find marker in images and estimate camera position
 	// ==============================================================
 
-	cv::Mat_<double> reference_depthMat;
-	cv::Mat_<double> reference_irMat;
 	unsigned int lastPercentage = 0;
 	std::vector<bow::DepthFileData> recordedFiles = bow::DataLoader::loadRecordedFilesFromFolder(recordingsFolderPath);
-	for (unsigned int dirIndex = 0; dirIndex < recordedFiles.size(); dirIndex++)
+
+	// ==============================================================
+	// Run_0 is our background for reference, its mean is cached
+	// next to the recordings and shared by all later runs
+	// ==============================================================
+
+	bow::ReferenceModel referenceDepthModel;
+	if (recordedFiles.size() > 0)
+	{
+		std::cout << "Loading reference... " << recordedFiles[0].folderName << "\t\r";
+		referenceDepthModel.Load(recordedFiles[0].rangeFiles, bow::ReferenceModel::GetCacheFilePath(recordingsFolderPath, recordedFiles[0].folderName, "range"));
+	}
+	cv::Mat_<double> reference_depthMat = referenceDepthModel.GetMean();
+
+	for (unsigned int dirIndex = 1; dirIndex < recordedFiles.size(); dirIndex++)
 	{
 		cv::Mat_<double> mean_depthMat;
 		if (recordedFiles[dirIndex].rangeFiles.size() > 0)
@@ -68,42 +81,20 @@ void runAnalysis(const std::string& calibrationFilePath, const std::string& reco
 				if (depthMat.cols == 0 || depthMat.rows == 0)
 					continue;
 
-				if (dirIndex == 0)
-				{
-					// ==============================================================
-					// If this ist Run_0, then it is our background for reference
-					// ==============================================================
+				// ==============================================================
+				// Calculate mean of depth values to reduce noise
+				// ==============================================================
 
-					if (reference_depthMat.cols != depthMat.cols || reference_depthMat.rows != depthMat.rows)
-						reference_depthMat = cv::Mat_<double>(depthMat.rows, depthMat.cols);
+				if (mean_depthMat.cols != depthMat.cols || mean_depthMat.rows != depthMat.rows)
+					mean_depthMat = cv::Mat_<double>(depthMat.rows, depthMat.cols);
 
-					for (unsigned int row = 0; row < depthMat.rows; row++)
-					{
-						for (unsigned int col = 0; col < depthMat.cols; col++)
-						{
-							double temp_depth = (double)depthMat.at<ushort>(row, col);
-							double a = 1.0f / (double)(frameIndex + 1);
-							reference_depthMat.at<double>(row, col) = (reference_depthMat.at<double>(row, col) * (1.0 - a)) + (temp_depth * a);
-						}
-					}
-				}
-				else
+				for (unsigned int row = 0; row < depthMat.rows; row++)
 				{
-					// ==============================================================
-					// Calculate mean of depth values to reduce noise
-					// ==============================================================
-
-					if (mean_depthMat.cols != depthMat.cols || mean_depthMat.rows != depthMat.rows)
-						mean_depthMat = cv::Mat_<double>(depthMat.rows, depthMat.cols);
-
-					for (unsigned int row = 0; row < depthMat.rows; row++)
+					for (unsigned int col = 0; col < depthMat.cols; col++)
 					{
-						for (unsigned int col = 0; col < depthMat.cols; col++)
-						{
-							double temp_depth = (double)depthMat.at<ushort>(row, col);
-							double a = 1.0f / (double)(frameIndex + 1);
-							mean_depthMat.at<double>(row, col) = (mean_depthMat.at<double>(row, col) * (1.0 - a)) + (temp_depth * a);
-						}
+						double temp_depth = (double)depthMat.at<ushort>(row, col);
+						double a = 1.0f / (double)(frameIndex + 1);
+						mean_depthMat.at<double>(row, col) = (mean_depthMat.at<double>(row, col) * (1.0 - a)) + (temp_depth * a);
 					}
 				}
 			}
@@ -113,12 +104,11 @@ void runAnalysis(const std::string& calibrationFilePath, const std::string& reco
 				cv::Mat_<float> differenceMat(mean_depthMat.rows, mean_depthMat.cols);
 				cv::Mat_<ushort> depthMat(mean_depthMat.rows, mean_depthMat.cols);
 				cv::Mat_<ushort> refDepthMat(reference_depthMat.rows, reference_depthMat.cols);
+				referenceDepthModel.ComputeDifference(mean_depthMat, differenceMat);
 				for (unsigned int row = 0; row < mean_depthMat.rows; row++)
 				{
 					for (unsigned int col = 0; col < mean_depthMat.cols; col++)
 					{
-						differenceMat.at<float>(row, col) = (mean_depthMat.at<double>(row, col) - reference_depthMat.at<double>(row, col));
-
 						refDepthMat.at<ushort>(row, col) = (ushort)reference_depthMat.at<double>(row, col);
 						depthMat.at<ushort>(row, col) = (ushort)mean_depthMat.at<double>(row, col);
 					}
@@ -0,0 +1,132 @@
+#include <CoreSystems/BowCoreSystems.h>
+#include <Resources/Codecs/BowDepthCodec.h>
+
+#include <EvaluationUtils/DataLoader.h>
+
+#include <Masterthesis/cuda_config.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sys/stat.h>
+
+#if defined(_WIN32) || defined(WIN32)
+const std::string g_pathSeparator = "\\";
+#else
+const std::string g_pathSeparator = "/";
+#endif
+
+struct CodecStatistics
+{
+	CodecStatistics() : frames(0), rawBytes(0), encodedBytes(0), encodeSeconds(0.0), decodeSeconds(0.0), mismatches(0) {}
+
+	unsigned int	frames;
+	size_t			rawBytes;
+	size_t			encodedBytes;
+	double			encodeSeconds;
+	double			decodeSeconds;
+	unsigned int	mismatches;
+};
+
+bool isDirectory(const std::string& path)
+{
+	struct stat statbuf;
+	return stat(path.c_str(), &statbuf) == 0 && (statbuf.st_mode & S_IFDIR) != 0;
+}
+
+// Collects all Depth_ and Range_ frames below folderPath
+void findDepthFrames(const std::string& folderPath, std::vector<std::string>& frames)
+{
+	std::vector<std::string> entries = bow::DataLoader::getDirectoryContent(folderPath);
+	for (unsigned int i = 0; i < entries.size(); i++)
+	{
+		if (entries[i] == "." || entries[i] == "..")
+			continue;
+
+		std::string path = folderPath + g_pathSeparator + entries[i];
+		if (isDirectory(path))
+		{
+			findDepthFrames(path, frames);
+		}
+		else if (entries[i].find("Depth_") == 0 || entries[i].find("Range_") == 0)
+		{
+			frames.push_back(path);
+		}
+	}
+}
+
+void measureFrame(const cv::Mat_<ushort>& frame, bow::DepthPredictor predictor, CodecStatistics& statistics)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+
+	std::vector<unsigned char> encoded;
+	Clock::time_point start = Clock::now();
+	bow::DepthCodec::Encode((const unsigned short*)frame.data, frame.cols, frame.rows, encoded, predictor);
+	Clock::time_point encodeEnd = Clock::now();
+
+	cv::Mat_<ushort> decoded(frame.rows, frame.cols);
+	bool success = bow::DepthCodec::Decode(encoded.data(), encoded.size(), (unsigned short*)decoded.data);
+	Clock::time_point decodeEnd = Clock::now();
+
+	if (!success || cv::countNonZero(frame != decoded) != 0)
+	{
+		statistics.mismatches++;
+	}
+
+	statistics.frames++;
+	statistics.rawBytes += frame.total() * sizeof(ushort);
+	statistics.encodedBytes += encoded.size();
+	statistics.encodeSeconds += std::chrono::duration<double>(encodeEnd - start).count();
+	statistics.decodeSeconds += std::chrono::duration<double>(decodeEnd - encodeEnd).count();
+}
+
+void printStatistics(const std::string& name, const CodecStatistics& statistics)
+{
+	double megaBytes = statistics.rawBytes / (1024.0 * 1024.0);
+	std::cout << std::left << std::setw(10) << name << std::right << std::fixed
+		<< std::setw(8) << statistics.frames << " frames"
+		<< std::setw(10) << std::setprecision(2) << (double)statistics.rawBytes / std::max<size_t>(1, statistics.encodedBytes) << " : 1"
+		<< std::setw(10) << std::setprecision(0) << megaBytes / std::max(1e-9, statistics.encodeSeconds) << " MiB/s encode"
+		<< std::setw(10) << std::setprecision(0) << megaBytes / std::max(1e-9, statistics.decodeSeconds) << " MiB/s decode"
+		<< (statistics.mismatches > 0 ? "  MISMATCHES: " + std::to_string(statistics.mismatches) : "") << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	std::string recordingsFolderPath = std::string(PROJECT_BASE_DIR) + std::string("/data/EvaluationData");
+	if (argc > 1)
+	{
+		recordingsFolderPath = argv[1];
+	}
+
+	std::vector<std::string> frameFiles;
+	findDepthFrames(recordingsFolderPath, frameFiles);
+	std::cout << "Found " << frameFiles.size() << " depth/range frames in " << recordingsFolderPath << std::endl;
+
+	CodecStatistics rowDelta, med;
+	for (unsigned int i = 0; i < frameFiles.size(); i++)
+	{
+		std::cout << "Measuring... (" << std::to_string((unsigned int)(((double)i / (double)frameFiles.size()) * 100.0)) << "%)\t\r";
+
+		cv::Mat_<ushort> frame = bow::DataLoader::loadDepthFromFile(frameFiles[i]);
+		if (frame.empty())
+		{
+			continue;
+		}
+
+		measureFrame(frame, bow::DepthPredictor::RowDelta, rowDelta);
+		measureFrame(frame, bow::DepthPredictor::MED, med);
+	}
+	std::cout << std::endl;
+
+	if (rowDelta.frames == 0)
+	{
+		std::cout << "No raw or encoded Depth_/Range_ recordings found, pass a recordings folder as first argument." << std::endl;
+		return 0;
+	}
+
+	printStatistics("RowDelta", rowDelta);
+	printStatistics("MED", med);
+	return 0;
+}
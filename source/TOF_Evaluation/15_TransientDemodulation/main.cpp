@@ -0,0 +1,230 @@
+#include <CoreSystems/BowCoreSystems.h>
+#include <Resources/Codecs/BowDepthCodec.h>
+#include <Resources/Codecs/BowTransientHistogram.h>
+
+#include <EvaluationUtils/DataLoader.h>
+
+#include <Masterthesis/cuda_config.h>
+
+#include <transient_histogram.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sys/stat.h>
+
+#if defined(_WIN32) || defined(WIN32)
+const std::string g_pathSeparator = "\\";
+#else
+const std::string g_pathSeparator = "/";
+#endif
+
+// Modulations every histogram is demodulated with
+const double g_frequencies[] = { 10e6, 20e6, 30e6, 40e6, 60e6, 80e6, 100e6 };
+const double g_pulseWidths[] = { 10e-9, 20e-9, 50e-9 };
+
+struct TransientFrame
+{
+	std::vector<unsigned char>	data;
+	std::vector<float>			ambient;
+	unsigned int				width;
+	unsigned int				height;
+	unsigned int				bins;
+	float						binWidth;
+};
+
+bool isDirectory(const std::string& path)
+{
+	struct stat statbuf;
+	return stat(path.c_str(), &statbuf) == 0 && (statbuf.st_mode & S_IFDIR) != 0;
+}
+
+// Collects all Transient_ frames below folderPath
+void findTransientFrames(const std::string& folderPath, std::vector<std::string>& frames)
+{
+	std::vector<std::string> entries = bow::DataLoader::getDirectoryContent(folderPath);
+	for (unsigned int i = 0; i < entries.size(); i++)
+	{
+		if (entries[i] == "." || entries[i] == "..")
+			continue;
+
+		std::string path = folderPath + g_pathSeparator + entries[i];
+		if (isDirectory(path))
+		{
+			findTransientFrames(path, frames);
+		}
+		else if (entries[i].find("Transient_") == 0 && path.size() > 4 && path.compare(path.size() - 4, 4, ".bth") == 0)
+		{
+			frames.push_back(path);
+		}
+	}
+}
+
+bool loadTransientFrame(const std::string& filePath, TransientFrame& frame)
+{
+	std::ifstream file(filePath, std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	frame.data.resize((size_t)file.tellg());
+	file.seekg(0);
+	file.read((char*)frame.data.data(), frame.data.size());
+
+	if (!bow::TransientHistogram::ReadHeader(frame.data.data(), frame.data.size(), frame.width, frame.height, frame.bins, frame.binWidth))
+	{
+		return false;
+	}
+
+	frame.ambient.resize((size_t)frame.width * frame.height);
+	return bow::TransientHistogram::DecodeAmbient(frame.data.data(), frame.data.size(), frame.ambient.data());
+}
+
+enum class ModelType { Pulse, Rect, Sine };
+
+// One modulation of the sweep, its kernels start at firstKernel in the kernels of the sweep
+struct Demodulation
+{
+	std::string				name;
+	ModelType				model;
+	tof_modulation<double>	modulation;
+	unsigned int			firstKernel;
+};
+
+template <typename Model>
+void addDemodulation(const std::string& name, ModelType model, const tof_modulation<double>& modulation, const TransientFrame& frame, std::vector<Demodulation>& sweep, std::vector<float>& kernels)
+{
+	Demodulation demodulation;
+	demodulation.name = name;
+	demodulation.model = model;
+	demodulation.modulation = modulation;
+	demodulation.firstKernel = (unsigned int)(kernels.size() / frame.bins);
+	sweep.push_back(demodulation);
+
+	std::vector<double> kernel(Model::num_buckets * frame.bins);
+	transient_correlation_kernel<Model>(modulation, frame.bins, (double)frame.binWidth, kernel.data());
+	kernels.insert(kernels.end(), kernel.begin(), kernel.end());
+}
+
+// Range in millimeters of every pixel from the correlated buckets of the whole sweep
+template <typename Model>
+void computeRange(const TransientFrame& frame, const Demodulation& demodulation, const std::vector<float>& buckets, unsigned int numKernels, std::vector<unsigned short>& range)
+{
+	const int numPixels = (int)(frame.width * frame.height);
+	range.resize(numPixels);
+
+	#pragma omp parallel for
+	for (int pixel = 0; pixel < numPixels; pixel++)
+	{
+		const float* pixelKernels = &buckets[(size_t)pixel * numKernels + demodulation.firstKernel];
+
+		tof_buckets<Model, double> pixelBuckets;
+		for (int k = 0; k < Model::num_buckets; k++)
+		{
+			pixelBuckets.value[k] = pixelKernels[k];
+		}
+		tof_accumulate_ambient((double)frame.ambient[pixel], pixelBuckets);
+
+		double distance = tof_distance(demodulation.modulation, pixelBuckets) * 1000.0;
+		range[pixel] = (unsigned short)std::min(std::max(distance, 0.0), 65535.0);
+	}
+}
+
+void writeRangeFrame(const std::string& filePath, const std::vector<unsigned short>& range, unsigned int width, unsigned int height)
+{
+	std::vector<unsigned char> encoded;
+	bow::DepthCodec::Encode(range.data(), width, height, encoded);
+
+	std::ofstream file(filePath, std::ios::binary);
+	file.write((const char*)encoded.data(), encoded.size());
+}
+
+// Correlates the histograms with the kernels of every modulation in a single pass over the frame
+void runSweep(const TransientFrame& frame, const std::string& outputPath)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+	Clock::time_point start = Clock::now();
+
+	std::vector<Demodulation> sweep;
+	std::vector<float> kernels;
+	for (double frequency : g_frequencies)
+	{
+		const tof_modulation<double> modulation = tof_make_modulation(frequency);
+		const std::string megaHertz = std::to_string((int)(frequency * 1e-6)) + "MHz";
+		addDemodulation<tof_rect_model>("rect_" + megaHertz, ModelType::Rect, modulation, frame, sweep, kernels);
+		addDemodulation<tof_sine_model>("sin_" + megaHertz, ModelType::Sine, modulation, frame, sweep, kernels);
+	}
+	for (double pulseWidth : g_pulseWidths)
+	{
+		const tof_modulation<double> modulation = tof_make_pulse_modulation(pulseWidth);
+		addDemodulation<tof_pulse_model>("pulse_" + std::to_string((int)(pulseWidth * 1e9)) + "ns", ModelType::Pulse, modulation, frame, sweep, kernels);
+	}
+
+	const unsigned int numKernels = (unsigned int)(kernels.size() / frame.bins);
+	std::vector<float> buckets((size_t)frame.width * frame.height * numKernels);
+	bow::TransientHistogram::Correlate(frame.data.data(), frame.data.size(), kernels.data(), numKernels, buckets.data());
+
+	std::vector<std::vector<unsigned short>> ranges(sweep.size());
+	for (unsigned int i = 0; i < sweep.size(); i++)
+	{
+		if (sweep[i].model == ModelType::Pulse)
+			computeRange<tof_pulse_model>(frame, sweep[i], buckets, numKernels, ranges[i]);
+		else if (sweep[i].model == ModelType::Rect)
+			computeRange<tof_rect_model>(frame, sweep[i], buckets, numKernels, ranges[i]);
+		else
+			computeRange<tof_sine_model>(frame, sweep[i], buckets, numKernels, ranges[i]);
+	}
+
+	double milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	std::cout << std::fixed << std::setprecision(2) << sweep.size() << " modulations, " << numKernels << " kernels: "
+		<< milliseconds << " ms per frame, " << milliseconds / sweep.size() << " ms per modulation" << std::endl;
+
+	if (!outputPath.empty())
+	{
+		for (unsigned int i = 0; i < sweep.size(); i++)
+		{
+			writeRangeFrame(outputPath + "_" + sweep[i].name + ".bdc", ranges[i], frame.width, frame.height);
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	std::string recordingsFolderPath = "/Simulated_Recordings";
+	if (argc > 1)
+	{
+		recordingsFolderPath = argv[1];
+	}
+
+	// range frames of every modulation are only written if asked for, a sweep creates many files per histogram
+	bool writeRange = argc > 2 && std::string(argv[2]) == "--write";
+
+	std::vector<std::string> frameFiles;
+	findTransientFrames(recordingsFolderPath, frameFiles);
+	std::cout << "Found " << frameFiles.size() << " transient frames in " << recordingsFolderPath << std::endl;
+
+	if (frameFiles.empty())
+	{
+		std::cout << "Record with the transient output of 03_TimeOfFlightRendering enabled and pass the recordings folder as first argument." << std::endl;
+		return 0;
+	}
+
+	for (unsigned int i = 0; i < frameFiles.size(); i++)
+	{
+		TransientFrame frame;
+		if (!loadTransientFrame(frameFiles[i], frame))
+		{
+			std::cout << "Could not read " << frameFiles[i] << std::endl;
+			continue;
+		}
+
+		std::cout << frameFiles[i] << ": " << frame.width << " x " << frame.height << ", " << frame.bins << " bins of " << frame.binWidth * 100.0f << " cm" << std::endl;
+
+		std::string outputPath = writeRange ? frameFiles[i].substr(0, frameFiles[i].size() - 4) : std::string();
+		runSweep(frame, outputPath);
+	}
+	return 0;
+}
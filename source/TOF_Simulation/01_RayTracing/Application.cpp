@@ -265,7 +265,7 @@ void SimpleDirectionalLightApp::loadMesh(const std::string& filename, optix::Geo
 
 	const char *ptx = sutil::getPtxString("TimeOfFlightRendering/pathtracer.cu");
 
-	mesh.closest_hit = g_context->createProgramFromPTXString(ptx, "microfacet_closest_hit");
+	mesh.closest_hit = g_context->createProgramFromPTXString(ptx, "microfacet_closest_hit_sin");
 	mesh.any_hit = g_context->createProgramFromPTXString(ptx, "any_hit_shadow");
 
 	::loadMesh(filename, mesh, unitsPerMeter);
@@ -290,7 +290,7 @@ void SimpleDirectionalLightApp::createSphere1(optix::GeometryGroup geometry_grou
 
 	optix::Material mat = g_context->createMaterial();
 	ptx = sutil::getPtxString("TimeOfFlightRendering/pathtracer.cu");
-	mat->setClosestHitProgram(0u, g_context->createProgramFromPTXString(ptx, "microfacet_closest_hit"));
+	mat->setClosestHitProgram(0u, g_context->createProgramFromPTXString(ptx, "microfacet_closest_hit_sin"));
 	mat->setAnyHitProgram(1u, g_context->createProgramFromPTXString(ptx, "any_hit_shadow"));
 
 	float roughness = 0.01f;
@@ -328,7 +328,7 @@ void SimpleDirectionalLightApp::createSphere2(optix::GeometryGroup geometry_grou
 
 	optix::Material mat = g_context->createMaterial();
 	ptx = sutil::getPtxString("TimeOfFlightRendering/pathtracer.cu");
-	mat->setClosestHitProgram(0u, g_context->createProgramFromPTXString(ptx, "microfacet_closest_hit"));
+	mat->setClosestHitProgram(0u, g_context->createProgramFromPTXString(ptx, "microfacet_closest_hit_sin"));
 	mat->setAnyHitProgram(1u, g_context->createProgramFromPTXString(ptx, "any_hit_shadow"));
 
 	float roughness = 0.01f;
@@ -366,7 +366,7 @@ void SimpleDirectionalLightApp::createSphere3(optix::GeometryGroup geometry_grou
 
 	optix::Material mat = g_context->createMaterial();
 	ptx = sutil::getPtxString("TimeOfFlightRendering/pathtracer.cu");
-	mat->setClosestHitProgram(0u, g_context->createProgramFromPTXString(ptx, "microfacet_closest_hit"));
+	mat->setClosestHitProgram(0u, g_context->createProgramFromPTXString(ptx, "microfacet_closest_hit_sin"));
 	mat->setAnyHitProgram(1u, g_context->createProgramFromPTXString(ptx, "any_hit_shadow"));
 
 	float roughness = 0.01f;
@@ -6,15 +6,33 @@
 #include <Masterthesis/cuda_config.h>
 #include <optixu/optixu_math_stream_namespace.h>
 
+#include <Resources/Codecs/BowDepthCodec.h>
+#include <Resources/Codecs/BowTransientHistogram.h>
+
+#include <adaptive_sampling.h>
+#include <compact_storage.h>
+#include <progressive_accumulation.h>
+#include <light_sampling.h>
+
 #include <iostream>     // std::cout, std::endl
 #include <iomanip>      // std::setw
 #include <random>
 #include <mutex>
+#include <sstream>
+#include <vector>
 
 extern optix::Context g_context;
 
 const double speedOfLight = 299792458.0;
 const double frequency = 30000000.0; // 30 Mhz
+const unsigned int irLightSamples = 1; // ir lights selected per hit by their power, 0 traces a shadow ray to every ir light
+const float depthErrorThreshold = 0.002f; // standard error of the distance in meters a pixel needs to stop getting extra passes, 0 disables them
+const unsigned int maxAdaptivePasses = 16; // passes per frame including the one that renders every pixel
+const unsigned int minAdaptivePasses = 4; // passes a pixel gets before its error estimate is trusted
+const unsigned int transientBins = 256; // path length histogram bins per pixel while the transient output is enabled
+const float transientBinWidth = 0.04f; // path length per bin in meters, 256 bins cover 10.24 m
+const unsigned int bucketStorage = COMPACT_BUCKETS_HALF; // format the buckets are read back in, see compact_storage.h, COMPACT_BUCKETS_FLOAT maps float buffers
+const bool compactColor = true; // colour read back as 8 bit RGBA instead of float4
 
 struct BasicLight
 {
@@ -25,6 +43,19 @@ struct BasicLight
 	int    casts_shadow;
 };
 
+void updateIrLightAliasTable(const BasicLight* ir_lights, unsigned int count)
+{
+	std::vector<float> power(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		power[i] = ir_lights[i].intensity * optix::luminanceCIE(ir_lights[i].color);
+	}
+
+	optix::Buffer alias_table_buffer = g_context["ir_light_alias_table"]->getBuffer();
+	light_alias_build(power.data(), count, reinterpret_cast<light_alias_entry*>(alias_table_buffer->map()));
+	alias_table_buffer->unmap();
+}
+
 //------------------------------------------------------------------------------
 //
 //  Image Saving for Evaluation
@@ -35,6 +66,7 @@ std::mutex g_imageQueue_mutex;
 std::mutex g_irQueue_mutex;
 std::mutex g_depthQueue_mutex;
 std::mutex g_rangeQueue_mutex;
+std::mutex g_transientQueue_mutex;
 
 std::string g_outputFolder = "";
 std::string g_recordingsFolderPath = "/Simulated_Recordings";
@@ -80,6 +112,28 @@ bool directoryExists(const std::string& path)
 #endif
 }
 
+// Writes a 16 bit frame either lossless compressed (.bdc) or as raw dump (.bin)
+void writeDepthFrame(const std::string& fileNameWithoutExtension, const cv::Mat& frame, bool compress)
+{
+	cv::Mat continuousFrame = frame.isContinuous() ? frame : frame.clone();
+
+	if (compress)
+	{
+		std::vector<unsigned char> encoded;
+		bow::DepthCodec::Encode((const unsigned short*)continuousFrame.data, continuousFrame.cols, continuousFrame.rows, encoded);
+
+		FILE* pFile = fopen((fileNameWithoutExtension + ".bdc").c_str(), "wb");
+		fwrite(encoded.data(), 1, encoded.size(), pFile);
+		fclose(pFile);
+	}
+	else
+	{
+		FILE* pFile = fopen((fileNameWithoutExtension + ".bin").c_str(), "wb");
+		fwrite(&(continuousFrame.data[0]), sizeof(ushort), continuousFrame.cols * continuousFrame.rows, pFile);
+		fclose(pFile);
+	}
+}
+
 void ImageSavingThreadProc(image_save_thread_data *my_data)
 {
 	std::cout << "Starting Thread" << std::endl;
@@ -95,9 +149,17 @@ void ImageSavingThreadProc(image_save_thread_data *my_data)
 	unsigned int irCount = 1;
 	unsigned int rangeCount = 1;
 
-	while ((!my_data->stopThread || my_data->images.size() > 0 || my_data->depth.size() > 0 || my_data->ir.size() > 0 || my_data->range.size() > 0))
+	while ((!my_data->stopThread || my_data->images.size() > 0 || my_data->depth.size() > 0 || my_data->ir.size() > 0 || my_data->range.size() > 0 || my_data->transient.size() > 0))
 	{
-		my_data->busy = my_data->images.size() > 0 || my_data->depth.size() > 0 || my_data->ir.size() > 0 || my_data->range.size() > 0;
+		bool queuesEmpty = my_data->images.size() == 0 && my_data->depth.size() == 0 && my_data->ir.size() == 0 && my_data->range.size() == 0 && my_data->transient.size() == 0;
+		my_data->busy = !queuesEmpty || my_data->compressDeferred || my_data->encoderPool->IsBusy();
+
+		if (queuesEmpty && my_data->compressDeferred)
+		{
+			// recording has stopped and every raw frame was handed to the pool
+			my_data->encoderPool->CompressDeferred();
+			my_data->compressDeferred = false;
+		}
 
 		g_imageQueue_mutex.lock();
 		bool newImageData = false;
@@ -148,8 +210,8 @@ void ImageSavingThreadProc(image_save_thread_data *my_data)
 
 				imageCount++;
 
-				cv::cvtColor(temp_image.second, temp_image.second, CV_BGR2RGB);
-				cv::imwrite(fileName.c_str(), temp_image.second);
+				// compressed on the encoder pool, the stream swaps to RGB before encoding
+				my_data->encoderPool->Enqueue(my_data->imageStream, fileName, temp_image.second);
 			}
 		}
 
@@ -197,13 +259,10 @@ void ImageSavingThreadProc(image_save_thread_data *my_data)
 					fileName.append(std::to_string(0));
 
 				fileName.append(std::to_string(temp_depth.first));
-				fileName.append(".bin");
 
 				depthCount++;
 
-				FILE* pFile = fopen(fileName.c_str(), "wb");
-				fwrite(&(temp_depth.second.data[0]), sizeof(ushort), temp_depth.second.cols * temp_depth.second.rows, pFile);
-				fclose(pFile);
+				writeDepthFrame(fileName, temp_depth.second, my_data->compressDepth);
 			}
 		}
 
@@ -305,15 +364,33 @@ void ImageSavingThreadProc(image_save_thread_data *my_data)
 					fileName.append(std::to_string(0));
 
 				fileName.append(std::to_string(temp_range.first));
-				fileName.append(".bin");
 
 				rangeCount++;
 
-				FILE* pFile = fopen(fileName.c_str(), "wb");
-				fwrite(&(temp_range.second.data[0]), sizeof(ushort), temp_range.second.cols * temp_range.second.rows, pFile);
-				fclose(pFile);
+				writeDepthFrame(fileName, temp_range.second, my_data->compressDepth);
 			}
 		}
+
+		g_transientQueue_mutex.lock();
+		bool newTransientData = my_data->transient.size() > 0;
+		g_transientQueue_mutex.unlock();
+
+		if (newTransientData)
+		{
+			g_transientQueue_mutex.lock();
+			std::pair<long long, std::vector<unsigned char>> temp_transient;
+			temp_transient.first = my_data->transient.front().first;
+			temp_transient.second.swap(my_data->transient.front().second);
+			my_data->transient.pop();
+			g_transientQueue_mutex.unlock();
+
+			std::ostringstream fileName;
+			fileName << g_outputFolder << "/Transient_" << std::setw(13) << std::setfill('0') << temp_transient.first << ".bth";
+
+			FILE* pFile = fopen(fileName.str().c_str(), "wb");
+			fwrite(temp_transient.second.data(), 1, temp_transient.second.size(), pFile);
+			fclose(pFile);
+		}
 	}
 
 	std::cout << "Stopping Thread" << std::endl;
@@ -332,6 +409,8 @@ void ImageSavingThreadProc(image_save_thread_data *my_data)
 
 optix::Buffer getOutputBuffer()
 {
+	if (compactColor)
+		return g_context["output_compact_color"]->getBuffer();
 	return g_context["output_buffer"]->getBuffer();
 }
 
@@ -350,6 +429,23 @@ optix::Buffer getBucketBufferSin()
 	return g_context["output_buckets_sin"]->getBuffer();
 }
 
+// Converts the compact copy of the accumulated buckets to Model::num_buckets floats per pixel
+template <typename Model>
+void decodeCompactBuckets(float* buckets, unsigned int numPixels)
+{
+	optix::Buffer compact_buffer = g_context["output_compact_buckets"]->getBuffer();
+	const unsigned int* words = static_cast<const unsigned int*>(compact_buffer->map(0, RT_BUFFER_MAP_READ));
+	const unsigned int wordsPerPixel = compact_words_per_pixel<Model>(bucketStorage);
+	const float fixedScale = compact_default_fixed_scale();
+
+	#pragma omp parallel for
+	for (int pixel = 0; pixel < (int)numPixels; pixel++)
+	{
+		compact_load_buckets<Model>(bucketStorage, fixedScale, &words[pixel * wordsPerPixel], &buckets[pixel * Model::num_buckets]);
+	}
+	compact_buffer->unmap();
+}
+
 struct UsageReportLogger
 {
 	void log(int lvl, const char* tag, const char* msg)
@@ -374,7 +470,7 @@ void usageReportCallback(int lvl, const char* tag, const char* msg, void* cbdata
 // ======================================================================
 
 
-Time_of_Flight_App::Time_of_Flight_App() : m_logger(nullptr), m_usage_report_level(0), m_camera(nullptr), m_noise_enabled(false), m_lens_scattering_enabled(true), m_save_data(false), recording_pressed(false), enable_lens_scattering_pressed(false), enable_noise_pressed(false)
+Time_of_Flight_App::Time_of_Flight_App(const bow::RenderingConfigs& configs) : m_logger(nullptr), m_usage_report_level(0), m_camera(nullptr), m_noise_enabled(false), m_lens_scattering_enabled(true), m_save_data(false), m_transient_enabled(false), recording_pressed(false), enable_lens_scattering_pressed(false), enable_noise_pressed(false), enable_transient_pressed(false), m_measure_encoder(false), measure_encoder_pressed(false), m_encoderPool(nullptr), m_framePool(nullptr)
 {
 	m_logger = new UsageReportLogger();
 
@@ -396,8 +492,19 @@ Time_of_Flight_App::Time_of_Flight_App() : m_logger(nullptr), m_usage_report_lev
 		}
 	}
 
+	bow::FrameEncoderSettings encoderSettings;
+	encoderSettings.numWorkers = configs.recording_encoder_threads;
+	encoderSettings.compressionLevel = configs.recording_png_compression;
+	encoderSettings.strategy = (bow::PngStrategy)configs.recording_png_strategy;
+	encoderSettings.deferCompression = configs.recording_defer_compression;
+	m_encoderPool = new bow::FrameEncoderPool(encoderSettings);
+
 	m_threadData.stopThread = false;
 	m_threadData.savingRunning = false;
+	m_threadData.compressDeferred = false;
+	m_threadData.compressDepth = configs.recording_compress_depth;
+	m_threadData.encoderPool = m_encoderPool;
+	m_threadData.imageStream = m_encoderPool->CreateStream("Image", true);
 	m_imageSavingThread = std::thread([this](){ ImageSavingThreadProc(&m_threadData); });
 }
 
@@ -431,6 +538,14 @@ Time_of_Flight_App::~Time_of_Flight_App()
 	}
 
 	m_imageSavingThread.join();
+
+	std::cout << "Waiting for encoder pool to finish..." << std::endl;
+	delete m_encoderPool;
+	m_encoderPool = nullptr;
+
+	// after the encoders, they still reference frames of the pool
+	delete m_framePool;
+	m_framePool = nullptr;
 }
 
 // ======================================================================
@@ -441,6 +556,11 @@ void Time_of_Flight_App::OnInit(bow::IntrinsicCameraParameters cameraParameters)
 	m_width = cameraParameters.image_width;
 	m_height = cameraParameters.image_height;
 
+	// intermediates of OnRender, recycled once the recording queues and encoders are done with them
+	m_framePool = new bow::FrameBufferPool(m_width, m_height);
+	m_framePool->Reserve(CV_32FC1, 2);
+	m_framePool->Reserve(CV_32FC4, bucketStorage == COMPACT_BUCKETS_FLOAT ? 1 : 2);
+
 	createContext(m_usage_report_level, m_logger);
 
 	optix::GeometryGroup geometry_group = g_context->createGeometryGroup();
@@ -560,17 +680,17 @@ void Time_of_Flight_App::OnUpdate(double deltaTime)
 
 	if (m_keyboard->VIsPressed(bow::Key::K_KP_1))
 	{
-		m_use_model = 0;
+		setModulationModel(0);
 	}
 
 	if (m_keyboard->VIsPressed(bow::Key::K_KP_2))
 	{
-		m_use_model = 1;
+		setModulationModel(1);
 	}
 
 	if (m_keyboard->VIsPressed(bow::Key::K_KP_3))
 	{
-		m_use_model = 2;
+		setModulationModel(2);
 	}
 
 	if (m_keyboard->VIsPressed(bow::Key::K_R))
@@ -590,6 +710,7 @@ void Time_of_Flight_App::OnUpdate(double deltaTime)
 					}
 					g_outputFolder = g_recordingsFolderPath + "/" + std::string("Run_") + std::to_string(c);
 
+					m_encoderPool->ResetStatistics();
 					m_save_data = true;
 					std::cout << "Recording started!" << std::endl;
 				}
@@ -602,6 +723,13 @@ void Time_of_Flight_App::OnUpdate(double deltaTime)
 			{
 				m_save_data = false;
 				std::cout << "Recording stopped!" << std::endl;
+
+				m_encoderPool->PrintStatistics();
+				std::cout << "Frame buffers: " << m_framePool->GetNumAllocations() << " allocated, " << m_framePool->GetNumReuses() << " reused" << std::endl;
+				if (m_encoderPool->GetSettings().deferCompression)
+				{
+					m_threadData.compressDeferred = true;
+				}
 			}
 		}
 	}
@@ -611,6 +739,19 @@ void Time_of_Flight_App::OnUpdate(double deltaTime)
 	}
 
 
+	if (m_keyboard->VIsPressed(bow::Key::K_B))
+	{
+		if (!measure_encoder_pressed)
+		{
+			measure_encoder_pressed = true;
+			m_measure_encoder = true;
+		}
+	}
+	else
+	{
+		measure_encoder_pressed = false;
+	}
+
 	if (m_keyboard->VIsPressed(bow::Key::K_T))
 	{
 		if (!enable_lens_scattering_pressed)
@@ -655,6 +796,20 @@ void Time_of_Flight_App::OnUpdate(double deltaTime)
 		enable_noise_pressed = false;
 	}
 
+	if (m_keyboard->VIsPressed(bow::Key::K_H))
+	{
+		if (!enable_transient_pressed)
+		{
+			enable_transient_pressed = true;
+			setTransientOutput(!m_transient_enabled);
+			std::cout << (m_transient_enabled ? "Transient histograms enabled!" : "Transient histograms disabled!") << std::endl;
+		}
+	}
+	else
+	{
+		enable_transient_pressed = false;
+	}
+
 
 	if (m_mouse->VIsPressed(bow::MouseButton::MOFS_BUTTON1))
 	{
@@ -692,10 +847,30 @@ uchar clamp(float value)
 
 std::default_random_engine g_generator;
 
+void Time_of_Flight_App::queueRecordedImage(long long seconds, const cv::Mat& imageMat)
+{
+	if (m_measure_encoder)
+	{
+		m_measure_encoder = false;
+		bow::FrameEncoderPool::MeasureThroughput(imageMat, 60, m_encoderPool->GetSettings());
+	}
+
+	if (m_save_data)
+	{
+		g_imageQueue_mutex.lock();
+		m_threadData.images.push(std::pair<long long, cv::Mat>(seconds, imageMat));
+		g_imageQueue_mutex.unlock();
+	}
+}
+
 void Time_of_Flight_App::OnRender()
 {
 	long long seconds = clock();
-	g_context->launch(0, m_width, m_height);
+	launchPasses();
+	if (m_save_data && m_transient_enabled)
+	{
+		queueTransientFrame(seconds);
+	}
 	{
 		optix::Buffer image_buffer = getOutputBuffer();
 
@@ -709,67 +884,59 @@ void Time_of_Flight_App::OnRender()
 
 		if (buffer_format == RT_FORMAT_FLOAT3)
 		{
-			if (m_save_data)
+			if (m_save_data || m_measure_encoder)
 			{
-				cv::Mat imageMat = cv::Mat(image_height, image_width, CV_8UC3);
+				cv::Mat imageMat = m_framePool->Acquire(image_height, image_width, CV_8UC3);
 				for (unsigned int launch_index = 0; launch_index < image_width * image_height; launch_index++)
 				{
 					imageMat.at<cv::Vec3b>(launch_index) = cv::Vec3b(clamp(((float*)imageData)[launch_index * 3] * 255.0f), clamp(((float*)imageData)[launch_index * 3 + 1] * 255.0f), clamp(((float*)imageData)[launch_index * 3 + 2] * 255.0f));
 				}
 
-				g_imageQueue_mutex.lock();
-				m_threadData.images.push(std::pair<long long, cv::Mat>(seconds, imageMat.clone()));
-				g_imageQueue_mutex.unlock();
+				queueRecordedImage(seconds, imageMat);
 			}
 			UpdateColorBuffer(imageData, image_width, image_height, bow::ImageFormat::RedGreenBlue, bow::ImageDatatype::Float);
 		}
 		else if (buffer_format == RT_FORMAT_FLOAT4)
 		{
-			if (m_save_data)
+			if (m_save_data || m_measure_encoder)
 			{
-				cv::Mat imageMat = cv::Mat(image_height, image_width, CV_8UC3);
+				cv::Mat imageMat = m_framePool->Acquire(image_height, image_width, CV_8UC3);
 				#pragma parallel for
 				for (unsigned int launch_index = 0; launch_index < image_width * image_height; launch_index++)
 				{
 					imageMat.at<cv::Vec3b>(launch_index) = cv::Vec3b(clamp(((float*)imageData)[launch_index * 4] * 255.0f), clamp(((float*)imageData)[launch_index * 4 + 1] * 255.0f), clamp(((float*)imageData)[launch_index * 4 + 2] * 255.0f));
 				}
 
-				g_imageQueue_mutex.lock();
-				m_threadData.images.push(std::pair<long long, cv::Mat>(seconds, imageMat.clone()));
-				g_imageQueue_mutex.unlock();
+				queueRecordedImage(seconds, imageMat);
 			}
 			UpdateColorBuffer(imageData, image_width, image_height, bow::ImageFormat::RedGreenBlueAlpha, bow::ImageDatatype::Float);
 		}
 		else if (buffer_format == RT_FORMAT_UNSIGNED_BYTE3)
 		{
-			if (m_save_data)
+			if (m_save_data || m_measure_encoder)
 			{
-				cv::Mat imageMat = cv::Mat(image_height, image_width, CV_8UC3);
+				cv::Mat imageMat = m_framePool->Acquire(image_height, image_width, CV_8UC3);
 				#pragma omp parallel for
 				for (int launch_index = 0; launch_index < image_width * image_height; launch_index++)
 				{
 					imageMat.at<cv::Vec3b>(launch_index) = cv::Vec3b((uchar)((uchar*)imageData)[launch_index * 3], (uchar)((uchar*)imageData)[launch_index * 3 + 1], (uchar)((uchar*)imageData)[launch_index * 3 + 2]);
 				}
 
-				g_imageQueue_mutex.lock();
-				m_threadData.images.push(std::pair<long long, cv::Mat>(seconds, imageMat.clone()));
-				g_imageQueue_mutex.unlock();
+				queueRecordedImage(seconds, imageMat);
 			}
 			UpdateColorBuffer(imageData, image_width, image_height, bow::ImageFormat::RedGreenBlue, bow::ImageDatatype::UnsignedByte);
 		}
 		else if (buffer_format == RT_FORMAT_UNSIGNED_BYTE4)
 		{
-			if (m_save_data)
+			if (m_save_data || m_measure_encoder)
 			{
-				cv::Mat imageMat = cv::Mat(image_height, image_width, CV_8UC3);
+				cv::Mat imageMat = m_framePool->Acquire(image_height, image_width, CV_8UC3);
 				#pragma omp parallel for
 				for (int launch_index = 0; launch_index < image_width * image_height; launch_index++)
 				{
 					imageMat.at<cv::Vec3b>(launch_index) = cv::Vec3b((uchar)((uchar*)imageData)[launch_index * 4], (uchar)((uchar*)imageData)[launch_index * 4 + 1], (uchar)((uchar*)imageData)[launch_index * 4 + 2]);
 				}
-				g_imageQueue_mutex.lock();
-				m_threadData.images.push(std::pair<long long, cv::Mat>(seconds, imageMat.clone()));
-				g_imageQueue_mutex.unlock();
+				queueRecordedImage(seconds, imageMat);
 			}
 			UpdateColorBuffer(imageData, image_width, image_height, bow::ImageFormat::RedGreenBlueAlpha, bow::ImageDatatype::UnsignedByte);
 		}
@@ -801,7 +968,28 @@ void Time_of_Flight_App::OnRender()
 		uint32_t image_width = static_cast<int>(buffer_width_rts);
 		uint32_t image_height = static_cast<int>(buffer_height_rts);
 		RTformat buffer_format = bucket_buffer->getFormat();
-		void* imageData = bucket_buffer->map(0, RT_BUFFER_MAP_READ);
+
+		// with compact storage only the compact copy of the buckets is written, it is converted back to float
+		cv::Mat decodedBuckets;
+		void* imageData = nullptr;
+		if (bucketStorage == COMPACT_BUCKETS_FLOAT)
+		{
+			imageData = bucket_buffer->map(0, RT_BUFFER_MAP_READ);
+		}
+		else
+		{
+			decodedBuckets = m_framePool->Acquire(image_height, image_width, buffer_format == RT_FORMAT_FLOAT4 ? CV_32FC4 : CV_32FC2);
+			if (m_use_model == 0)
+			{
+				decodeCompactBuckets<tof_pulse_model>((float*)decodedBuckets.data, image_width * image_height);
+			}
+			else
+			{
+				// rect and sin store their four buckets the same way
+				decodeCompactBuckets<tof_rect_model>((float*)decodedBuckets.data, image_width * image_height);
+			}
+			imageData = decodedBuckets.data;
+		}
 
 		//cv::Mat_<uchar> phaseImage_C1 = cv::Mat_<uchar>(image_height, image_width);
 		//cv::Mat_<uchar> phaseImage_C2 = cv::Mat_<uchar>(image_height, image_width);
@@ -811,12 +999,15 @@ void Time_of_Flight_App::OnRender()
 		if (buffer_format == RT_FORMAT_FLOAT4)
 		{
 			float* output_buckets = (float*)imageData;
-			float* output_intensity = new float[image_width * image_height];
-			float* output_depth = new float[image_width * image_height];
+			cv::Mat intensityMat = m_framePool->Acquire(image_height, image_width, CV_32FC1);
+			cv::Mat depthMat = m_framePool->Acquire(image_height, image_width, CV_32FC1);
+			float* output_intensity = (float*)intensityMat.data;
+			float* output_depth = (float*)depthMat.data;
 
 			if (m_lens_scattering_enabled)
 			{
-				float* scattered_output_buckets = new float[image_width * image_height * 4];
+				cv::Mat scatteredMat = m_framePool->Acquire(image_height, image_width, CV_32FC4);
+				float* scattered_output_buckets = (float*)scatteredMat.data;
 				memset(scattered_output_buckets, 0, sizeof(float) * image_width * image_height * 4);
 				for (int row = 0; row < image_height; row++)
 				{
@@ -862,8 +1053,6 @@ void Time_of_Flight_App::OnRender()
 						}
 					}
 				}
-
-				delete[] scattered_output_buckets;
 			}
 
 			float maxDistanceInMeter = (speedOfLight / (2.0 * frequency));
@@ -946,7 +1135,7 @@ void Time_of_Flight_App::OnRender()
 
 			if (m_save_data)
 			{
-				cv::Mat irMat = cv::Mat(image_height, image_width, CV_16UC1);
+				cv::Mat irMat = m_framePool->Acquire(image_height, image_width, CV_16UC1);
 				
 				#pragma omp parallel for
 				for (int launch_index = 0; launch_index < image_width * image_height; launch_index++)
@@ -954,10 +1143,10 @@ void Time_of_Flight_App::OnRender()
 					irMat.at<unsigned short>(launch_index) = (unsigned short)(output_intensity[launch_index]);
 				}
 				g_irQueue_mutex.lock();
-				m_threadData.ir.push(std::pair<long long, cv::Mat>(seconds, irMat.clone()));
+				m_threadData.ir.push(std::pair<long long, cv::Mat>(seconds, irMat));
 				g_irQueue_mutex.unlock();
 
-				cv::Mat rangeMat = cv::Mat(image_height, image_width, CV_16UC1);
+				cv::Mat rangeMat = m_framePool->Acquire(image_height, image_width, CV_16UC1);
 				
 				#pragma omp parallel for
 				for (int launch_index = 0; launch_index < image_width * image_height; launch_index++)
@@ -966,21 +1155,20 @@ void Time_of_Flight_App::OnRender()
 					rangeMat.at<unsigned short>(launch_index) = range_value;
 				}
 				g_depthQueue_mutex.lock();
-				m_threadData.range.push(std::pair<long long, cv::Mat>(seconds, rangeMat.clone()));
+				m_threadData.range.push(std::pair<long long, cv::Mat>(seconds, rangeMat));
 				g_depthQueue_mutex.unlock();
 			}
 
 			UpdateIRBuffer(output_intensity, image_width, image_height, bow::ImageFormat::Red, bow::ImageDatatype::Float);
 			UpdateDepthBuffer(output_depth, maxDistanceInMeter * 1000.0f, image_width, image_height, bow::ImageFormat::Red, bow::ImageDatatype::Float);
-
-			delete[] output_depth;
-			delete[] output_intensity;
 		}
 		else if (buffer_format == RT_FORMAT_FLOAT2)
 		{
 			float* output_buckets = (float*)imageData;
-			float* output_depth = new float[image_width * image_height];
-			float* output_intensity = new float[image_width * image_height];
+			cv::Mat depthMat = m_framePool->Acquire(image_height, image_width, CV_32FC1);
+			cv::Mat intensityMat = m_framePool->Acquire(image_height, image_width, CV_32FC1);
+			float* output_depth = (float*)depthMat.data;
+			float* output_intensity = (float*)intensityMat.data;
 
 			const double pulselength = (1.0 / frequency) * 0.5f;
 			float maxDistanceInMeter = ((speedOfLight * pulselength) * 0.5f);
@@ -1020,17 +1208,17 @@ void Time_of_Flight_App::OnRender()
 
 			if (m_save_data)
 			{
-				cv::Mat irMat = cv::Mat(image_height, image_width, CV_16UC1);
+				cv::Mat irMat = m_framePool->Acquire(image_height, image_width, CV_16UC1);
 				#pragma omp parallel for
 				for (int launch_index = 0; launch_index < image_width * image_height; launch_index++)
 				{
 					irMat.at<unsigned short>(launch_index) = (unsigned short)(output_intensity[launch_index]);
 				}
 				g_irQueue_mutex.lock();
-				m_threadData.ir.push(std::pair<long long, cv::Mat>(seconds, irMat.clone()));
+				m_threadData.ir.push(std::pair<long long, cv::Mat>(seconds, irMat));
 				g_irQueue_mutex.unlock();
 
-				cv::Mat rangeMat = cv::Mat(image_height, image_width, CV_16UC1);
+				cv::Mat rangeMat = m_framePool->Acquire(image_height, image_width, CV_16UC1);
 				#pragma omp parallel for
 				for (int launch_index = 0; launch_index < image_width * image_height; launch_index++)
 				{
@@ -1038,21 +1226,22 @@ void Time_of_Flight_App::OnRender()
 					rangeMat.at<unsigned short>(launch_index) = range_value;
 				}
 				g_depthQueue_mutex.lock();
-				m_threadData.range.push(std::pair<long long, cv::Mat>(seconds, rangeMat.clone()));
+				m_threadData.range.push(std::pair<long long, cv::Mat>(seconds, rangeMat));
 				g_depthQueue_mutex.unlock();
 			}
 
 			UpdateIRBuffer(output_intensity, image_width, image_height, bow::ImageFormat::Red, bow::ImageDatatype::Float);
 			UpdateDepthBuffer(output_depth, maxDistanceInMeter * 1000.0f, image_width, image_height, bow::ImageFormat::Red, bow::ImageDatatype::Float);
-
-			delete[] output_depth;
-			delete[] output_intensity;
 		}
 		else
 		{
 			throw optix::Exception("Unknown Buffer Format!");
 		}
-		bucket_buffer->unmap();
+
+		if (bucketStorage == COMPACT_BUCKETS_FLOAT)
+		{
+			bucket_buffer->unmap();
+		}
 
 		//cv::imwrite("phase_C1.png", phaseImage_C1);
 		//cv::imwrite("phase_C2.png", phaseImage_C2);
@@ -1094,6 +1283,16 @@ void Time_of_Flight_App::createContext(int usage_report_level, UsageReportLogger
 	g_context["rr_begin_depth"]->setUint(3);
 	g_context["max_depth"]->setUint(8);
 	g_context["frequency"]->setFloat((float)frequency);
+	g_context["ir_light_samples"]->setUint(irLightSamples);
+	g_context["depth_error_threshold"]->setFloat(depthErrorThreshold);
+	g_context["min_passes"]->setUint(minAdaptivePasses);
+
+	// compensated sums of all passes, the output buffers hold their mean
+	optix::Buffer accumulation = g_context->createBuffer(RT_BUFFER_INPUT_OUTPUT | RT_BUFFER_GPU_LOCAL);
+	accumulation->setFormat(RT_FORMAT_USER);
+	accumulation->setElementSize(sizeof(progressive_pixel));
+	accumulation->setSize(m_width, m_height);
+	g_context["pixel_accumulation"]->set(accumulation);
 
 	optix::Buffer buffer = sutil::createOutputBuffer(g_context, RT_FORMAT_FLOAT4, m_width, m_height);
 	g_context["output_buffer"]->set(buffer);
@@ -1107,10 +1306,47 @@ void Time_of_Flight_App::createContext(int usage_report_level, UsageReportLogger
 	optix::Buffer buckets_sin = sutil::createOutputBuffer(g_context, RT_FORMAT_FLOAT4, m_width, m_height);
 	g_context["output_buckets_sin"]->set(buckets_sin);
 
-	// Ray generation program
+	// copies of the accumulated pixels the host maps every frame, sized once they are used
+	optix::Buffer compact_color = sutil::createOutputBuffer(g_context, RT_FORMAT_UNSIGNED_BYTE4, compactColor ? m_width : 1, compactColor ? m_height : 1);
+	g_context["output_compact_color"]->set(compact_color);
+	g_context["compact_color"]->setUint(compactColor ? 1u : 0u);
+
+	optix::Buffer compact_buckets = g_context->createBuffer(RT_BUFFER_OUTPUT, RT_FORMAT_UNSIGNED_INT, 1, 1, 1);
+	g_context["output_compact_buckets"]->set(compact_buckets);
+	g_context["bucket_storage"]->setUint(bucketStorage);
+	g_context["bucket_fixed_scale"]->setFloat(compact_default_fixed_scale());
+	resizeCompactBuckets();
+
+	// read back for the sample counts of the transient histograms
+	optix::Buffer statistics = g_context->createBuffer(RT_BUFFER_INPUT_OUTPUT);
+	statistics->setFormat(RT_FORMAT_USER);
+	statistics->setElementSize(sizeof(adaptive_statistics));
+	statistics->setSize(m_width, m_height);
+	g_context["pixel_statistics"]->set(statistics);
+
+	optix::Buffer unconverged_pixels = g_context->createBuffer(RT_BUFFER_INPUT_OUTPUT, RT_FORMAT_UNSIGNED_INT, 1);
+	g_context["unconverged_pixels"]->set(unconverged_pixels);
+
+	// the transient histograms get their size once they are enabled
+	optix::Buffer transient = g_context->createBuffer(RT_BUFFER_INPUT_OUTPUT, RT_FORMAT_FLOAT, 1, 1, 1);
+	g_context["output_transient"]->set(transient);
+
+	optix::Buffer transient_ambient = g_context->createBuffer(RT_BUFFER_INPUT_OUTPUT, RT_FORMAT_FLOAT, 1, 1);
+	g_context["output_transient_ambient"]->set(transient_ambient);
+
+	g_context["transient_bins"]->setUint(0u);
+	g_context["transient_bin_width"]->setFloat(transientBinWidth);
+
+	// Ray generation, miss and closest hit programs of every modulation model
 	const char *ptx = sutil::getPtxString("TimeOfFlightRendering/pathtracer.cu");
-	optix::Program ray_gen_program = g_context->createProgramFromPTXString(ptx, "pathtrace_camera");
-	g_context->setRayGenerationProgram(0, ray_gen_program);
+	const std::string modelSuffixes[3] = { "_pulse", "_rect", "_sin" };
+	for (unsigned int model = 0; model < 3; model++)
+	{
+		m_ray_gen_programs[model] = g_context->createProgramFromPTXString(ptx, "pathtrace_camera" + modelSuffixes[model]);
+		m_miss_programs[model] = g_context->createProgramFromPTXString(ptx, "envmap_miss" + modelSuffixes[model]);
+		m_closest_hit_programs[model] = g_context->createProgramFromPTXString(ptx, "microfacet_closest_hit" + modelSuffixes[model]);
+	}
+	g_context->setRayGenerationProgram(0, m_ray_gen_programs[m_use_model]);
 
 	// Exception program
 	optix::Program exception_program = g_context->createProgramFromPTXString(ptx, "exception");
@@ -1118,12 +1354,115 @@ void Time_of_Flight_App::createContext(int usage_report_level, UsageReportLogger
 	g_context["bad_color"]->setFloat(1000000.0f, 0.0f, 1000000.0f); // Super magenta to make sure it doesn't get
 
 	// Miss program
-	optix::Program miss_program = g_context->createProgramFromPTXString(ptx, "envmap_miss");
-	g_context->setMissProgram(0, miss_program);
+	g_context->setMissProgram(0, m_miss_programs[m_use_model]);
 	g_context["bg_color"]->setFloat(optix::make_float3(m_ambientSunLightIntensity));
 	g_context["envmap"]->setTextureSampler(sutil::loadTexture(g_context, std::string(PROJECT_BASE_DIR) + std::string("/data/CedarCity.hdr"), optix::make_float3(m_ambientSunLightIntensity)));
 }
 
+// The first pass renders every pixel, the following ones only the pixels whose distance is not within depthErrorThreshold yet
+void Time_of_Flight_App::launchPasses()
+{
+	optix::Buffer unconverged_buffer = g_context["unconverged_pixels"]->getBuffer();
+
+	for (unsigned int pass = 0; pass < maxAdaptivePasses; pass++)
+	{
+		*static_cast<unsigned int*>(unconverged_buffer->map()) = 0;
+		unconverged_buffer->unmap();
+
+		g_context["adaptive_pass"]->setUint(pass);
+		g_context->launch(0, m_width, m_height);
+
+		if (depthErrorThreshold <= 0.0f)
+			break;
+
+		unsigned int unconverged_pixels = *static_cast<unsigned int*>(unconverged_buffer->map());
+		unconverged_buffer->unmap();
+
+		if (unconverged_pixels == 0)
+			break;
+	}
+}
+
+// The histograms hold transientBins floats per pixel, so they are only allocated while the output is enabled
+void Time_of_Flight_App::setTransientOutput(bool enabled)
+{
+	m_transient_enabled = enabled;
+
+	if (enabled)
+	{
+		g_context["output_transient"]->getBuffer()->setSize(transientBins, m_width, m_height);
+		g_context["output_transient_ambient"]->getBuffer()->setSize(m_width, m_height);
+	}
+	else
+	{
+		g_context["output_transient"]->getBuffer()->setSize(1, 1, 1);
+		g_context["output_transient_ambient"]->getBuffer()->setSize(1, 1);
+	}
+	g_context["transient_bins"]->setUint(enabled ? transientBins : 0u);
+
+	// the histograms start with the next accumulation
+	m_camera_changed = true;
+}
+
+// Stores the mean histogram of every pixel, the buffers hold the sums over all samples of the pixel
+void Time_of_Flight_App::queueTransientFrame(long long seconds)
+{
+	optix::Buffer transient_buffer = g_context["output_transient"]->getBuffer();
+	optix::Buffer transient_ambient_buffer = g_context["output_transient_ambient"]->getBuffer();
+	optix::Buffer statistics_buffer = g_context["pixel_statistics"]->getBuffer();
+
+	const adaptive_statistics* statistics = static_cast<const adaptive_statistics*>(statistics_buffer->map(0, RT_BUFFER_MAP_READ));
+	std::vector<float> weights(m_width * m_height);
+	for (unsigned int pixel = 0; pixel < m_width * m_height; pixel++)
+	{
+		weights[pixel] = statistics[pixel].samples > 0.0f ? 1.0f / statistics[pixel].samples : 0.0f;
+	}
+	statistics_buffer->unmap();
+
+	std::vector<unsigned char> encoded;
+	bow::TransientHistogram::Encode(static_cast<const float*>(transient_buffer->map(0, RT_BUFFER_MAP_READ)), static_cast<const float*>(transient_ambient_buffer->map(0, RT_BUFFER_MAP_READ)),
+		m_width, m_height, transientBins, transientBinWidth, encoded, weights.data());
+	transient_ambient_buffer->unmap();
+	transient_buffer->unmap();
+
+	g_transientQueue_mutex.lock();
+	m_threadData.transient.push(std::pair<long long, std::vector<unsigned char>>(seconds, std::vector<unsigned char>()));
+	m_threadData.transient.back().second.swap(encoded);
+	g_transientQueue_mutex.unlock();
+}
+
+void Time_of_Flight_App::setModulationModel(unsigned int model)
+{
+	if (model == m_use_model)
+		return;
+
+	m_use_model = model;
+
+	g_context->setRayGenerationProgram(0, m_ray_gen_programs[m_use_model]);
+	g_context->setMissProgram(0, m_miss_programs[m_use_model]);
+	for (unsigned int i = 0; i < m_materials.size(); i++)
+	{
+		m_materials[i]->setClosestHitProgram(0u, m_closest_hit_programs[m_use_model]);
+	}
+
+	resizeCompactBuckets();
+
+	// the buckets of the new model have not been accumulated yet
+	m_camera_changed = true;
+}
+
+// The compact copy holds the words of the buckets of the current model
+void Time_of_Flight_App::resizeCompactBuckets()
+{
+	const unsigned int wordsPerPixel = m_use_model == 0 ? compact_words_per_pixel<tof_pulse_model>(bucketStorage) : compact_words_per_pixel<tof_rect_model>(bucketStorage);
+
+	optix::Buffer compact_buckets = g_context["output_compact_buckets"]->getBuffer();
+	if (wordsPerPixel > 0)
+		compact_buckets->setSize(wordsPerPixel, m_width, m_height);
+	else
+		compact_buckets->setSize(1, 1, 1);
+}
+
 void Time_of_Flight_App::loadMesh(const std::string& filename, optix::GeometryGroup geometry_group, float unitsPerMeter)
 {
 	OptiXMesh mesh;
@@ -1131,11 +1470,16 @@ void Time_of_Flight_App::loadMesh(const std::string& filename, optix::GeometryGr
 
 	const char *ptx = sutil::getPtxString("TimeOfFlightRendering/pathtracer.cu");
 
-	mesh.closest_hit = g_context->createProgramFromPTXString(ptx, "microfacet_closest_hit");
+	mesh.closest_hit = m_closest_hit_programs[m_use_model];
 	mesh.any_hit = g_context->createProgramFromPTXString(ptx, "any_hit_shadow");
 
 	::loadMesh(filename, mesh, unitsPerMeter);
 
+	for (unsigned int i = 0; i < mesh.geom_instance->getMaterialCount(); i++)
+	{
+		m_materials.push_back(mesh.geom_instance->getMaterial(i));
+	}
+
 	m_aabb.set(mesh.bbox_min, mesh.bbox_max);
 
 	geometry_group->addChild(mesh.geom_instance);
@@ -1157,8 +1501,9 @@ void Time_of_Flight_App::createSphere0(optix::GeometryGroup geometry_group)
 
 	optix::Material mat = g_context->createMaterial();
 	ptx = sutil::getPtxString("TimeOfFlightRendering/pathtracer.cu");
-	mat->setClosestHitProgram(0u, g_context->createProgramFromPTXString(ptx, "microfacet_closest_hit"));
+	mat->setClosestHitProgram(0u, m_closest_hit_programs[m_use_model]);
 	mat->setAnyHitProgram(1u, g_context->createProgramFromPTXString(ptx, "any_hit_shadow"));
+	m_materials.push_back(mat);
 
 	float roughness = 0.0f;
 	float metallic = 1.0f;
@@ -1197,8 +1542,9 @@ void Time_of_Flight_App::createSphere1(optix::GeometryGroup geometry_group)
 
 	optix::Material mat = g_context->createMaterial();
 	ptx = sutil::getPtxString("TimeOfFlightRendering/pathtracer.cu");
-	mat->setClosestHitProgram(0u, g_context->createProgramFromPTXString(ptx, "microfacet_closest_hit"));
+	mat->setClosestHitProgram(0u, m_closest_hit_programs[m_use_model]);
 	mat->setAnyHitProgram(1u, g_context->createProgramFromPTXString(ptx, "any_hit_shadow"));
+	m_materials.push_back(mat);
 
 	float roughness = 0.0f;
 	float metallic = 1.0f;
@@ -1237,8 +1583,9 @@ void Time_of_Flight_App::createSphere2(optix::GeometryGroup geometry_group)
 
 	optix::Material mat = g_context->createMaterial();
 	ptx = sutil::getPtxString("TimeOfFlightRendering/pathtracer.cu");
-	mat->setClosestHitProgram(0u, g_context->createProgramFromPTXString(ptx, "microfacet_closest_hit"));
+	mat->setClosestHitProgram(0u, m_closest_hit_programs[m_use_model]);
 	mat->setAnyHitProgram(1u, g_context->createProgramFromPTXString(ptx, "any_hit_shadow"));
+	m_materials.push_back(mat);
 
 	float roughness = 0.0f;
 	float metallic = 0.0f;
@@ -1276,8 +1623,9 @@ void Time_of_Flight_App::createSphere3(optix::GeometryGroup geometry_group)
 
 	optix::Material mat = g_context->createMaterial();
 	ptx = sutil::getPtxString("TimeOfFlightRendering/pathtracer.cu");
-	mat->setClosestHitProgram(0u, g_context->createProgramFromPTXString(ptx, "microfacet_closest_hit"));
+	mat->setClosestHitProgram(0u, m_closest_hit_programs[m_use_model]);
 	mat->setAnyHitProgram(1u, g_context->createProgramFromPTXString(ptx, "any_hit_shadow"));
+	m_materials.push_back(mat);
 
 	float roughness = 0.0f;
 	float metallic = 0.0f;
@@ -1365,6 +1713,14 @@ void Time_of_Flight_App::setupLights()
 	ir_light_buffer->unmap();
 
 	g_context["ir_lights"]->set(ir_light_buffer);
+
+	optix::Buffer alias_table_buffer = g_context->createBuffer(RT_BUFFER_INPUT);
+	alias_table_buffer->setFormat(RT_FORMAT_USER);
+	alias_table_buffer->setElementSize(sizeof(light_alias_entry));
+	alias_table_buffer->setSize(sizeof(ir_lights) / sizeof(ir_lights[0]));
+	g_context["ir_light_alias_table"]->set(alias_table_buffer);
+
+	updateIrLightAliasTable(ir_lights, sizeof(ir_lights) / sizeof(ir_lights[0]));
 }
 
 
@@ -1413,6 +1769,8 @@ void Time_of_Flight_App::updateLights()
 
 		g_context["ir_lights"]->set(light_buffer);
 
+		updateIrLightAliasTable(ir_lights, sizeof(ir_lights) / sizeof(ir_lights[0]));
+
 		g_context["bg_color"]->setFloat(optix::make_float3(m_ambientSunLightIntensity));
 	}
 }
@@ -4,6 +4,8 @@
 #include <CameraUtils/FirstPersonCamera.h>
 
 #include <CameraUtils/CameraCalibration.h>
+#include <CameraUtils/FrameBufferPool.h>
+#include <CameraUtils/FrameEncoderPool.h>
 #include <CameraUtils/RenderingConfigs.h>
 
 #include <optixu/optixpp_namespace.h>
@@ -15,16 +17,21 @@ struct image_save_thread_data {
 	bool				running;
 	bool				savingRunning;
 	bool				busy;
+	bool				compressDeferred;
+	bool				compressDepth;
+	bow::FrameEncoderPool* encoderPool;
+	unsigned int		imageStream;
 	std::queue<std::pair<long long, cv::Mat>> images;
 	std::queue<std::pair<long long, cv::Mat>> depth;
 	std::queue<std::pair<long long, cv::Mat>> range;
 	std::queue<std::pair<long long, cv::Mat>> ir;
+	std::queue<std::pair<long long, std::vector<unsigned char>>> transient;
 };
 
 class Time_of_Flight_App : public bow::Application
 {
 public:
-	Time_of_Flight_App();
+	Time_of_Flight_App(const bow::RenderingConfigs& configs);
 	~Time_of_Flight_App();
 
 private:
@@ -39,6 +46,11 @@ private:
 
 	// helperfunctions
 	void createContext(int usage_report_level, UsageReportLogger* logger);
+	void setModulationModel(unsigned int model);
+	void resizeCompactBuckets();
+	void launchPasses();
+	void setTransientOutput(bool enabled);
+	void queueTransientFrame(long long seconds);
 
 	void loadMesh(const std::string& filename, optix::GeometryGroup geometry_group, float unitsPerMeter = 1.0f);
 	void createSphere0(optix::GeometryGroup geometry_group);
@@ -51,6 +63,8 @@ private:
 	void updateCamera();
 	void updateLights();
 
+	void queueRecordedImage(long long seconds, const cv::Mat& imageMat);
+
 	unsigned int			m_width;
 	unsigned int			m_height;
 
@@ -65,6 +79,12 @@ private:
 	bool				m_camera_changed;
 	unsigned int		m_use_model;
 
+	// pathtracer programs of every modulation model (pulse, rect, sin), only the ones of m_use_model are bound
+	optix::Program					m_ray_gen_programs[3];
+	optix::Program					m_miss_programs[3];
+	optix::Program					m_closest_hit_programs[3];
+	std::vector<optix::Material>	m_materials;
+
 	float				m_irLightIntensity;
 	float				m_ambientSunLightIntensity;
 
@@ -74,10 +94,16 @@ private:
 	bool	m_noise_enabled;
 	bool	m_lens_scattering_enabled;
 	bool	m_save_data;
+	bool	m_transient_enabled;
 	bool	recording_pressed;
 	bool	enable_lens_scattering_pressed;
 	bool    enable_noise_pressed;
+	bool	enable_transient_pressed;
+	bool	m_measure_encoder;
+	bool	measure_encoder_pressed;
 
+	bow::FrameEncoderPool* m_encoderPool;
+	bow::FrameBufferPool* m_framePool;
 	std::thread m_imageSavingThread;
 	image_save_thread_data m_threadData;
 };
\ No newline at end of file
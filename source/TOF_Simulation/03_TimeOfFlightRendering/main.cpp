@@ -33,6 +33,7 @@ int main(int /*argc*/, char* /*argv[]*/)
 	std::cout << "Use [LEFT SHIFT] to increase moving speed." << std::endl;
 	std::cout << "Move the Mouse while pressing the [Right Mousebutton] to look around." << std::endl;
 	std::cout << "Use [1][2][3] on Numpad to switch between TOF Types." << std::endl;
+	std::cout << "Use [R] to start/stop recording, [B] to measure png encoding throughput." << std::endl;
 	std::cout << "=======================================================================" << std::endl;
 	std::cout << std::endl;
 
@@ -40,7 +41,7 @@ int main(int /*argc*/, char* /*argv[]*/)
 	g_height = intrinisicCameraParameters.image_height;
 	try
 	{
-		Time_of_Flight_App app;
+		Time_of_Flight_App app(configs);
 		app.Run(intrinisicCameraParameters);
 	} SUTIL_CATCH(g_context->get())
 
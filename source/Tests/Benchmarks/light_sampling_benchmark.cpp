@@ -0,0 +1,73 @@
+#include <gmock/gmock.h>
+
+#include <light_sampling.h>
+
+#include "Simulation-test/light_sampling_scene.h"
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+class light_sampling_benchmark: public testing::Test
+{
+public:
+	typedef LightSamplingScene Scene;
+
+	struct Efficiency
+	{
+		double variance;
+		double secondsPerEstimate;
+	};
+
+	static Efficiency Measure(const Scene& scene, Scene::Strategy strategy, unsigned int numSamples, const std::vector<double>& reference)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		Efficiency efficiency;
+		efficiency.variance = scene.Variance(strategy, numSamples, reference);
+		auto end = std::chrono::high_resolution_clock::now();
+		efficiency.secondsPerEstimate = std::chrono::duration<double>(end - start).count() / reference.size();
+		return efficiency;
+	}
+
+	// variance times time, lower is better
+	static void Compare(const Scene& scene, const char* name, double& exhaustive, double& alias, double& bvh)
+	{
+		std::vector<double> reference = scene.Reference(64, 4096);
+		Efficiency e = Measure(scene, Scene::Exhaustive, 4, reference);
+		Efficiency a = Measure(scene, Scene::Alias, 64, reference);
+		Efficiency b = Measure(scene, Scene::Bvh, 64, reference);
+
+		std::cout << "[          ] " << name << " (" << scene.NumLights() << " leds)" << std::endl;
+		std::cout << "[          ]   exhaustive, 4 spp:  variance " << e.variance << ", " << e.secondsPerEstimate * 1e6 << " us" << std::endl;
+		std::cout << "[          ]   alias table, 64 spp: variance " << a.variance << ", " << a.secondsPerEstimate * 1e6 << " us" << std::endl;
+		std::cout << "[          ]   light bvh, 64 spp:   variance " << b.variance << ", " << b.secondsPerEstimate * 1e6 << " us" << std::endl;
+
+		exhaustive = e.variance * e.secondsPerEstimate;
+		alias = a.variance * a.secondsPerEstimate;
+		bvh = b.variance * b.secondsPerEstimate;
+	}
+};
+
+TEST_F(light_sampling_benchmark, LedBoardVarianceVersusTime)
+{
+	// illumination board of a ToF camera, the wall is far away compared to the board size
+	Scene scene = Scene::Create(8, 0.04f, 2.0f, 0.5f);
+
+	double exhaustive, alias, bvh;
+	Compare(scene, "led board, wall at 2 m", exhaustive, alias, bvh);
+
+	EXPECT_LT(alias, exhaustive);
+	EXPECT_LT(bvh, exhaustive);
+}
+
+TEST_F(light_sampling_benchmark, LargePanelVarianceVersusTime)
+{
+	// the wall is close to a large panel, only the leds next to the footprint matter. A single sample of the
+	// light bvh still loses against shadow rays to all leds here, but it clearly beats the power based table.
+	Scene scene = Scene::Create(16, 2.0f, 0.3f, 0.2f);
+
+	double exhaustive, alias, bvh;
+	Compare(scene, "large panel, wall at 0.3 m", exhaustive, alias, bvh);
+
+	EXPECT_LT(bvh, alias);
+}
@@ -0,0 +1,92 @@
+#include <gmock/gmock.h>
+
+#include <Platform/BowMappedFile.h>
+
+#include "Resources-test/scene_files.h"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#if defined(__unix__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+class mapped_file_benchmark: public testing::Test
+{
+public:
+	// Drops the file from the page cache, so the next read comes from disk
+	static bool Evict(const std::string& filePath)
+	{
+#if defined(__unix__)
+		int fileDescriptor = open(filePath.c_str(), O_RDONLY);
+		if (fileDescriptor < 0)
+			return false;
+		bool evicted = posix_fadvise(fileDescriptor, 0, 0, POSIX_FADV_DONTNEED) == 0;
+		close(fileDescriptor);
+		return evicted;
+#else
+		return false;
+#endif
+	}
+};
+
+TEST_F(mapped_file_benchmark, ColdAndWarmSceneFiles)
+{
+	std::vector<std::string> files = SceneFiles();
+	size_t totalBytes = 0;
+	for (const std::string& filePath : files)
+	{
+		bow::MappedFile file;
+		if (file.Open(filePath.c_str()))
+			totalBytes += file.GetSizeInBytes();
+	}
+	const double megaBytes = totalBytes / (1024.0 * 1024.0);
+
+	typedef std::chrono::high_resolution_clock Clock;
+	for (int cold = 1; cold >= 0; cold--)
+	{
+		bool evicted = true;
+		if (cold)
+			for (const std::string& filePath : files)
+				evicted &= Evict(filePath);
+		if (!evicted)
+		{
+			std::cout << "[          ] page cache can not be dropped here, skipping cold loads" << std::endl;
+			continue;
+		}
+
+		Clock::time_point start = Clock::now();
+		size_t legacyChecksum = 0;
+		for (const std::string& filePath : files)
+		{
+			std::vector<char> data = LegacyPrepare(filePath);
+			for (size_t i = 0; i < data.size(); i += 4096)
+				legacyChecksum += data[i];
+		}
+		const double legacySeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+		if (cold)
+			for (const std::string& filePath : files)
+				Evict(filePath);
+
+		// touch every page, as the loaders do
+		start = Clock::now();
+		size_t mappedChecksum = 0;
+		for (const std::string& filePath : files)
+		{
+			bow::MappedFile file;
+			if (!file.Open(filePath.c_str()))
+				continue;
+			for (size_t i = 0; i < file.GetSizeInBytes() + 1; i += 4096)
+				mappedChecksum += file.GetData()[i];
+		}
+		const double mappedSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+		std::cout << "[          ] " << files.size() << " files, " << megaBytes << " MB " << (cold ? "cold" : "warm")
+			<< ": FileReader " << megaBytes / legacySeconds << " MB/s, MappedFile " << megaBytes / mappedSeconds << " MB/s" << std::endl;
+		EXPECT_EQ(legacyChecksum, mappedChecksum);
+	}
+}
@@ -0,0 +1,65 @@
+#include <gmock/gmock.h>
+
+#include <Resources/Spatial/BowMortonOrder.h>
+#include <Resources/Spatial/BowPointCloudFilters.h>
+
+#include "Resources-test/synthetic_scan.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+TEST(morton_order_benchmark, NeighbourQueryThroughput)
+{
+	const unsigned int numPoints = 1000000;
+	const float size[3] = { 6.0f, 4.0f, 2.5f };
+	std::vector<float> shuffled = ShufflePoints(CreateRoomScan(numPoints, size, 6, 0.0f, 4), 5);
+
+	typedef std::chrono::high_resolution_clock Clock;
+	Clock::time_point start = Clock::now();
+	std::vector<unsigned long long> codes(numPoints);
+	bow::MortonOrder::ComputeCodes(shuffled.data(), numPoints, 0.0f, codes.data());
+	const double encode = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	start = Clock::now();
+	std::vector<unsigned int> permutation;
+	bow::MortonOrder::SortPermutation(codes.data(), numPoints, permutation);
+	const double radixSort = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	start = Clock::now();
+	std::vector<std::pair<unsigned long long, unsigned int>> pairs(numPoints);
+	for (unsigned int i = 0; i < numPoints; i++)
+		pairs[i] = std::make_pair(codes[i], i);
+	std::sort(pairs.begin(), pairs.end());
+	const double stdSort = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	for (unsigned int i = 0; i < numPoints; i += 1009)
+		ASSERT_EQ(pairs[i].second, permutation[i]);
+
+	std::vector<float> sorted(shuffled.size());
+	start = Clock::now();
+	bow::MortonOrder::Reorder(shuffled.data(), 3 * sizeof(float), permutation, sorted.data());
+	const double reorder = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	// the same normals, once in scan order and once in Morton order
+	std::vector<float> shuffledNormals(shuffled.size()), sortedNormals(sorted.size());
+	start = Clock::now();
+	bow::PointCloudFilters::EstimateNormals(shuffled.data(), numPoints, 10, nullptr, shuffledNormals.data());
+	const double shuffledQuery = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	start = Clock::now();
+	bow::PointCloudFilters::EstimateNormals(sorted.data(), numPoints, 10, nullptr, sortedNormals.data());
+	const double sortedQuery = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	std::cout << "[          ] " << numPoints << " points: codes " << encode << " ms, radix sort " << radixSort << " ms (std::sort " << stdSort
+		<< " ms), reorder " << reorder << " ms; normals in scan order " << shuffledQuery << " ms, in Morton order " << sortedQuery << " ms" << std::endl;
+
+	for (unsigned int i = 0; i < numPoints; i += 101)
+	{
+		const float* a = &sortedNormals[i * 3];
+		const float* b = &shuffledNormals[permutation[i] * 3];
+		EXPECT_NEAR(1.0f, std::fabs(a[0] * b[0] + a[1] * b[1] + a[2] * b[2]), 1e-3f) << i;
+	}
+}
@@ -0,0 +1,38 @@
+#include <gmock/gmock.h>
+
+#include <Resources/Spatial/BowPointCloudFilters.h>
+
+#include "Resources-test/synthetic_scan.h"
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+TEST(point_cloud_filters_benchmark, FilterThroughput)
+{
+	// 10 accumulated 512 x 424 frames of a Kinect v2
+	std::vector<float> frames = CreateDepthFrames(512, 424, 10, 4);
+	const size_t numPoints = frames.size() / 3;
+
+	typedef std::chrono::high_resolution_clock Clock;
+	Clock::time_point start = Clock::now();
+	std::vector<float> downsampled, colors;
+	const size_t numDownsampled = bow::PointCloudFilters::VoxelDownsample(frames.data(), nullptr, numPoints, 0.02f, downsampled, colors);
+	const double downsample = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	start = Clock::now();
+	std::vector<unsigned int> inliers;
+	const size_t numInliers = bow::PointCloudFilters::RemoveStatisticalOutliers(downsampled.data(), numDownsampled, 8, 2.0f, inliers);
+	const double outliers = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	std::vector<float> filtered;
+	bow::PointCloudFilters::Gather(downsampled.data(), inliers, filtered);
+	std::vector<float> normals(filtered.size());
+	const float camera[3] = { 0.0f, 0.0f, 0.0f };
+	start = Clock::now();
+	bow::PointCloudFilters::EstimateNormals(filtered.data(), numInliers, 16, camera, normals.data());
+	const double normalEstimation = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	std::cout << "[          ] " << numPoints << " points: downsampled to " << numDownsampled << " in " << downsample << " ms, " << numDownsampled - numInliers
+		<< " outliers in " << outliers << " ms, normals in " << normalEstimation << " ms" << std::endl;
+}
@@ -0,0 +1,53 @@
+#include <gmock/gmock.h>
+
+#include <Resources/Spatial/BowPointCloudKdTree.h>
+#include <Resources/Spatial/BowPointCloudVoxelGrid.h>
+
+#include "Resources-test/synthetic_scan.h"
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+TEST(point_cloud_index_benchmark, DistanceMapThroughput)
+{
+	// a measured frame against the reference geometry, 512 x 424 points like a Kinect v2 depth image
+	const float size[3] = { 4.0f, 3.0f, 2.5f };
+	std::vector<float> reference = CreateRoomScan(300000, size, 7, 0.005f, 7);
+	std::vector<float> frame = CreateRoomScan(512 * 424, size, 7, 0.005f, 8);
+	const size_t numQueries = frame.size() / 3;
+
+	typedef std::chrono::high_resolution_clock Clock;
+	Clock::time_point start = Clock::now();
+	bow::PointCloudKdTree tree(reference.data(), reference.size() / 3);
+	const double treeBuild = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	start = Clock::now();
+	bow::PointCloudVoxelGrid grid(reference.data(), reference.size() / 3, 0.05f);
+	const double gridBuild = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	std::vector<float> treeDistances(numQueries), gridDistances(numQueries);
+	start = Clock::now();
+	tree.FindNearestDistances(frame.data(), numQueries, treeDistances.data());
+	const double treeQuery = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	start = Clock::now();
+	grid.FindNearestDistances(frame.data(), numQueries, gridDistances.data(), 0.1f);
+	const double gridQuery = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	std::cout << "[          ] " << numQueries << " queries against " << reference.size() / 3 << " points: kd-tree build " << treeBuild << " ms, query " << treeQuery
+		<< " ms; voxel grid build " << gridBuild << " ms, query " << gridQuery << " ms" << std::endl;
+
+	const size_t k = 8;
+	std::vector<unsigned int> indices(numQueries * k);
+	std::vector<float> squaredDistances(numQueries * k);
+	start = Clock::now();
+	tree.FindNearest(frame.data(), numQueries, k, indices.data(), squaredDistances.data());
+	const double treeNearest = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	start = Clock::now();
+	grid.FindNearest(frame.data(), numQueries, k, 0.1f, indices.data(), squaredDistances.data());
+	const double gridNearest = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	std::cout << "[          ] " << k << " nearest neighbours: kd-tree " << treeNearest << " ms, voxel grid " << gridNearest << " ms" << std::endl;
+}
@@ -0,0 +1,46 @@
+#include <gmock/gmock.h>
+
+#include <Resources/Spatial/BowPointCloudOctree.h>
+
+#include "Resources-test/synthetic_scan.h"
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+TEST(point_cloud_octree_benchmark, BuildThroughput)
+{
+	// points on the walls and floor of a 10 x 10 x 3 m building
+	const std::string scanPath = testing::TempDir() + "point_cloud_octree_benchmark.xtc";
+	const std::string octreePath = testing::TempDir() + "point_cloud_octree_benchmark.bpo";
+	const float size[3] = { 10.0f, 10.0f, 3.0f };
+	WriteTextScan(scanPath, CreateRoomScan(1000000, size, 5, 0.0f, 3), 1.0f / size[0]);
+
+	typedef std::chrono::high_resolution_clock Clock;
+	Clock::time_point start = Clock::now();
+	ASSERT_TRUE(bow::PointCloudOctree::Build(scanPath, octreePath));
+	const double build = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	bow::PointCloudOctree octree;
+	ASSERT_TRUE(octree.Open(octreePath));
+	float planes[6][4];
+	// an orthographic projection of [-1, 11]^3 around the whole building
+	const float s = 1.0f / 6.0f, t = -5.0f / 6.0f;
+	const float projection[16] = { s, 0, 0, 0, 0, s, 0, 0, 0, 0, s, 0, t, t, t, 1 };
+	bow::PointCloudOctree::ExtractFrustumPlanes(projection, planes);
+	const float eye[3] = { 5.0f, -10.0f, 1.5f };
+
+	std::vector<float> positions, colors;
+	start = Clock::now();
+	const size_t numPoints = octree.Query(planes, eye, 500000, positions, colors);
+	const double query = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	std::cout << "[          ] " << octree.GetNumPoints() << " points in " << octree.GetNumNodes() << " nodes: build " << build << " ms, query of "
+		<< numPoints << " points " << query << " ms" << std::endl;
+
+	remove(scanPath.c_str());
+	remove(octreePath.c_str());
+	remove((octreePath + ".points").c_str());
+}
@@ -0,0 +1,34 @@
+#include <gmock/gmock.h>
+
+#include <Resources/FileLoader/PointCloudLoader/BowPointCloudTextScanner.h>
+
+#include "Resources-test/point_cloud_text.h"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+TEST(point_cloud_text_scanner_benchmark, Throughput)
+{
+	const float defaults[9] = { 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 0.0f };
+	std::string text = CreateTextCloud(500000, 9);
+	const double megaBytes = text.size() / (1024.0 * 1024.0);
+
+	typedef std::chrono::high_resolution_clock Clock;
+	Clock::time_point start = Clock::now();
+	std::vector<float> legacy = LegacyImport(text, 9, defaults);
+	const double legacySeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	// parsing into the arrays of the point cloud, as the loaders do
+	start = Clock::now();
+	bow::PointCloudTextScanner scanner(text.data(), text.size());
+	std::vector<float> positions(scanner.GetNumPoints() * 3), colors(scanner.GetNumPoints() * 3), normals(scanner.GetNumPoints() * 3);
+	float* attributes[3] = { positions.data(), colors.data(), normals.data() };
+	scanner.Parse(9, defaults, attributes);
+	const double scannerSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	std::cout << "[          ] " << megaBytes << " MB xcn: legacy " << megaBytes / legacySeconds << " MB/s, scanner " << megaBytes / scannerSeconds << " MB/s" << std::endl;
+	ASSERT_EQ(legacy.size(), positions.size() * 3);
+	EXPECT_EQ(legacy[legacy.size() - 1], normals.back());
+}
@@ -0,0 +1,128 @@
+#include <gmock/gmock.h>
+
+#include <tof_correlation.h>
+
+#include "Simulation-test/legacy_rect_buckets.h"
+
+#include <chrono>
+#include <iostream>
+
+class tof_correlation_benchmark: public testing::Test
+{
+public:
+	static double SpeedOfLight()
+	{
+		return 299792458.0;
+	}
+
+	template <typename Model>
+	static double Benchmark(const tof_modulation<float>& modulation, float maxPathLength, unsigned int numEvaluations)
+	{
+		tof_buckets<Model, float> buckets = tof_make_buckets<Model, float>();
+
+		auto start = std::chrono::high_resolution_clock::now();
+		for (unsigned int i = 0; i < numEvaluations; i++)
+		{
+			float pathLength = maxPathLength * (float)(i % 4096) / 4096.0f;
+			tof_accumulate(modulation, tof_travel_time(pathLength), 1.0f, buckets);
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+
+		// keep the result alive
+		float sum = 0.0f;
+		for (int i = 0; i < Model::num_buckets; i++)
+			sum += buckets.value[i];
+		EXPECT_GT(sum, 0.0f);
+
+		return std::chrono::duration<double, std::nano>(end - start).count() / numEvaluations;
+	}
+
+	// Bucket work of one microfacet_closest_hit call: ambient light of the visible light and the
+	// correlation of the three ir lights at slightly different distances
+	template <typename Model>
+	static void ShadeHit(const tof_modulation<float>& modulation, float traveledDistance, float intensity, tof_buckets<Model, float>& buckets)
+	{
+		tof_accumulate_ambient(intensity, buckets);
+		for (int light = 0; light < 3; light++)
+		{
+			float pathLength = traveledDistance * 2.0f + 0.005f * (float)light;
+			tof_accumulate(modulation, tof_travel_time(pathLength), intensity, buckets);
+		}
+	}
+
+	template <typename Model>
+	static double BenchmarkHitShading(const tof_modulation<float>& modulation, unsigned int numHits)
+	{
+		tof_buckets<Model, float> buckets = tof_make_buckets<Model, float>();
+
+		auto start = std::chrono::high_resolution_clock::now();
+		for (unsigned int i = 0; i < numHits; i++)
+			ShadeHit(modulation, 20.0f * (float)(i % 4096) / 4096.0f, 1.0f, buckets);
+		auto end = std::chrono::high_resolution_clock::now();
+
+		EXPECT_GT(buckets.value[0], 0.0f);
+		return std::chrono::duration<double, std::nano>(end - start).count() / numHits;
+	}
+
+	// what every hit computed before the programs were split per model
+	static double BenchmarkHitShadingAllModels(const tof_modulation<float>& modulation, unsigned int numHits)
+	{
+		tof_buckets<tof_pulse_model, float> pulse = tof_make_buckets<tof_pulse_model, float>();
+		tof_buckets<tof_rect_model, float> rect = tof_make_buckets<tof_rect_model, float>();
+		tof_buckets<tof_sine_model, float> sine = tof_make_buckets<tof_sine_model, float>();
+
+		auto start = std::chrono::high_resolution_clock::now();
+		for (unsigned int i = 0; i < numHits; i++)
+		{
+			float traveledDistance = 20.0f * (float)(i % 4096) / 4096.0f;
+			ShadeHit(modulation, traveledDistance, 1.0f, pulse);
+			ShadeHit(modulation, traveledDistance, 1.0f, rect);
+			ShadeHit(modulation, traveledDistance, 1.0f, sine);
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+
+		EXPECT_GT(pulse.value[0] + rect.value[0] + sine.value[0], 0.0f);
+		return std::chrono::duration<double, std::nano>(end - start).count() / numHits;
+	}
+};
+
+TEST_F(tof_correlation_benchmark, Models)
+{
+	const unsigned int numEvaluations = 1 << 22;
+	const tof_modulation<float> modulation = tof_make_modulation(20e6f);
+
+	double pulse = Benchmark<tof_pulse_model>(modulation, 30.0f, numEvaluations);
+	double rect = Benchmark<tof_rect_model>(modulation, 30.0f, numEvaluations);
+	double sine = Benchmark<tof_sine_model>(modulation, 30.0f, numEvaluations);
+
+	double legacyBuckets[4] = { 0.0, 0.0, 0.0, 0.0 };
+	auto start = std::chrono::high_resolution_clock::now();
+	for (unsigned int i = 0; i < numEvaluations; i++)
+		LegacyRectBuckets(20e6, (30.0 * (double)(i % 4096) / 4096.0) / SpeedOfLight(), 1.0, legacyBuckets);
+	auto end = std::chrono::high_resolution_clock::now();
+	double legacyRect = std::chrono::duration<double, std::nano>(end - start).count() / numEvaluations;
+	EXPECT_GT(legacyBuckets[0], 0.0);
+
+	std::cout << "[          ] ns per path: pulse " << pulse << ", rect " << rect << " (legacy loop " << legacyRect << "), sine " << sine << std::endl;
+}
+
+TEST_F(tof_correlation_benchmark, HitShadingCostPerModel)
+{
+	const unsigned int numHits = 1 << 20;
+	const tof_modulation<float> modulation = tof_make_modulation(20e6f);
+
+	double allModels = BenchmarkHitShadingAllModels(modulation, numHits);
+	double pulse = BenchmarkHitShading<tof_pulse_model>(modulation, numHits);
+	double rect = BenchmarkHitShading<tof_rect_model>(modulation, numHits);
+	double sine = BenchmarkHitShading<tof_sine_model>(modulation, numHits);
+
+	std::cout << "[          ] ns per hit: all models " << allModels << ", pulse " << pulse << ", rect " << rect << ", sine " << sine << std::endl;
+	std::cout << "[          ] bucket bytes per payload: all models " << 2 * (sizeof(tof_buckets<tof_pulse_model, float>) + sizeof(tof_buckets<tof_rect_model, float>) + sizeof(tof_buckets<tof_sine_model, float>))
+		<< ", pulse " << 2 * sizeof(tof_buckets<tof_pulse_model, float>)
+		<< ", rect " << 2 * sizeof(tof_buckets<tof_rect_model, float>)
+		<< ", sine " << 2 * sizeof(tof_buckets<tof_sine_model, float>) << std::endl;
+
+	EXPECT_LT(pulse, allModels);
+	EXPECT_LT(rect, allModels);
+	EXPECT_LT(sine, allModels);
+}
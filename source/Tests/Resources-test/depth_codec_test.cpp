@@ -0,0 +1,119 @@
+#include <gmock/gmock.h>
+
+#include <Resources/Codecs/BowDepthCodec.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+class depth_codec_test: public testing::Test
+{
+public:
+	// smooth surfaces with sensor noise, a foreground object and invalid pixels
+	static std::vector<unsigned short> CreateDepthFrame(unsigned int width, unsigned int height)
+	{
+		std::mt19937 generator(42);
+		std::normal_distribution<float> noise(0.0f, 3.0f);
+
+		std::vector<unsigned short> frame(width * height);
+		for (unsigned int y = 0; y < height; y++)
+		{
+			for (unsigned int x = 0; x < width; x++)
+			{
+				float depth = 1500.0f + 0.8f * x + 0.3f * y + 200.0f * std::sin(x * 0.01f);
+				if (x > width / 3 && x < width / 2 && y > height / 3 && y < height / 2)
+					depth = 900.0f;
+
+				unsigned short value = (unsigned short)(depth + noise(generator));
+				if ((x * 7 + y * 13) % 97 == 0)
+					value = 0;
+				frame[y * width + x] = value;
+			}
+		}
+		return frame;
+	}
+
+	static void ExpectRoundTrip(const std::vector<unsigned short>& frame, unsigned int width, unsigned int height, bow::DepthPredictor predictor)
+	{
+		std::vector<unsigned char> encoded;
+		ASSERT_TRUE(bow::DepthCodec::Encode(&frame[0], width, height, encoded, predictor));
+
+		unsigned int decodedWidth = 0, decodedHeight = 0;
+		ASSERT_TRUE(bow::DepthCodec::ReadHeader(&encoded[0], encoded.size(), decodedWidth, decodedHeight));
+		EXPECT_EQ(width, decodedWidth);
+		EXPECT_EQ(height, decodedHeight);
+
+		std::vector<unsigned short> decoded(width * height);
+		ASSERT_TRUE(bow::DepthCodec::Decode(&encoded[0], encoded.size(), &decoded[0]));
+		EXPECT_EQ(frame, decoded);
+	}
+};
+
+TEST_F(depth_codec_test, RoundTripRowDelta)
+{
+	std::vector<unsigned short> frame = CreateDepthFrame(512, 424);
+	ExpectRoundTrip(frame, 512, 424, bow::DepthPredictor::RowDelta);
+}
+
+TEST_F(depth_codec_test, RoundTripMED)
+{
+	std::vector<unsigned short> frame = CreateDepthFrame(512, 424);
+	ExpectRoundTrip(frame, 512, 424, bow::DepthPredictor::MED);
+}
+
+TEST_F(depth_codec_test, RoundTripFullRangeNoise)
+{
+	std::mt19937 generator(7);
+	std::vector<unsigned short> frame(37 * 19);
+	for (size_t i = 0; i < frame.size(); i++)
+		frame[i] = (unsigned short)generator();
+
+	ExpectRoundTrip(frame, 37, 19, bow::DepthPredictor::RowDelta);
+	ExpectRoundTrip(frame, 37, 19, bow::DepthPredictor::MED);
+}
+
+TEST_F(depth_codec_test, CompressesDepth)
+{
+	std::vector<unsigned short> frame = CreateDepthFrame(512, 424);
+
+	std::vector<unsigned char> encoded;
+	ASSERT_TRUE(bow::DepthCodec::Encode(&frame[0], 512, 424, encoded));
+	EXPECT_LT(encoded.size(), frame.size() * sizeof(unsigned short) / 3 * 2);
+}
+
+TEST_F(depth_codec_test, DecodeRowsMatchesFullDecode)
+{
+	std::vector<unsigned short> frame = CreateDepthFrame(320, 240);
+
+	std::vector<unsigned char> encoded;
+	ASSERT_TRUE(bow::DepthCodec::Encode(&frame[0], 320, 240, encoded));
+
+	// spans block boundaries and the last partial block
+	const unsigned int ranges[][2] = { { 0, 1 }, { 15, 2 }, { 101, 37 }, { 230, 10 } };
+	for (size_t i = 0; i < sizeof(ranges) / sizeof(ranges[0]); i++)
+	{
+		std::vector<unsigned short> rows(ranges[i][1] * 320);
+		ASSERT_TRUE(bow::DepthCodec::DecodeRows(&encoded[0], encoded.size(), ranges[i][0], ranges[i][1], &rows[0]));
+		EXPECT_TRUE(std::equal(rows.begin(), rows.end(), frame.begin() + ranges[i][0] * 320));
+	}
+
+	std::vector<unsigned short> rows(320);
+	EXPECT_FALSE(bow::DepthCodec::DecodeRows(&encoded[0], encoded.size(), 240, 1, &rows[0]));
+}
+
+TEST_F(depth_codec_test, RejectsInvalidData)
+{
+	std::vector<unsigned short> frame = CreateDepthFrame(320, 240);
+
+	std::vector<unsigned char> encoded;
+	ASSERT_TRUE(bow::DepthCodec::Encode(&frame[0], 320, 240, encoded));
+
+	std::vector<unsigned short> decoded(320 * 240);
+	EXPECT_FALSE(bow::DepthCodec::Decode(&encoded[0], encoded.size() - 16, &decoded[0]));
+
+	// raw frames must not be mistaken for encoded ones
+	const unsigned char* raw = reinterpret_cast<const unsigned char*>(&frame[0]);
+	unsigned int width, height;
+	EXPECT_FALSE(bow::DepthCodec::ReadHeader(raw, frame.size() * sizeof(unsigned short), width, height));
+}
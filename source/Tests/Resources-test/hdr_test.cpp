@@ -0,0 +1,148 @@
+#include <gmock/gmock.h>
+
+#include <Resources/ResourceManagers/BowImageManager.h>
+#include <Resources/FileLoader/ImageLoader/BowImageLoader_hdr.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+class hdr_test: public testing::Test
+{
+public:
+	// Reference float -> RGBe conversion as written by the Radiance tools
+	static void FloatsToRGBe(const float* FV, unsigned char* RV)
+	{
+		float v = std::max(FV[0], std::max(FV[1], FV[2]));
+		if (v < 1e-32f)
+		{
+			RV[0] = RV[1] = RV[2] = RV[3] = 0;
+			return;
+		}
+
+		int e;
+		float scale = (float)frexp(v, &e) * 256.0f / v;
+		RV[0] = (unsigned char)(FV[0] * scale);
+		RV[1] = (unsigned char)(FV[1] * scale);
+		RV[2] = (unsigned char)(FV[2] * scale);
+		RV[3] = (unsigned char)(e + 128);
+	}
+
+	static int RunLength(const std::vector<unsigned char>& line, int x, int width, int ch)
+	{
+		int run = 1;
+		while (x + run < width && run < 127 && line[(x + run) * 4 + ch] == line[x * 4 + ch])
+			run++;
+		return run;
+	}
+
+	// Encodes the image as new-style RLE scanlines, mixing run and literal spans
+	static std::string Encode(const float* data, int width, int height)
+	{
+		char header[128];
+		sprintf(header, "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\nEXPOSURE=1.0\n\n-Y %d +X %d\n", height, width);
+		std::string result(header);
+
+		std::vector<unsigned char> line(width * 4);
+		for (int y = 0; y < height; y++)
+		{
+			for (int x = 0; x < width; x++)
+			{
+				FloatsToRGBe(data + (size_t(y) * width + x) * 4, &line[x * 4]);
+			}
+
+			result += char(2);
+			result += char(2);
+			result += char(width >> 8);
+			result += char(width & 0xff);
+
+			for (int ch = 0; ch < 4; ch++)
+			{
+				int x = 0;
+				while (x < width)
+				{
+					int run = RunLength(line, x, width, ch);
+					if (run >= 4)
+					{
+						result += char(0x80 | run);
+						result += char(line[x * 4 + ch]);
+						x += run;
+						continue;
+					}
+
+					int count = 0;
+					while (x + count < width && count < 128 && RunLength(line, x + count, width, ch) < 4)
+						count++;
+
+					result += char(count);
+					for (int i = 0; i < count; i++)
+						result += char(line[(x + i) * 4 + ch]);
+					x += count;
+				}
+			}
+		}
+		return result;
+	}
+
+	static bow::ImagePtr Decode(const std::string& fileData, const std::string& name)
+	{
+		bow::ImagePtr image = bow::ImageManager::GetInstance().CreateManual(name);
+		bow::ImageLoader_hdr loader;
+		loader.ImportImage(fileData.data(), fileData.size(), image.get());
+		return image;
+	}
+};
+
+TEST_F(hdr_test, RoundTripCedarCity)
+{
+	bow::ImagePtr original = bow::ImageManager::GetInstance().Load(TEST_DATA_DIR "/CedarCity.hdr");
+	ASSERT_EQ(1600u, original->GetWidth());
+	ASSERT_EQ(800u, original->GetHeight());
+	ASSERT_EQ(4u, original->GetNumChannels());
+
+	const int width = original->GetWidth();
+	const int height = original->GetHeight();
+	const size_t numValues = size_t(width) * height * 4;
+
+	// The first pass may renormalize pixels that were not written with a full mantissa,
+	// so it is only expected to match within the RGBe quantization step.
+	std::string encoded = Encode(original->GetData(), width, height);
+	bow::ImagePtr firstPass = Decode(encoded, "hdr_test_first.hdr");
+	ASSERT_EQ(original->GetWidth(), firstPass->GetWidth());
+	ASSERT_EQ(original->GetHeight(), firstPass->GetHeight());
+
+	const float* a = original->GetData();
+	const float* b = firstPass->GetData();
+	for (size_t i = 0; i < numValues; i += 4)
+	{
+		float maxValue = std::max(a[i], std::max(a[i + 1], a[i + 2]));
+		for (int c = 0; c < 3; c++)
+		{
+			ASSERT_NEAR(a[i + c], b[i + c], maxValue / 128.0f) << "pixel " << i / 4;
+		}
+		ASSERT_EQ(0.0f, b[i + 3]);
+	}
+
+	// Afterwards every pixel is normalized and encode/decode has to be lossless.
+	std::string reencoded = Encode(firstPass->GetData(), width, height);
+	bow::ImagePtr secondPass = Decode(reencoded, "hdr_test_second.hdr");
+
+	const float* c = secondPass->GetData();
+	for (size_t i = 0; i < numValues; i++)
+	{
+		ASSERT_EQ(b[i], c[i]) << "value " << i;
+	}
+}
+
+TEST_F(hdr_test, RejectsTruncatedFile)
+{
+	bow::ImagePtr original = bow::ImageManager::GetInstance().Load(TEST_DATA_DIR "/CedarCity.hdr");
+	std::string encoded = Encode(original->GetData(), original->GetWidth(), original->GetHeight());
+	encoded.resize(encoded.size() / 2);
+
+	bow::ImagePtr truncated = Decode(encoded, "hdr_test_truncated.hdr");
+	EXPECT_EQ(0u, truncated->GetWidth());
+	EXPECT_EQ(0u, truncated->GetHeight());
+}
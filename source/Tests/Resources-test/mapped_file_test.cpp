@@ -0,0 +1,73 @@
+#include <gmock/gmock.h>
+
+#include <Platform/BowMappedFile.h>
+
+#include "scene_files.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+class mapped_file_test: public testing::Test
+{
+public:
+	static void WriteFile(const std::string& filePath, const std::string& content)
+	{
+		std::ofstream file(filePath.c_str(), std::ios::out | std::ios::binary);
+		file.write(content.data(), content.size());
+	}
+};
+
+TEST_F(mapped_file_test, MatchesFileReader)
+{
+	std::vector<std::string> files = SceneFiles();
+	ASSERT_GT(files.size(), 7u);
+
+	for (const std::string& filePath : files)
+	{
+		std::vector<char> legacy = LegacyPrepare(filePath);
+		ASSERT_FALSE(legacy.empty()) << filePath;
+
+		bow::MappedFile file;
+		ASSERT_TRUE(file.Open(filePath.c_str()));
+		ASSERT_EQ(legacy.size() - 1, file.GetSizeInBytes()) << filePath;
+		EXPECT_EQ(0, memcmp(legacy.data(), file.GetData(), legacy.size())) << filePath;
+	}
+}
+
+TEST_F(mapped_file_test, TerminatedAtPageBoundary)
+{
+	const std::string filePath = testing::TempDir() + "mapped_file_test.txt";
+	const size_t sizes[] = { 1, 4095, 4096, 8192, 65536 + 17 };
+	for (size_t size : sizes)
+	{
+		std::string content(size, 'x');
+		content[size - 1] = '7';
+		WriteFile(filePath, content);
+
+		bow::MappedFile file;
+		ASSERT_TRUE(file.Open(filePath.c_str(), bow::FileAccessHint::RandomAccess));
+		ASSERT_EQ(size, file.GetSizeInBytes());
+		EXPECT_EQ('7', file.GetData()[size - 1]);
+		EXPECT_EQ('\0', file.GetData()[size]);
+		EXPECT_EQ(size, strlen(file.GetData()));
+	}
+	remove(filePath.c_str());
+}
+
+TEST_F(mapped_file_test, EmptyAndMissingFiles)
+{
+	const std::string filePath = testing::TempDir() + "mapped_file_test_empty.txt";
+	WriteFile(filePath, "");
+
+	bow::MappedFile file;
+	ASSERT_TRUE(file.Open(filePath.c_str()));
+	EXPECT_EQ(0u, file.GetSizeInBytes());
+	EXPECT_EQ('\0', file.GetData()[0]);
+	remove(filePath.c_str());
+
+	EXPECT_FALSE(file.Open((filePath + ".missing").c_str()));
+	EXPECT_EQ(nullptr, file.GetData());
+}
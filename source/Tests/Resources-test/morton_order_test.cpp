@@ -0,0 +1,116 @@
+#include <gmock/gmock.h>
+
+#include <Resources/Spatial/BowMortonOrder.h>
+
+#include "synthetic_scan.h"
+
+#include <algorithm>
+#include <random>
+#include <utility>
+#include <vector>
+
+class morton_order_test: public testing::Test
+{
+public:
+	// A scan of a closed 6 x 4 x 2.5 m room with the points shuffled, like a cloud merged from several captures
+	static std::vector<float> CreateShuffledCloud(unsigned int numPoints, unsigned int seed)
+	{
+		const float size[3] = { 6.0f, 4.0f, 2.5f };
+		return ShufflePoints(CreateRoomScan(numPoints, size, 6, 0.0f, seed), seed + 1);
+	}
+};
+
+TEST_F(morton_order_test, EncodeAndDecode)
+{
+	EXPECT_EQ(1ull, bow::MortonOrder::Encode(1, 0, 0));
+	EXPECT_EQ(2ull, bow::MortonOrder::Encode(0, 1, 0));
+	EXPECT_EQ(4ull, bow::MortonOrder::Encode(0, 0, 1));
+	EXPECT_EQ(0x38ull, bow::MortonOrder::Encode(2, 2, 2));
+	EXPECT_EQ((1ull << 63) - 1, bow::MortonOrder::Encode((1u << 21) - 1, (1u << 21) - 1, (1u << 21) - 1));
+	EXPECT_EQ(5u, bow::MortonOrder::Encode2D(3, 0));
+	EXPECT_EQ(0xffffffffu, bow::MortonOrder::Encode2D(0xffff, 0xffff));
+
+	std::mt19937 generator(1);
+	std::uniform_int_distribution<unsigned int> coordinate(0, (1u << 21) - 1);
+	for (int i = 0; i < 1000; i++)
+	{
+		const unsigned int x = coordinate(generator), y = coordinate(generator), z = coordinate(generator);
+		unsigned int dx, dy, dz;
+		bow::MortonOrder::Decode(bow::MortonOrder::Encode(x, y, z), dx, dy, dz);
+		EXPECT_EQ(x, dx);
+		EXPECT_EQ(y, dy);
+		EXPECT_EQ(z, dz);
+	}
+}
+
+TEST_F(morton_order_test, RadixSortIsStable)
+{
+	std::mt19937 generator(2);
+	for (size_t numCodes : { size_t(0), size_t(1), size_t(1000), size_t(300000) })
+	{
+		// few distinct codes, so there are many ties
+		std::uniform_int_distribution<unsigned long long> code(0, 5000);
+		std::vector<unsigned long long> codes(numCodes);
+		for (size_t i = 0; i < numCodes; i++)
+			codes[i] = code(generator) << 40;
+
+		std::vector<std::pair<unsigned long long, unsigned int>> expected(numCodes);
+		for (size_t i = 0; i < numCodes; i++)
+			expected[i] = std::make_pair(codes[i], (unsigned int)i);
+		std::sort(expected.begin(), expected.end());
+
+		std::vector<unsigned int> permutation;
+		bow::MortonOrder::SortPermutation(codes.data(), numCodes, permutation);
+		ASSERT_EQ(numCodes, permutation.size());
+		for (size_t i = 0; i < numCodes; i++)
+			EXPECT_EQ(expected[i].second, permutation[i]) << numCodes << " " << i;
+	}
+}
+
+TEST_F(morton_order_test, PixelsAndReorder)
+{
+	std::vector<unsigned int> permutation;
+	bow::MortonOrder::PixelPermutation(4, 3, permutation);
+	const unsigned int expected[12] = { 0, 1, 4, 5, 2, 3, 6, 7, 8, 9, 10, 11 };
+	EXPECT_EQ(std::vector<unsigned int>(expected, expected + 12), permutation);
+
+	std::vector<float> values(12 * 2);
+	for (size_t i = 0; i < values.size(); i++)
+		values[i] = float(i / 2);
+	bow::MortonOrder::Reorder(values.data(), 2 * sizeof(float), permutation);
+	for (size_t i = 0; i < 12; i++)
+	{
+		EXPECT_EQ(float(expected[i]), values[i * 2]);
+		EXPECT_EQ(float(expected[i]), values[i * 2 + 1]);
+	}
+
+	// sorted points have non decreasing codes
+	std::vector<float> cloud = CreateShuffledCloud(10000, 3);
+	std::vector<unsigned long long> codes(10000);
+	bow::MortonOrder::ComputeCodes(cloud.data(), 10000, 0.0f, codes.data());
+	bow::MortonOrder::SortPermutation(cloud.data(), 10000, permutation);
+	for (size_t i = 1; i < permutation.size(); i++)
+		EXPECT_LE(codes[permutation[i - 1]], codes[permutation[i]]);
+}
+
+TEST_F(morton_order_test, RadixSortMatchesStdSort)
+{
+	// arbitrary 63 bit codes, so every pass of the sort has work to do
+	std::mt19937_64 generator(4);
+	std::uniform_int_distribution<unsigned long long> code(0, (1ull << 63) - 1);
+	const size_t numCodes = 10000;
+	std::vector<unsigned long long> codes(numCodes);
+	for (size_t i = 0; i < numCodes; i++)
+		codes[i] = code(generator);
+
+	std::vector<std::pair<unsigned long long, unsigned int>> expected(numCodes);
+	for (size_t i = 0; i < numCodes; i++)
+		expected[i] = std::make_pair(codes[i], (unsigned int)i);
+	std::sort(expected.begin(), expected.end());
+
+	std::vector<unsigned int> permutation;
+	bow::MortonOrder::SortPermutation(codes.data(), numCodes, permutation);
+	ASSERT_EQ(numCodes, permutation.size());
+	for (size_t i = 0; i < numCodes; i++)
+		EXPECT_EQ(expected[i].second, permutation[i]) << i;
+}
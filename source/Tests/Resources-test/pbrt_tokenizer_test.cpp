@@ -0,0 +1,87 @@
+#include <gmock/gmock.h>
+
+#include <Resources/FileLoader/SceneLoader/BowPbrtTokenizer.h>
+
+#include <string>
+#include <vector>
+
+class pbrt_tokenizer_test: public testing::Test
+{
+public:
+	void Tokenize(const std::string& scene)
+	{
+		m_scene = scene;
+		m_statements.clear();
+		m_parameters.clear();
+		bow::PbrtTokenizer::Tokenize(m_scene.data(), m_scene.data() + m_scene.size(), m_statements, m_parameters);
+	}
+
+	const bow::PbrtParameter& Parameter(size_t statement, size_t parameter) const
+	{
+		return m_parameters[m_statements[statement].firstParameter + parameter];
+	}
+
+	std::string m_scene;
+	std::vector<bow::PbrtStatement> m_statements;
+	std::vector<bow::PbrtParameter> m_parameters;
+};
+
+TEST_F(pbrt_tokenizer_test, StatementsAndParameters)
+{
+	Tokenize(
+		"# a comment\n"
+		"LookAt 0 1 2  # eye\n"
+		"       3 4 5\n"
+		"Shape \"plymesh\" \"string filename\" [ \"mesh.ply\" ]\n"
+		"Texture \"wood\" \"spectrum\" \"imagemap\" \"string filename\" \"wood.png\"\n");
+
+	ASSERT_EQ(3u, m_statements.size());
+	EXPECT_TRUE(m_statements[0].directive == "LookAt");
+	ASSERT_EQ(6u, m_statements[0].numParameters);
+	EXPECT_TRUE(Parameter(0, 5).values == "5");
+
+	ASSERT_EQ(2u, m_statements[1].numParameters);
+	EXPECT_TRUE(Parameter(1, 0).name == "plymesh");
+	EXPECT_TRUE(Parameter(1, 1).name == "string filename");
+	EXPECT_TRUE(Parameter(1, 1).values == " \"mesh.ply\" ");
+
+	// the texture type is a single word and no parameter name
+	ASSERT_EQ(4u, m_statements[2].numParameters);
+	EXPECT_TRUE(Parameter(2, 1).name == "spectrum");
+	EXPECT_TRUE(Parameter(2, 1).values.empty());
+	EXPECT_TRUE(Parameter(2, 2).name == "imagemap");
+	EXPECT_TRUE(Parameter(2, 3).values == "\"wood.png\"");
+}
+
+TEST_F(pbrt_tokenizer_test, NameWithSpaces)
+{
+	Tokenize(
+		"MakeNamedMaterial \"floor tiles\" \"string type\" [ \"matte\" ] \"rgb Kd\" [ 0.5 0.5 0.5 ]\n"
+		"Texture \"old wood\" \"color\" \"imagemap\" \"string filename\" \"old wood.png\"\n");
+
+	ASSERT_EQ(2u, m_statements.size());
+	ASSERT_EQ(3u, m_statements[0].numParameters);
+	EXPECT_TRUE(Parameter(0, 0).name == "floor tiles");
+	EXPECT_TRUE(Parameter(0, 0).values.empty());
+	EXPECT_TRUE(Parameter(0, 1).name == "string type");
+	EXPECT_TRUE(Parameter(0, 1).values == " \"matte\" ");
+	EXPECT_TRUE(Parameter(0, 2).name == "rgb Kd");
+
+	ASSERT_EQ(4u, m_statements[1].numParameters);
+	EXPECT_TRUE(Parameter(1, 0).name == "old wood");
+	EXPECT_TRUE(Parameter(1, 1).name == "color");
+	EXPECT_TRUE(Parameter(1, 2).name == "imagemap");
+	EXPECT_TRUE(Parameter(1, 3).name == "string filename");
+	EXPECT_TRUE(Parameter(1, 3).values == "\"old wood.png\"");
+}
+
+TEST_F(pbrt_tokenizer_test, TypedParameterNames)
+{
+	const char* typed[] = { "integer indices", "float fov", "point3 P", "normal N", "rgb Kd", "spectrum eta", "blackbody L", "bool remaproughness", "string type", "texture Kd", "color Kd", "  point P" };
+	for (const char* name : typed)
+		EXPECT_TRUE(bow::PbrtTokenizer::IsTypedParameterName(bow::PbrtToken(name, name + strlen(name)))) << name;
+
+	const char* untyped[] = { "floor tiles", "string", "color", "matte", "", "strings x" };
+	for (const char* name : untyped)
+		EXPECT_FALSE(bow::PbrtTokenizer::IsTypedParameterName(bow::PbrtToken(name, name + strlen(name)))) << name;
+}
@@ -0,0 +1,176 @@
+#include <gmock/gmock.h>
+
+#include <Resources/Spatial/BowPointCloudFilters.h>
+
+#include "synthetic_scan.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+class point_cloud_filters_test: public testing::Test
+{
+};
+
+TEST_F(point_cloud_filters_test, VoxelDownsample)
+{
+	// 4 points in each of 8 voxels of size 1 in reverse order, the centroids are the voxel centres
+	std::vector<float> points, colors;
+	for (int voxel = 7; voxel >= 0; voxel--)
+	{
+		for (int corner = 0; corner < 4; corner++)
+		{
+			const float offset = corner % 2 == 0 ? 0.25f : 0.75f;
+			points.push_back((voxel & 1) + offset);
+			points.push_back(((voxel >> 1) & 1) + offset);
+			points.push_back(((voxel >> 2) & 1) + (corner < 2 ? 0.25f : 0.75f));
+			colors.push_back(float(voxel));
+			colors.push_back(float(corner));
+			colors.push_back(1.0f);
+		}
+	}
+
+	std::vector<float> outPoints, outColors;
+	ASSERT_EQ(8u, bow::PointCloudFilters::VoxelDownsample(points.data(), colors.data(), points.size() / 3, 1.0f, outPoints, outColors));
+
+	// Morton order: x changes first
+	for (int voxel = 0; voxel < 8; voxel++)
+	{
+		EXPECT_EQ((voxel & 1) + 0.5f, outPoints[voxel * 3 + 0]);
+		EXPECT_EQ(((voxel >> 1) & 1) + 0.5f, outPoints[voxel * 3 + 1]);
+		EXPECT_EQ(((voxel >> 2) & 1) + 0.5f, outPoints[voxel * 3 + 2]);
+		EXPECT_EQ(1.0f, outColors[voxel * 3 + 2]);
+		EXPECT_EQ(1.5f, outColors[voxel * 3 + 1]);
+	}
+
+	// without colors, and negative coordinates
+	for (float& coordinate : points)
+		coordinate -= 10.0f;
+	ASSERT_EQ(8u, bow::PointCloudFilters::VoxelDownsample(points.data(), nullptr, points.size() / 3, 1.0f, outPoints, outColors));
+	EXPECT_TRUE(outColors.empty());
+	EXPECT_EQ(-9.5f, outPoints[0]);
+
+	EXPECT_EQ(0u, bow::PointCloudFilters::VoxelDownsample(nullptr, nullptr, 0, 1.0f, outPoints, outColors));
+	EXPECT_TRUE(outPoints.empty());
+}
+
+TEST_F(point_cloud_filters_test, DownsampleIsDeterministic)
+{
+	std::vector<float> frames = CreateDepthFrames(128, 106, 4, 1);
+	std::vector<float> first, second, colors;
+	bow::PointCloudFilters::VoxelDownsample(frames.data(), frames.data(), frames.size() / 3, 0.01f, first, colors);
+	bow::PointCloudFilters::VoxelDownsample(frames.data(), frames.data(), frames.size() / 3, 0.01f, second, colors);
+	EXPECT_EQ(first, second);
+	EXPECT_EQ(first, colors);
+	EXPECT_GT(frames.size(), first.size());
+}
+
+TEST_F(point_cloud_filters_test, OutlierRemoval)
+{
+	// a dense plane and a few isolated points
+	std::mt19937 generator(2);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	std::vector<float> points;
+	for (int i = 0; i < 10000; i++)
+	{
+		points.push_back(unit(generator));
+		points.push_back(unit(generator));
+		points.push_back(0.001f * unit(generator));
+	}
+	for (int i = 0; i < 10; i++)
+	{
+		points.push_back(unit(generator));
+		points.push_back(unit(generator));
+		points.push_back(0.2f + unit(generator));
+	}
+
+	std::vector<unsigned int> inliers;
+	ASSERT_EQ(10000u, bow::PointCloudFilters::RemoveRadiusOutliers(points.data(), points.size() / 3, 0.05f, 3, inliers));
+	EXPECT_EQ(9999u, inliers.back());
+
+	ASSERT_EQ(10000u, bow::PointCloudFilters::RemoveStatisticalOutliers(points.data(), points.size() / 3, 8, 3.0f, inliers));
+	EXPECT_TRUE(std::is_sorted(inliers.begin(), inliers.end()));
+	EXPECT_EQ(9999u, inliers.back());
+
+	std::vector<float> filtered;
+	bow::PointCloudFilters::Gather(points.data(), inliers, filtered);
+	ASSERT_EQ(30000u, filtered.size());
+	EXPECT_EQ(points[3 * 9999 + 2], filtered[3 * 9999 + 2]);
+
+	EXPECT_EQ(0u, bow::PointCloudFilters::RemoveStatisticalOutliers(nullptr, 0, 8, 1.0f, inliers));
+}
+
+TEST_F(point_cloud_filters_test, Normals)
+{
+	// a plane tilted around x and a sphere
+	std::mt19937 generator(3);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::vector<float> plane, sphere;
+	for (int i = 0; i < 5000; i++)
+	{
+		const float u = unit(generator), v = unit(generator);
+		plane.push_back(u);
+		plane.push_back(v * 0.8f);
+		plane.push_back(v * 0.6f + 5.0f);
+
+		float direction[3] = { unit(generator), unit(generator), unit(generator) };
+		const float length = std::sqrt(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+		for (int d = 0; d < 3; d++)
+			sphere.push_back(direction[d] / length);
+	}
+
+	std::vector<float> normals(plane.size()), curvatures(plane.size() / 3);
+	const float viewpoint[3] = { 0.0f, 0.0f, 0.0f };
+	bow::PointCloudFilters::EstimateNormals(plane.data(), plane.size() / 3, 10, viewpoint, normals.data(), curvatures.data());
+	for (size_t i = 0; i < plane.size(); i += 3)
+	{
+		// towards the viewpoint
+		EXPECT_NEAR(0.0f, normals[i + 0], 1e-3f);
+		EXPECT_NEAR(0.6f, normals[i + 1], 1e-3f);
+		EXPECT_NEAR(-0.8f, normals[i + 2], 1e-3f);
+		EXPECT_NEAR(0.0f, curvatures[i / 3], 1e-5f);
+	}
+
+	// facing the centre of the sphere
+	bow::PointCloudFilters::EstimateNormals(sphere.data(), sphere.size() / 3, 12, viewpoint, normals.data());
+	for (size_t i = 0; i < sphere.size(); i += 3)
+	{
+		const float cosine = -(normals[i] * sphere[i] + normals[i + 1] * sphere[i + 1] + normals[i + 2] * sphere[i + 2]);
+		EXPECT_LT(0.99f, cosine) << i / 3;
+	}
+
+	// too few neighbours
+	bow::PointCloudFilters::EstimateNormals(plane.data(), 2, 10, nullptr, normals.data());
+	EXPECT_EQ(0.0f, normals[0]);
+}
+
+TEST_F(point_cloud_filters_test, FilterPipeline)
+{
+	// 4 accumulated frames of a quarter of the Kinect v2 resolution, with voxels about the size of a pixel on the wall
+	std::vector<float> frames = CreateDepthFrames(128, 106, 4, 4);
+	const size_t numPoints = frames.size() / 3;
+
+	std::vector<float> downsampled, colors;
+	const size_t numDownsampled = bow::PointCloudFilters::VoxelDownsample(frames.data(), nullptr, numPoints, 0.05f, downsampled, colors);
+	std::vector<unsigned int> inliers;
+	const size_t numInliers = bow::PointCloudFilters::RemoveStatisticalOutliers(downsampled.data(), numDownsampled, 8, 2.0f, inliers);
+
+	std::vector<float> filtered;
+	bow::PointCloudFilters::Gather(downsampled.data(), inliers, filtered);
+	std::vector<float> normals(filtered.size());
+	const float camera[3] = { 0.0f, 0.0f, 0.0f };
+	bow::PointCloudFilters::EstimateNormals(filtered.data(), numInliers, 16, camera, normals.data());
+
+	EXPECT_GT(numPoints / 2, numDownsampled);
+	EXPECT_LT(numDownsampled * 9 / 10, numInliers);
+
+	// the wall faces the camera
+	size_t facing = 0;
+	for (size_t i = 0; i < numInliers; i++)
+	{
+		if (filtered[i * 3 + 2] < -2.9f && normals[i * 3 + 2] > 0.9f)
+			facing++;
+	}
+	EXPECT_LT(numInliers / 2, facing);
+}
@@ -0,0 +1,189 @@
+#include <gmock/gmock.h>
+
+#include <Resources/Spatial/BowPointCloudKdTree.h>
+#include <Resources/Spatial/BowPointCloudVoxelGrid.h>
+
+#include "synthetic_scan.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <vector>
+
+class point_cloud_index_test: public testing::Test
+{
+public:
+	// A scanned room: points on the walls and floor of a 4 x 3 x 2.5 m box with some noise, and a few outliers
+	static std::vector<float> CreateCloud(unsigned int numPoints, unsigned int seed)
+	{
+		const float size[3] = { 4.0f, 3.0f, 2.5f };
+		return CreateRoomScan(numPoints, size, 7, 0.005f, seed);
+	}
+
+	static std::vector<std::pair<float, unsigned int>> BruteForce(const std::vector<float>& points, const float* query)
+	{
+		std::vector<std::pair<float, unsigned int>> neighbours(points.size() / 3);
+		for (unsigned int i = 0; i < neighbours.size(); i++)
+		{
+			const float dx = points[i * 3 + 0] - query[0];
+			const float dy = points[i * 3 + 1] - query[1];
+			const float dz = points[i * 3 + 2] - query[2];
+			neighbours[i] = std::make_pair(dx * dx + dy * dy + dz * dz, i);
+		}
+		std::sort(neighbours.begin(), neighbours.end());
+		return neighbours;
+	}
+};
+
+TEST_F(point_cloud_index_test, NearestMatchesBruteForce)
+{
+	std::vector<float> points = CreateCloud(20000, 3);
+	std::vector<float> queries = CreateCloud(200, 4);
+	queries[0] = -3.0f;	// outside of the cloud
+
+	bow::PointCloudKdTree tree(points.data(), points.size() / 3);
+	bow::PointCloudVoxelGrid grid(points.data(), points.size() / 3, 0.05f);
+	ASSERT_EQ(20000u, tree.GetNumPoints());
+	ASSERT_EQ(20000u, grid.GetNumPoints());
+
+	const size_t k = 8;
+	for (size_t q = 0; q < queries.size() / 3; q++)
+	{
+		const float* query = &queries[q * 3];
+		std::vector<std::pair<float, unsigned int>> expected = BruteForce(points, query);
+
+		unsigned int indices[k];
+		float distances[k];
+		ASSERT_EQ(k, tree.FindNearest(query, k, indices, distances));
+		for (size_t i = 0; i < k; i++)
+			EXPECT_EQ(expected[i].first, distances[i]) << q << " " << i;
+
+		// the grid only finds neighbours within its maximum distance
+		const float maxDistance = 0.2f;
+		size_t inRange = 0;
+		while (inRange < k && expected[inRange].first <= maxDistance * maxDistance)
+			inRange++;
+		ASSERT_EQ(inRange, grid.FindNearest(query, k, maxDistance, indices, distances)) << q;
+		for (size_t i = 0; i < inRange; i++)
+			EXPECT_EQ(expected[i].first, distances[i]) << q << " " << i;
+		for (size_t i = inRange; i < k; i++)
+			EXPECT_EQ(bow::PointCloudVoxelGrid::InvalidIndex, indices[i]);
+	}
+}
+
+TEST_F(point_cloud_index_test, RadiusMatchesBruteForce)
+{
+	std::vector<float> points = CreateCloud(20000, 5);
+	std::vector<float> queries = CreateCloud(100, 6);
+
+	bow::PointCloudKdTree tree(points.data(), points.size() / 3, 4);
+	bow::PointCloudVoxelGrid grid(points.data(), points.size() / 3, 0.04f);
+
+	const float radius = 0.1f;
+	std::vector<unsigned int> counts(queries.size() / 3), gridCounts(queries.size() / 3);
+	tree.CountInRadius(queries.data(), queries.size() / 3, radius, counts.data());
+	grid.CountInRadius(queries.data(), queries.size() / 3, radius, gridCounts.data());
+
+	for (size_t q = 0; q < queries.size() / 3; q++)
+	{
+		const float* query = &queries[q * 3];
+		std::vector<std::pair<float, unsigned int>> expected = BruteForce(points, query);
+		size_t inRadius = 0;
+		while (inRadius < expected.size() && expected[inRadius].first <= radius * radius)
+			inRadius++;
+
+		std::vector<unsigned int> indices, gridIndices;
+		std::vector<float> distances, gridDistances;
+		ASSERT_EQ(inRadius, tree.FindInRadius(query, radius, indices, distances));
+		ASSERT_EQ(inRadius, grid.FindInRadius(query, radius, gridIndices, gridDistances));
+		EXPECT_EQ(inRadius, counts[q]);
+		EXPECT_EQ(inRadius, gridCounts[q]);
+
+		std::sort(indices.begin(), indices.end());
+		std::sort(gridIndices.begin(), gridIndices.end());
+		std::vector<unsigned int> expectedIndices;
+		for (size_t i = 0; i < inRadius; i++)
+			expectedIndices.push_back(expected[i].second);
+		std::sort(expectedIndices.begin(), expectedIndices.end());
+		EXPECT_EQ(expectedIndices, indices);
+		EXPECT_EQ(expectedIndices, gridIndices);
+	}
+}
+
+TEST_F(point_cloud_index_test, DegenerateClouds)
+{
+	// identical points do not split
+	std::vector<float> same(300, 1.0f);
+	bow::PointCloudKdTree tree(same.data(), 100, 4);
+	const float query[3] = { 1.0f, 1.0f, 2.0f };
+	unsigned int indices[3];
+	float distances[3];
+	EXPECT_EQ(3u, tree.FindNearest(query, 3, indices, distances));
+	EXPECT_EQ(1.0f, distances[2]);
+
+	bow::PointCloudKdTree empty(nullptr, 0);
+	EXPECT_EQ(0u, empty.FindNearest(query, 3, indices, distances));
+	EXPECT_EQ(bow::PointCloudKdTree::InvalidIndex, indices[0]);
+
+	bow::PointCloudVoxelGrid emptyGrid(nullptr, 0, 0.1f);
+	EXPECT_EQ(0u, emptyGrid.FindNearest(query, 3, 1.0f, indices, distances));
+
+	// negative coordinates round down to their voxel
+	const float negative[6] = { -0.01f, -0.01f, -0.01f, 0.01f, 0.01f, 0.01f };
+	bow::PointCloudVoxelGrid grid(negative, 2, 1.0f);
+	EXPECT_EQ(2u, grid.GetNumOccupiedVoxels());
+	const float origin[3] = { 0.0f, 0.0f, 0.0f };
+	EXPECT_EQ(2u, grid.FindNearest(origin, 3, 0.5f, indices, distances));
+}
+
+TEST_F(point_cloud_index_test, BatchedQueriesMatchBruteForce)
+{
+	// a measured frame against the reference geometry
+	std::vector<float> reference = CreateCloud(10000, 7);
+	std::vector<float> frame = CreateCloud(400, 8);
+	const size_t numQueries = frame.size() / 3;
+
+	bow::PointCloudKdTree tree(reference.data(), reference.size() / 3);
+	bow::PointCloudVoxelGrid grid(reference.data(), reference.size() / 3, 0.05f);
+
+	std::vector<float> treeDistances(numQueries), gridDistances(numQueries);
+	tree.FindNearestDistances(frame.data(), numQueries, treeDistances.data());
+	grid.FindNearestDistances(frame.data(), numQueries, gridDistances.data(), 0.1f);
+
+	const size_t k = 4;
+	const float maxDistance = 0.1f;
+	std::vector<unsigned int> treeIndices(numQueries * k), gridIndices(numQueries * k);
+	std::vector<float> treeSquaredDistances(numQueries * k), gridSquaredDistances(numQueries * k);
+	tree.FindNearest(frame.data(), numQueries, k, treeIndices.data(), treeSquaredDistances.data());
+	grid.FindNearest(frame.data(), numQueries, k, maxDistance, gridIndices.data(), gridSquaredDistances.data());
+
+	for (size_t q = 0; q < numQueries; q++)
+	{
+		std::vector<std::pair<float, unsigned int>> expected = BruteForce(reference, &frame[q * 3]);
+		const float closest = std::sqrt(expected[0].first);
+		EXPECT_EQ(closest, treeDistances[q]) << q;
+		if (closest <= 0.1f)
+			EXPECT_EQ(closest, gridDistances[q]) << q;
+		else
+			EXPECT_EQ(std::numeric_limits<float>::infinity(), gridDistances[q]) << q;
+
+		for (size_t i = 0; i < k; i++)
+		{
+			EXPECT_EQ(expected[i].first, treeSquaredDistances[q * k + i]) << q << " " << i;
+			if (expected[i].first <= maxDistance * maxDistance)
+			{
+				EXPECT_EQ(expected[i].first, gridSquaredDistances[q * k + i]) << q << " " << i;
+			}
+			else
+			{
+				EXPECT_EQ(bow::PointCloudVoxelGrid::InvalidIndex, gridIndices[q * k + i]) << q << " " << i;
+			}
+		}
+	}
+
+	// without distances
+	std::vector<unsigned int> indices(numQueries * k);
+	grid.FindNearest(frame.data(), numQueries, k, maxDistance, indices.data(), nullptr);
+	EXPECT_EQ(gridIndices, indices);
+}
@@ -0,0 +1,233 @@
+#include <gmock/gmock.h>
+
+#include <Resources/FileLoader/PointCloudLoader/BowPointCloudTextScanner.h>
+#include <Resources/Spatial/BowPointCloudOctree.h>
+
+#include "synthetic_scan.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <tuple>
+#include <vector>
+
+class point_cloud_octree_test: public testing::Test
+{
+public:
+	typedef std::tuple<float, float, float> Point;
+
+	// Points on the walls and floor of a 10 x 10 x 3 m building with colors along x, written as .xtc
+	static std::vector<float> WriteScan(const std::string& filePath, unsigned int numPoints, unsigned int seed)
+	{
+		const float size[3] = { 10.0f, 10.0f, 3.0f };
+		std::vector<float> points = CreateRoomScan(numPoints, size, 5, 0.0f, seed);
+		WriteTextScan(filePath, points, 1.0f / size[0]);
+
+		// the positions as the text loaders read them
+		std::string text;
+		std::ifstream input(filePath.c_str(), std::ios::in | std::ios::binary);
+		text.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+		std::vector<float> colors(points.size());
+		float* const attributes[2] = { points.data(), colors.data() };
+		const float defaults[6] = { 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f };
+		bow::PointCloudTextScanner(text.data(), text.size()).Parse(6, defaults, attributes);
+		return points;
+	}
+
+	static std::vector<Point> ToPoints(const std::vector<float>& positions)
+	{
+		std::vector<Point> points(positions.size() / 3);
+		for (size_t i = 0; i < points.size(); i++)
+			points[i] = std::make_tuple(positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2]);
+		std::sort(points.begin(), points.end());
+		return points;
+	}
+
+	static bool Inside(const float planes[6][4], const float* point)
+	{
+		for (int p = 0; p < 6; p++)
+		{
+			if (planes[p][0] * point[0] + planes[p][1] * point[1] + planes[p][2] * point[2] + planes[p][3] < 0.0f)
+				return false;
+		}
+		return true;
+	}
+
+	// Planes of an axis aligned box in the order near, far, left, right, top, bottom
+	static void BoxPlanes(const float* boxMin, const float* boxMax, float planes[6][4])
+	{
+		const float normals[6][3] = { { 0, 0, 1 }, { 0, 0, -1 }, { 1, 0, 0 }, { -1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 } };
+		for (int p = 0; p < 6; p++)
+		{
+			planes[p][3] = 0.0f;
+			for (int d = 0; d < 3; d++)
+			{
+				planes[p][d] = normals[p][d];
+				planes[p][3] -= normals[p][d] * (normals[p][d] > 0.0f ? boxMin[d] : boxMax[d]);
+			}
+		}
+	}
+};
+
+TEST_F(point_cloud_octree_test, ReturnsEveryPointOnce)
+{
+	const std::string scanPath = testing::TempDir() + "point_cloud_octree_test.xtc";
+	const std::string octreePath = testing::TempDir() + "point_cloud_octree_test.bpo";
+	std::vector<float> scan = WriteScan(scanPath, 200000, 1);
+
+	ASSERT_TRUE(bow::PointCloudOctree::Build(scanPath, octreePath, 5000, 16));
+
+	bow::PointCloudOctree octree;
+	ASSERT_TRUE(octree.Open(octreePath));
+	EXPECT_EQ(200000u, octree.GetNumPoints());
+	EXPECT_LT(1u, octree.GetNumNodes());
+
+	float boundsMin[3], boundsMax[3];
+	octree.GetBounds(boundsMin, boundsMax);
+	EXPECT_EQ(0.0f, boundsMin[0]);
+	EXPECT_LE(10.0f - 1e-3f, boundsMax[0]);
+
+	float planes[6][4];
+	const float low[3] = { -1.0f, -1.0f, -1.0f }, high[3] = { 11.0f, 11.0f, 11.0f };
+	BoxPlanes(low, high, planes);
+	const float eye[3] = { 5.0f, 5.0f, 20.0f };
+
+	std::vector<float> positions, colors;
+	ASSERT_EQ(200000u, octree.Query(planes, eye, 1000000, positions, colors));
+	EXPECT_EQ(ToPoints(scan), ToPoints(positions));
+	for (size_t i = 0; i < positions.size(); i += 3)
+	{
+		EXPECT_NEAR(positions[i] / 10.0f, colors[i], 1.0f / 255.0f);
+		EXPECT_NEAR(1.0f, colors[i + 2], 1e-6f);
+	}
+
+	remove(scanPath.c_str());
+	remove(octreePath.c_str());
+	remove((octreePath + ".points").c_str());
+}
+
+TEST_F(point_cloud_octree_test, FrustumAndBudget)
+{
+	const std::string scanPath = testing::TempDir() + "point_cloud_octree_test_frustum.xtc";
+	const std::string octreePath = testing::TempDir() + "point_cloud_octree_test_frustum.bpo";
+	std::vector<float> scan = WriteScan(scanPath, 100000, 2);
+	ASSERT_TRUE(bow::PointCloudOctree::Build(scanPath, octreePath, 2000, 8));
+
+	bow::PointCloudOctree octree;
+	ASSERT_TRUE(octree.Open(octreePath));
+
+	// a corner of the building
+	float planes[6][4];
+	const float low[3] = { 6.0f, -1.0f, -1.0f }, high[3] = { 11.0f, 3.0f, 2.0f };
+	BoxPlanes(low, high, planes);
+	const float eye[3] = { 8.0f, -5.0f, 1.0f };
+
+	std::vector<float> positions, colors;
+	const size_t numPoints = octree.Query(planes, eye, 1000000, positions, colors);
+	EXPECT_LT(numPoints, scan.size() / 3);
+
+	// every point in the frustum is returned
+	std::vector<float> inside;
+	for (size_t i = 0; i < scan.size(); i += 3)
+	{
+		if (Inside(planes, &scan[i]))
+			inside.insert(inside.end(), &scan[i], &scan[i] + 3);
+	}
+	std::vector<float> returnedInside;
+	for (size_t i = 0; i < positions.size(); i += 3)
+	{
+		if (Inside(planes, &positions[i]))
+			returnedInside.insert(returnedInside.end(), &positions[i], &positions[i] + 3);
+	}
+	EXPECT_EQ(ToPoints(inside), ToPoints(returnedInside));
+
+	// a smaller budget returns a coarser subset of the same points
+	std::vector<float> coarse, coarseColors;
+	const size_t numCoarse = octree.Query(planes, eye, 3000, coarse, coarseColors);
+	EXPECT_LE(numCoarse, 3000u);
+	EXPECT_LT(0u, numCoarse);
+	std::vector<Point> all = ToPoints(positions);
+	for (const Point& point : ToPoints(coarse))
+		EXPECT_TRUE(std::binary_search(all.begin(), all.end(), point));
+
+	// nothing behind the eye
+	const float behindLow[3] = { 20.0f, 20.0f, 20.0f }, behindHigh[3] = { 30.0f, 30.0f, 30.0f };
+	BoxPlanes(behindLow, behindHigh, planes);
+	positions.clear();
+	EXPECT_EQ(0u, octree.Query(planes, eye, 1000000, positions, colors));
+
+	remove(scanPath.c_str());
+	remove(octreePath.c_str());
+	remove((octreePath + ".points").c_str());
+}
+
+TEST_F(point_cloud_octree_test, BinaryInputAndErrors)
+{
+	const std::string scanPath = testing::TempDir() + "point_cloud_octree_test.bin";
+	const std::string octreePath = testing::TempDir() + "point_cloud_octree_test_bin.bpo";
+
+	std::vector<float> scan;
+	std::vector<float> points;
+	for (int i = 0; i < 1000; i++)
+	{
+		const float point[4] = { float(i % 10), float(i / 10 % 10), float(i / 100), 1.0f };
+		points.insert(points.end(), point, point + 4);
+		scan.insert(scan.end(), point, point + 3);
+	}
+	std::ofstream file(scanPath.c_str(), std::ios::out | std::ios::binary);
+	file.write(reinterpret_cast<const char*>(points.data()), points.size() * sizeof(float));
+	file.close();
+
+	ASSERT_TRUE(bow::PointCloudOctree::Build(scanPath, octreePath, 100, 4));
+	bow::PointCloudOctree octree;
+	ASSERT_TRUE(octree.Open(octreePath));
+
+	float planes[6][4];
+	const float low[3] = { -1.0f, -1.0f, -1.0f }, high[3] = { 10.0f, 10.0f, 10.0f };
+	BoxPlanes(low, high, planes);
+	const float eye[3] = { 0.0f, 0.0f, 0.0f };
+	std::vector<float> positions, colors;
+	ASSERT_EQ(1000u, octree.Query(planes, eye, 1000, positions, colors));
+	EXPECT_EQ(ToPoints(scan), ToPoints(positions));
+	EXPECT_EQ(std::vector<float>(3000, 1.0f), colors);
+
+	// colors are appended to their own end, even if it differs from the one of the positions
+	positions.clear();
+	ASSERT_EQ(1000u, octree.Query(planes, eye, 1000, positions, colors));
+	EXPECT_EQ(3000u, positions.size());
+	EXPECT_EQ(std::vector<float>(6000, 1.0f), colors);
+
+	EXPECT_FALSE(bow::PointCloudOctree::Build(scanPath + ".missing.xyz", octreePath));
+	EXPECT_FALSE(octree.Open(scanPath));
+	EXPECT_EQ(0u, octree.GetNumNodes());
+
+	remove(scanPath.c_str());
+	remove(octreePath.c_str());
+	remove((octreePath + ".points").c_str());
+}
+
+TEST_F(point_cloud_octree_test, FrustumPlanes)
+{
+	// the identity maps the clip cube [-1, 1]^3 onto itself
+	const float identity[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+	float planes[6][4];
+	bow::PointCloudOctree::ExtractFrustumPlanes(identity, planes);
+
+	const float expected[6][4] = { { 0, 0, 1, 1 }, { 0, 0, -1, 1 }, { 1, 0, 0, 1 }, { -1, 0, 0, 1 }, { 0, -1, 0, 1 }, { 0, 1, 0, 1 } };
+	for (int p = 0; p < 6; p++)
+		for (int c = 0; c < 4; c++)
+			EXPECT_FLOAT_EQ(expected[p][c], planes[p][c]) << p << " " << c;
+
+	// a perspective projection looking down -z with near 1 and far 100
+	const float n = 1.0f, f = 100.0f;
+	const float perspective[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, -(f + n) / (f - n), -1, 0, 0, -2 * f * n / (f - n), 0 };
+	bow::PointCloudOctree::ExtractFrustumPlanes(perspective, planes);
+	const float inFront[3] = { 0.0f, 0.0f, -10.0f }, behind[3] = { 0.0f, 0.0f, 10.0f }, tooFar[3] = { 0.0f, 0.0f, -101.0f }, aside[3] = { 20.0f, 0.0f, -10.0f };
+	EXPECT_TRUE(Inside(planes, inFront));
+	EXPECT_FALSE(Inside(planes, behind));
+	EXPECT_FALSE(Inside(planes, tooFar));
+	EXPECT_FALSE(Inside(planes, aside));
+	EXPECT_NEAR(-1.0f, planes[0][3], 1e-4f);	// near plane at z = -1
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <Resources/FileLoader/PointCloudLoader/BowPointCloudTextScanner.h>
+
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Text point clouds for point_cloud_text_scanner_test and the benchmarks, and the import of the loaders before
+// PointCloudTextScanner to compare with
+
+// The line loop of the loaders before the scanner: safeGetline over an istringstream and parseReal per column
+inline std::istream& SafeGetline(std::istream& is, std::string& t)
+{
+	t.clear();
+	std::istream::sentry se(is, true);
+	std::streambuf* sb = is.rdbuf();
+	if (se)
+	{
+		for (;;)
+		{
+			int c = sb->sbumpc();
+			switch (c)
+			{
+			case '\n':
+				return is;
+			case '\r':
+				if (sb->sgetc() == '\n') sb->sbumpc();
+				return is;
+			case EOF:
+				if (t.empty()) is.setstate(std::ios::eofbit);
+				return is;
+			default:
+				t += static_cast<char>(c);
+			}
+		}
+	}
+	return is;
+}
+
+inline float ParseReal(const char** token, float default_value)
+{
+	(*token) += strspn((*token), " \t");
+	const char* end = (*token) + strcspn((*token), " \t\r");
+	float val = default_value;
+	bow::PointCloudTextScanner::ParseFloat((*token), end, &val);
+	(*token) = end;
+	return val;
+}
+
+inline std::vector<float> LegacyImport(const std::string& text, unsigned int numColumns, const float* defaults)
+{
+	std::vector<float> values;
+	std::string line;
+	std::istringstream dataStream(text.c_str());
+	while (SafeGetline(dataStream, line))
+	{
+		if (line.empty())
+			continue;
+
+		const char* token = line.c_str();
+		token += strspn(token, " \t");
+		for (unsigned int column = 0; column < numColumns; column++)
+			values.push_back(ParseReal(&token, defaults[column]));
+	}
+	return values;
+}
+
+// a laser scan with colours and normals, mixed formatting of the numbers and line endings
+inline std::string CreateTextCloud(unsigned int numPoints, unsigned int numColumns)
+{
+	std::mt19937 generator(17);
+	std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	std::ostringstream text;
+	for (unsigned int i = 0; i < numPoints; i++)
+	{
+		for (unsigned int column = 0; column < numColumns; column++)
+		{
+			if (column > 0)
+				text << (i % 5 == 0 ? "\t" : " ");
+			float value = column < 3 ? position(generator) : unit(generator);
+			if (i % 7 == 3)
+				text << std::scientific << value << std::fixed;
+			else
+				text << value;
+		}
+		text << (i % 11 == 0 ? "\r\n" : "\n");
+	}
+	return text.str();
+}
@@ -0,0 +1,80 @@
+#include <gmock/gmock.h>
+
+#include <Resources/FileLoader/PointCloudLoader/BowPointCloudTextScanner.h>
+
+#include "point_cloud_text.h"
+
+#include <string>
+#include <vector>
+
+class point_cloud_text_scanner_test: public testing::Test
+{
+public:
+	// point columns in one array per three columns, interleaved again to compare with LegacyImport
+	static std::vector<float> ScannerImport(const std::string& text, unsigned int numColumns, const float* defaults)
+	{
+		bow::PointCloudTextScanner scanner(text.data(), text.size());
+		const size_t numPoints = scanner.GetNumPoints();
+
+		std::vector<std::vector<float>> attributes(numColumns / 3, std::vector<float>(numPoints * 3 + 1));
+		std::vector<float*> pointers;
+		for (unsigned int i = 0; i < attributes.size(); i++)
+			pointers.push_back(attributes[i].data());
+		scanner.Parse(numColumns, defaults, pointers.data());
+
+		std::vector<float> values;
+		for (size_t point = 0; point < numPoints; point++)
+			for (unsigned int column = 0; column < numColumns; column++)
+				values.push_back(attributes[column / 3][point * 3 + column % 3]);
+		return values;
+	}
+};
+
+TEST_F(point_cloud_text_scanner_test, MatchesLegacyLoader)
+{
+	const float defaults[9] = { 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 0.0f };
+	for (unsigned int numColumns = 3; numColumns <= 9; numColumns += 3)
+	{
+		// large enough for several chunks
+		std::string text = CreateTextCloud(150000, numColumns);
+		ASSERT_GT(text.size(), 3u << 20);
+
+		std::vector<float> legacy = LegacyImport(text, numColumns, defaults);
+		std::vector<float> scanned = ScannerImport(text, numColumns, defaults);
+		EXPECT_EQ(legacy.size(), 150000u * numColumns);
+		EXPECT_EQ(legacy, scanned);
+	}
+}
+
+TEST_F(point_cloud_text_scanner_test, HandlesIrregularLines)
+{
+	const float defaults[6] = { 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f };
+	const char* texts[] = {
+		"1 2 3\n\n4 5 6",
+		"\r\n  1\t2 3 0.5\r\r7 8 9 1 1 1 extra\n",
+		"1 2 3\r4 5 6\r\n   \n-1.5e2 +3 x 1e 2 3\n",
+		"",
+		"\n\r\n",
+		"1.25 2 3 0.1 0.2 0.3",
+	};
+	for (const char* text : texts)
+	{
+		std::vector<float> legacy = LegacyImport(text, 6, defaults);
+		std::vector<float> scanned = ScannerImport(text, 6, defaults);
+		EXPECT_EQ(legacy, scanned) << "'" << text << "'";
+	}
+}
+
+TEST_F(point_cloud_text_scanner_test, StopsAtTerminator)
+{
+	const float defaults[3] = { 0.0f, 0.0f, 0.0f };
+	const char text[] = "1 2 3\n4 5 6\n\0 7 8 9\n";
+
+	bow::PointCloudTextScanner scanner(text, sizeof(text) - 1);
+	EXPECT_EQ(2u, scanner.GetNumPoints());
+
+	std::vector<float> points(6);
+	float* attributes[1] = { points.data() };
+	scanner.Parse(3, defaults, attributes);
+	EXPECT_EQ(6.0f, points[5]);
+}
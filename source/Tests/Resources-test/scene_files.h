@@ -0,0 +1,65 @@
+#pragma once
+
+#include <Platform/BowFileReader.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// The bundled scene files and how the resources read them before MappedFile, for mapped_file_test and the benchmarks
+
+// How the resources prepared their data before MappedFile: 1 KB reads copied into a terminated array
+inline std::vector<char> LegacyPrepare(const std::string& filePath)
+{
+	std::vector<char> data;
+	bow::FileReader reader;
+	if (!reader.Open(filePath.c_str()))
+		return data;
+
+	data.resize(reader.GetSizeOfFile());
+	data[data.size() - 1] = '\0';
+
+	char buffer[1024];
+	reader.Seek(0);
+	for (size_t i = 0, readBytes = 0; !reader.EndOfFile(); i += readBytes)
+	{
+		readBytes = reader.Read(buffer, 1024);
+		memcpy(data.data() + i, buffer, readBytes);
+	}
+	reader.Close();
+	return data;
+}
+
+// The bundled scene files: meshes, material libraries and the textures they reference
+inline std::vector<std::string> SceneFiles()
+{
+	const std::string scenes = std::string(TEST_DATA_DIR) + "/Scenes/";
+	std::vector<std::string> files;
+	const char* geometry[] = { "BoxScene", "Edge", "Wall" };
+	for (const char* name : geometry)
+	{
+		files.push_back(scenes + "EvaluationGeometry/" + name + ".obj");
+		files.push_back(scenes + "EvaluationGeometry/" + name + ".mtl");
+	}
+	files.push_back(scenes + "Sponza/sponza.mtl");
+
+	std::ifstream material((scenes + "Sponza/sponza.mtl").c_str());
+	std::string line;
+	while (std::getline(material, line))
+	{
+		std::istringstream tokens(line);
+		std::string key, texture;
+		if (tokens >> key >> texture && key.compare(0, 4, "map_") == 0)
+		{
+			std::replace(texture.begin(), texture.end(), '\\', '/');
+			texture = scenes + "Sponza/" + texture;
+			// not every texture of the material library is bundled
+			if (std::find(files.begin(), files.end(), texture) == files.end() && std::ifstream(texture.c_str()).good())
+				files.push_back(texture);
+		}
+	}
+	return files;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Synthetic point clouds for the point cloud tests and benchmarks
+
+/** Points on the walls of an axis aligned box from the origin to size, like a scanned room. Point i lies on side
+i % period in the order x = 0, x = size[0], y = 0, y = size[1], z = 0, z = size[2], so a period of 5 leaves out the
+ceiling and 6 closes the box. With a period of 7 every seventh point is an outlier up to 3 m above the floor level of
+the box instead. Points on a side are moved off it by normal distributed noise if noise > 0.
+*/
+inline std::vector<float> CreateRoomScan(unsigned int numPoints, const float size[3], unsigned int period, float noise, unsigned int seed)
+{
+	std::mt19937 generator(seed);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	std::normal_distribution<float> offset(0.0f, noise > 0.0f ? noise : 1.0f);
+
+	std::vector<float> points(size_t(numPoints) * 3);
+	for (unsigned int i = 0; i < numPoints; i++)
+	{
+		float* point = &points[size_t(i) * 3];
+		for (int d = 0; d < 3; d++)
+			point[d] = unit(generator) * size[d];
+
+		const unsigned int side = i % period;
+		if (side < 6)
+			point[side / 2] = (side % 2) * size[side / 2] + (noise > 0.0f ? offset(generator) : 0.0f);
+		else
+			point[2] += 3.0f * unit(generator);
+	}
+	return points;
+}
+
+// The xyz points in a random order, like a cloud merged from several captures
+inline std::vector<float> ShufflePoints(const std::vector<float>& points, unsigned int seed)
+{
+	std::vector<unsigned int> order(points.size() / 3);
+	for (unsigned int i = 0; i < order.size(); i++)
+		order[i] = i;
+	std::mt19937 generator(seed);
+	std::shuffle(order.begin(), order.end(), generator);
+
+	std::vector<float> shuffled(points.size());
+	for (size_t i = 0; i < order.size(); i++)
+		std::copy(&points[size_t(order[i]) * 3], &points[size_t(order[i]) * 3] + 3, &shuffled[i * 3]);
+	return shuffled;
+}
+
+// Writes points as .xtc lines "x y z r g b" with a red channel of x * redPerMeter, green 0.5 and blue 1
+inline void WriteTextScan(const std::string& filePath, const std::vector<float>& points, float redPerMeter)
+{
+	std::ofstream file(filePath.c_str(), std::ios::out | std::ios::binary);
+	char line[128];
+	for (size_t i = 0; i < points.size(); i += 3)
+	{
+		snprintf(line, sizeof(line), "%.9g %.9g %.9g %.9g 0.5 1\n", points[i], points[i + 1], points[i + 2], points[i] * redPerMeter);
+		file << line;
+	}
+}
+
+/** Frames of a depth camera at the origin looking down -z at a wall 3 m away and a box 2 m away, with noise growing
+with the distance and flying pixels along the edges of the box. The frames follow each other as xyz points.
+*/
+inline std::vector<float> CreateDepthFrames(unsigned int width, unsigned int height, unsigned int numFrames, unsigned int seed)
+{
+	std::mt19937 generator(seed);
+	std::normal_distribution<float> noise(0.0f, 1.0f);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	std::vector<float> points;
+	points.reserve(size_t(width) * height * numFrames * 3);
+	for (unsigned int frame = 0; frame < numFrames; frame++)
+	{
+		for (unsigned int y = 0; y < height; y++)
+		{
+			for (unsigned int x = 0; x < width; x++)
+			{
+				// 70 x 60 degrees field of view like a Kinect v2
+				const float dx = (2.0f * (x + 0.5f) / width - 1.0f) * 0.7f;
+				const float dy = (2.0f * (y + 0.5f) / height - 1.0f) * 0.58f;
+				const bool onBox = std::fabs(dx) < 0.2f && std::fabs(dy) < 0.2f;
+				float depth = onBox ? 2.0f : 3.0f;
+				if (onBox && (std::fabs(dx) > 0.19f || std::fabs(dy) > 0.19f) && unit(generator) < 0.3f)
+					depth = 2.0f + unit(generator);		// mixed pixel between box and wall
+				depth += noise(generator) * 0.0015f * depth * depth;
+
+				points.push_back(dx * depth);
+				points.push_back(dy * depth);
+				points.push_back(-depth);
+			}
+		}
+	}
+	return points;
+}
@@ -0,0 +1,178 @@
+#include <gmock/gmock.h>
+
+#include <Resources/Codecs/BowTransientHistogram.h>
+
+#include <half_float.h>
+
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+class transient_histogram_test: public testing::Test
+{
+public:
+	// a return of a few bins per pixel on a dark background
+	static std::vector<float> CreateHistograms(unsigned int width, unsigned int height, unsigned int bins)
+	{
+		std::mt19937 generator(5);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+		std::vector<float> histograms((size_t)width * height * bins);
+		for (size_t pixel = 0; pixel < (size_t)width * height; pixel++)
+		{
+			float* histogram = &histograms[pixel * bins];
+			for (unsigned int bin = 0; bin < bins; bin++)
+				histogram[bin] = 1e-4f * unit(generator);
+
+			unsigned int peak = (unsigned int)(unit(generator) * (bins - 4));
+			for (unsigned int bin = peak; bin < peak + 4; bin++)
+				histogram[bin] += 0.5f * unit(generator);
+		}
+		return histograms;
+	}
+};
+
+TEST_F(transient_histogram_test, HalfConversionMatchesRenderer)
+{
+	// the vector paths of the codec write the same bits as half_float.h, which has the rounding tests
+	std::vector<unsigned short> halfs(65536);
+	for (unsigned int i = 0; i < 65536; i++)
+		halfs[i] = (unsigned short)i;
+
+	std::vector<float> values(halfs.size());
+	bow::TransientHistogram::HalfToFloat(&halfs[0], halfs.size(), &values[0]);
+	for (unsigned int i = 0; i < 65536; i++)
+	{
+		// the hardware conversion quiets signalling nans
+		const float expected = half_to_float(halfs[i]);
+		if (std::isnan(expected))
+		{
+			EXPECT_TRUE(std::isnan(values[i])) << i;
+		}
+		else
+		{
+			EXPECT_EQ(0, memcmp(&expected, &values[i], sizeof(float))) << i;
+		}
+	}
+
+	// every half, the values halfway between neighbouring halfs and random values
+	std::mt19937 generator(3);
+	std::uniform_real_distribution<float> exponent(-26.0f, 17.0f);
+	for (unsigned int i = 0; i + 1 < 65536; i++)
+		values.push_back(0.5f * (half_to_float((unsigned short)i) + half_to_float((unsigned short)(i + 1))));
+	for (int i = 0; i < 10000; i++)
+		values.push_back((i & 1 ? -1.0f : 1.0f) * std::pow(2.0f, exponent(generator)));
+
+	std::vector<unsigned short> converted(values.size());
+	bow::TransientHistogram::FloatToHalf(&values[0], values.size(), &converted[0]);
+	for (size_t i = 0; i < values.size(); i++)
+	{
+		if (!std::isnan(values[i]))
+		{
+			EXPECT_EQ(float_to_half(values[i]), converted[i]) << i;
+		}
+	}
+}
+
+TEST_F(transient_histogram_test, RoundTrip)
+{
+	const unsigned int width = 37, height = 19, bins = 61;
+	std::vector<float> histograms = CreateHistograms(width, height, bins);
+	std::vector<float> ambient(width * height);
+	for (size_t pixel = 0; pixel < ambient.size(); pixel++)
+		ambient[pixel] = 0.01f * pixel;
+
+	std::vector<unsigned char> encoded;
+	ASSERT_TRUE(bow::TransientHistogram::Encode(&histograms[0], &ambient[0], width, height, bins, 0.04f, encoded));
+
+	unsigned int decodedWidth = 0, decodedHeight = 0, decodedBins = 0;
+	float binWidth = 0.0f;
+	ASSERT_TRUE(bow::TransientHistogram::ReadHeader(&encoded[0], encoded.size(), decodedWidth, decodedHeight, decodedBins, binWidth));
+	EXPECT_EQ(width, decodedWidth);
+	EXPECT_EQ(height, decodedHeight);
+	EXPECT_EQ(bins, decodedBins);
+	EXPECT_EQ(0.04f, binWidth);
+
+	std::vector<float> decoded(histograms.size());
+	std::vector<float> decodedAmbient(ambient.size());
+	ASSERT_TRUE(bow::TransientHistogram::Decode(&encoded[0], encoded.size(), &decoded[0], &decodedAmbient[0]));
+	EXPECT_EQ(ambient, decodedAmbient);
+	for (size_t i = 0; i < histograms.size(); i++)
+		EXPECT_NEAR(histograms[i], decoded[i], histograms[i] * std::ldexp(1.0f, -11) + 1e-7f);
+}
+
+TEST_F(transient_histogram_test, EncodesWeightedSums)
+{
+	const unsigned int width = 8, height = 4, bins = 16;
+	std::vector<float> histograms = CreateHistograms(width, height, bins);
+	std::vector<float> ambient(width * height, 1.0f);
+
+	// the renderer stores sums over a different number of samples per pixel
+	std::vector<float> sums(histograms.size());
+	std::vector<float> ambientSums(ambient.size());
+	std::vector<float> weights(width * height);
+	for (unsigned int pixel = 0; pixel < width * height; pixel++)
+	{
+		float samples = (float)(1 + pixel % 5);
+		weights[pixel] = 1.0f / samples;
+		ambientSums[pixel] = ambient[pixel] * samples;
+		for (unsigned int bin = 0; bin < bins; bin++)
+			sums[pixel * bins + bin] = histograms[pixel * bins + bin] * samples;
+	}
+
+	std::vector<unsigned char> encoded, expected;
+	ASSERT_TRUE(bow::TransientHistogram::Encode(&sums[0], &ambientSums[0], width, height, bins, 0.04f, encoded, &weights[0]));
+	ASSERT_TRUE(bow::TransientHistogram::Encode(&histograms[0], &ambient[0], width, height, bins, 0.04f, expected));
+	EXPECT_EQ(expected, encoded);
+}
+
+TEST_F(transient_histogram_test, CorrelateMatchesDecodedHistograms)
+{
+	const unsigned int width = 32, height = 24, bins = 100, numKernels = 6;
+	std::vector<float> histograms = CreateHistograms(width, height, bins);
+	std::vector<float> ambient(width * height, 0.0f);
+
+	std::vector<float> kernels(numKernels * bins);
+	for (unsigned int k = 0; k < numKernels; k++)
+		for (unsigned int bin = 0; bin < bins; bin++)
+			kernels[k * bins + bin] = 1.0f + std::cos(0.1f * bin + 1.3f * k);
+
+	std::vector<unsigned char> encoded;
+	ASSERT_TRUE(bow::TransientHistogram::Encode(&histograms[0], &ambient[0], width, height, bins, 0.04f, encoded));
+
+	std::vector<float> decoded(histograms.size());
+	ASSERT_TRUE(bow::TransientHistogram::Decode(&encoded[0], encoded.size(), &decoded[0], &ambient[0]));
+
+	std::vector<float> correlated(width * height * numKernels);
+	ASSERT_TRUE(bow::TransientHistogram::Correlate(&encoded[0], encoded.size(), &kernels[0], numKernels, &correlated[0]));
+
+	for (unsigned int pixel = 0; pixel < width * height; pixel++)
+	{
+		for (unsigned int k = 0; k < numKernels; k++)
+		{
+			double expected = 0.0;
+			for (unsigned int bin = 0; bin < bins; bin++)
+				expected += (double)kernels[k * bins + bin] * decoded[pixel * bins + bin];
+			EXPECT_NEAR(expected, correlated[pixel * numKernels + k], 1e-5 * (1.0 + std::abs(expected)));
+		}
+	}
+}
+
+TEST_F(transient_histogram_test, RejectsInvalidData)
+{
+	const unsigned int width = 16, height = 8, bins = 32;
+	std::vector<float> histograms = CreateHistograms(width, height, bins);
+	std::vector<float> ambient(width * height, 0.0f);
+
+	std::vector<unsigned char> encoded;
+	ASSERT_TRUE(bow::TransientHistogram::Encode(&histograms[0], &ambient[0], width, height, bins, 0.04f, encoded));
+
+	std::vector<float> decoded(histograms.size());
+	EXPECT_FALSE(bow::TransientHistogram::Decode(&encoded[0], encoded.size() - 2, &decoded[0], &ambient[0]));
+
+	encoded[0] = 'X';
+	EXPECT_FALSE(bow::TransientHistogram::Decode(&encoded[0], encoded.size(), &decoded[0], &ambient[0]));
+
+	EXPECT_FALSE(bow::TransientHistogram::Encode(&histograms[0], &ambient[0], width, height, 0, 0.04f, encoded));
+}
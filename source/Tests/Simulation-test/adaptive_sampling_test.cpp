@@ -0,0 +1,207 @@
+#include <gmock/gmock.h>
+
+#include <adaptive_sampling.h>
+#include <sampler.h>
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+class adaptive_sampling_test: public testing::Test
+{
+public:
+	typedef tof_sine_model Model;
+
+	static const unsigned int SamplesPerPass = 4;
+	static const unsigned int MinPasses = 4;
+
+	// A pixel of the ToF image: the direct return of a wall and, in corners, returns over a second wall
+	// that only some of the paths find
+	struct Pixel
+	{
+		float distance;
+		float footprintDepth;	// depth range of the surface inside the pixel footprint
+		float multipathProbability;
+		float multipathIntensity;
+		float multipathLength;	// longest detour of the indirect light
+	};
+
+	static tof_buckets<Model, float> Sample(const tof_modulation<float>& modulation, const Pixel& pixel, unsigned int key, unsigned int index)
+	{
+		float u1, u2;
+		sample_2d(key, index, 0, u1, u2);
+		const float u3 = sample_1d(key, index, 1);
+
+		tof_buckets<Model, float> buckets = tof_make_buckets<Model, float>();
+		const float distance = pixel.distance + (u1 - 0.5f) * pixel.footprintDepth;
+		tof_accumulate(modulation, tof_travel_time(2.0f * distance), 1.0f, buckets);
+
+		if (u3 < pixel.multipathProbability)
+		{
+			const float pathLength = 2.0f * distance + u2 * pixel.multipathLength;
+			tof_accumulate(modulation, tof_travel_time(pathLength), pixel.multipathIntensity / pixel.multipathProbability, buckets);
+		}
+		return buckets;
+	}
+
+	static tof_buckets<Model, float> RenderPass(const tof_modulation<float>& modulation, const Pixel& pixel, unsigned int key, unsigned int firstSample)
+	{
+		tof_buckets<Model, float> buckets = tof_make_buckets<Model, float>();
+		for (unsigned int s = 0; s < SamplesPerPass; s++)
+			tof_add_buckets(buckets, Sample(modulation, pixel, key, firstSample + s));
+		tof_scale_buckets(buckets, 1.0f / SamplesPerPass);
+		return buckets;
+	}
+
+	// 64 x 64 pixels, mostly flat walls, a band of multipath heavy corners
+	static std::vector<Pixel> CreateImage()
+	{
+		std::vector<Pixel> image;
+		for (unsigned int y = 0; y < 64; y++)
+		{
+			for (unsigned int x = 0; x < 64; x++)
+			{
+				Pixel pixel;
+				pixel.distance = 1.0f + 0.02f * x + 0.01f * y;
+				pixel.footprintDepth = 0.02f;
+				pixel.multipathProbability = 0.0f;
+				pixel.multipathIntensity = 0.0f;
+				pixel.multipathLength = 0.0f;
+				if (x >= 48)
+				{
+					pixel.multipathProbability = 0.3f;
+					pixel.multipathIntensity = 0.4f;
+					pixel.multipathLength = 1.5f;
+				}
+				image.push_back(pixel);
+			}
+		}
+		return image;
+	}
+
+	struct Result
+	{
+		double rmsError;
+		unsigned long long samples;
+	};
+
+	// distance of the expected buckets of every pixel
+	static std::vector<float> Reference(const tof_modulation<float>& modulation, const std::vector<Pixel>& image)
+	{
+		std::vector<float> reference(image.size());
+		for (size_t i = 0; i < image.size(); i++)
+		{
+			tof_buckets<Model, float> buckets = tof_make_buckets<Model, float>();
+			for (unsigned int s = 0; s < 1 << 12; s++)
+				tof_add_buckets(buckets, Sample(modulation, image[i], sampler_pixel_key((unsigned int)i, 1000), s));
+			reference[i] = tof_distance(modulation, buckets);
+		}
+		return reference;
+	}
+
+	// passes like launchPasses of the renderer, every pixel gets the first pass, threshold 0 renders all passes
+	static Result Render(const tof_modulation<float>& modulation, const std::vector<Pixel>& image, const std::vector<float>& reference, unsigned int maxPasses, float threshold)
+	{
+		std::vector<adaptive_statistics> statistics(image.size(), adaptive_make_statistics());
+		std::vector<tof_buckets<Model, float> > accumulated(image.size(), tof_make_buckets<Model, float>());
+
+		Result result = { 0.0, 0 };
+		for (unsigned int pass = 0; pass < maxPasses; pass++)
+		{
+			unsigned int unconverged = 0;
+			for (size_t i = 0; i < image.size(); i++)
+			{
+				if (pass > 0 && threshold > 0.0f && adaptive_converged(statistics[i], threshold, MinPasses))
+					continue;
+
+				const unsigned int key = sampler_pixel_key((unsigned int)i, 0);
+				tof_buckets<Model, float> buckets = RenderPass(modulation, image[i], key, (unsigned int)statistics[i].samples);
+
+				// running mean weighted by the samples, as the renderer blends the output buffer
+				const float a = (float)SamplesPerPass / (statistics[i].samples + SamplesPerPass);
+				for (int k = 0; k < Model::num_buckets; k++)
+					accumulated[i].value[k] += (buckets.value[k] - accumulated[i].value[k]) * a;
+
+				adaptive_add_pass<Model>(statistics[i], modulation, tof_distance(modulation, buckets), SamplesPerPass);
+				result.samples += SamplesPerPass;
+
+				if (threshold > 0.0f && !adaptive_converged(statistics[i], threshold, MinPasses))
+					unconverged++;
+			}
+
+			if (threshold > 0.0f && unconverged == 0)
+				break;
+		}
+
+		double squaredError = 0.0;
+		for (size_t i = 0; i < image.size(); i++)
+		{
+			const double error = tof_distance_difference<Model>(modulation, tof_distance(modulation, accumulated[i]), reference[i]);
+			squaredError += error * error;
+		}
+		result.rmsError = std::sqrt(squaredError / image.size());
+		return result;
+	}
+};
+
+TEST_F(adaptive_sampling_test, StatisticsMatchTwoPassFormula)
+{
+	const tof_modulation<float> modulation = tof_make_modulation(30e6f);
+
+	const float distances[5] = { 1.0f, 1.2f, 0.9f, 1.1f, 1.05f };
+	adaptive_statistics statistics = adaptive_make_statistics();
+	EXPECT_GT(adaptive_standard_error(statistics), 1e20f);
+
+	double mean = 0.0;
+	for (int i = 0; i < 5; i++)
+	{
+		adaptive_add_pass<Model>(statistics, modulation, distances[i], 4);
+		mean += distances[i] / 5.0;
+	}
+	double variance = 0.0;
+	for (int i = 0; i < 5; i++)
+		variance += (distances[i] - mean) * (distances[i] - mean) / 4.0;
+
+	EXPECT_FLOAT_EQ(20.0f, statistics.samples);
+	EXPECT_NEAR(mean, statistics.mean_distance, 1e-5);
+	EXPECT_NEAR(std::sqrt(variance / 5.0), adaptive_standard_error(statistics), 1e-5);
+}
+
+TEST_F(adaptive_sampling_test, PhaseWrapIsNotNoise)
+{
+	// 30 MHz wraps at 4.99654 m, estimates on both sides of the wrap belong to the same distance
+	const tof_modulation<float> modulation = tof_make_modulation(30e6f);
+	const float range = tof_speed_of_light<float>() / (2.0f * modulation.frequency);
+
+	adaptive_statistics statistics = adaptive_make_statistics();
+	const float distances[4] = { range - 0.01f, 0.01f, range - 0.02f, 0.02f };
+	for (int i = 0; i < 4; i++)
+		adaptive_add_pass<Model>(statistics, modulation, distances[i], 4);
+
+	EXPECT_LT(adaptive_standard_error(statistics), 0.02f);
+
+	// the pulse model does not wrap
+	adaptive_statistics pulse = adaptive_make_statistics();
+	for (int i = 0; i < 4; i++)
+		adaptive_add_pass<tof_pulse_model>(pulse, modulation, distances[i], 4);
+	EXPECT_GT(adaptive_standard_error(pulse), 1.0f);
+}
+
+TEST_F(adaptive_sampling_test, EqualDepthErrorWithFewerSamples)
+{
+	const tof_modulation<float> modulation = tof_make_modulation(30e6f);
+	const std::vector<Pixel> image = CreateImage();
+	const std::vector<float> reference = Reference(modulation, image);
+
+	const unsigned int passes = 16;
+	Result uniform = Render(modulation, image, reference, passes, 0.0f);
+
+	// the threshold is close to the error the uniform passes reach in the multipath corners, the walls stop early
+	Result adaptive = Render(modulation, image, reference, 4 * passes, 0.01f);
+
+	std::cout << "[          ] uniform:  " << uniform.samples << " samples, rms depth error " << uniform.rmsError * 1000.0 << " mm" << std::endl;
+	std::cout << "[          ] adaptive: " << adaptive.samples << " samples, rms depth error " << adaptive.rmsError * 1000.0 << " mm" << std::endl;
+
+	EXPECT_LE(adaptive.rmsError, uniform.rmsError * 1.05);
+	EXPECT_LT(adaptive.samples, uniform.samples * 3 / 4);
+}
@@ -0,0 +1,129 @@
+#include <gmock/gmock.h>
+
+#include <compact_storage.h>
+
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+class compact_storage_test: public testing::Test
+{
+public:
+	// standard deviation of the depth noise 03_TimeOfFlightRendering adds to four bucket distances, buckets of 1 are a full sensor
+	static double SensorNoise(double frequency, const float* buckets)
+	{
+		const double speedOfLight = 299792458.0;
+		const double modulationContrast = 60000.0;
+		const double pi = 3.14159265358979323846;
+
+		const double intensity = 0.5 * std::sqrt((buckets[2] - buckets[3]) * (buckets[2] - buckets[3]) + (buckets[0] - buckets[1]) * (buckets[0] - buckets[1]));
+		const double offset = (buckets[0] + buckets[1] + buckets[2] + buckets[3]) / 4.0;
+		return std::sqrt((speedOfLight / (4.0 * std::sqrt(2.0) * pi * frequency)) * std::sqrt(intensity + offset) / (modulationContrast * intensity));
+	}
+
+	// largest ratio of the distance error introduced by the format to the sensor noise, over returns from
+	// the darkest signal the renderer demodulates (200 of 65000 counts) up to a full sensor, with ambient
+	// light of up to ten times the signal
+	template <typename Model>
+	static double WorstErrorToNoise(unsigned int format)
+	{
+		const float frequency = 30e6f;
+		const tof_modulation<float> modulation = tof_make_modulation(frequency);
+
+		std::mt19937 generator(11);
+		std::uniform_real_distribution<float> pathLength(0.2f, 9.8f);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+		double worst = 0.0;
+		for (int i = 0; i < 100000; i++)
+		{
+			const float ambientRatio = 10.0f * unit(generator);
+			const float darkest = 200.0f / 65000.0f;
+			const float brightest = 1.0f / (1.0f + ambientRatio);
+			const float intensity = darkest * std::pow(brightest / darkest, unit(generator));
+
+			tof_buckets<Model, float> buckets = tof_make_buckets<Model, float>();
+			tof_accumulate(modulation, tof_travel_time(pathLength(generator)), intensity, buckets);
+			tof_accumulate_ambient(intensity * ambientRatio, buckets);
+
+			unsigned int words[Model::num_buckets];
+			tof_buckets<Model, float> loaded;
+			compact_store_buckets<Model>(format, compact_default_fixed_scale(), buckets.value, words);
+			compact_load_buckets<Model>(format, compact_default_fixed_scale(), words, loaded.value);
+
+			const double error = std::abs(tof_distance_difference<Model>(modulation, tof_distance(modulation, loaded), tof_distance(modulation, buckets)));
+			worst = std::max(worst, error / SensorNoise(frequency, buckets.value));
+		}
+		return worst;
+	}
+};
+
+TEST_F(compact_storage_test, FixedPointRoundTrip)
+{
+	const float scale = compact_default_fixed_scale();
+	EXPECT_EQ(0u, compact_float_to_fixed(-1.0f, scale));
+	EXPECT_EQ(0xffffffffu, compact_float_to_fixed(1e10f, scale));
+
+	std::mt19937 generator(7);
+	std::uniform_real_distribution<float> value(0.0f, 4000.0f);
+	for (int i = 0; i < 10000; i++)
+	{
+		const float bucket = value(generator);
+		const float loaded = compact_fixed_to_float(compact_float_to_fixed(bucket, scale), scale);
+		EXPECT_LE(std::abs(loaded - bucket), std::max(0.5f / scale, bucket * std::ldexp(1.0f, -23)));
+	}
+}
+
+TEST_F(compact_storage_test, PacksBucketsOfEveryModel)
+{
+	const float buckets[4] = { 0.25f, 1.5f, 3.0f, 0.125f };
+	unsigned int words[4] = { 0, 0, 0, 0 };
+	float loaded[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+	EXPECT_EQ(1u, compact_words_per_pixel<tof_pulse_model>(COMPACT_BUCKETS_HALF));
+	EXPECT_EQ(2u, compact_words_per_pixel<tof_sine_model>(COMPACT_BUCKETS_HALF));
+	EXPECT_EQ(4u, compact_words_per_pixel<tof_rect_model>(COMPACT_BUCKETS_FIXED));
+	EXPECT_EQ(0u, compact_words_per_pixel<tof_rect_model>(COMPACT_BUCKETS_FLOAT));
+
+	compact_store_buckets<tof_pulse_model>(COMPACT_BUCKETS_HALF, 1.0f, buckets, words);
+	compact_load_buckets<tof_pulse_model>(COMPACT_BUCKETS_HALF, 1.0f, words, loaded);
+	EXPECT_EQ(buckets[0], loaded[0]);
+	EXPECT_EQ(buckets[1], loaded[1]);
+	EXPECT_EQ(0u, words[1]);
+
+	compact_store_buckets<tof_rect_model>(COMPACT_BUCKETS_HALF, 1.0f, buckets, words);
+	compact_load_buckets<tof_rect_model>(COMPACT_BUCKETS_HALF, 1.0f, words, loaded);
+	for (int i = 0; i < 4; i++)
+		EXPECT_EQ(buckets[i], loaded[i]);
+
+	compact_store_buckets<tof_sine_model>(COMPACT_BUCKETS_FIXED, 64.0f, buckets, words);
+	compact_load_buckets<tof_sine_model>(COMPACT_BUCKETS_FIXED, 64.0f, words, loaded);
+	for (int i = 0; i < 4; i++)
+		EXPECT_EQ(buckets[i], loaded[i]);
+}
+
+TEST_F(compact_storage_test, ColorIsRounded)
+{
+	EXPECT_EQ(0, compact_unorm8(-0.5f));
+	EXPECT_EQ(0, compact_unorm8(0.5f / 255.0f - 1e-4f));
+	EXPECT_EQ(128, compact_unorm8(0.5f));
+	EXPECT_EQ(255, compact_unorm8(2.0f));
+}
+
+TEST_F(compact_storage_test, DepthErrorIsBelowSensorNoise)
+{
+	const double halfRect = WorstErrorToNoise<tof_rect_model>(COMPACT_BUCKETS_HALF);
+	const double halfSine = WorstErrorToNoise<tof_sine_model>(COMPACT_BUCKETS_HALF);
+	const double fixedRect = WorstErrorToNoise<tof_rect_model>(COMPACT_BUCKETS_FIXED);
+	const double fixedSine = WorstErrorToNoise<tof_sine_model>(COMPACT_BUCKETS_FIXED);
+
+	std::cout << "[          ] largest depth error relative to the sensor noise" << std::endl;
+	std::cout << "[          ] half:  rect " << halfRect << ", sine " << halfSine << std::endl;
+	std::cout << "[          ] fixed: rect " << fixedRect << ", sine " << fixedSine << std::endl;
+
+	EXPECT_LT(halfRect, 1.0);
+	EXPECT_LT(halfSine, 1.0);
+	EXPECT_LT(fixedRect, 1.0);
+	EXPECT_LT(fixedSine, 1.0);
+}
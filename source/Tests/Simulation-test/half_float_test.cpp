@@ -0,0 +1,46 @@
+#include <gmock/gmock.h>
+
+#include <half_float.h>
+
+#include <cmath>
+#include <random>
+
+class half_float_test: public testing::Test
+{
+};
+
+TEST_F(half_float_test, RoundTrip)
+{
+	// every half except nan survives the way through float unchanged
+	for (unsigned int i = 0; i < 65536; i++)
+	{
+		const float value = half_to_float((unsigned short)i);
+		if ((i & 0x7c00) == 0x7c00 && (i & 0x03ff) != 0)
+			EXPECT_TRUE(std::isnan(value));
+		else
+			EXPECT_EQ(i, float_to_half(value));
+	}
+
+	EXPECT_EQ(1.0f, half_to_float(0x3c00));
+	EXPECT_EQ(-2.0f, half_to_float(0xc000));
+	EXPECT_EQ(65504.0f, half_to_float(0x7bff));
+	EXPECT_EQ(std::ldexp(1.0f, -24), half_to_float(0x0001));
+	EXPECT_EQ(0x7c00, float_to_half(65520.0f));
+	EXPECT_EQ(0x0000, float_to_half(std::ldexp(1.0f, -25)));
+	EXPECT_EQ(0x0001, float_to_half(std::ldexp(1.5f, -25)));
+}
+
+TEST_F(half_float_test, RoundsToNearestEven)
+{
+	// exactly between 1 and the next half, and between the next two
+	EXPECT_EQ(0x3c00, float_to_half(1.0f + std::ldexp(1.0f, -11)));
+	EXPECT_EQ(0x3c02, float_to_half(1.0f + 3.0f * std::ldexp(1.0f, -11)));
+
+	std::mt19937 generator(3);
+	std::uniform_real_distribution<float> exponent(-14.0f, 15.0f);
+	for (int i = 0; i < 10000; i++)
+	{
+		const float value = std::pow(2.0f, exponent(generator));
+		EXPECT_LE(std::abs(half_to_float(float_to_half(value)) - value), value * std::ldexp(1.0f, -11));
+	}
+}
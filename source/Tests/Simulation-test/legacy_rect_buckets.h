@@ -0,0 +1,34 @@
+#pragma once
+
+// Rectangular pulse train the renderer used before the correlation models of tof_correlation.h, copied from
+// microfacet_closest_hit. Shared by tof_correlation_test and the benchmarks as the reference implementation.
+inline void LegacyRectBuckets(double frequency, double deltaTime, double intensity, double* buckets)
+{
+	const double pulselength = (1.0 / frequency) * 0.5;
+
+	const double C_start[4] = { 0.0, pulselength, pulselength * 0.5, (pulselength * 0.5) + pulselength };
+
+	while (deltaTime < C_start[3] + pulselength)
+	{
+		deltaTime = deltaTime + (pulselength * 2.0);
+	}
+
+	while (deltaTime + pulselength > 0.0)
+	{
+		double begin = deltaTime;
+		double end = deltaTime + pulselength;
+
+		for (int i = 0; i < 4; i++)
+		{
+			if ((end >= C_start[i] && end <= C_start[i] + pulselength) || (begin >= C_start[i] && begin <= C_start[i] + pulselength))
+			{
+				if (begin > C_start[i])
+					buckets[i] += (((C_start[i] + pulselength) - begin) / pulselength) * intensity;
+				else
+					buckets[i] += ((end - C_start[i]) / pulselength) * intensity;
+			}
+		}
+
+		deltaTime = deltaTime - (pulselength * 2.0);
+	}
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <light_sampling.h>
+#include <sampler.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Square board of n x n leds with slightly different power and a wall at wallDistance in front of it, with spheres
+// between the board and the wall as occluders. Shared by light_sampling_test and the benchmarks.
+struct LightSamplingScene
+{
+	enum Strategy { Exhaustive, Alias, Bvh };
+
+	std::vector<float> positions;	// x, y, z of every led, the board faces +z
+	std::vector<float> power;
+	std::vector<float> occluders;	// x, y, z, radius of spheres between the board and the wall
+	float wallDistance;
+	float footprintSize;
+
+	static float Hash(unsigned int value)
+	{
+		return sampler_to_float(sampler_hash(value));
+	}
+
+	static LightSamplingScene Create(unsigned int n, float boardSize, float wallDistance, float footprintSize)
+	{
+		LightSamplingScene scene;
+		for (unsigned int y = 0; y < n; y++)
+		{
+			for (unsigned int x = 0; x < n; x++)
+			{
+				scene.positions.push_back(((x + 0.5f) / n - 0.5f) * boardSize);
+				scene.positions.push_back(((y + 0.5f) / n - 0.5f) * boardSize);
+				scene.positions.push_back(0.0f);
+				scene.power.push_back(0.5f + Hash(y * n + x));
+			}
+		}
+
+		for (unsigned int i = 0; i < 16; i++)
+		{
+			scene.occluders.push_back((Hash(4 * i + 100) - 0.5f) * (boardSize + footprintSize));
+			scene.occluders.push_back((Hash(4 * i + 101) - 0.5f) * (boardSize + footprintSize));
+			scene.occluders.push_back((0.2f + 0.6f * Hash(4 * i + 102)) * wallDistance);
+			scene.occluders.push_back(0.02f * (boardSize + footprintSize) * (0.5f + Hash(4 * i + 103)));
+		}
+
+		scene.wallDistance = wallDistance;
+		scene.footprintSize = footprintSize;
+		return scene;
+	}
+
+	unsigned int NumLights() const
+	{
+		return (unsigned int)power.size();
+	}
+
+	// stands in for the shadow ray of microfacet_closest_hit
+	bool Visible(const float* from, const float* to) const
+	{
+		float direction[3] = { to[0] - from[0], to[1] - from[1], to[2] - from[2] };
+		float lengthPow2 = direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2];
+		for (size_t i = 0; i < occluders.size(); i += 4)
+		{
+			float toCenter[3] = { occluders[i] - from[0], occluders[i + 1] - from[1], occluders[i + 2] - from[2] };
+			float t = (toCenter[0] * direction[0] + toCenter[1] * direction[1] + toCenter[2] * direction[2]) / lengthPow2;
+			t = std::min(1.0f, std::max(0.0f, t));
+			float dx = toCenter[0] - t * direction[0];
+			float dy = toCenter[1] - t * direction[1];
+			float dz = toCenter[2] - t * direction[2];
+			if (dx * dx + dy * dy + dz * dz < occluders[i + 3] * occluders[i + 3])
+				return false;
+		}
+		return true;
+	}
+
+	// irradiance of one led on the wall
+	float Contribution(unsigned int light, const float* point) const
+	{
+		const float* position = &positions[light * 3];
+		float dx = position[0] - point[0];
+		float dy = position[1] - point[1];
+		float dz = position[2] - point[2];
+		float distancePow2 = dx * dx + dy * dy + dz * dz;
+		float cosTheta = -dz / std::sqrt(distancePow2);
+		if (cosTheta <= 0.0f || !Visible(point, position))
+			return 0.0f;
+		return power[light] * cosTheta * cosTheta / distancePow2;
+	}
+
+	void WallPoint(unsigned int pixel, unsigned int sample, float* point) const
+	{
+		float u1, u2;
+		sample_2d(sampler_pixel_key(pixel, 0), sample, 0, u1, u2);
+		point[0] = (u1 - 0.5f) * footprintSize;
+		point[1] = (u2 - 0.5f) * footprintSize;
+		point[2] = wallDistance;
+	}
+
+	// mean irradiance over the footprint of one pixel
+	double Estimate(Strategy strategy, const std::vector<light_alias_entry>& table, const std::vector<light_bvh_node>& nodes, unsigned int pixel, unsigned int numSamples) const
+	{
+		const unsigned int numLights = NumLights();
+
+		double sum = 0.0;
+		for (unsigned int s = 0; s < numSamples; s++)
+		{
+			float point[3];
+			WallPoint(pixel, s, point);
+
+			if (strategy == Exhaustive)
+			{
+				for (unsigned int light = 0; light < numLights; light++)
+					sum += Contribution(light, point);
+			}
+			else
+			{
+				float u = sample_1d(sampler_pixel_key(pixel, 0), s, 1);
+				float pdf;
+				unsigned int light = strategy == Alias ? light_alias_sample(table.data(), numLights, u, pdf) : light_bvh_sample(nodes.data(), point, u, pdf);
+				sum += Contribution(light, point) / pdf;
+			}
+		}
+		return sum / numSamples;
+	}
+
+	// exhaustive estimates of the first numPixels pixels
+	std::vector<double> Reference(unsigned int numPixels, unsigned int numSamples) const
+	{
+		std::vector<light_alias_entry> table;
+		std::vector<light_bvh_node> nodes;
+		std::vector<double> reference(numPixels);
+		for (unsigned int pixel = 0; pixel < numPixels; pixel++)
+			reference[pixel] = Estimate(Exhaustive, table, nodes, pixel, numSamples);
+		return reference;
+	}
+
+	// mean squared error of the estimates of a strategy against the reference
+	double Variance(Strategy strategy, unsigned int numSamples, const std::vector<double>& reference) const
+	{
+		std::vector<light_alias_entry> table(NumLights());
+		light_alias_build(power.data(), NumLights(), table.data());
+		std::vector<light_bvh_node> nodes = light_bvh_build(positions.data(), power.data(), NumLights());
+
+		double squaredError = 0.0;
+		for (unsigned int pixel = 0; pixel < reference.size(); pixel++)
+		{
+			double estimate = Estimate(strategy, table, nodes, pixel, numSamples);
+			squaredError += (estimate - reference[pixel]) * (estimate - reference[pixel]);
+		}
+		return squaredError / reference.size();
+	}
+};
@@ -0,0 +1,142 @@
+#include <gmock/gmock.h>
+
+#include <light_sampling.h>
+
+#include "light_sampling_scene.h"
+
+#include <vector>
+
+class light_sampling_test: public testing::Test
+{
+public:
+	typedef LightSamplingScene Scene;
+};
+
+TEST_F(light_sampling_test, AliasTableFollowsPower)
+{
+	const float power[6] = { 1.0f, 4.0f, 0.0f, 2.0f, 0.5f, 0.5f };
+	std::vector<light_alias_entry> table(6);
+	light_alias_build(power, 6, table.data());
+
+	const unsigned int numSamples = 8000;
+	std::vector<unsigned int> counts(6, 0);
+	for (unsigned int s = 0; s < numSamples; s++)
+	{
+		float pdf;
+		unsigned int light = light_alias_sample(table.data(), 6, (s + 0.5f) / numSamples, pdf);
+		ASSERT_LT(light, 6u);
+		EXPECT_FLOAT_EQ(power[light] / 8.0f, pdf);
+		counts[light]++;
+	}
+
+	// stratified u reproduces the distribution up to the slot resolution
+	for (unsigned int i = 0; i < 6; i++)
+		EXPECT_NEAR(power[i] / 8.0, (double)counts[i] / numSamples, 1e-3) << "light " << i;
+	EXPECT_EQ(0u, counts[2]);
+}
+
+TEST_F(light_sampling_test, AliasTableWithoutPowerIsUniform)
+{
+	const float power[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	std::vector<light_alias_entry> table(4);
+	light_alias_build(power, 4, table.data());
+
+	for (unsigned int i = 0; i < 4; i++)
+	{
+		float pdf;
+		EXPECT_EQ(i, light_alias_sample(table.data(), 4, (i + 0.5f) / 4.0f, pdf));
+		EXPECT_FLOAT_EQ(0.25f, pdf);
+	}
+}
+
+TEST_F(light_sampling_test, BvhPdfIsNormalized)
+{
+	Scene scene = Scene::Create(7, 0.5f, 1.0f, 1.0f);
+	std::vector<light_bvh_node> nodes = light_bvh_build(scene.positions.data(), scene.power.data(), 49);
+	ASSERT_EQ(2u * 49u - 1u, nodes.size());
+
+	const float points[3][3] = { { 0.0f, 0.0f, 1.0f }, { 0.3f, -0.2f, 0.05f }, { -2.0f, 1.0f, 0.5f } };
+	for (int p = 0; p < 3; p++)
+	{
+		double sum = 0.0;
+		for (unsigned int leaf = 0; leaf < 49; leaf++)
+			sum += light_bvh_pdf(nodes.data(), points[p], leaf);
+		EXPECT_NEAR(1.0, sum, 1e-5);
+	}
+}
+
+TEST_F(light_sampling_test, BvhSampleMatchesPdf)
+{
+	Scene scene = Scene::Create(5, 1.0f, 0.2f, 0.5f);
+	std::vector<light_bvh_node> nodes = light_bvh_build(scene.positions.data(), scene.power.data(), 25);
+
+	std::vector<unsigned int> leafOfLight(25);
+	for (size_t i = 0; i < nodes.size(); i++)
+	{
+		if (nodes[i].second_child == 0)
+			leafOfLight[nodes[i].light_index] = nodes[i].first;
+	}
+
+	const float point[3] = { 0.35f, 0.1f, 0.2f };
+	const unsigned int numSamples = 20000;
+	std::vector<unsigned int> counts(25, 0);
+	for (unsigned int s = 0; s < numSamples; s++)
+	{
+		float pdf;
+		unsigned int light = light_bvh_sample(nodes.data(), point, (s + 0.5f) / numSamples, pdf);
+		ASSERT_LT(light, 25u);
+		EXPECT_NEAR(light_bvh_pdf(nodes.data(), point, leafOfLight[light]), pdf, 1e-5);
+		counts[light]++;
+	}
+
+	for (unsigned int light = 0; light < 25; light++)
+		EXPECT_NEAR(light_bvh_pdf(nodes.data(), point, leafOfLight[light]), (double)counts[light] / numSamples, 2e-3) << "light " << light;
+
+	// the closest led gets more samples than the most distant one
+	EXPECT_GT(counts[4 + 5 * 2], counts[0 + 5 * 0]);
+}
+
+TEST_F(light_sampling_test, SamplingIsUnbiased)
+{
+	Scene scene = Scene::Create(4, 0.3f, 0.5f, 0.5f);
+	std::vector<double> reference = scene.Reference(4, 4096);
+
+	std::vector<light_alias_entry> table(16);
+	light_alias_build(scene.power.data(), 16, table.data());
+	std::vector<light_bvh_node> nodes = light_bvh_build(scene.positions.data(), scene.power.data(), 16);
+
+	for (unsigned int pixel = 0; pixel < 4; pixel++)
+	{
+		double alias = scene.Estimate(Scene::Alias, table, nodes, pixel, 1 << 16);
+		double bvh = scene.Estimate(Scene::Bvh, table, nodes, pixel, 1 << 16);
+		EXPECT_NEAR(1.0, alias / reference[pixel], 0.01);
+		EXPECT_NEAR(1.0, bvh / reference[pixel], 0.01);
+	}
+}
+
+TEST_F(light_sampling_test, LedBoardVarianceAtEqualShadowRays)
+{
+	// illumination board of a ToF camera, the wall is far away compared to the board size. One exhaustive sample
+	// traces as many shadow rays as 64 samples of a single light.
+	Scene scene = Scene::Create(8, 0.04f, 2.0f, 0.5f);
+	std::vector<double> reference = scene.Reference(16, 1024);
+
+	double exhaustive = scene.Variance(Scene::Exhaustive, 1, reference);
+	double alias = scene.Variance(Scene::Alias, 64, reference);
+	double bvh = scene.Variance(Scene::Bvh, 64, reference);
+
+	EXPECT_LT(alias, exhaustive);
+	EXPECT_LT(bvh, exhaustive);
+}
+
+TEST_F(light_sampling_test, LargePanelBvhBeatsAliasTable)
+{
+	// the wall is close to a large panel, only the leds next to the footprint matter
+	Scene scene = Scene::Create(16, 2.0f, 0.3f, 0.2f);
+	std::vector<double> reference = scene.Reference(16, 256);
+
+	double alias = scene.Variance(Scene::Alias, 64, reference);
+	double bvh = scene.Variance(Scene::Bvh, 64, reference);
+
+	EXPECT_LT(bvh * 2.0, alias);
+}
@@ -0,0 +1,115 @@
+#include <gmock/gmock.h>
+
+#include <progressive_accumulation.h>
+
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+class progressive_accumulation_test: public testing::Test
+{
+public:
+	// the blend of the renderer before the compensated sums
+	static float Lerp(float a, float b, float t)
+	{
+		return a + t * (b - a);
+	}
+
+	// noisy pass means of a bucket, every pass with its own number of samples
+	static void CreatePasses(unsigned int count, std::vector<float>& values, std::vector<float>& weights)
+	{
+		std::mt19937 generator(13);
+		std::normal_distribution<float> noise(0.37f, 0.05f);
+		std::uniform_int_distribution<int> samples(1, 4);
+
+		values.resize(count);
+		weights.resize(count);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			values[i] = noise(generator);
+			weights[i] = (float)samples(generator);
+		}
+	}
+};
+
+TEST_F(progressive_accumulation_test, DriftAfter100kFrames)
+{
+	const unsigned int frames = 100000;
+	std::vector<float> values, weights;
+	CreatePasses(frames, values, weights);
+
+	double referenceSum = 0.0, referenceWeight = 0.0;
+	float lerpMean = 0.0f, lerpWeight = 0.0f;
+	progressive_sum<1> accumulator = progressive_make_sum<1>();
+	for (unsigned int i = 0; i < frames; i++)
+	{
+		referenceSum += (double)values[i] * weights[i];
+		referenceWeight += weights[i];
+
+		lerpWeight += weights[i];
+		lerpMean = Lerp(lerpMean, values[i], weights[i] / lerpWeight);
+
+		progressive_add(accumulator, &values[i], weights[i]);
+	}
+
+	const double reference = referenceSum / referenceWeight;
+	float mean = 0.0f;
+	progressive_mean(accumulator, &mean);
+
+	std::cout << "[          ] drift after " << frames << " frames: lerp " << std::abs(lerpMean - reference) << ", compensated sum " << std::abs(mean - reference) << std::endl;
+
+	// the compensated mean is the reference rounded to float
+	EXPECT_LE(std::abs(mean - reference), reference * std::ldexp(1.0, -23));
+	EXPECT_GT(std::abs(lerpMean - reference), 10.0 * std::abs(mean - reference));
+}
+
+TEST_F(progressive_accumulation_test, WeightsPassesBySamples)
+{
+	progressive_sum<2> accumulator = progressive_make_sum<2>();
+
+	const float first[2] = { 1.0f, 4.0f };
+	const float second[2] = { 3.0f, 0.0f };
+	progressive_add(accumulator, first, 1.0f);
+	progressive_add(accumulator, second, 3.0f);
+
+	float mean[2];
+	progressive_mean(accumulator, mean);
+	EXPECT_FLOAT_EQ(2.5f, mean[0]);
+	EXPECT_FLOAT_EQ(1.0f, mean[1]);
+
+	progressive_sum<2> empty = progressive_make_sum<2>();
+	progressive_mean(empty, mean);
+	EXPECT_EQ(0.0f, mean[0]);
+}
+
+TEST_F(progressive_accumulation_test, MergeMatchesSinglePixel)
+{
+	// passes rendered on two nodes with different sample counts, merged afterwards
+	const unsigned int frames = 20000;
+	std::vector<float> values, weights;
+	CreatePasses(frames, values, weights);
+
+	progressive_sum<1> single = progressive_make_sum<1>();
+	progressive_sum<1> nodes[2] = { progressive_make_sum<1>(), progressive_make_sum<1>() };
+	double referenceSum = 0.0, referenceWeight = 0.0;
+	for (unsigned int i = 0; i < frames; i++)
+	{
+		progressive_add(single, &values[i], weights[i]);
+		progressive_add(nodes[i % 3 == 0 ? 1 : 0], &values[i], weights[i]);
+
+		referenceSum += (double)values[i] * weights[i];
+		referenceWeight += weights[i];
+	}
+
+	progressive_merge(nodes[0], nodes[1]);
+	EXPECT_EQ(single.weight + single.weight_compensation, nodes[0].weight + nodes[0].weight_compensation);
+
+	float mergedMean = 0.0f, singleMean = 0.0f;
+	progressive_mean(nodes[0], &mergedMean);
+	progressive_mean(single, &singleMean);
+
+	const double reference = referenceSum / referenceWeight;
+	EXPECT_LE(std::abs(mergedMean - reference), reference * std::ldexp(1.0, -23));
+	EXPECT_LE(std::abs(singleMean - reference), reference * std::ldexp(1.0, -23));
+}
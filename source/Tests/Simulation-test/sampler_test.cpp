@@ -0,0 +1,284 @@
+#include <gmock/gmock.h>
+
+#include <sampler.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+class sampler_test: public testing::Test
+{
+public:
+	// generator that pathtrace_camera used before, copied from cuda/random.h
+	struct TeaLcgGenerator
+	{
+		TeaLcgGenerator(unsigned int pixel, unsigned int frame)
+		{
+			unsigned int v0 = pixel;
+			unsigned int v1 = frame;
+			unsigned int s0 = 0;
+			for (unsigned int n = 0; n < 16; n++)
+			{
+				s0 += 0x9e3779b9;
+				v0 += ((v1 << 4) + 0xa341316c) ^ (v1 + s0) ^ ((v1 >> 5) + 0xc8013ea4);
+				v1 += ((v0 << 4) + 0xad90777d) ^ (v0 + s0) ^ ((v0 >> 5) + 0x7e95761e);
+			}
+			seed = v0;
+			draws = 0;
+		}
+
+		float rnd()
+		{
+			draws++;
+			seed = 1664525u * seed + 1013904223u;
+			return (float)(seed & 0x00FFFFFF) / (float)0x01000000;
+		}
+
+		unsigned int seed;
+		unsigned int draws;
+	};
+
+	// Fixed scene: the pixel footprint covers a depth edge between a surface at 1.0 m and 1.6 m, a diffuse bounce
+	// reaches a wall on one side of the hemisphere and russian roulette ends half of the bounces.
+	// Returns the path length weighted contribution to the second bucket of a pulsed sensor.
+	static float EvaluatePath(float jitterX, float jitterY, float bounceU1, float bounceU2, float roulette, bool indirect)
+	{
+		const float pulseLength = 7500.0f;
+
+		float depth = (0.866f * jitterX + 0.5f * jitterY > 0.1f) ? 1600.0f : 1000.0f;
+		float pathLength = 2.0f * depth;
+		float bucket = pathLength / pulseLength;
+
+		if (indirect && roulette < 0.5f)
+		{
+			float r = std::sqrt(bounceU1);
+			float phi = 2.0f * 3.14159265f * bounceU2;
+			float x = r * std::cos(phi);
+			float z = std::sqrt(std::max(0.0f, 1.0f - bounceU1));
+			if (x > 0.2f)
+			{
+				float indirectLength = pathLength + 800.0f * (1.0f + z);
+				bucket += 2.0f * 0.5f * (indirectLength / pulseLength);
+			}
+		}
+		return bucket;
+	}
+
+	static float EstimateTeaLcg(unsigned int pixel, unsigned int numSamples, bool indirect, unsigned int& draws)
+	{
+		TeaLcgGenerator generator(pixel, 1);
+		float sum = 0.0f;
+		for (unsigned int s = 0; s < numSamples; s++)
+		{
+			float jitterX, jitterY;
+			do
+			{
+				jitterX = generator.rnd() - 0.5f;
+				jitterY = generator.rnd() - 0.5f;
+			} while (std::sqrt(jitterX * jitterX + jitterY * jitterY) > 0.5f);
+
+			float bounceU1 = generator.rnd();
+			float bounceU2 = generator.rnd();
+			sum += EvaluatePath(jitterX, jitterY, bounceU1, bounceU2, generator.rnd(), indirect);
+		}
+		draws += generator.draws;
+		return sum / (float)numSamples;
+	}
+
+	static float EstimateSobol(unsigned int pixel, unsigned int numSamples, bool indirect)
+	{
+		unsigned int pixelKey = sampler_pixel_key(pixel, 0);
+		float sum = 0.0f;
+		for (unsigned int s = 0; s < numSamples; s++)
+		{
+			float u1, u2, jitterX, jitterY;
+			sample_2d(pixelKey, s, 0, u1, u2);
+			concentric_sample_disk(u1, u2, jitterX, jitterY);
+
+			float bounceU1, bounceU2;
+			sample_2d(pixelKey, s, 1, bounceU1, bounceU2);
+			sum += EvaluatePath(jitterX * 0.5f, jitterY * 0.5f, bounceU1, bounceU2, sample_1d(pixelKey, s, 2), indirect);
+		}
+		return sum / (float)numSamples;
+	}
+
+	// variance of the per pixel estimates around the reference value
+	static double Variance(const std::vector<float>& estimates, double reference)
+	{
+		double sum = 0.0;
+		for (size_t i = 0; i < estimates.size(); i++)
+			sum += (estimates[i] - reference) * (estimates[i] - reference);
+		return sum / (double)estimates.size();
+	}
+
+	// slope of log(variance) over log(samples)
+	static double ConvergenceRate(const std::vector<unsigned int>& samples, const std::vector<double>& variances)
+	{
+		double meanX = 0.0, meanY = 0.0;
+		for (size_t i = 0; i < samples.size(); i++)
+		{
+			meanX += std::log((double)samples[i]);
+			meanY += std::log(variances[i]);
+		}
+		meanX /= samples.size();
+		meanY /= samples.size();
+
+		double covariance = 0.0, varianceX = 0.0;
+		for (size_t i = 0; i < samples.size(); i++)
+		{
+			double dx = std::log((double)samples[i]) - meanX;
+			covariance += dx * (std::log(variances[i]) - meanY);
+			varianceX += dx * dx;
+		}
+		return covariance / varianceX;
+	}
+
+	// bucket variance over 512 pixels for 4 to 1024 samples per pixel, prints the variances and returns the convergence rates
+	static void MeasureConvergence(bool indirect, std::vector<double>& teaLcgVariances, std::vector<double>& sobolVariances, double& teaLcgRate, double& sobolRate)
+	{
+		const unsigned int numPixels = 512;
+
+		// reference from a long run of the old generator
+		unsigned int draws = 0;
+		double reference = 0.0;
+		for (unsigned int pixel = 0; pixel < 64; pixel++)
+			reference += EstimateTeaLcg(100000 + pixel, 16384, indirect, draws);
+		reference /= 64.0;
+
+		draws = 0;
+		unsigned int numPaths = 0;
+		std::vector<unsigned int> sampleCounts;
+		for (unsigned int numSamples = 4; numSamples <= 1024; numSamples *= 4)
+		{
+			std::vector<float> teaLcg(numPixels), sobol(numPixels);
+			for (unsigned int pixel = 0; pixel < numPixels; pixel++)
+			{
+				teaLcg[pixel] = EstimateTeaLcg(pixel, numSamples, indirect, draws);
+				sobol[pixel] = EstimateSobol(pixel, numSamples, indirect);
+			}
+			numPaths += numPixels * numSamples;
+
+			sampleCounts.push_back(numSamples);
+			teaLcgVariances.push_back(Variance(teaLcg, reference));
+			sobolVariances.push_back(Variance(sobol, reference));
+
+			std::cout << "[          ] " << numSamples << " spp: tea/lcg variance " << teaLcgVariances.back() << ", sobol variance " << sobolVariances.back() << std::endl;
+		}
+
+		teaLcgRate = ConvergenceRate(sampleCounts, teaLcgVariances);
+		sobolRate = ConvergenceRate(sampleCounts, sobolVariances);
+		std::cout << "[          ] convergence rate: tea/lcg N^" << teaLcgRate << ", sobol N^" << sobolRate << std::endl;
+		std::cout << "[          ] tea/lcg draws per path: " << (double)draws / numPaths << " (sobol: 5)" << std::endl;
+	}
+};
+
+TEST_F(sampler_test, ValuesInUnitInterval)
+{
+	for (unsigned int pixel = 0; pixel < 64; pixel++)
+	{
+		for (unsigned int s = 0; s < 256; s++)
+		{
+			float u1, u2;
+			sample_2d(sampler_pixel_key(pixel, 3), s, pixel % 7, u1, u2);
+			EXPECT_GE(u1, 0.0f);
+			EXPECT_LT(u1, 1.0f);
+			EXPECT_GE(u2, 0.0f);
+			EXPECT_LT(u2, 1.0f);
+		}
+	}
+}
+
+TEST_F(sampler_test, PrefixesAreStratified)
+{
+	// every power of two prefix has exactly one sample in each elementary interval of its size
+	for (unsigned int dimension = 0; dimension < 4; dimension++)
+	{
+		unsigned int pixelKey = sampler_pixel_key(17, 5);
+		for (unsigned int log2Samples = 0; log2Samples <= 8; log2Samples++)
+		{
+			unsigned int numSamples = 1u << log2Samples;
+			for (unsigned int log2Columns = 0; log2Columns <= log2Samples; log2Columns++)
+			{
+				unsigned int columns = 1u << log2Columns;
+				unsigned int rows = numSamples / columns;
+
+				std::vector<unsigned int> counts(numSamples, 0);
+				for (unsigned int s = 0; s < numSamples; s++)
+				{
+					float u1, u2;
+					sample_2d(pixelKey, s, dimension, u1, u2);
+					counts[(unsigned int)(u2 * rows) * columns + (unsigned int)(u1 * columns)]++;
+				}
+
+				for (unsigned int cell = 0; cell < numSamples; cell++)
+					ASSERT_EQ(1u, counts[cell]) << "dimension " << dimension << ", " << numSamples << " samples, " << columns << " columns";
+			}
+		}
+	}
+}
+
+TEST_F(sampler_test, DimensionsAreDecorrelated)
+{
+	// the same sample index must not land in the same cell of two dimensions
+	unsigned int pixelKey = sampler_pixel_key(3, 9);
+	unsigned int equalCells = 0;
+	for (unsigned int s = 0; s < 1024; s++)
+	{
+		float a1, a2, b1, b2;
+		sample_2d(pixelKey, s, 0, a1, a2);
+		sample_2d(pixelKey, s, 1, b1, b2);
+		if ((unsigned int)(a1 * 8.0f) == (unsigned int)(b1 * 8.0f))
+			equalCells++;
+	}
+	EXPECT_NEAR(1024.0 / 8.0, (double)equalCells, 40.0);
+}
+
+TEST_F(sampler_test, ConcentricDiskIsUniform)
+{
+	const unsigned int resolution = 256;
+	unsigned int inner = 0;
+	for (unsigned int y = 0; y < resolution; y++)
+	{
+		for (unsigned int x = 0; x < resolution; x++)
+		{
+			float u1 = (x + 0.5f) / resolution;
+			float u2 = (y + 0.5f) / resolution;
+
+			float dx, dy;
+			concentric_sample_disk(u1, u2, dx, dy);
+			float radius = std::sqrt(dx * dx + dy * dy);
+			ASSERT_LE(radius, 1.0f + 1e-5f);
+
+			if (radius < 0.5f)
+				inner++;
+		}
+	}
+
+	// the inner disk covers a quarter of the area
+	EXPECT_NEAR(0.25, (double)inner / (resolution * resolution), 0.005);
+}
+
+TEST_F(sampler_test, PixelFootprintConvergesFaster)
+{
+	// only the depth edge inside the pixel footprint, a 2d integrand with a discontinuity
+	std::vector<double> teaLcgVariances, sobolVariances;
+	double teaLcgRate, sobolRate;
+	MeasureConvergence(false, teaLcgVariances, sobolVariances, teaLcgRate, sobolRate);
+
+	EXPECT_LT(teaLcgRate, -0.8);
+	EXPECT_LT(sobolRate, -1.3);
+	EXPECT_LT(sobolVariances.back(), teaLcgVariances.back() * 0.25);
+}
+
+TEST_F(sampler_test, PathBucketVarianceIsLower)
+{
+	// the bounce and russian roulette use their own dimensions, the cross terms converge like random sampling
+	std::vector<double> teaLcgVariances, sobolVariances;
+	double teaLcgRate, sobolRate;
+	MeasureConvergence(true, teaLcgVariances, sobolVariances, teaLcgRate, sobolRate);
+
+	EXPECT_LT(sobolRate, -0.9);
+	for (size_t i = 0; i < sobolVariances.size(); i++)
+		EXPECT_LT(sobolVariances[i], teaLcgVariances[i] * 0.75);
+}
@@ -0,0 +1,217 @@
+#include <gmock/gmock.h>
+
+#include <tof_correlation.h>
+
+#include "legacy_rect_buckets.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+class tof_correlation_test: public testing::Test
+{
+public:
+	static double SpeedOfLight()
+	{
+		return 299792458.0;
+	}
+
+	static double Pi()
+	{
+		return 3.14159265358979323846;
+	}
+
+	// triangular correlation of a 50% duty cycle square wave with a window of half a period
+	static double ExpectedRectBucket(double frequency, double deltaTime, double windowStart)
+	{
+		const double period = 1.0 / frequency;
+		double offset = std::fmod(deltaTime - windowStart, period);
+		if (offset < 0.0)
+			offset += period;
+		offset = std::min(offset, period - offset);
+		return 1.0 - offset / (0.5 * period);
+	}
+};
+
+TEST_F(tof_correlation_test, PulseBucketsMatchPathLength)
+{
+	const double pulseWidth = 50e-9;
+	const tof_modulation<double> modulation = tof_make_pulse_modulation(pulseWidth);
+
+	for (double pathLength = 0.0; pathLength <= SpeedOfLight() * pulseWidth; pathLength += 0.25)
+	{
+		const double deltaTime = pathLength / SpeedOfLight();
+
+		tof_buckets<tof_pulse_model, double> buckets = tof_make_buckets<tof_pulse_model, double>();
+		tof_accumulate(modulation, deltaTime, 2.0, buckets);
+
+		EXPECT_NEAR(2.0 * (1.0 - deltaTime / pulseWidth), buckets.value[0], 1e-9);
+		EXPECT_NEAR(2.0 * (deltaTime / pulseWidth), buckets.value[1], 1e-9);
+		EXPECT_NEAR(pathLength * 0.5, tof_distance(modulation, buckets), 1e-6);
+	}
+}
+
+TEST_F(tof_correlation_test, PulseOutsideWindowsIsIgnored)
+{
+	const double pulseWidth = 50e-9;
+	const tof_modulation<double> modulation = tof_make_pulse_modulation(pulseWidth);
+
+	tof_buckets<tof_pulse_model, double> buckets = tof_make_buckets<tof_pulse_model, double>();
+	tof_accumulate(modulation, 2.5 * pulseWidth, 1.0, buckets);
+	tof_accumulate(modulation, -1.5 * pulseWidth, 1.0, buckets);
+
+	EXPECT_EQ(0.0, buckets.value[0]);
+	EXPECT_EQ(0.0, buckets.value[1]);
+	EXPECT_EQ(0.0, tof_distance(modulation, buckets));
+}
+
+TEST_F(tof_correlation_test, ExposureWindowsAreParameters)
+{
+	// windows twice as long as the pulse capture it completely until it leaves the first window
+	const double pulseWidth = 10e-9;
+	tof_modulation<double> modulation = tof_make_pulse_modulation(pulseWidth);
+	modulation.exposure = 2.0 * pulseWidth;
+	modulation.window_start[1] = 2.0 * pulseWidth;
+
+	tof_buckets<tof_pulse_model, double> buckets = tof_make_buckets<tof_pulse_model, double>();
+	tof_accumulate(modulation, 0.5 * pulseWidth, 1.0, buckets);
+	EXPECT_NEAR(1.0, buckets.value[0], 1e-12);
+	EXPECT_NEAR(0.0, buckets.value[1], 1e-12);
+
+	buckets = tof_make_buckets<tof_pulse_model, double>();
+	tof_accumulate(modulation, 1.25 * pulseWidth, 1.0, buckets);
+	EXPECT_NEAR(0.75, buckets.value[0], 1e-12);
+	EXPECT_NEAR(0.25, buckets.value[1], 1e-12);
+}
+
+TEST_F(tof_correlation_test, RectBucketsAreTriangular)
+{
+	const double frequencies[3] = { 16e6, 80e6, 120e6 };
+	for (int f = 0; f < 3; f++)
+	{
+		const tof_modulation<double> modulation = tof_make_modulation(frequencies[f]);
+
+		// covers several ambiguity ranges
+		for (double pathLength = 0.0; pathLength < 60.0; pathLength += 0.0173)
+		{
+			const double deltaTime = pathLength / SpeedOfLight();
+
+			tof_buckets<tof_rect_model, double> buckets = tof_make_buckets<tof_rect_model, double>();
+			tof_accumulate(modulation, deltaTime, 1.0, buckets);
+
+			for (int i = 0; i < 4; i++)
+				ASSERT_NEAR(ExpectedRectBucket(frequencies[f], deltaTime, modulation.window_start[i]), buckets.value[i], 1e-6) << "bucket " << i << " at " << pathLength << " m, " << frequencies[f] << " Hz";
+		}
+	}
+}
+
+TEST_F(tof_correlation_test, RectMatchesLegacyLoop)
+{
+	const double frequency = 20e6;
+	const tof_modulation<double> modulation = tof_make_modulation(frequency);
+
+	for (double pathLength = 0.01; pathLength < 40.0; pathLength += 0.031)
+	{
+		const double deltaTime = pathLength / SpeedOfLight();
+
+		double legacy[4] = { 0.0, 0.0, 0.0, 0.0 };
+		LegacyRectBuckets(frequency, deltaTime, 0.7, legacy);
+
+		tof_buckets<tof_rect_model, double> buckets = tof_make_buckets<tof_rect_model, double>();
+		tof_accumulate(modulation, deltaTime, 0.7, buckets);
+
+		for (int i = 0; i < 4; i++)
+			ASSERT_NEAR(legacy[i], buckets.value[i], 1e-6) << "bucket " << i << " at " << pathLength << " m";
+	}
+}
+
+TEST_F(tof_correlation_test, SineBucketsMatchCorrelation)
+{
+	const double frequency = 16e6;
+	const tof_modulation<double> modulation = tof_make_modulation(frequency);
+	const double ambiguityRange = SpeedOfLight() / (2.0 * frequency);
+
+	for (double distance = 0.0; distance < ambiguityRange; distance += 0.05)
+	{
+		const double deltaTime = 2.0 * distance / SpeedOfLight();
+		const double phi = 2.0 * Pi() * frequency * deltaTime;
+
+		tof_buckets<tof_sine_model, double> buckets = tof_make_buckets<tof_sine_model, double>();
+		tof_accumulate(modulation, deltaTime, 3.0, buckets);
+
+		// windows at 0, 180, 90 and 270 degrees
+		EXPECT_NEAR(3.0 * (0.5 + std::cos(phi) / Pi()), buckets.value[0], 1e-9);
+		EXPECT_NEAR(3.0 * (0.5 - std::cos(phi) / Pi()), buckets.value[1], 1e-9);
+		EXPECT_NEAR(3.0 * (0.5 + std::sin(phi) / Pi()), buckets.value[2], 1e-9);
+		EXPECT_NEAR(3.0 * (0.5 - std::sin(phi) / Pi()), buckets.value[3], 1e-9);
+
+		// the sine model has no systematic error
+		EXPECT_NEAR(distance, tof_distance(modulation, buckets), 1e-6);
+	}
+}
+
+TEST_F(tof_correlation_test, RectDistanceHasBoundedWiggling)
+{
+	const double frequency = 16e6;
+	const tof_modulation<double> modulation = tof_make_modulation(frequency);
+	const double ambiguityRange = SpeedOfLight() / (2.0 * frequency);
+
+	double maxError = 0.0;
+	for (double distance = 0.0; distance < ambiguityRange; distance += 0.01)
+	{
+		tof_buckets<tof_rect_model, double> buckets = tof_make_buckets<tof_rect_model, double>();
+		tof_accumulate(modulation, 2.0 * distance / SpeedOfLight(), 1.0, buckets);
+
+		double error = std::fabs(tof_distance(modulation, buckets) - distance);
+		maxError = std::max(maxError, std::min(error, ambiguityRange - error));
+	}
+
+	// the four phase decoding of a triangular correlation has a phase error of about 0.071 rad
+	std::cout << "[          ] rect wiggling error at 16 MHz: " << maxError * 1000.0 << " mm" << std::endl;
+	EXPECT_GT(maxError, 0.01);
+	EXPECT_LT(maxError, 0.075 / (2.0 * Pi()) * ambiguityRange);
+}
+
+TEST_F(tof_correlation_test, AmbientIsSpreadOverAllBuckets)
+{
+	tof_buckets<tof_pulse_model, float> pulse = tof_make_buckets<tof_pulse_model, float>();
+	tof_buckets<tof_rect_model, float> rect = tof_make_buckets<tof_rect_model, float>();
+	tof_buckets<tof_sine_model, float> sine = tof_make_buckets<tof_sine_model, float>();
+
+	tof_accumulate_ambient(2.0f, pulse);
+	tof_accumulate_ambient(2.0f, rect);
+	tof_accumulate_ambient(2.0f, sine);
+
+	for (int i = 0; i < 2; i++)
+		EXPECT_FLOAT_EQ(1.0f, pulse.value[i]);
+	for (int i = 0; i < 4; i++)
+	{
+		EXPECT_FLOAT_EQ(0.5f, rect.value[i]);
+		EXPECT_FLOAT_EQ(1.0f, sine.value[i]);
+	}
+}
+
+TEST_F(tof_correlation_test, FloatMatchesDouble)
+{
+	const tof_modulation<float> modulationFloat = tof_make_modulation(20e6f);
+	const tof_modulation<double> modulationDouble = tof_make_modulation(20e6);
+
+	for (float pathLength = 0.1f; pathLength < 30.0f; pathLength += 0.37f)
+	{
+		tof_buckets<tof_rect_model, float> rectFloat = tof_make_buckets<tof_rect_model, float>();
+		tof_buckets<tof_rect_model, double> rectDouble = tof_make_buckets<tof_rect_model, double>();
+		tof_buckets<tof_sine_model, float> sineFloat = tof_make_buckets<tof_sine_model, float>();
+		tof_buckets<tof_sine_model, double> sineDouble = tof_make_buckets<tof_sine_model, double>();
+
+		tof_accumulate(modulationFloat, tof_travel_time(pathLength), 1.0f, rectFloat);
+		tof_accumulate(modulationDouble, tof_travel_time((double)pathLength), 1.0, rectDouble);
+		tof_accumulate(modulationFloat, tof_travel_time(pathLength), 1.0f, sineFloat);
+		tof_accumulate(modulationDouble, tof_travel_time((double)pathLength), 1.0, sineDouble);
+
+		for (int i = 0; i < 4; i++)
+		{
+			EXPECT_NEAR(rectDouble.value[i], rectFloat.value[i], 1e-4);
+			EXPECT_NEAR(sineDouble.value[i], sineFloat.value[i], 1e-4);
+		}
+	}
+}
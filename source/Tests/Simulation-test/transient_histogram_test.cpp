@@ -0,0 +1,128 @@
+#include <gmock/gmock.h>
+
+#include <transient_histogram.h>
+
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+class transient_histogram_test: public testing::Test
+{
+public:
+	static const unsigned int Bins = 256;
+
+	static float BinWidth()
+	{
+		return 0.04f;
+	}
+
+	// direct return, a weaker multipath return and ambient light, as the renderer sees them at one pixel
+	struct Returns
+	{
+		float pathLength[2];
+		float intensity[2];
+		float ambient;
+	};
+
+	static Returns RandomReturns(std::mt19937& generator)
+	{
+		std::uniform_real_distribution<float> direct(0.5f, 9.0f);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+		Returns returns;
+		returns.pathLength[0] = direct(generator);
+		returns.pathLength[1] = returns.pathLength[0] + 0.2f + 0.8f * unit(generator);
+		returns.intensity[0] = 0.2f + unit(generator);
+		returns.intensity[1] = 0.3f * returns.intensity[0] * unit(generator);
+		returns.ambient = unit(generator);
+		return returns;
+	}
+
+	template <typename Model>
+	static tof_buckets<Model, float> DirectBuckets(const tof_modulation<float>& modulation, const Returns& returns)
+	{
+		tof_buckets<Model, float> buckets = tof_make_buckets<Model, float>();
+		for (int i = 0; i < 2; i++)
+			tof_accumulate(modulation, tof_travel_time(returns.pathLength[i]), returns.intensity[i], buckets);
+		tof_accumulate_ambient(returns.ambient, buckets);
+		return buckets;
+	}
+
+	template <typename Model>
+	static tof_buckets<Model, float> HistogramBuckets(const tof_modulation<float>& modulation, const Returns& returns)
+	{
+		std::vector<float> histogram(Bins, 0.0f);
+		for (int i = 0; i < 2; i++)
+			transient_accumulate(returns.pathLength[i], returns.intensity[i], BinWidth(), Bins, &histogram[0]);
+
+		std::vector<float> kernel(Model::num_buckets * Bins);
+		transient_correlation_kernel<Model>(modulation, Bins, BinWidth(), &kernel[0]);
+		return transient_correlate<Model>(&kernel[0], Bins, &histogram[0], returns.ambient);
+	}
+
+	// largest difference of the distance from the histogram to the distance of the directly correlated buckets
+	template <typename Model>
+	static float MaxDistanceError(const tof_modulation<float>& modulation)
+	{
+		std::mt19937 generator(11);
+		float maxError = 0.0f;
+		for (int i = 0; i < 1000; i++)
+		{
+			Returns returns = RandomReturns(generator);
+			float direct = tof_distance(modulation, DirectBuckets<Model>(modulation, returns));
+			float histogram = tof_distance(modulation, HistogramBuckets<Model>(modulation, returns));
+			maxError = std::max(maxError, std::abs(tof_distance_difference<Model>(modulation, histogram, direct)));
+		}
+		return maxError;
+	}
+};
+
+const unsigned int transient_histogram_test::Bins;
+
+TEST_F(transient_histogram_test, SplitKeepsIntensityAndMean)
+{
+	std::vector<float> histogram(Bins, 0.0f);
+	transient_accumulate(3.61f, 2.0f, BinWidth(), Bins, &histogram[0]);
+
+	float sum = 0.0f, mean = 0.0f;
+	for (unsigned int bin = 0; bin < Bins; bin++)
+	{
+		sum += histogram[bin];
+		mean += histogram[bin] * bin * BinWidth();
+	}
+	EXPECT_NEAR(2.0f, sum, 1e-5f);
+	EXPECT_NEAR(3.61f, mean / sum, 1e-4f);
+}
+
+TEST_F(transient_histogram_test, ClampsPathLength)
+{
+	std::vector<float> histogram(Bins, 0.0f);
+	transient_accumulate(-1.0f, 1.0f, BinWidth(), Bins, &histogram[0]);
+	transient_accumulate(1000.0f, 2.0f, BinWidth(), Bins, &histogram[0]);
+
+	EXPECT_EQ(1.0f, histogram[0]);
+	EXPECT_EQ(2.0f, histogram[Bins - 1]);
+}
+
+TEST_F(transient_histogram_test, DemodulatesEveryModel)
+{
+	// bins of 4 cm path length, the distance is half of it
+	const float frequencies[] = { 10e6f, 20e6f, 30e6f, 60e6f };
+	for (float frequency : frequencies)
+	{
+		const tof_modulation<float> modulation = tof_make_modulation(frequency);
+
+		float rect = MaxDistanceError<tof_rect_model>(modulation);
+		float sine = MaxDistanceError<tof_sine_model>(modulation);
+		std::cout << "[          ] " << frequency * 1e-6f << " MHz: rect " << rect * 1000.0f << " mm, sin " << sine * 1000.0f << " mm" << std::endl;
+
+		EXPECT_LT(rect, 0.002f);
+		EXPECT_LT(sine, 0.002f);
+	}
+
+	const tof_modulation<float> pulse = tof_make_pulse_modulation(50e-9f);
+	float error = MaxDistanceError<tof_pulse_model>(pulse);
+	std::cout << "[          ] pulse 50 ns: " << error * 1000.0f << " mm" << std::endl;
+	EXPECT_LT(error, 0.002f);
+}